@@ -74,12 +74,26 @@ BitmapImage::BitmapImage(ImageObserver* observer)
     , m_decodedPropertiesSize(0)
     , m_haveFrameCount(false)
     , m_frameCount(0)
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    , m_decodeJob(0)
+    , m_decodeSavedBytes(0)
+#endif
+//-EAWebKitChange
 {
     initPlatformData();
 }
 
 BitmapImage::~BitmapImage()
 {
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    cancelAsyncDecode();
+    setDecodedFrameSize(IntSize());
+#endif
+//-EAWebKitChange
     invalidatePlatformData();
     stopAnimation();
 }
@@ -87,6 +101,15 @@ BitmapImage::~BitmapImage()
 void BitmapImage::destroyDecodedData(bool destroyAll)
 {
     int framesCleared = 0;
+
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    // The decoder of a pending decode would bring the frame right back.
+    if (destroyAll)
+        cancelAsyncDecode();
+#endif
+//-EAWebKitChange
   
 //+EAWebKitChange
 //5/23/2012
@@ -105,12 +128,16 @@ void BitmapImage::destroyDecodedData(bool destroyAll)
         }
         else if (m_frames[i].m_frame)
         {
-            releasedSize -= frameBytes(m_size);
+            releasedSize -= frameBytes(decodedFrameSize(i));
         }
 #endif
         if (m_frames[i].clear(false))
           ++framesCleared;
     }
+#if PLATFORM(EA)
+    if (clearBeforeFrame)
+        setDecodedFrameSize(IntSize());
+#endif
     destroyMetadataAndNotify(framesCleared, releasedSize);
 //-EAWebKitChange 
 
@@ -147,6 +174,14 @@ void BitmapImage::destroyMetadataAndNotify(int framesCleared, int releasedSize)
 
 void BitmapImage::cacheFrame(size_t index)
 {
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    // Someone needs the frame now. Rather than decoding it a second time, take it from the worker.
+    finishAsyncDecode();
+#endif
+//-EAWebKitChange
+
     size_t numFrames = frameCount();
     ASSERT(m_decodedSize == 0 || numFrames > 1);
     
@@ -176,7 +211,18 @@ void BitmapImage::cacheFrame(size_t index)
         if ((m_frames[index].m_isComplete) &&  (!shouldAnimate()))
             compressSize = compressFrame(index);
 #endif        
+//-EAWebKitChange
+
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+        // The first frame may have been decoded to its display size.
+        if (!index)
+            setDecodedFrameSize(m_source.decodedFrameSize());
+        int deltaBytes = compressSize ? compressSize : frameBytes(index ? frameSize : decodedFrameSize(0));
+#else
         int deltaBytes = compressSize ? compressSize : frameBytes(frameSize);
+#endif
 //-EAWebKitChange
 
         m_decodedSize += deltaBytes;
@@ -238,6 +284,13 @@ bool BitmapImage::dataChanged(bool allDataReceived)
     // Because we're modifying the current frame, clear its (now possibly
     // inaccurate) metadata as well.
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    cancelAsyncDecode();
+#endif
+//-EAWebKitChange
+
 //+EAWebKitChange
 //5/23/2012
     // We need to get the compression buffer size that will be released before we clear.
@@ -246,6 +299,14 @@ bool BitmapImage::dataChanged(bool allDataReceived)
     if (!m_frames.isEmpty())
     {
         releasedSize -= m_frames[m_frames.size() - 1].m_compressedSize;
+
+        // A still image's frame may be smaller than destroyMetadataAndNotify would assume.
+        if (m_frames.size() == 1)
+        {
+            if (!releasedSize && m_frames[0].m_frame)
+                releasedSize -= frameBytes(decodedFrameSize(0));
+            setDecodedFrameSize(IntSize());
+        }
     }
 #endif
 
@@ -339,6 +400,15 @@ bool BitmapImage::frameHasAlphaAtIndex(size_t index)
     if (index >= frameCount())
         return true;
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    // Asking would wait for the frame being decoded. Until it is in, nothing is drawn, which is as good as all alpha.
+    if (m_decodeJob)
+        return true;
+#endif
+//-EAWebKitChange
+
     if (index >= m_frames.size() || !m_frames[index].m_haveMetadata)
         cacheFrame(index);
 
@@ -64,6 +64,12 @@ namespace WTF {
 namespace WebCore {
 
 template <typename T> class Timer;
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+struct ImageDecodeJob;
+#endif
+//-EAWebKitChange
 
 // ================================================
 // FrameData Class
@@ -183,7 +189,30 @@ public:
 #endif
 //-EAWebKitChange
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    // Asynchronous decoding (Parameters::mEnableAsyncImageDecoding). The first frame of a complete still image is decoded
+    // on a worker thread and the image draws nothing until it is in, at which point the observer is told the image changed.
+    bool decodeCurrentFrameAsync();     // Returns true while the frame is not ready to be drawn.
+    void asyncDecodeCompleted(NativeImageSourcePtr decoder);   // Called by the ImageDecodeQueue, on the main thread.
+
+    // Decoding to display size (Parameters::mEnableDecodeToDisplaySize). Renderers pass the size the whole image is displayed at.
+    // A complete still image is then decoded no larger than that, and decoded again if it later gets displayed larger than its frame.
+    void requestDecodedSize(const IntSize& displaySize);
+    static void getDecodeToDisplaySizeUsage(unsigned& savedBytes, unsigned& reducedImageCount, unsigned& redecodeCount);
+#endif
+//-EAWebKitChange
+
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    // Patterns, canvases and textures sample the frame with the image size, so they need it decoded at full size.
+    virtual NativeImagePtr nativeImageForCurrentFrame() { requestDecodedSize(size()); return frameAtIndex(currentFrame()); }
+#else
     virtual NativeImagePtr nativeImageForCurrentFrame() { return frameAtIndex(currentFrame()); }
+#endif
+//-EAWebKitChange
     bool frameHasAlphaAtIndex(size_t);
     virtual bool currentFrameHasAlpha() { return frameHasAlphaAtIndex(currentFrame()); }
 
@@ -227,6 +256,17 @@ protected:
     // Decodes and caches a frame. Never accessed except internally.
     void cacheFrame(size_t index);
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    void finishAsyncDecode();   // Waits for the pending decode, if any, so that the frame can be used right away.
+    void cancelAsyncDecode();   // Drops the pending decode, if any. The worker finishes it but the result is thrown away.
+
+    IntSize decodedFrameSize(size_t index) const;           // The size of the frame as decoded, which may be smaller than the image.
+    void setDecodedFrameSize(const IntSize& frameSize);     // Records the size the first frame got decoded at, or empty once it is gone.
+#endif
+//-EAWebKitChange
+
     // Called to invalidate cached data.  When |destroyAll| is true, we wipe out
     // the entire frame buffer cache and tell the image source to destroy
     // everything; this is used when e.g. we want to free some room in the image
@@ -328,6 +368,16 @@ protected:
 
     mutable bool m_haveFrameCount;
     size_t m_frameCount;
+
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    ImageDecodeJob* m_decodeJob; // The decode of the first frame on a worker thread, if one is pending.
+    IntSize m_decodeTargetSize; // The largest display size requested so far; empty until a renderer asks.
+    IntSize m_decodedFrameSize; // The size the first frame is decoded at; empty when it is not decoded.
+    unsigned m_decodeSavedBytes; // The bytes the first frame saves by being decoded smaller than the image.
+#endif
+//-EAWebKitChange
 };
 
 }
@@ -84,12 +84,57 @@ void ImageSource::setData(SharedBuffer* data, bool allDataReceived)
         if (m_decoder && s_maxPixelsPerDecodedImage)
             m_decoder->setMaxNumPixels(s_maxPixelsPerDecodedImage);
 #endif
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+        if (m_decoder)
+            m_decoder->setDecodeTargetSize(m_decodeTargetSize);
+#endif
+//-EAWebKitChange
     }
 
     if (m_decoder)
         m_decoder->setData(data, allDataReceived);
 }
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+NativeImageSourcePtr ImageSource::createDecoder(SharedBuffer* data) const
+{
+    NativeImageSourcePtr decoder = static_cast<NativeImageSourcePtr>(ImageDecoder::create(*data, m_alphaOption, m_gammaAndColorProfileOption));
+    if (!decoder)
+        return 0;
+
+#if ENABLE(IMAGE_DECODER_DOWN_SAMPLING)
+    if (s_maxPixelsPerDecodedImage)
+        decoder->setMaxNumPixels(s_maxPixelsPerDecodedImage);
+#endif
+    decoder->setDecodeTargetSize(m_decodeTargetSize);
+    decoder->setData(data, true);
+    return decoder;
+}
+
+void ImageSource::adoptDecoder(NativeImageSourcePtr decoder)
+{
+    delete m_decoder;
+    m_decoder = decoder;
+}
+
+void ImageSource::setDecodeTargetSize(const IntSize& targetSize)
+{
+    m_decodeTargetSize = targetSize;
+    if (m_decoder)
+        m_decoder->setDecodeTargetSize(targetSize);
+}
+
+IntSize ImageSource::decodedFrameSize() const
+{
+    return m_decoder ? m_decoder->scaledSize() : IntSize();
+}
+#endif
+//-EAWebKitChange
+
 String ImageSource::filenameExtension() const
 {
     return m_decoder ? m_decoder->filenameExtension() : String();
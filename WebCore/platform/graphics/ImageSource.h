@@ -31,6 +31,12 @@
 #include <wtf/Forward.h>
 #include <wtf/Noncopyable.h>
 #include <wtf/Vector.h>
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+#include "IntSize.h"
+#endif
+//-EAWebKitChange
 
 #if PLATFORM(WX)
 class wxBitmap;
@@ -202,6 +208,21 @@ public:
 #endif
 //-EAWebKitChange
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    // Asynchronous decoding (see ImageDecodeQueueEA.h). A worker thread decodes with a decoder of its own, made from the
+    // complete data, which then replaces the decoder of the source along with the frame it decoded.
+    NativeImageSourcePtr createDecoder(SharedBuffer* data) const;
+    void adoptDecoder(NativeImageSourcePtr decoder);
+
+    // Decode-to-display-size (see ImageDecoder::setDecodeTargetSize). The target applies to the current decoder and to 
+    // the ones made later.
+    void setDecodeTargetSize(const IntSize& targetSize);
+    IntSize decodedFrameSize() const;   // The size of the decoded first frame, which is smaller than size() when it was reduced.
+#endif
+//-EAWebKitChange
+
 private:
     NativeImageSourcePtr m_decoder;
     AlphaOption m_alphaOption;
@@ -209,6 +230,12 @@ private:
 #if ENABLE(IMAGE_DECODER_DOWN_SAMPLING)
     static unsigned s_maxPixelsPerDecodedImage;
 #endif
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    IntSize m_decodeTargetSize;
+#endif
+//-EAWebKitChange
 };
 
 }
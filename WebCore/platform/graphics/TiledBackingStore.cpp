@@ -25,11 +25,23 @@
 
 #include "GraphicsContext.h"
 #include "TiledBackingStoreClient.h"
+//+EAWebKitChange
+//10/18/2026
+#include <algorithm>
+#include <wtf/CurrentTime.h>
+//-EAWebKitChange
 
 namespace WebCore {
 
 static const int defaultTileDimension = 512;
 
+//+EAWebKitChange
+//10/18/2026
+static const float minPrefetchSpeed = 60.0f; // Backing store pixels per second under which the view is considered at rest.
+static const float prefetchLookAhead = 0.5f; // Seconds of scrolling that the tiles painted ahead should cover.
+static const unsigned maxPrefetchTileCount = 2; // Tiles outside of the visible rect created per update.
+//-EAWebKitChange
+
 static IntPoint innerBottomRight(const IntRect& rect)
 {
     // Actually, the rect does not contain rect.maxX(). Refer to IntRect::contain.
@@ -54,6 +66,12 @@ TiledBackingStore::TiledBackingStore(TiledBackingStoreClient* client, PassOwnPtr
 	, m_tilesNeedUpdate(true)
 	, m_tilesNeedCreation(true)
     //-EAWebKitChange
+    //+EAWebKitChange
+    //10/18/2026
+    , m_tileMemoryBudget(0)
+    , m_prefetchEnabled(false)
+    , m_lastVisibleRectTime(0)
+    //-EAWebKitChange
 {
 }
 
@@ -61,8 +79,14 @@ TiledBackingStore::TiledBackingStore(TiledBackingStoreClient* client, PassOwnPtr
 //3/22/2012
 void TiledBackingStore::UpdateTilesIfNeeded(void)
 {
+	// Cover ahead of the scroll when the view moves fast enough, and all around it otherwise.
+	updateScrollVelocity();
+	FloatPoint trajectoryVector;
+	if (m_prefetchEnabled && m_scrollVelocity.length() >= minPrefetchSpeed)
+		trajectoryVector = m_scrollVelocity;
+
 	// This also takes care of removing any unnecessary tiles (for example, when navigating to a new page with smaller content).
-	coverWithTilesIfNeeded();
+	coverWithTilesIfNeeded(trajectoryVector);
 
 	if(m_tilesNeedCreation)
 	{
@@ -76,6 +100,55 @@ void TiledBackingStore::UpdateTilesIfNeeded(void)
 		updateTileBuffers();
     }
 }
+
+// The velocity is smoothed over a few updates so that a single uneven frame does not flip the direction tiles are painted in.
+void TiledBackingStore::updateScrollVelocity()
+{
+    const IntRect visibleRect = this->visibleRect();
+    const double now = currentTime();
+    const double elapsed = now - m_lastVisibleRectTime;
+
+    // Start over after a resize or zoom, or if the view was not updated for a while.
+    if (visibleRect.size() != m_lastVisibleRect.size() || elapsed <= 0 || elapsed > prefetchLookAhead)
+        m_scrollVelocity = FloatPoint();
+    else {
+        const float velocityX = (visibleRect.x() - m_lastVisibleRect.x()) / elapsed;
+        const float velocityY = (visibleRect.y() - m_lastVisibleRect.y()) / elapsed;
+        m_scrollVelocity = FloatPoint((m_scrollVelocity.x() + velocityX) / 2, (m_scrollVelocity.y() + velocityY) / 2);
+    }
+
+    m_lastVisibleRect = visibleRect;
+    m_lastVisibleRectTime = now;
+}
+
+unsigned TiledBackingStore::maxTileCount() const
+{
+    if (!m_tileMemoryBudget)
+        return 0;
+    const unsigned tileBytes = m_tileSize.width() * m_tileSize.height() * 4;
+    return std::max(m_tileMemoryBudget / tileBytes, 1u);
+}
+
+static bool isFartherTile(const std::pair<double, Tile::Coordinate>& a, const std::pair<double, Tile::Coordinate>& b)
+{
+    return a.first > b.first;
+}
+
+// Removes up to tileCount tiles outside of keepRect, starting with the ones farthest from the visible rect.
+void TiledBackingStore::removeTilesForBudget(const IntRect& keepRect, const IntRect& visibleRect, unsigned tileCount)
+{
+    Vector<std::pair<double, Tile::Coordinate> > candidates;
+    TileMap::iterator end = m_tiles.end();
+    for (TileMap::iterator it = m_tiles.begin(); it != end; ++it) {
+        if (!it->second->rect().intersects(keepRect))
+            candidates.append(std::make_pair(tileDistance(visibleRect, it->first), it->first));
+    }
+
+    std::sort(candidates.begin(), candidates.end(), isFartherTile);
+    const unsigned removeCount = std::min<unsigned>(tileCount, candidates.size());
+    for (unsigned n = 0; n < removeCount; ++n)
+        removeTile(candidates[n].second);
+}
 //-EAWebKitChange
 
 TiledBackingStore::~TiledBackingStore()
@@ -151,15 +224,18 @@ void TiledBackingStore::updateTileBuffers()
         return;
     }
 
-    // FIXME: In single threaded case, tile back buffers could be updated asynchronously 
-    // one by one and then swapped to front in one go. This would minimize the time spent
-    // blocking on tile updates.
+    //+EAWebKitChange
+    //10/18/2026
+    // All the back buffers are updated before any is swapped to front, so that tiles which finish
+    // their update asynchronously (see TileEA) are all in flight together.
     unsigned size = dirtyTiles.size();
     for (unsigned n = 0; n < size; ++n) {
         Vector<IntRect> paintedRects = dirtyTiles[n]->updateBackBuffer();
         paintedArea.append(paintedRects);
-        dirtyTiles[n]->swapBackBufferToFront();
     }
+    for (unsigned n = 0; n < size; ++n)
+        dirtyTiles[n]->swapBackBufferToFront();
+    //-EAWebKitChange
 
     m_client->tiledBackingStorePaintEnd(paintedArea);
 }
@@ -320,6 +396,28 @@ void TiledBackingStore::createTiles()
         }
     }
 
+    //+EAWebKitChange
+    //10/18/2026
+    // Tiles outside of the visible rect are only painted a few per update, the timer below takes care of the rest. 
+    if (shortestDistance > 0 && tilesToCreate.size() > maxPrefetchTileCount)
+        tilesToCreate.shrink(maxPrefetchTileCount);
+
+    // Make room within the tile memory budget by dropping the tiles outside of the cover rect. The visible rect is always
+    // covered, even over budget, but the tiles around it are not created once the budget is reached.
+    if (unsigned maxCount = maxTileCount()) {
+        if (m_tiles.size() + tilesToCreate.size() > maxCount)
+            removeTilesForBudget(coverRect, visibleRect, m_tiles.size() + tilesToCreate.size() - maxCount);
+        if (!shortestDistance && m_tiles.size() + tilesToCreate.size() > maxCount)
+            removeTilesForBudget(visibleRect, visibleRect, m_tiles.size() + tilesToCreate.size() - maxCount);
+
+        const unsigned roomCount = (m_tiles.size() < maxCount) ? (maxCount - m_tiles.size()) : 0;
+        if (shortestDistance > 0 && tilesToCreate.size() >= roomCount) {
+            tilesToCreate.shrink(roomCount);
+            requiredTileCount = tilesToCreate.size(); // Don't come back for tiles that won't fit.
+        }
+    }
+    //-EAWebKitChange
+
     // Now construct the tile(s) within the shortest distance.
     unsigned tilesToCreateCount = tilesToCreate.size();
     for (unsigned n = 0; n < tilesToCreateCount; ++n) {
@@ -378,7 +476,12 @@ void TiledBackingStore::computeCoverAndKeepRect(const IntRect& visibleRect, IntR
         coverRect.inflateY(visibleRect.height() * (m_coverAreaMultiplier - 1) / 2);
         keepRect = coverRect;
 
-        if (m_trajectoryVector == FloatPoint::zero()) {
+        //+EAWebKitChange
+        //10/18/2026 - This test used to be inverted, so only the visible rect was ever covered. Without prefetching that is still the case.
+        if (!m_prefetchEnabled)
+            coverRect = visibleRect;
+        else if (m_trajectoryVector != FloatPoint::zero()) {
+        //-EAWebKitChange
             // A null trajectory vector (no motion) means that tiles for the coverArea will be created.
             // A non-null trajectory vector will shrink the covered rect to visibleRect plus its expansion from its
             // center toward the cover area edges in the direction of the given vector.
@@ -392,9 +495,13 @@ void TiledBackingStore::computeCoverAndKeepRect(const IntRect& visibleRect, IntR
             float trajectoryVectorMultiplier = (m_coverAreaMultiplier - 1) / 2;
 
             // Unite the visible rect with a "ghost" of the visible rect moved in the direction of the trajectory vector.
+            //+EAWebKitChange
+            //10/18/2026 - Move the ghost by the distance the scroll velocity predicts, up to the cover area edges.
+            const float predictedDistance = m_scrollVelocity.length() * prefetchLookAhead;
             coverRect = visibleRect;
-            coverRect.move(coverRect.width() * m_trajectoryVector.x() * trajectoryVectorMultiplier,
-                           coverRect.height() * m_trajectoryVector.y() * trajectoryVectorMultiplier);
+            coverRect.move(m_trajectoryVector.x() * std::min(predictedDistance, coverRect.width() * trajectoryVectorMultiplier),
+                           m_trajectoryVector.y() * std::min(predictedDistance, coverRect.height() * trajectoryVectorMultiplier));
+            //-EAWebKitChange
 
             coverRect.unite(visibleRect);
         }
@@ -465,6 +572,16 @@ void TiledBackingStore::setKeepRect(const IntRect& keepRect)
 
 void TiledBackingStore::removeAllNonVisibleTiles()
 {
+    //+EAWebKitChange
+    //10/18/2026 - Keep the tiles painted ahead of the scroll.
+    if (m_prefetchEnabled) {
+        IntRect coverRect;
+        IntRect keepRect;
+        computeCoverAndKeepRect(visibleRect(), coverRect, keepRect);
+        setKeepRect(coverRect);
+        return;
+    }
+    //-EAWebKitChange
     setKeepRect(visibleRect());
 }
 
@@ -52,6 +52,12 @@ public:
     void SetUseTimers(bool setting) { m_useTimers = setting; }
     //-EAWebKitChange
 
+    //+EAWebKitChange
+    //10/18/2026 - Tile memory budget and predictive tile painting in the scroll direction.
+    void setTileMemoryBudget(unsigned bytes) { m_tileMemoryBudget = bytes; } // 0 means no limit.
+    void setPrefetchEnabled(bool enabled) { m_prefetchEnabled = enabled; }
+    //-EAWebKitChange
+
     TiledBackingStoreClient* client() { return m_client; }
 
     void coverWithTilesIfNeeded(const FloatPoint& panningTrajectoryVector = FloatPoint());
@@ -149,6 +155,19 @@ private:
 	bool m_tilesNeedCreation;
     //-EAWebKitChange
 
+    //+EAWebKitChange
+    //10/18/2026
+    void updateScrollVelocity();
+    unsigned maxTileCount() const;
+    void removeTilesForBudget(const IntRect& keepRect, const IntRect& visibleRect, unsigned tileCount);
+
+    unsigned m_tileMemoryBudget;
+    bool m_prefetchEnabled;
+    IntRect m_lastVisibleRect;
+    double m_lastVisibleRectTime;
+    FloatPoint m_scrollVelocity; // In backing store pixels per second.
+    //-EAWebKitChange
+
     friend class Tile;
 };
 
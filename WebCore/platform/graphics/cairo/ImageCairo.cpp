@@ -99,6 +99,13 @@ BitmapImage::BitmapImage(cairo_surface_t* surface, ImageObserver* observer)
     , m_decodedSize(0)
     , m_haveFrameCount(true)
     , m_frameCount(1)
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    , m_decodeJob(0)
+    , m_decodeSavedBytes(0)
+#endif
+//-EAWebKitChange
 {
     initPlatformData();
 
@@ -127,10 +134,36 @@ void BitmapImage::draw(GraphicsContext* context, const FloatRect& dst, const Flo
 
     startAnimation();
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    // The frame needs no more pixels than the whole image covers on screen at the scale of this draw.
+    const AffineTransform ctm = context->getCTM();
+    const IntSize imageSize = size();
+    requestDecodedSize(IntSize(static_cast<int>(ceil(imageSize.width() * dstRect.width() / srcRect.width() * ctm.xScale())),
+                               static_cast<int>(ceil(imageSize.height() * dstRect.height() / srcRect.height() * ctm.yScale()))));
+
+    // Like an image that is still loading, draw nothing while the frame decodes on a worker thread.
+    if (decodeCurrentFrameAsync())
+        return;
+#endif
+//-EAWebKitChange
+
     cairo_surface_t* image = frameAtIndex(m_currentFrame);
     if (!image) // If it's too early we won't have an image yet.
         return;
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    // srcRect is in image coordinates; a frame decoded to display size covers the same image with fewer pixels.
+    const int frameWidth = cairo_image_surface_get_width(image);
+    const int frameHeight = cairo_image_surface_get_height(image);
+    if (frameWidth != imageSize.width() || frameHeight != imageSize.height())
+        srcRect.scale(static_cast<float>(frameWidth) / imageSize.width(), static_cast<float>(frameHeight) / imageSize.height());
+#endif
+//-EAWebKitChange
+
 //+EAWebKitChange
 //5/30/2012
 #if PLATFORM(EA)
@@ -178,6 +211,19 @@ void BitmapImage::draw(GraphicsContext* context, const FloatRect& dst, const Flo
 void Image::drawPattern(GraphicsContext* context, const FloatRect& tileRect, const AffineTransform& patternTransform,
                         const FloatPoint& phase, ColorSpace colorSpace, CompositeOperator op, const FloatRect& destRect)
 {
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    if (isBitmapImage()) {
+        BitmapImage* bitmapImage = static_cast<BitmapImage*>(this);
+        // The pattern is laid out in image coordinates (see drawPatternToCairoContext), so it takes the full-size frame.
+        bitmapImage->requestDecodedSize(size());
+        if (bitmapImage->decodeCurrentFrameAsync())
+            return;
+    }
+#endif
+//-EAWebKitChange
+
     cairo_surface_t* image = nativeImageForCurrentFrame();
     if (!image) // If it's too early we won't have an image yet.
         return;
@@ -207,6 +253,16 @@ void BitmapImage::checkForSolidColor()
     if (frameCount() > 1)
         return;
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    // Only a 1x1 image is a solid color, and the size is known without decoding the frame (which may be decoding on a worker thread).
+    // cacheFrame checks again once the frame is decoded, in case the size was not known yet.
+    if (size() != IntSize(1, 1))
+        return;
+#endif
+//-EAWebKitChange
+
     cairo_surface_t* frameSurface = frameAtIndex(0);
     if (!frameSurface)
         return;
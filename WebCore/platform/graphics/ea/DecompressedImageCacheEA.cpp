@@ -0,0 +1,217 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "config.h"
+#include "DecompressedImageCacheEA.h"
+
+#include <string.h>
+#include <EAWebKit/EAWebKit.h>
+#include <internal/include/EAWebKitAssert.h>
+#include <internal/include/EAWebkit_p.h>
+
+namespace WebCore 
+{
+
+// Buffers start with a header holding their size, as the surface destroy callback only gets the pixel pointer.
+// 16 bytes keeps the pixels aligned the same way as the allocation.
+static const uint32_t kBufferHeaderSize = 16;
+
+static inline uint32_t GetBufferSize(const unsigned char* pBlock)
+{
+    return *reinterpret_cast<const uint32_t*>(pBlock);
+}
+
+DecompressedImageCache& DecompressedImageCache::GetInstance()
+{
+    static DecompressedImageCache instance;
+    return instance;
+}
+
+DecompressedImageCache::DecompressedImageCache()
+    : mImageList()
+    , mImageMap()
+    , mSize(0)
+    , mPooledBufferCount(0)
+    , mPooledSize(0)
+    , mHits(0)
+    , mPooledBufferReuses(0)
+{
+    memset(mPooledBuffers, 0, sizeof(mPooledBuffers));
+}
+
+DecompressedImageCache::~DecompressedImageCache()
+{
+    Clear();
+}
+
+cairo_surface_t* DecompressedImageCache::Find(void* pCompressedBuffer)
+{
+    if (mImageMap.empty())
+        return NULL;
+
+    DecompressedImageMap::iterator it = mImageMap.find(pCompressedBuffer);
+    if (it == mImageMap.end())
+        return NULL;
+
+    DecompressedImage* pImage = it->second;
+    DecompressedImageList::remove(*pImage);
+    mImageList.push_front(*pImage);
+    ++mHits;
+
+    return cairo_surface_reference(pImage->mpSurface);
+}
+
+void DecompressedImageCache::Add(void* pCompressedBuffer, cairo_surface_t* pSurface, uint32_t size)
+{
+    const uint32_t budget = EA::WebKit::GetParameters().mDecompressedImageCacheSize;
+    if (!budget)
+    {
+        if (!mImageList.empty() || mPooledBufferCount)
+            Clear();    // The cache was turned off.
+        return;
+    }
+
+    if (size > budget)
+        return;
+
+    EAW_ASSERT(mImageMap.find(pCompressedBuffer) == mImageMap.end());
+
+    Trim(budget - size);
+
+    DecompressedImage* pImage = new DecompressedImage(pCompressedBuffer, cairo_surface_reference(pSurface), size);
+    mImageList.push_front(*pImage);
+    mImageMap.insert(DecompressedImageMap::value_type(pCompressedBuffer, pImage));
+    mSize += size;
+}
+
+void DecompressedImageCache::Remove(void* pCompressedBuffer)
+{
+    if (mImageMap.empty())
+        return;
+
+    DecompressedImageMap::iterator it = mImageMap.find(pCompressedBuffer);
+    if (it != mImageMap.end())
+        Remove(it->second);
+}
+
+void DecompressedImageCache::Clear()
+{
+    Trim(0);
+    EAW_ASSERT(mImageMap.empty() && !mSize && !mPooledBufferCount);
+}
+
+unsigned char* DecompressedImageCache::AllocateBuffer(uint32_t size)
+{
+    for (uint32_t i = 0; i < mPooledBufferCount; ++i)
+    {
+        unsigned char* pBlock = mPooledBuffers[i];
+        if (GetBufferSize(pBlock) == size)
+        {
+            memmove(&mPooledBuffers[i], &mPooledBuffers[i + 1], (mPooledBufferCount - i - 1) * sizeof(mPooledBuffers[0]));
+            --mPooledBufferCount;
+            mPooledSize -= size;
+            ++mPooledBufferReuses;
+            return pBlock + kBufferHeaderSize;
+        }
+    }
+
+    unsigned char* pBlock = new unsigned char[size + kBufferHeaderSize];
+    if (!pBlock)
+        return NULL;
+
+    *reinterpret_cast<uint32_t*>(pBlock) = size;
+    return pBlock + kBufferHeaderSize;
+}
+
+void DecompressedImageCache::ReleaseBuffer(unsigned char* pBuffer)
+{
+    unsigned char* pBlock = pBuffer - kBufferHeaderSize;
+    const uint32_t size = GetBufferSize(pBlock);
+
+    // Keep the buffer if it fits next to the cached frames. The oldest pooled buffer makes room if the pool is full.
+    const uint32_t budget = EA::WebKit::GetParameters().mDecompressedImageCacheSize;
+    if ((mSize + mPooledSize + size) <= budget)
+    {
+        if (mPooledBufferCount == kMaxPooledBufferCount)
+            FreePooledBuffer(0);
+
+        mPooledBuffers[mPooledBufferCount++] = pBlock;
+        mPooledSize += size;
+        return;
+    }
+
+    delete [] pBlock;
+}
+
+void DecompressedImageCache::GetUsage(EA::WebKit::ImageCompressionUsageInfo& usageInfo) const
+{
+    usageInfo.mDecompressedCacheHits = mHits;
+    usageInfo.mDecompressedCacheBytes = mSize + mPooledSize;
+    usageInfo.mPooledBufferReuses = mPooledBufferReuses;
+}
+
+void DecompressedImageCache::Remove(DecompressedImage* pImage)
+{
+    mImageMap.erase(pImage->mpCompressedBuffer);
+
+    DecompressedImageList::remove(*pImage);
+    EAW_ASSERT(mSize >= pImage->mSize);
+    mSize -= pImage->mSize;
+
+    // If nothing else holds the surface, this releases its buffer, which may come back to the pool.
+    cairo_surface_destroy(pImage->mpSurface);
+    delete pImage;
+}
+
+void DecompressedImageCache::Trim(uint32_t budget)
+{
+    // Pooled buffers go first, then frames from the least recently used end.
+    while ((mSize + mPooledSize) > budget)
+    {
+        if (mPooledBufferCount)
+            FreePooledBuffer(0);
+        else if (!mImageList.empty())
+            Remove(&mImageList.back());
+        else
+            break;
+    }
+}
+
+void DecompressedImageCache::FreePooledBuffer(uint32_t index)
+{
+    EAW_ASSERT(index < mPooledBufferCount);
+
+    unsigned char* pBlock = mPooledBuffers[index];
+    mPooledSize -= GetBufferSize(pBlock);
+    memmove(&mPooledBuffers[index], &mPooledBuffers[index + 1], (mPooledBufferCount - index - 1) * sizeof(mPooledBuffers[0]));
+    --mPooledBufferCount;
+
+    delete [] pBlock;
+}
+
+} // namespace WebCore
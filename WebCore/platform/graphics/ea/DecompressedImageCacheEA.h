@@ -0,0 +1,98 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef DecompressedImageCacheEA_h
+#define DecompressedImageCacheEA_h
+
+#include <EABase/eabase.h>
+#include <EASTL/hash_map.h>
+#include <EASTL/intrusive_list.h>
+#include <EAWebKit/EAWebkitAllocator.h>
+#include <cairo/cairo.h>
+
+namespace EA { namespace WebKit {
+    struct ImageCompressionUsageInfo;
+}}
+
+namespace WebCore 
+{
+    // A decompressed frame, keyed by the compressed buffer it was restored from.
+    struct DecompressedImage : public eastl::intrusive_list_node
+    {
+        DecompressedImage(void* pCompressedBuffer, cairo_surface_t* pSurface, uint32_t size) : mpCompressedBuffer(pCompressedBuffer), mpSurface(pSurface), mSize(size) { }
+
+        void*            mpCompressedBuffer;
+        cairo_surface_t* mpSurface;     // The cache holds a reference.
+        uint32_t         mSize;         // Bytes of pixel data.
+    };
+
+    // Keeps recently drawn compressed frames decompressed so that images which are drawn every frame (scrolling
+    // backgrounds, sprites) are only restored once. Least recently used frames are evicted to stay within 
+    // Parameters::mDecompressedImageCacheSize. The pixel buffers of destroyed surfaces are pooled within the same 
+    // budget and handed to the next decompression of the same size. Main thread only.
+    class DecompressedImageCache
+    {
+    public:
+        static DecompressedImageCache& GetInstance();
+
+        cairo_surface_t* Find(void* pCompressedBuffer);    // Returns a new reference, or NULL. On success, the frame becomes the most recently used.
+        void Add(void* pCompressedBuffer, cairo_surface_t* pSurface, uint32_t size); // The cache takes its own reference if the frame fits.
+        void Remove(void* pCompressedBuffer);  // Needs to be called before a compressed buffer is released since frames are keyed by its address.
+        void Clear();   // Also frees the pooled buffers.
+
+        // Pixel buffers for decompressed surfaces. AllocateBuffer returns a pooled buffer of the same size if there is one.
+        unsigned char* AllocateBuffer(uint32_t size);
+        void ReleaseBuffer(unsigned char* pBuffer);
+
+        void GetUsage(EA::WebKit::ImageCompressionUsageInfo& usageInfo) const;
+
+    private:
+        DecompressedImageCache();
+        ~DecompressedImageCache();
+
+        void Remove(DecompressedImage* pImage);
+        void Trim(uint32_t budget);
+        void FreePooledBuffer(uint32_t index);
+
+        typedef eastl::intrusive_list<DecompressedImage> DecompressedImageList;
+        typedef eastl::hash_map<void*, DecompressedImage*, eastl::hash<void*>, eastl::equal_to<void*>, EA::WebKit::EASTLAllocator> DecompressedImageMap;
+
+        static const uint32_t kMaxPooledBufferCount = 4;
+
+        DecompressedImageList   mImageList;     // Most recently used in front.
+        DecompressedImageMap    mImageMap;
+        uint32_t                mSize;
+        unsigned char*          mPooledBuffers[kMaxPooledBufferCount];  // Oldest first.
+        uint32_t                mPooledBufferCount;
+        uint32_t                mPooledSize;
+        uint32_t                mHits;
+        uint32_t                mPooledBufferReuses;
+    };
+}
+
+#endif // DecompressedImageCacheEA_h
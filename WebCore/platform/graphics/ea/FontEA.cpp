@@ -32,6 +32,7 @@
 #include "WidthIterator.h"
 #include <cairo/cairo.h>
 #include <EAWebKit/EAWebKit.h>
+#include <EAWebKit/EAWebKitClient.h>
 #include <EAWebKit/EAWebkitAllocator.h>
 #include <internal/include/EAWebKitAssert.h>
 #include <EASTL/fixed_vector.h>
@@ -40,6 +41,21 @@
 #include "PlatformContextCairo.h"
 #include "TextRun.h"
 #include "ShadowBlur.h"
+#include "GlyphRunCacheEA.h"
+
+// SSE2 is always there on x64. On x86 it is checked for at run time.
+#if defined(EA_PROCESSOR_X86_64) || (defined(EA_PROCESSOR_X86) && (defined(_MSC_VER) || defined(__SSE2__)))
+    #define USE_FONT_SSE2 1
+    #include <emmintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #elif !defined(EA_PROCESSOR_X86_64)
+        #include <cpuid.h>
+    #endif
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+    #define USE_FONT_NEON 1
+    #include <arm_neon.h>
+#endif
 
 namespace WebCore {
 
@@ -111,15 +127,18 @@ const uint8_t kAlphaTable[256] = {
     0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xdf, 0xe0, 0xe1, 0xe2, 0xe3, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9,
     0xeb, 0xec, 0xed, 0xee, 0xf0, 0xf1, 0xf2, 0xf3, 0xf5, 0xf6, 0xf7, 0xf9, 0xfb, 0xfc, 0xff, 0xff}; 
 
-static const uint32_t* GetColorTable(uint32_t penRGB)
+// bFiltered is set if the table was built with the alpha filter.
+static const uint32_t* GetColorTable(uint32_t penRGB, bool& bFiltered)
 {
     struct AlphaTable
     {
         uint32_t mColor;            // The color to be pre-multiplied. Should only be RGB value without alpha.
         uint32_t mTable[256];
+        bool     mbFiltered;
 
         AlphaTable()
             : mColor(0xffffffff)    // Init with alpha since alpha should never be set so we can use this to detect init.
+            , mbFiltered(false)
         {
         }
     };  
@@ -131,6 +150,7 @@ static const uint32_t* GetColorTable(uint32_t penRGB)
     if (penRGB == sAlphaTable.mColor)
     {
         // Found. 
+        bFiltered = sAlphaTable.mbFiltered;
         return  sAlphaTable.mTable;
     }
     
@@ -153,6 +173,9 @@ static const uint32_t* GetColorTable(uint32_t penRGB)
         }
     }
     
+    sAlphaTable.mbFiltered = useFilter;
+    bFiltered = useFilter;
+
     sAlphaTable.mTable[0] = 0;  // 0 alpha is always 0 rgb
     if (useFilter)
     {
@@ -175,6 +198,273 @@ static const uint32_t* GetColorTable(uint32_t penRGB)
 }
 #endif
 
+// The pen that glyph rows are composited with.
+struct GlyphPen
+{
+    uint32_t        mPenA;
+    uint32_t        mPenRGB;
+    uint32_t        mAlphaShift;    // ARGB glyphs only. The shift needed to bring the glyph alpha in the first byte.
+    const uint32_t* mpColorTable;   // Only set if USE_FONT_COLOR_TABLE is defined.
+    bool            mbLinearColor;  // The color for an alpha is (alpha << 24) | MultiplyColorAlpha(mPenRGB, alpha), so it can be computed instead of looked up.
+};
+
+EA_FORCE_INLINE void CompositeGlyphPixel(uint32_t& destColor, uint32_t glyphAlpha, const GlyphPen& pen)
+{
+    //+ 2/23/10 YChin - We have switched to using premultiplied colors, so we need to multiply the alpha onto the final color so the Blt
+    uint32_t destAlpha = DivideBy255Rounded(pen.mPenA * glyphAlpha) | (destColor >> 24);
+
+    // Skip this pixel if alpha is 0.
+    if (destAlpha)
+    {
+        // Get the premultiplied alpha from table. Alpha needs to be within 0xff;
+        #ifdef USE_FONT_COLOR_TABLE
+            destColor = pen.mpColorTable[destAlpha];
+        #else
+            uint32_t destRGB = MultiplyColorAlpha(pen.mPenRGB, destAlpha);
+            destColor = (destAlpha << 24 ) | destRGB;
+        #endif
+    }
+}
+
+// This is for the more compact 8bit format. Just passes down the alpha and the pen color provides the RGB
+static void CompositeGlyphRowA8(uint32_t* pDestColor, const uint8_t* pGlyphAlpha, int width, const GlyphPen& pen)
+{
+    for (int x = 0; x < width; ++x)
+        CompositeGlyphPixel(pDestColor[x], pGlyphAlpha[x], pen);
+}
+
+// Normal 32 bit render using the pen color
+static void CompositeGlyphRowARGB(uint32_t* pDestColor, const uint32_t* pGlyphColor, int width, const GlyphPen& pen)
+{
+    for (int x = 0; x < width; ++x)
+        CompositeGlyphPixel(pDestColor[x], (pGlyphColor[x] >> pen.mAlphaShift) & 0xff, pen);
+}
+
+#if defined(USE_FONT_SSE2) || defined(USE_FONT_NEON)
+// Used when the color table is filtered. The alphas are computed 8 at a time and only the colors are looked up one by one.
+EA_FORCE_INLINE void LookUpGlyphColors(uint32_t* pDestColor, const uint16_t* pDestAlpha, const GlyphPen& pen)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        if (pDestAlpha[i])
+            pDestColor[i] = pen.mpColorTable[pDestAlpha[i]];
+    }
+}
+#endif
+
+#if defined(USE_FONT_SSE2)
+
+static bool HasSSE2()
+{
+#if defined(EA_PROCESSOR_X86_64)
+    return true;
+#elif defined(_MSC_VER)
+    int cpuInfo[4];
+    __cpuid(cpuInfo, 1);
+    return (cpuInfo[3] & (1 << 26)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (edx & (1 << 26));
+#endif
+}
+
+// DivideBy255Rounded for 8 16 bit values. Exact for values up to 255 * 255.
+EA_FORCE_INLINE __m128i DivideBy255RoundedSSE2(__m128i a)
+{
+    a = _mm_add_epi16(a, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(a, _mm_srli_epi16(a, 8)), 8);
+}
+
+// Multiplies the pen color by the alpha of 2 pixels, as in MultiplyColorAlpha. penBGRA holds the pen color as 16 bit B, G, R, 255 twice.
+EA_FORCE_INLINE __m128i MultiplyPenColorAlphaSSE2(__m128i penBGRA, __m128i alphaPair)
+{
+    return DivideBy255RoundedSSE2(_mm_mullo_epi16(penBGRA, alphaPair));
+}
+
+// Composites 8 pixels given the glyph alphas in 16 bit lanes.
+EA_FORCE_INLINE void CompositeGlyphPixelsSSE2(uint32_t* pDestColor, __m128i glyphAlpha, __m128i penA, __m128i penBGRA, const GlyphPen& pen)
+{
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i dest0 = _mm_loadu_si128((const __m128i*)pDestColor);
+    const __m128i dest1 = _mm_loadu_si128((const __m128i*)(pDestColor + 4));
+
+    __m128i destAlpha = DivideBy255RoundedSSE2(_mm_mullo_epi16(glyphAlpha, penA));
+    destAlpha = _mm_or_si128(destAlpha, _mm_packs_epi32(_mm_srli_epi32(dest0, 24), _mm_srli_epi32(dest1, 24)));
+
+    const __m128i skipMask = _mm_cmpeq_epi16(destAlpha, zero);
+    if (_mm_movemask_epi8(skipMask) == 0xffff)
+        return;
+
+    if (!pen.mbLinearColor)
+    {
+        uint16_t destAlphas[8];
+        _mm_storeu_si128((__m128i*)destAlphas, destAlpha);
+        LookUpGlyphColors(pDestColor, destAlphas, pen);
+        return;
+    }
+
+    // Spread each alpha over the 4 channels of its pixel, 2 pixels per register.
+    const __m128i alphaLo = _mm_unpacklo_epi16(destAlpha, destAlpha);
+    const __m128i alphaHi = _mm_unpackhi_epi16(destAlpha, destAlpha);
+    const __m128i color0  = _mm_packus_epi16(MultiplyPenColorAlphaSSE2(penBGRA, _mm_unpacklo_epi32(alphaLo, alphaLo)),
+                                             MultiplyPenColorAlphaSSE2(penBGRA, _mm_unpackhi_epi32(alphaLo, alphaLo)));
+    const __m128i color1  = _mm_packus_epi16(MultiplyPenColorAlphaSSE2(penBGRA, _mm_unpacklo_epi32(alphaHi, alphaHi)),
+                                             MultiplyPenColorAlphaSSE2(penBGRA, _mm_unpackhi_epi32(alphaHi, alphaHi)));
+
+    // Pixels with a 0 alpha are left alone.
+    const __m128i skip0 = _mm_unpacklo_epi16(skipMask, skipMask);
+    const __m128i skip1 = _mm_unpackhi_epi16(skipMask, skipMask);
+    _mm_storeu_si128((__m128i*)pDestColor, _mm_or_si128(_mm_andnot_si128(skip0, color0), _mm_and_si128(skip0, dest0)));
+    _mm_storeu_si128((__m128i*)(pDestColor + 4), _mm_or_si128(_mm_andnot_si128(skip1, color1), _mm_and_si128(skip1, dest1)));
+}
+
+EA_FORCE_INLINE __m128i GetPenBGRASSE2(const GlyphPen& pen)
+{
+    const short b = (short)(pen.mPenRGB & 0xff);
+    const short g = (short)((pen.mPenRGB >> 8) & 0xff);
+    const short r = (short)((pen.mPenRGB >> 16) & 0xff);
+    return _mm_setr_epi16(b, g, r, 255, b, g, r, 255);
+}
+
+static void CompositeGlyphRowA8SSE2(uint32_t* pDestColor, const uint8_t* pGlyphAlpha, int width, const GlyphPen& pen)
+{
+    const __m128i zero    = _mm_setzero_si128();
+    const __m128i penA    = _mm_set1_epi16((short)pen.mPenA);
+    const __m128i penBGRA = GetPenBGRASSE2(pen);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        const __m128i glyphAlpha = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(pGlyphAlpha + x)), zero);
+        CompositeGlyphPixelsSSE2(pDestColor + x, glyphAlpha, penA, penBGRA, pen);
+    }
+    CompositeGlyphRowA8(pDestColor + x, pGlyphAlpha + x, width - x, pen);
+}
+
+static void CompositeGlyphRowARGBSSE2(uint32_t* pDestColor, const uint32_t* pGlyphColor, int width, const GlyphPen& pen)
+{
+    const __m128i alphaMask  = _mm_set1_epi32(0xff);
+    const __m128i alphaShift = _mm_cvtsi32_si128((int)pen.mAlphaShift);
+    const __m128i penA       = _mm_set1_epi16((short)pen.mPenA);
+    const __m128i penBGRA    = GetPenBGRASSE2(pen);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        const __m128i glyph0 = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i*)(pGlyphColor + x)), alphaShift), alphaMask);
+        const __m128i glyph1 = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i*)(pGlyphColor + x + 4)), alphaShift), alphaMask);
+        CompositeGlyphPixelsSSE2(pDestColor + x, _mm_packs_epi32(glyph0, glyph1), penA, penBGRA, pen);
+    }
+    CompositeGlyphRowARGB(pDestColor + x, pGlyphColor + x, width - x, pen);
+}
+
+#elif defined(USE_FONT_NEON)
+
+// DivideBy255Rounded for 8 16 bit values. Exact for values up to 255 * 255.
+EA_FORCE_INLINE uint16x8_t DivideBy255RoundedNEON(uint16x8_t a)
+{
+    a = vaddq_u16(a, vdupq_n_u16(128));
+    return vshrq_n_u16(vaddq_u16(a, vshrq_n_u16(a, 8)), 8);
+}
+
+// Composites 8 pixels given the glyph alphas in 16 bit lanes.
+EA_FORCE_INLINE void CompositeGlyphPixelsNEON(uint32_t* pDestColor, uint16x8_t glyphAlpha, const GlyphPen& pen)
+{
+    const uint32x4_t dest0 = vld1q_u32(pDestColor);
+    const uint32x4_t dest1 = vld1q_u32(pDestColor + 4);
+
+    uint16x8_t destAlpha = DivideBy255RoundedNEON(vmulq_n_u16(glyphAlpha, (uint16_t)pen.mPenA));
+    destAlpha = vorrq_u16(destAlpha, vcombine_u16(vmovn_u32(vshrq_n_u32(dest0, 24)), vmovn_u32(vshrq_n_u32(dest1, 24))));
+
+    const uint64x2_t anyAlpha = vreinterpretq_u64_u16(destAlpha);
+    if ((vgetq_lane_u64(anyAlpha, 0) | vgetq_lane_u64(anyAlpha, 1)) == 0)
+        return;
+
+    if (!pen.mbLinearColor)
+    {
+        uint16_t destAlphas[8];
+        vst1q_u16(destAlphas, destAlpha);
+        LookUpGlyphColors(pDestColor, destAlphas, pen);
+        return;
+    }
+
+    // Computes the channels in planar form, then interleaves them as B, G, R, A bytes.
+    const uint8x8_t a = vmovn_u16(destAlpha);
+    const uint8x8_t b = vmovn_u16(DivideBy255RoundedNEON(vmull_u8(a, vdup_n_u8((uint8_t)(pen.mPenRGB & 0xff)))));
+    const uint8x8_t g = vmovn_u16(DivideBy255RoundedNEON(vmull_u8(a, vdup_n_u8((uint8_t)((pen.mPenRGB >> 8) & 0xff)))));
+    const uint8x8_t r = vmovn_u16(DivideBy255RoundedNEON(vmull_u8(a, vdup_n_u8((uint8_t)((pen.mPenRGB >> 16) & 0xff)))));
+
+    const uint8x8x2_t  bg = vzip_u8(b, g);
+    const uint8x8x2_t  ra = vzip_u8(r, a);
+    const uint16x4x2_t lo = vzip_u16(vreinterpret_u16_u8(bg.val[0]), vreinterpret_u16_u8(ra.val[0]));
+    const uint16x4x2_t hi = vzip_u16(vreinterpret_u16_u8(bg.val[1]), vreinterpret_u16_u8(ra.val[1]));
+    const uint32x4_t color0 = vreinterpretq_u32_u16(vcombine_u16(lo.val[0], lo.val[1]));
+    const uint32x4_t color1 = vreinterpretq_u32_u16(vcombine_u16(hi.val[0], hi.val[1]));
+
+    // Pixels with a 0 alpha are left alone.
+    const uint32x4_t skip0 = vceqq_u32(vmovl_u16(vget_low_u16(destAlpha)), vdupq_n_u32(0));
+    const uint32x4_t skip1 = vceqq_u32(vmovl_u16(vget_high_u16(destAlpha)), vdupq_n_u32(0));
+    vst1q_u32(pDestColor, vbslq_u32(skip0, dest0, color0));
+    vst1q_u32(pDestColor + 4, vbslq_u32(skip1, dest1, color1));
+}
+
+static void CompositeGlyphRowA8NEON(uint32_t* pDestColor, const uint8_t* pGlyphAlpha, int width, const GlyphPen& pen)
+{
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+        CompositeGlyphPixelsNEON(pDestColor + x, vmovl_u8(vld1_u8(pGlyphAlpha + x)), pen);
+    CompositeGlyphRowA8(pDestColor + x, pGlyphAlpha + x, width - x, pen);
+}
+
+static void CompositeGlyphRowARGBNEON(uint32_t* pDestColor, const uint32_t* pGlyphColor, int width, const GlyphPen& pen)
+{
+    const int32x4_t  alphaShift = vdupq_n_s32(-(int32_t)pen.mAlphaShift);
+    const uint32x4_t alphaMask  = vdupq_n_u32(0xff);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        const uint32x4_t glyph0 = vandq_u32(vshlq_u32(vld1q_u32(pGlyphColor + x), alphaShift), alphaMask);
+        const uint32x4_t glyph1 = vandq_u32(vshlq_u32(vld1q_u32(pGlyphColor + x + 4), alphaShift), alphaMask);
+        CompositeGlyphPixelsNEON(pDestColor + x, vcombine_u16(vmovn_u32(glyph0), vmovn_u32(glyph1)), pen);
+    }
+    CompositeGlyphRowARGB(pDestColor + x, pGlyphColor + x, width - x, pen);
+}
+
+#endif
+
+typedef void (*CompositeGlyphRowA8Func)(uint32_t* pDestColor, const uint8_t* pGlyphAlpha, int width, const GlyphPen& pen);
+typedef void (*CompositeGlyphRowARGBFunc)(uint32_t* pDestColor, const uint32_t* pGlyphColor, int width, const GlyphPen& pen);
+
+struct GlyphRowCompositors
+{
+    CompositeGlyphRowA8Func   mA8;
+    CompositeGlyphRowARGBFunc mARGB;
+
+    GlyphRowCompositors()
+        : mA8(CompositeGlyphRowA8)
+        , mARGB(CompositeGlyphRowARGB)
+    {
+        #if defined(USE_FONT_SSE2)
+            if (HasSSE2())
+            {
+                mA8   = CompositeGlyphRowA8SSE2;
+                mARGB = CompositeGlyphRowARGBSSE2;
+            }
+        #elif defined(USE_FONT_NEON)
+            mA8   = CompositeGlyphRowA8NEON;
+            mARGB = CompositeGlyphRowARGBNEON;
+        #endif
+    }
+};
+
+// The best compositors for the processor we run on, picked on first use.
+static const GlyphRowCompositors& GetGlyphRowCompositors()
+{
+    static GlyphRowCompositors sCompositors;
+    return sCompositors;
+}
+
 static bool drawGlyphsShadow(GraphicsContext* graphicsContext, float x, float y, float w, float h, cairo_surface_t *surface)
 {
     
@@ -192,23 +482,30 @@ static bool drawGlyphsShadow(GraphicsContext* graphicsContext, float x, float y,
     return true;  
 }
 
-static void drawGlyphsToContext(GraphicsContext* pGraphicsContext, const EA::WebKit::GlyphDrawInfo *glyphs, const int glyphCount, int srcW, int srcH, float x, float y, float xMin, float yMin)
+// Sets up the pen for the fill color of the context.
+static void SetUpGlyphPen(GraphicsContext* pGraphicsContext, GlyphPen& pen)
 {
-    // Set up the intermediate 32bit draw surface.
-    eastl::fixed_vector<uint32_t, 500, true, EA::WebKit::EASTLAllocator> glyphRGBABuffer;
-    const uint32_t dataBufferSize = srcW * srcH;
-    glyphRGBABuffer.reserve(dataBufferSize);
-    memset(glyphRGBABuffer.data(), 0, dataBufferSize * sizeof(uint32_t));
-
-    // Set up the pen color.
     const Color penColor = pGraphicsContext->fillColor();
     uint32_t  penC    = penColor.rgb();
-    uint32_t  penA    = (penC >> 24);
-    uint32_t  penRGB  = (penC & 0x00ffffff);
+
+    pen.mPenA         = (penC >> 24);
+    pen.mPenRGB       = (penC & 0x00ffffff);
+    pen.mAlphaShift   = 0;
+    pen.mpColorTable  = NULL;
+    pen.mbLinearColor = true;
    
     #ifdef USE_FONT_COLOR_TABLE
-    const uint32_t* pColorTable = GetColorTable(penRGB); 
+    bool bFilteredColorTable = false;
+    pen.mpColorTable  = GetColorTable(pen.mPenRGB, bFilteredColorTable); 
+    pen.mbLinearColor = !bFilteredColorTable;
     #endif
+}
+
+// Composites the glyphs into the cleared srcH rows of pDest. destStride is in pixels.
+static void compositeGlyphs(uint32_t* pDest, int destStride, const GlyphPen& penIn, const EA::WebKit::GlyphDrawInfo *glyphs, const int glyphCount, int srcH, float xMin, float yMin)
+{
+    GlyphPen pen(penIn);
+    const GlyphRowCompositors& compositors = GetGlyphRowCompositors();
 
     for (int i = 0; i < glyphCount; ++i)
     {
@@ -218,9 +515,9 @@ static void drawGlyphsToContext(GraphicsContext* pGraphicsContext, const EA::Web
         const int textureSize = (int)gdi.mSize;   
         const int yOffset = (srcH + (int) yMin) - (int)gdi.y1;
 
-        const int bufferIndex = (yOffset * srcW) + (int)(gdi.x1 - xMin);
-        EAW_ASSERT_FORMATTED(bufferIndex >= 0, "Buffer Index is negative. This would corrupt memory. yOffset:%d,destWidth:%u,gdi.x1:%d",yOffset,srcW,(int)gdi.x1);
-        uint32_t*            pDestColor  = glyphRGBABuffer.data() + bufferIndex;
+        const int bufferIndex = (yOffset * destStride) + (int)(gdi.x1 - xMin);
+        EAW_ASSERT_FORMATTED(bufferIndex >= 0, "Buffer Index is negative. This would corrupt memory. yOffset:%d,destWidth:%u,gdi.x1:%d",yOffset,destStride,(int)gdi.x1);
+        uint32_t*            pDestColor  = pDest + bufferIndex;
 
         const int            glyphWidth  = (int) (gdi.x2 - gdi.x1);
         const int            glyphHeight = (int) (gdi.y1 - gdi.y2);			
@@ -233,70 +530,24 @@ static void drawGlyphsToContext(GraphicsContext* pGraphicsContext, const EA::Web
         {
             const uint32_t stride = gdi.mStride >> 2; // >> 2 for 32 bits           
             const uint32_t* pGlyphAlpha = (uint32_t*) ( gdi.mpData + (ty * gdi.mStride) + (tx << 2) );
-            const uint32_t alphaShift = (gdi.mFormat  == EA::WebKit::kBFARGB_FLIP ? 0 : 24);     // To shift needed to bring alpha in first byte.
+            pen.mAlphaShift = (gdi.mFormat  == EA::WebKit::kBFARGB_FLIP ? 0 : 24);     // To shift needed to bring alpha in first byte.
 
-            // Normal 32 bit render using the pen color
             for (int y = 0; y < glyphHeight; ++y)
             {
-                for (int x = 0; x < glyphWidth; ++x)
-                {
-                    uint32_t surfaceAlpha = pDestColor[x] >> 24; 
-                    uint32_t glyphColor = pGlyphAlpha[x]; 
-
-                    // ARGB here
-                    uint32_t glyphAlpha = glyphColor >> alphaShift; 
-                    glyphAlpha &= 0xff;    // Clean out in case of 0 shift case 
-
-                    uint32_t destAlpha = DivideBy255Rounded(penA * glyphAlpha) | surfaceAlpha;
-                        
-                    // Skip this pixel if alpha is 0.
-                    if (destAlpha)
-                    {
-                        // Uncomment to bounds check.
-                        //if (pDestColor + x > glyphRGBABuffer.data() + dataBufferSize)
-                        //{
-                        //    __debugbreak();
-                        //}
-
-                        // Get the premultiplied alpha from table. Alpha needs to be within 0xff;
-                        #ifdef USE_FONT_COLOR_TABLE
-                            pDestColor[x] = pColorTable[destAlpha];
-                        #else
-                            uint32_t destRGB = MultiplyColorAlpha(penRGB, destAlpha);
-                            pDestColor[x] = (destAlpha << 24 ) | destRGB;
-                        #endif
-                    }
-                }
-                pDestColor  += srcW;
+                compositors.mARGB(pDestColor, pGlyphAlpha, glyphWidth, pen);
+                pDestColor  += destStride;
                 pGlyphAlpha += stride;   
             }
         }
         else if(gdi.mFormat == EA::WebKit::kBFGrayscale)              
         {
-            // This is for the more compact 8bit format. Just passes down the alpha and the pen color provides the RGB
             const uint32_t stride = gdi.mStride;
             const uint8_t* pGlyphAlpha = (gdi.mpData) + (ty * stride) + tx;
 
             for (int y = 0; y < glyphHeight; ++y)
             {
-                for (int x = 0; x < glyphWidth; ++x)
-                {
-                    //+ 2/23/10 YChin - We have switched to using premultiplied colors, so we need to multiply the alpha onto the final color so the Blt
-                    uint32_t destAlpha = DivideBy255Rounded(penA * pGlyphAlpha[x]) | (pDestColor[x] >> 24);
-                   
-                    // Skip this pixel if alpha is 0.
-                    if (destAlpha)
-                    {
-                        // Get the premultiplied alpha from table. Alpha needs to be within 0xff;
-                        #ifdef USE_FONT_COLOR_TABLE
-                            pDestColor[x] = pColorTable[destAlpha];
-                        #else
-                            uint32_t destRGB = MultiplyColorAlpha(penRGB, destAlpha);
-                            pDestColor[x] = (destAlpha << 24 ) | destRGB;					
-                        #endif
-                    }
-                }
-                pDestColor  += srcW;
+                compositors.mA8(pDestColor, pGlyphAlpha, glyphWidth, pen);
+                pDestColor  += destStride;
                 pGlyphAlpha += stride;
             }
         }
@@ -305,12 +556,14 @@ static void drawGlyphsToContext(GraphicsContext* pGraphicsContext, const EA::Web
             EAW_ASSERT_FORMATTED(0, "FontEA: unsuported glyph texture format: %d", gdi.mFormat);
         }
      }
+}
 
+// Draws a composited text run surface.
+static void drawGlyphsSurface(GraphicsContext* pGraphicsContext, cairo_surface_t* surface, int srcW, int srcH, float x, float y)
+{
      // Draw the final image using Cairo lib   
      cairo_t* context = pGraphicsContext->platformContext()->cr();
      cairo_save(context);
-     cairo_surface_t *surface = cairo_image_surface_create_for_data((unsigned char*)glyphRGBABuffer.data(), CAIRO_FORMAT_ARGB32, srcW, srcH, srcW * sizeof(uint32_t));
-     EAW_ASSERT(cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS);
      
      // If we pass sub pixel offsets (e.g. 75.5), some Cario interpolation kicks in and can degrade the font quality.
      // So we use pixel grid "snapping" to disable this.  This might cause some jitter if the font is animating/moving slowly. 
@@ -328,7 +581,6 @@ static void drawGlyphsToContext(GraphicsContext* pGraphicsContext, const EA::Web
      //cairo_surface_write_to_png(surface, filepath.c_str());
      //cairo_surface_write_to_png(cairo_get_target(context), filepath.c_str());
      
-     cairo_surface_destroy(surface);
      cairo_restore(context);
  
      // Uncomment to visualize text runs.
@@ -340,6 +592,24 @@ static void drawGlyphsToContext(GraphicsContext* pGraphicsContext, const EA::Web
      //cairo_restore(context);
 }
 
+static void drawGlyphsToContext(GraphicsContext* pGraphicsContext, const EA::WebKit::GlyphDrawInfo *glyphs, const int glyphCount, int srcW, int srcH, float x, float y, float xMin, float yMin)
+{
+    // Set up the intermediate 32bit draw surface.
+    eastl::fixed_vector<uint32_t, 500, true, EA::WebKit::EASTLAllocator> glyphRGBABuffer;
+    const uint32_t dataBufferSize = srcW * srcH;
+    glyphRGBABuffer.reserve(dataBufferSize);
+    memset(glyphRGBABuffer.data(), 0, dataBufferSize * sizeof(uint32_t));
+
+    GlyphPen pen;
+    SetUpGlyphPen(pGraphicsContext, pen);
+    compositeGlyphs(glyphRGBABuffer.data(), srcW, pen, glyphs, glyphCount, srcH, xMin, yMin);
+
+    cairo_surface_t *surface = cairo_image_surface_create_for_data((unsigned char*)glyphRGBABuffer.data(), CAIRO_FORMAT_ARGB32, srcW, srcH, srcW * sizeof(uint32_t));
+    EAW_ASSERT(cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS);
+    drawGlyphsSurface(pGraphicsContext, surface, srcW, srcH, x, y);
+    cairo_surface_destroy(surface);
+}
+
 namespace
 {
     void GetMetrics(EA::WebKit::IFont *font, EA::WebKit::GlyphId *glyphInOut, EA::WebKit::GlyphMetrics *metricsOut)
@@ -416,14 +686,43 @@ void Font::drawGlyphs(GraphicsContext* pGraphicsContext, const SimpleFontData* p
 		EAW_ASSERT_MSG(pFont, "Font is not available");
 		return;
 	}   
+
+    EA::WebKit::ViewProcessInfo processInfo(EA::WebKit::kVProcessTypeDrawGlyph, EA::WebKit::kVProcessStatusNone);
+    processInfo.mSize = glyphCount;
+    NOTIFY_PROCESS_STATUS(processInfo, EA::WebKit::kVProcessStatusStarted);
+
     pFont->BeginDraw();    
 
     EA::WebKit::GlyphMetrics glyphMetrics;
     const GlyphBufferGlyph *glyphs = glyphBuffer.glyphs(glyphIndexBegin);
 
+    GlyphPen pen;
+    SetUpGlyphPen(pGraphicsContext, pen);
+
+    // Look for the run in the run cache first. The cached run holds all of its glyphs, so it is only used if none of them is clipped out.
+    GlyphRunCache& runCache = GlyphRunCache::GetInstance();
+    bool bUseRunCache = (EA::WebKit::GetParameters().mGlyphRunCacheSize != 0);
+    GlyphRunKey runKey(pFont, pGraphicsContext->fillColor().rgb(), !pen.mbLinearColor);
+    if (bUseRunCache)
+    {
+        for (int i = 0; i < glyphCount; ++i)
+            runKey.AddGlyph(glyphs[i], glyphBuffer.advanceAt(glyphIndexBegin + i));
+        runKey.Finish();
+
+        const GlyphRun* pRun = runCache.Find(runKey);
+        if (pRun && (pRun->mXMin >= clipLeft) && (pRun->mXMax <= clipRight))
+        {
+            drawGlyphsSurface(pGraphicsContext, pRun->mpSurface, pRun->mWidth, pRun->mHeight, point.x() + pRun->mXOffset + pRun->mXMin, point.y() - pRun->mYMax);
+            pFont->EndDraw();
+            NOTIFY_PROCESS_STATUS(processInfo, EA::WebKit::kVProcessStatusEnded);
+            return;
+        }
+        bUseRunCache = !pRun;  // Already cached but partially clipped.
+    }
+
     // Collect the glyphs texture info for the text run.
     GlyphDrawInfoArray gdiTextures(glyphCount);
-    pTextSystem->GetGlyphs(pFont, glyphs, glyphCount, gdiTextures.data());
+    bool bCacheable = pTextSystem->GetGlyphs(pFont, glyphs, glyphCount, gdiTextures.data()); // Not if some glyph textures are missing.
     GlyphDrawInfoArray::iterator it(gdiTextures.begin());
     
     GlyphDrawInfoArray gdiArray;     
@@ -465,6 +764,7 @@ void Font::drawGlyphs(GraphicsContext* pGraphicsContext, const SimpleFontData* p
         xMax = FLT_MIN;
         yMin = FLT_MAX;
         yMax = FLT_MIN;
+        bCacheable = false;
     }
 
     offset += glyphBuffer.advanceAt(glyphIndexBegin);
@@ -516,9 +816,14 @@ void Font::drawGlyphs(GraphicsContext* pGraphicsContext, const SimpleFontData* p
             }
             else
             {
+                bCacheable = false;
                 break;  // This break assumes that we are rendering text from left to right.
             }
         }
+        else
+        {
+            bCacheable = false;
+        }
 
         // advanceAt should return a value that is usually equivalent to glyphMetrics.mfHAdvanceX, at least 
         // for most simple Western text. A case where it would be different would be Arabic combining glyphs,
@@ -538,11 +843,32 @@ void Font::drawGlyphs(GraphicsContext* pGraphicsContext, const SimpleFontData* p
         {
             const float x = point.x() + x_offset + xMin;
             const float y = point.y() - yMax;
-            drawGlyphsToContext(pGraphicsContext, gdiArray.data(), gdiArray.size(), destWidth, destHeight, x, y, xMin, yMin);
+
+            GlyphRun* pRun = (bUseRunCache && bCacheable) ? runCache.Add(runKey, destWidth, destHeight) : NULL;
+            if (pRun)
+            {
+                pRun->mXOffset = x_offset;
+                pRun->mXMin = xMin;
+                pRun->mXMax = xMax;
+                pRun->mYMax = yMax;
+
+                cairo_surface_flush(pRun->mpSurface);
+                uint32_t* pDest = (uint32_t*) cairo_image_surface_get_data(pRun->mpSurface);
+                const int destStride = cairo_image_surface_get_stride(pRun->mpSurface) >> 2;
+                compositeGlyphs(pDest, destStride, pen, gdiArray.data(), gdiArray.size(), destHeight, xMin, yMin);
+                cairo_surface_mark_dirty(pRun->mpSurface);
+
+                drawGlyphsSurface(pGraphicsContext, pRun->mpSurface, destWidth, destHeight, x, y);
+            }
+            else
+            {
+                drawGlyphsToContext(pGraphicsContext, gdiArray.data(), gdiArray.size(), destWidth, destHeight, x, y, xMin, yMin);
+            }
         }
     }
 
     pFont->EndDraw();    
+    NOTIFY_PROCESS_STATUS(processInfo, EA::WebKit::kVProcessStatusEnded);
 }
 
 
@@ -24,6 +24,7 @@
 #include "FontPlatformData.h"
 #include "PlatformString.h"
 #include "SharedBuffer.h"
+#include "GlyphRunCacheEA.h"
 
 #include <float.h>
 #include <math.h>
@@ -41,6 +42,7 @@ FontPlatformDataPrivate::~FontPlatformDataPrivate()
 {
 	if(mpFont)
 	{
+		GlyphRunCache::GetInstance().RemoveFont(mpFont);
 		mpFont->Release();
 		mpFont = NULL;
 	}
@@ -0,0 +1,222 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "config.h"
+#include "GlyphRunCacheEA.h"
+
+#include <string.h>
+#include <EAWebKit/EAWebKit.h>
+#include <internal/include/EAWebKitAssert.h>
+#include <internal/include/EAWebkit_p.h>
+
+namespace WebCore 
+{
+
+GlyphRunKey::GlyphRunKey(EA::WebKit::IFont* pFont, uint32_t color, bool bFilteredColor)
+    : mpFont(pFont)
+    , mFontSize(pFont->GetSize())
+    , mColor(color)
+    , mbFilteredColor(bFilteredColor)
+    , mHash(0)
+    , mGlyphData()
+{
+}
+
+void GlyphRunKey::AddGlyph(uint16_t glyph, float advance)
+{
+    uint32_t advanceBits;
+    memcpy(&advanceBits, &advance, sizeof(advanceBits));
+    
+    mGlyphData.push_back(glyph);
+    mGlyphData.push_back(advanceBits);
+}
+
+void GlyphRunKey::Finish()
+{
+    // FNV-1 over the words.
+    uint32_t fontSizeBits;
+    memcpy(&fontSizeBits, &mFontSize, sizeof(fontSizeBits));
+
+    uint32_t hash = 2166136261U;
+    hash = (hash * 16777619) ^ (uint32_t)(uintptr_t)mpFont;
+    hash = (hash * 16777619) ^ fontSizeBits;
+    hash = (hash * 16777619) ^ mColor;
+    hash = (hash * 16777619) ^ (uint32_t)mbFilteredColor;
+    for (GlyphData::const_iterator it = mGlyphData.begin(); it != mGlyphData.end(); ++it)
+        hash = (hash * 16777619) ^ *it;
+
+    mHash = hash ? hash : 1; // 0 marks an empty recent hash slot.
+}
+
+bool GlyphRunKey::operator==(const GlyphRunKey& key) const
+{
+    EAW_ASSERT(mHash && key.mHash); // Finish() missing.
+
+    return (mHash == key.mHash) &&
+           (mpFont == key.mpFont) &&
+           (mFontSize == key.mFontSize) &&
+           (mColor == key.mColor) &&
+           (mbFilteredColor == key.mbFilteredColor) &&
+           (mGlyphData.size() == key.mGlyphData.size()) &&
+           (memcmp(mGlyphData.data(), key.mGlyphData.data(), mGlyphData.size() * sizeof(uint32_t)) == 0);
+}
+
+GlyphRunCache& GlyphRunCache::GetInstance()
+{
+    static GlyphRunCache instance;
+    return instance;
+}
+
+GlyphRunCache::GlyphRunCache()
+    : mRunList()
+    , mRunMap()
+    , mSize(0)
+{
+    memset(mRecentHashes, 0, sizeof(mRecentHashes));
+}
+
+GlyphRunCache::~GlyphRunCache()
+{
+    Clear();
+}
+
+GlyphRun* GlyphRunCache::Find(const GlyphRunKey& key)
+{
+    if (mRunMap.empty())
+        return NULL;
+
+    eastl::pair<GlyphRunMap::iterator, GlyphRunMap::iterator> range = mRunMap.equal_range(key.GetHash());
+    for (GlyphRunMap::iterator it = range.first; it != range.second; ++it)
+    {
+        GlyphRun* pRun = it->second;
+        if (pRun->mKey == key)
+        {
+            GlyphRunList::remove(*pRun);
+            mRunList.push_front(*pRun);
+            return pRun;
+        }
+    }
+    return NULL;
+}
+
+GlyphRun* GlyphRunCache::Add(const GlyphRunKey& key, int width, int height)
+{
+    const uint32_t budget = EA::WebKit::GetParameters().mGlyphRunCacheSize;
+    if (!budget)
+    {
+        if (!mRunList.empty())
+            Clear();    // The cache was turned off.
+        return NULL;
+    }
+
+    // A single run is not allowed to take more than a fraction of the budget. These are usually long paragraph 
+    // lines which would push out many labels.
+    const uint32_t size = (uint32_t)(width * height * sizeof(uint32_t)) + sizeof(GlyphRun) + key.GetSize();
+    if (size > (budget >> 3))
+        return NULL;
+
+    // Only admit runs that were seen recently.
+    uint32_t& recentHash = mRecentHashes[key.GetHash() & (kRecentHashCount - 1)];
+    if (recentHash != key.GetHash())
+    {
+        recentHash = key.GetHash();
+        return NULL;
+    }
+    recentHash = 0;
+
+    Trim(budget - size);
+
+    // Cairo clears new image surfaces.
+    cairo_surface_t* pSurface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    if (cairo_surface_status(pSurface) != CAIRO_STATUS_SUCCESS)
+    {
+        cairo_surface_destroy(pSurface);
+        return NULL;
+    }
+
+    GlyphRun* pRun = new GlyphRun(key);
+    pRun->mpSurface = pSurface;
+    pRun->mWidth = width;
+    pRun->mHeight = height;
+    pRun->mSize = size;
+
+    mRunList.push_front(*pRun);
+    mRunMap.insert(GlyphRunMap::value_type(key.GetHash(), pRun));
+    mSize += size;
+
+    return pRun;
+}
+
+void GlyphRunCache::RemoveFont(EA::WebKit::IFont* pFont)
+{
+    GlyphRunList::iterator it = mRunList.begin();
+    while (it != mRunList.end())
+    {
+        GlyphRun* pRun = &*it;
+        ++it;
+        if (pRun->mKey.GetFont() == pFont)
+            Remove(pRun);
+    }
+}
+
+void GlyphRunCache::Clear()
+{
+    Trim(0);
+    EAW_ASSERT(mRunMap.empty() && !mSize);
+
+    memset(mRecentHashes, 0, sizeof(mRecentHashes));
+}
+
+void GlyphRunCache::Remove(GlyphRun* pRun)
+{
+    eastl::pair<GlyphRunMap::iterator, GlyphRunMap::iterator> range = mRunMap.equal_range(pRun->mKey.GetHash());
+    for (GlyphRunMap::iterator it = range.first; it != range.second; ++it)
+    {
+        if (it->second == pRun)
+        {
+            mRunMap.erase(it);
+            break;
+        }
+    }
+
+    GlyphRunList::remove(*pRun);
+    EAW_ASSERT(mSize >= pRun->mSize);
+    mSize -= pRun->mSize;
+
+    cairo_surface_destroy(pRun->mpSurface);
+    delete pRun;
+}
+
+void GlyphRunCache::Trim(uint32_t budget)
+{
+    // Evict from the least recently used end.
+    while ((mSize > budget) && !mRunList.empty())
+        Remove(&mRunList.back());
+}
+
+} // namespace WebCore
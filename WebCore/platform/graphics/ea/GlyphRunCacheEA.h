@@ -0,0 +1,122 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GlyphRunCacheEA_h
+#define GlyphRunCacheEA_h
+
+#include <EABase/eabase.h>
+#include <EASTL/fixed_vector.h>
+#include <EASTL/hash_map.h>
+#include <EASTL/intrusive_list.h>
+#include <EAWebKit/EAWebkitAllocator.h>
+#include <cairo/cairo.h>
+
+namespace EA { namespace WebKit {
+    class IFont;
+}}
+
+namespace WebCore 
+{
+    // Identifies the pixels of a text run drawn by Font::drawGlyphs: the font, the pen color and the glyph ids with their advances.
+    // The draw position is not part of it as the run is always snapped to the pixel grid before being drawn.
+    class GlyphRunKey
+    {
+    public:
+        GlyphRunKey(EA::WebKit::IFont* pFont, uint32_t color, bool bFilteredColor);
+
+        void AddGlyph(uint16_t glyph, float advance);
+        void Finish();  // Call once all the glyphs are added, before using the key for a look up.
+
+        uint32_t GetHash() const { return mHash; }
+        uint32_t GetSize() const { return (uint32_t)(mGlyphData.capacity() * sizeof(uint32_t)); }
+        EA::WebKit::IFont* GetFont() const { return mpFont; }
+
+        bool operator==(const GlyphRunKey& key) const;
+
+    private:
+        typedef eastl::fixed_vector<uint32_t, 64, true, EA::WebKit::EASTLAllocator> GlyphData;
+
+        EA::WebKit::IFont*  mpFont;
+        float               mFontSize;          // The IFont size can be changed after creation.
+        uint32_t            mColor;             // ARGB fill color.
+        bool                mbFilteredColor;    // If the alpha filter was applied for this color (see Parameters::mEnableFontAlphaFilter).
+        uint32_t            mHash;
+        GlyphData           mGlyphData;         // Glyph id and advance bits pairs.
+    };
+
+    // A composited text run. The extents are the ones Font::drawGlyphs computed for the run, in its pen offset space.
+    struct GlyphRun : public eastl::intrusive_list_node
+    {
+        GlyphRun(const GlyphRunKey& key) : mKey(key), mpSurface(NULL), mWidth(0), mHeight(0), mSize(0), mXOffset(0.0f), mXMin(0.0f), mXMax(0.0f), mYMax(0.0f) { }
+
+        GlyphRunKey      mKey;
+        cairo_surface_t* mpSurface;     // Premultiplied ARGB32 image surface of mWidth x mHeight.
+        int              mWidth;
+        int              mHeight;
+        uint32_t         mSize;         // Bytes charged to the cache budget.
+        float            mXOffset;
+        float            mXMin;
+        float            mXMax;
+        float            mYMax;
+    };
+
+    // A LRU cache of composited text runs so that labels that are repainted without changes (which is most of them
+    // on a typical frame) only cost a blit. Runs are only admitted the second time they are seen within a short window, 
+    // so that text which is drawn once (scrolling, animating counters) does not churn the cache.
+    // The byte budget is Parameters::mGlyphRunCacheSize. Main thread only.
+    class GlyphRunCache
+    {
+    public:
+        static GlyphRunCache& GetInstance();
+
+        GlyphRun* Find(const GlyphRunKey& key);   // On success, the run becomes the most recently used.
+        GlyphRun* Add(const GlyphRunKey& key, int width, int height); // Returns a cleared run for the caller to composite into, or NULL if it should not be cached.
+
+        void RemoveFont(EA::WebKit::IFont* pFont); // Needs to be called before a font is destroyed since runs are keyed by its address.
+        void Clear();
+
+    private:
+        GlyphRunCache();
+        ~GlyphRunCache();
+
+        void Remove(GlyphRun* pRun);
+        void Trim(uint32_t budget);
+
+        typedef eastl::intrusive_list<GlyphRun> GlyphRunList;
+        typedef eastl::hash_multimap<uint32_t, GlyphRun*, eastl::hash<uint32_t>, eastl::equal_to<uint32_t>, EA::WebKit::EASTLAllocator> GlyphRunMap;
+
+        static const uint32_t kRecentHashCount = 512;  // Power of 2.
+
+        GlyphRunList    mRunList;       // Most recently used in front.
+        GlyphRunMap     mRunMap;
+        uint32_t        mSize;
+        uint32_t        mRecentHashes[kRecentHashCount];    // Hashes of runs seen once but not admitted yet.
+    };
+}
+
+#endif // GlyphRunCacheEA_h
@@ -47,9 +47,29 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "config.h"
 #include "ImageCompressionEA.h"
 #include "AlwaysInline.h"
+#include "DecompressedImageCacheEA.h"
 #include <stdlib.h>
+#include <EAWebKit/EAWebKit.h>
+#include <EAWebKit/EAWebKitClient.h>
 #include <EAWebKit/EAWebKitConfig.h>
 #include <EAWebKit/EAWebkitAllocator.h>
+#include <internal/include/EAWebKit_p.h>
+#include <internal/include/EAWebKitThreadPool.h>
+
+// The YCoCgDXT5 block kernels and color conversions have SSE2 and NEON versions. They produce the same bytes as the C
+// versions. SSE2 is always there on x64. On x86 it is checked for at run time.
+#if defined(EA_SYSTEM_LITTLE_ENDIAN) && (defined(EA_PROCESSOR_X86_64) || (defined(EA_PROCESSOR_X86) && (defined(_MSC_VER) || defined(__SSE2__))))
+    #define USE_DXT_SSE2 1
+    #include <emmintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #elif !defined(EA_PROCESSOR_X86_64)
+        #include <cpuid.h>
+    #endif
+#elif defined(EA_SYSTEM_LITTLE_ENDIAN) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+    #define USE_DXT_NEON 1
+    #include <arm_neon.h>
+#endif
 
 namespace WebCore {
 
@@ -57,6 +77,37 @@ namespace WebCore {
 static const int kMaxRLETokenSize = 255;    // Max repetition for an RLE token count
 static const int kRLEAlphaShift = 24;       // Shift offset to the location of alpha (ARGB has alpha at 24)
 
+// Counters for ImageCompressionGetUsage. Main thread only.
+struct ImageCompressionStats
+{
+    uint32_t mCompressedImageCount;     // Compressed buffers alive
+    uint32_t mCompressedBytes;          // Their size, headers included
+    uint32_t mUncompressedBytes;        // The size of the frames they hold
+    uint32_t mCompressions;
+    uint32_t mDecompressions;
+};
+static ImageCompressionStats sImageCompressionStats;
+
+// Notifies the start and the end of a compression or decompression (see Parameters::mEnableProfiling). mSize is the pixel count.
+class ImageCompressionProcessScope
+{
+public:
+    ImageCompressionProcessScope(EA::WebKit::VProcessType processType, int pixelCount)
+        : mProcessInfo(processType, EA::WebKit::kVProcessStatusNone)
+    {
+        mProcessInfo.mSize = pixelCount;
+        NOTIFY_PROCESS_STATUS(mProcessInfo, EA::WebKit::kVProcessStatusStarted);
+    }
+
+    ~ImageCompressionProcessScope()
+    {
+        NOTIFY_PROCESS_STATUS(mProcessInfo, EA::WebKit::kVProcessStatusEnded);
+    }
+
+private:
+    EA::WebKit::ViewProcessInfo mProcessInfo;
+};
+
 // Small header for compression to allow more than one format. 
 struct CompressionHeader
 {
@@ -121,68 +172,227 @@ byte CLAMP_BYTE( int x ) { return ( (x) < 0 ? (0) : ( (x) > 255 ? 255 : (x) ) );
 #define COCG_TO_G( co, cg )         ( cg )
 #define COCG_TO_B( co, cg )         ( - co - cg )
  
-void ConvertRGBToCoCg_Y(byte *pImage, int width, int height, int stride)
+static ALWAYS_INLINE void ConvertPixelRGBToCoCg_Y(byte *pImageColumn)
 {
-
-   byte *pImageRow = pImage;
-    
-    for (int h = 0; h < height; ++h)
-    {
-        for (int w = 0; w < width; ++w)
-        {
-        
-            byte *pImageColumn = pImageRow + (w << 2);
 #ifdef EA_SYSTEM_LITTLE_ENDIAN
-            int r = pImageColumn[0];
-            int g = pImageColumn[1];
-            int b = pImageColumn[2];
-            int a = pImageColumn[3];
+    int r = pImageColumn[0];
+    int g = pImageColumn[1];
+    int b = pImageColumn[2];
+    int a = pImageColumn[3];
 #else
-            int a = pImageColumn[0];
-            int b = pImageColumn[1];
-            int g = pImageColumn[2];
-            int r = pImageColumn[3];
+    int a = pImageColumn[0];
+    int b = pImageColumn[1];
+    int g = pImageColumn[2];
+    int r = pImageColumn[3];
 #endif
-           pImageColumn[0] = CLAMP_BYTE( RGB_TO_YCOCG_CO( r, g, b ) + 128 );
-           pImageColumn[1] = CLAMP_BYTE( RGB_TO_YCOCG_CG( r, g, b ) + 128 );
-           pImageColumn[2] = a;
-           pImageColumn[3] = CLAMP_BYTE( RGB_TO_YCOCG_Y( r, g, b ) );
-        }
-        pImageRow += stride;            // Next line
-    }
+    pImageColumn[0] = CLAMP_BYTE( RGB_TO_YCOCG_CO( r, g, b ) + 128 );
+    pImageColumn[1] = CLAMP_BYTE( RGB_TO_YCOCG_CG( r, g, b ) + 128 );
+    pImageColumn[2] = a;
+    pImageColumn[3] = CLAMP_BYTE( RGB_TO_YCOCG_Y( r, g, b ) );
 }
 
 // This function doesn't load alpha from the source.
-void ConvertCoCg_YToRGBNoAlpha(byte *pImage, int width, int height, int strideIn) {
-    byte *pImageRow = pImage;
-    
-    for (int h = 0; h < height; ++h)
-    {
-        for (int w = 0; w < width; ++w)
-        {
-            
-            byte *pImageColumn = pImageRow + (w << 2);
-
-            int co = pImageColumn[0] - 128;
-            int cg = pImageColumn[1] - 128;
-            int y  = pImageColumn[3];
+static ALWAYS_INLINE void ConvertPixelCoCg_YToRGBNoAlpha(byte *pImageColumn)
+{
+    int co = pImageColumn[0] - 128;
+    int cg = pImageColumn[1] - 128;
+    int y  = pImageColumn[3];
 
 #ifdef EA_SYSTEM_LITTLE_ENDIAN  
-            pImageColumn[0] = CLAMP_BYTE( y + COCG_TO_R( co, cg ) );
-            pImageColumn[1] = CLAMP_BYTE( y + COCG_TO_G( co, cg ) );
-            pImageColumn[2] = CLAMP_BYTE( y + COCG_TO_B( co, cg ) );
-            pImageColumn[3] = 255;
+    pImageColumn[0] = CLAMP_BYTE( y + COCG_TO_R( co, cg ) );
+    pImageColumn[1] = CLAMP_BYTE( y + COCG_TO_G( co, cg ) );
+    pImageColumn[2] = CLAMP_BYTE( y + COCG_TO_B( co, cg ) );
+    pImageColumn[3] = 255;
 #else
-           pImageColumn[0] = 255;
-           pImageColumn[1] = CLAMP_BYTE( y + COCG_TO_B( co, cg ) );
-           pImageColumn[2] = CLAMP_BYTE( y + COCG_TO_G( co, cg ) );
-           pImageColumn[3] = CLAMP_BYTE( y + COCG_TO_R( co, cg ) );
+    pImageColumn[0] = 255;
+    pImageColumn[1] = CLAMP_BYTE( y + COCG_TO_B( co, cg ) );
+    pImageColumn[2] = CLAMP_BYTE( y + COCG_TO_G( co, cg ) );
+    pImageColumn[3] = CLAMP_BYTE( y + COCG_TO_R( co, cg ) );
 #endif
-        }
-        pImageRow += strideIn;             // Next line
+}
+
+static void ConvertRowRGBToCoCg_Y(byte *pImageRow, int width)
+{
+    for (int w = 0; w < width; ++w)
+        ConvertPixelRGBToCoCg_Y(pImageRow + (w << 2));
+}
+
+static void ConvertRowCoCg_YToRGBNoAlpha(byte *pImageRow, int width)
+{
+    for (int w = 0; w < width; ++w)
+        ConvertPixelCoCg_YToRGBNoAlpha(pImageRow + (w << 2));
+}
+
+#if defined(USE_DXT_SSE2)
+
+static bool HasSSE2()
+{
+#if defined(EA_PROCESSOR_X86_64)
+    return true;
+#elif defined(_MSC_VER)
+    int cpuInfo[4];
+    __cpuid(cpuInfo, 1);
+    return (cpuInfo[3] & (1 << 26)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (edx & (1 << 26));
+#endif
+}
+
+// Splits 8 texels into their 4 channels as 16 bit values.
+static ALWAYS_INLINE void UnpackChannelsSSE2(__m128i texels0, __m128i texels1, __m128i& c0, __m128i& c1, __m128i& c2, __m128i& c3)
+{
+    const __m128i byteMask = _mm_set1_epi32(0xff);
+    c0 = _mm_packs_epi32(_mm_and_si128(texels0, byteMask), _mm_and_si128(texels1, byteMask));
+    c1 = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(texels0, 8), byteMask), _mm_and_si128(_mm_srli_epi32(texels1, 8), byteMask));
+    c2 = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(texels0, 16), byteMask), _mm_and_si128(_mm_srli_epi32(texels1, 16), byteMask));
+    c3 = _mm_packs_epi32(_mm_srli_epi32(texels0, 24), _mm_srli_epi32(texels1, 24));
+}
+
+// Packs 4 channels of 8 texels, as 16 bit values in the 0-255 range, back into texels.
+static ALWAYS_INLINE void PackChannelsSSE2(__m128i c0, __m128i c1, __m128i c2, __m128i c3, __m128i& texels0, __m128i& texels1)
+{
+    const __m128i c01 = _mm_or_si128(c0, _mm_slli_epi16(c1, 8));
+    const __m128i c23 = _mm_or_si128(c2, _mm_slli_epi16(c3, 8));
+    texels0 = _mm_unpacklo_epi16(c01, c23);
+    texels1 = _mm_unpackhi_epi16(c01, c23);
+}
+
+static ALWAYS_INLINE __m128i ClampByteSSE2(__m128i a)
+{
+    return _mm_min_epi16(_mm_max_epi16(a, _mm_setzero_si128()), _mm_set1_epi16(255));
+}
+
+static void ConvertRowRGBToCoCg_YSSE2(byte *pImageRow, int width)
+{
+    const __m128i round = _mm_set1_epi16(2);
+    const __m128i center = _mm_set1_epi16(128);
+
+    int w = 0;
+    for (; w + 8 <= width; w += 8)
+    {
+        __m128i* pTexels = (__m128i*) (pImageRow + (w << 2));
+        __m128i r, g, b, a;
+        UnpackChannelsSSE2(_mm_loadu_si128(pTexels), _mm_loadu_si128(pTexels + 1), r, g, b, a);
+
+        const __m128i g2 = _mm_slli_epi16(g, 1);
+        const __m128i rb = _mm_add_epi16(r, b);
+        const __m128i co = _mm_srai_epi16(_mm_add_epi16(_mm_slli_epi16(_mm_sub_epi16(r, b), 1), round), 2);
+        const __m128i cg = _mm_srai_epi16(_mm_add_epi16(_mm_sub_epi16(g2, rb), round), 2);
+        const __m128i y  = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(g2, rb), round), 2);
+
+        __m128i texels0, texels1;
+        PackChannelsSSE2(ClampByteSSE2(_mm_add_epi16(co, center)), ClampByteSSE2(_mm_add_epi16(cg, center)), a, y, texels0, texels1);
+        _mm_storeu_si128(pTexels, texels0);
+        _mm_storeu_si128(pTexels + 1, texels1);
+    }
+    ConvertRowRGBToCoCg_Y(pImageRow + (w << 2), width - w);
+}
+
+static void ConvertRowCoCg_YToRGBNoAlphaSSE2(byte *pImageRow, int width)
+{
+    const __m128i center = _mm_set1_epi16(128);
+    const __m128i alpha = _mm_set1_epi16(255);
+
+    int w = 0;
+    for (; w + 8 <= width; w += 8)
+    {
+        __m128i* pTexels = (__m128i*) (pImageRow + (w << 2));
+        __m128i co, cg, a, y;
+        UnpackChannelsSSE2(_mm_loadu_si128(pTexels), _mm_loadu_si128(pTexels + 1), co, cg, a, y);
+        co = _mm_sub_epi16(co, center);
+        cg = _mm_sub_epi16(cg, center);
+
+        const __m128i r = ClampByteSSE2(_mm_sub_epi16(_mm_add_epi16(y, co), cg));
+        const __m128i g = ClampByteSSE2(_mm_add_epi16(y, cg));
+        const __m128i b = ClampByteSSE2(_mm_sub_epi16(_mm_sub_epi16(y, co), cg));
+
+        __m128i texels0, texels1;
+        PackChannelsSSE2(r, g, b, alpha, texels0, texels1);
+        _mm_storeu_si128(pTexels, texels0);
+        _mm_storeu_si128(pTexels + 1, texels1);
     }
+    ConvertRowCoCg_YToRGBNoAlpha(pImageRow + (w << 2), width - w);
 }
 
+#elif defined(USE_DXT_NEON)
+
+static ALWAYS_INLINE int16x8_t WidenNEON(uint8x8_t a)
+{
+    return vreinterpretq_s16_u16(vmovl_u8(a));
+}
+
+static ALWAYS_INLINE void ConvertRGBToCoCg_YNEON(uint8x8_t r8, uint8x8_t g8, uint8x8_t b8, uint8x8_t& co8, uint8x8_t& cg8, uint8x8_t& y8)
+{
+    const int16x8_t round = vdupq_n_s16(2);
+    const int16x8_t center = vdupq_n_s16(128);
+    const int16x8_t r = WidenNEON(r8);
+    const int16x8_t g2 = vshlq_n_s16(WidenNEON(g8), 1);
+    const int16x8_t b = WidenNEON(b8);
+    const int16x8_t rb = vaddq_s16(r, b);
+
+    // vqmovun_s16 clamps to the 0-255 range.
+    co8 = vqmovun_s16(vaddq_s16(vshrq_n_s16(vaddq_s16(vshlq_n_s16(vsubq_s16(r, b), 1), round), 2), center));
+    cg8 = vqmovun_s16(vaddq_s16(vshrq_n_s16(vaddq_s16(vsubq_s16(g2, rb), round), 2), center));
+    y8  = vqmovun_s16(vshrq_n_s16(vaddq_s16(vaddq_s16(g2, rb), round), 2));
+}
+
+static ALWAYS_INLINE void ConvertCoCg_YToRGBNEON(uint8x8_t co8, uint8x8_t cg8, uint8x8_t y8, uint8x8_t& r8, uint8x8_t& g8, uint8x8_t& b8)
+{
+    const int16x8_t center = vdupq_n_s16(128);
+    const int16x8_t co = vsubq_s16(WidenNEON(co8), center);
+    const int16x8_t cg = vsubq_s16(WidenNEON(cg8), center);
+    const int16x8_t y = WidenNEON(y8);
+
+    r8 = vqmovun_s16(vsubq_s16(vaddq_s16(y, co), cg));
+    g8 = vqmovun_s16(vaddq_s16(y, cg));
+    b8 = vqmovun_s16(vsubq_s16(vsubq_s16(y, co), cg));
+}
+
+static void ConvertRowRGBToCoCg_YNEON(byte *pImageRow, int width)
+{
+    int w = 0;
+    for (; w + 16 <= width; w += 16)
+    {
+        byte* pTexels = pImageRow + (w << 2);
+        const uint8x16x4_t rgba = vld4q_u8(pTexels);
+        uint8x8_t coLow, cgLow, yLow, coHigh, cgHigh, yHigh;
+        ConvertRGBToCoCg_YNEON(vget_low_u8(rgba.val[0]), vget_low_u8(rgba.val[1]), vget_low_u8(rgba.val[2]), coLow, cgLow, yLow);
+        ConvertRGBToCoCg_YNEON(vget_high_u8(rgba.val[0]), vget_high_u8(rgba.val[1]), vget_high_u8(rgba.val[2]), coHigh, cgHigh, yHigh);
+
+        uint8x16x4_t cocgay;
+        cocgay.val[0] = vcombine_u8(coLow, coHigh);
+        cocgay.val[1] = vcombine_u8(cgLow, cgHigh);
+        cocgay.val[2] = rgba.val[3];
+        cocgay.val[3] = vcombine_u8(yLow, yHigh);
+        vst4q_u8(pTexels, cocgay);
+    }
+    ConvertRowRGBToCoCg_Y(pImageRow + (w << 2), width - w);
+}
+
+static void ConvertRowCoCg_YToRGBNoAlphaNEON(byte *pImageRow, int width)
+{
+    int w = 0;
+    for (; w + 16 <= width; w += 16)
+    {
+        byte* pTexels = pImageRow + (w << 2);
+        const uint8x16x4_t cocgay = vld4q_u8(pTexels);
+        uint8x8_t rLow, gLow, bLow, rHigh, gHigh, bHigh;
+        ConvertCoCg_YToRGBNEON(vget_low_u8(cocgay.val[0]), vget_low_u8(cocgay.val[1]), vget_low_u8(cocgay.val[3]), rLow, gLow, bLow);
+        ConvertCoCg_YToRGBNEON(vget_high_u8(cocgay.val[0]), vget_high_u8(cocgay.val[1]), vget_high_u8(cocgay.val[3]), rHigh, gHigh, bHigh);
+
+        uint8x16x4_t rgba;
+        rgba.val[0] = vcombine_u8(rLow, rHigh);
+        rgba.val[1] = vcombine_u8(gLow, gHigh);
+        rgba.val[2] = vcombine_u8(bLow, bHigh);
+        rgba.val[3] = vdupq_n_u8(255);
+        vst4q_u8(pTexels, rgba);
+    }
+    ConvertRowCoCg_YToRGBNoAlpha(pImageRow + (w << 2), width - w);
+}
+
+#endif
+
 #ifndef word
 typedef unsigned short  word;
 #endif 
@@ -199,49 +409,49 @@ typedef unsigned int    dword;
  
 #define NVIDIA_G7X_HARDWARE_BUG_FIX     // keep the colors sorted as: max, min
  
-byte *globalOutData;
- 
 ALWAYS_INLINE word ColorTo565( const byte *color )
 {
     return ( ( color[ 0 ] >> 3 ) << 11 ) | ( ( color[ 1 ] >> 2 ) << 5 ) | ( color[ 2 ] >> 3 );
 }
 
-ALWAYS_INLINE void EmitByte( byte b )
+// The Emit functions write to outData and move it past what was written. The output used to be a global so each
+// compression call now keeps its own, which lets bands of an image be compressed at the same time.
+ALWAYS_INLINE void EmitByte( byte b, byte*& outData )
 {
-    globalOutData[0] = b;
-    globalOutData += 1;
+    outData[0] = b;
+    outData += 1;
 }
 
-ALWAYS_INLINE void EmitUInt( unsigned int s )
+ALWAYS_INLINE void EmitUInt( unsigned int s, byte*& outData )
 {
-   globalOutData[0] = ( s >>  0 ) & 255;
-   globalOutData[1] = ( s >>  8 ) & 255;
-   globalOutData[2] = ( s >>  16 ) & 255;
-   globalOutData[3] = ( s >>  24 ) & 255;
-   globalOutData += 4;
+   outData[0] = ( s >>  0 ) & 255;
+   outData[1] = ( s >>  8 ) & 255;
+   outData[2] = ( s >>  16 ) & 255;
+   outData[3] = ( s >>  24 ) & 255;
+   outData += 4;
 }
 
-ALWAYS_INLINE void EmitUShort( unsigned short s )
+ALWAYS_INLINE void EmitUShort( unsigned short s, byte*& outData )
 {
-    globalOutData[0] = ( s >>  0 ) & 255;
-    globalOutData[1] = ( s >>  8 ) & 255;
-    globalOutData += 2;
+    outData[0] = ( s >>  0 ) & 255;
+    outData[1] = ( s >>  8 ) & 255;
+    outData += 2;
 }
 
-ALWAYS_INLINE void EmitWord( word s )
+ALWAYS_INLINE void EmitWord( word s, byte*& outData )
 {
-    globalOutData[0] = ( s >>  0 ) & 255;
-    globalOutData[1] = ( s >>  8 ) & 255;
-    globalOutData += 2;
+    outData[0] = ( s >>  0 ) & 255;
+    outData[1] = ( s >>  8 ) & 255;
+    outData += 2;
 }
  
-ALWAYS_INLINE void EmitDoubleWord( dword i )
+ALWAYS_INLINE void EmitDoubleWord( dword i, byte*& outData )
 {
-    globalOutData[0] = ( i >>  0 ) & 255;
-    globalOutData[1] = ( i >>  8 ) & 255;
-    globalOutData[2] = ( i >> 16 ) & 255;
-    globalOutData[3] = ( i >> 24 ) & 255;
-    globalOutData += 4;
+    outData[0] = ( i >>  0 ) & 255;
+    outData[1] = ( i >>  8 ) & 255;
+    outData[2] = ( i >> 16 ) & 255;
+    outData[3] = ( i >> 24 ) & 255;
+    outData += 4;
 }
  
 ALWAYS_INLINE void ExtractBlock( const byte *inPtr, const int width, const int stride, byte *colorBlock )
@@ -274,12 +484,13 @@ void ExtractBlock( const byte *inPtr, const int width, const int stride, const i
             }
         }
 
-        // Set up offset for next texel row source (keep existing if we are at the end)
+        // Set up offset for next texel row source (keep existing if we are at the end).
+        // The row index is checked before it moves, like the column index, so the last row is not dropped.
         pBlock32 += 4;    
-        hIndex++;
         if (hIndex < (heightRemain - 1))
         {
             pSource32 += (stride >> 2);
+            hIndex++;
         }
    }
 }
@@ -328,7 +539,9 @@ static ALWAYS_INLINE int absEA( int liArg )
 }
 
 
-void ScaleYCoCg( byte *colorBlock, byte *minColor, byte *maxColor )
+// Returns the scale (1, 2 or 4) to stretch the chroma of the block by and applies it to the bounding box.
+// The scale is also stored in min[2] and max[2].
+static ALWAYS_INLINE int ScaleYCoCgBBox( byte *minColor, byte *maxColor )
 {
     int m0 = absEA( minColor[0] - 128 );      // (the 128 is to center to color to grey (128,128) )
     int m1 = absEA( minColor[1] - 128 );
@@ -353,6 +566,13 @@ void ScaleYCoCg( byte *colorBlock, byte *minColor, byte *maxColor )
     maxColor[0] = ( maxColor[0] - 128 ) * scale + 128;
     maxColor[1] = ( maxColor[1] - 128 ) * scale + 128;
     maxColor[2] = ( scale - 1 ) << 3;
+
+    return scale;
+}
+
+void ScaleYCoCg( byte *colorBlock, byte *minColor, byte *maxColor )
+{
+    int scale = ScaleYCoCgBBox( minColor, maxColor );
     
     for ( int i = 0; i < 16; ++i )
     {
@@ -428,24 +648,50 @@ void SelectYCoCgDiagonal( const byte *colorBlock, byte *minColor, byte *maxColor
     maxColor[1] = c1;
 }
  
-void EmitAlphaIndices( const byte *colorBlock, const byte minAlpha, const byte maxAlpha )
+// Fills ab[1] to ab[7] with the alpha values that separate the 8 alpha indexes.
+static ALWAYS_INLINE void GetAlphaIndexBounds( const byte minAlpha, const byte maxAlpha, byte *ab )
 {
     ASSERT( maxAlpha >= minAlpha );
     
     const int ALPHA_RANGE = 7;
     
-    byte mid, ab1, ab2, ab3, ab4, ab5, ab6, ab7;
-    byte indexes[16];
+    byte mid = ( maxAlpha - minAlpha ) / ( 2 * ALPHA_RANGE );
     
-    mid = ( maxAlpha - minAlpha ) / ( 2 * ALPHA_RANGE );
+    ab[0] = 0;
+    ab[1] = minAlpha + mid;
+    ab[2] = ( 6 * maxAlpha + 1 * minAlpha ) / ALPHA_RANGE + mid;
+    ab[3] = ( 5 * maxAlpha + 2 * minAlpha ) / ALPHA_RANGE + mid;
+    ab[4] = ( 4 * maxAlpha + 3 * minAlpha ) / ALPHA_RANGE + mid;
+    ab[5] = ( 3 * maxAlpha + 4 * minAlpha ) / ALPHA_RANGE + mid;
+    ab[6] = ( 2 * maxAlpha + 5 * minAlpha ) / ALPHA_RANGE + mid;
+    ab[7] = ( 1 * maxAlpha + 6 * minAlpha ) / ALPHA_RANGE + mid;
+}
+
+// Packs the 16 3 bit alpha indexes into 6 bytes.
+static ALWAYS_INLINE void EmitAlphaIndexBytes( const byte *indexes, byte*& outData )
+{
+    EmitByte( (indexes[ 0] >> 0) | (indexes[ 1] << 3) | (indexes[ 2] << 6), outData );
+    EmitByte( (indexes[ 2] >> 2) | (indexes[ 3] << 1) | (indexes[ 4] << 4) | (indexes[ 5] << 7), outData );
+    EmitByte( (indexes[ 5] >> 1) | (indexes[ 6] << 2) | (indexes[ 7] << 5), outData );
+    
+    EmitByte( (indexes[ 8] >> 0) | (indexes[ 9] << 3) | (indexes[10] << 6), outData );
+    EmitByte( (indexes[10] >> 2) | (indexes[11] << 1) | (indexes[12] << 4) | (indexes[13] << 7), outData );
+    EmitByte( (indexes[13] >> 1) | (indexes[14] << 2) | (indexes[15] << 5), outData );
+}
+
+void EmitAlphaIndices( const byte *colorBlock, const byte minAlpha, const byte maxAlpha, byte*& outData )
+{
+    byte ab[8];
+    byte indexes[16];
     
-    ab1 = minAlpha + mid;
-    ab2 = ( 6 * maxAlpha + 1 * minAlpha ) / ALPHA_RANGE + mid;
-    ab3 = ( 5 * maxAlpha + 2 * minAlpha ) / ALPHA_RANGE + mid;
-    ab4 = ( 4 * maxAlpha + 3 * minAlpha ) / ALPHA_RANGE + mid;
-    ab5 = ( 3 * maxAlpha + 4 * minAlpha ) / ALPHA_RANGE + mid;
-    ab6 = ( 2 * maxAlpha + 5 * minAlpha ) / ALPHA_RANGE + mid;
-    ab7 = ( 1 * maxAlpha + 6 * minAlpha ) / ALPHA_RANGE + mid;
+    GetAlphaIndexBounds( minAlpha, maxAlpha, ab );
+    const byte ab1 = ab[1];
+    const byte ab2 = ab[2];
+    const byte ab3 = ab[3];
+    const byte ab4 = ab[4];
+    const byte ab5 = ab[5];
+    const byte ab6 = ab[6];
+    const byte ab7 = ab[7];
     
     for ( int i = 0; i < 16; ++i )
     {
@@ -461,20 +707,12 @@ void EmitAlphaIndices( const byte *colorBlock, const byte minAlpha, const byte m
         indexes[i] = index ^ ( 2 > index );
     }
     
-    EmitByte( (indexes[ 0] >> 0) | (indexes[ 1] << 3) | (indexes[ 2] << 6) );
-    EmitByte( (indexes[ 2] >> 2) | (indexes[ 3] << 1) | (indexes[ 4] << 4) | (indexes[ 5] << 7) );
-    EmitByte( (indexes[ 5] >> 1) | (indexes[ 6] << 2) | (indexes[ 7] << 5) );
-    
-    EmitByte( (indexes[ 8] >> 0) | (indexes[ 9] << 3) | (indexes[10] << 6) );
-    EmitByte( (indexes[10] >> 2) | (indexes[11] << 1) | (indexes[12] << 4) | (indexes[13] << 7) );
-    EmitByte( (indexes[13] >> 1) | (indexes[14] << 2) | (indexes[15] << 5) );
+    EmitAlphaIndexBytes( indexes, outData );
 }
  
-void EmitColorIndices( const byte *colorBlock, const byte *minColor, const byte *maxColor )
+// Builds the 4 entry chroma table the color indexes select from.
+static ALWAYS_INLINE void GetColorIndexTable( const byte *minColor, const byte *maxColor, word colors[4][4] )
 {
-    word colors[4][4];
-    unsigned int result = 0;
-    
     colors[0][0] = ( maxColor[0] & C565_5_MASK ) | ( maxColor[0] >> 5 );
     colors[0][1] = ( maxColor[1] & C565_6_MASK ) | ( maxColor[1] >> 6 );
     colors[0][2] = ( maxColor[2] & C565_5_MASK ) | ( maxColor[2] >> 5 );
@@ -491,6 +729,14 @@ void EmitColorIndices( const byte *colorBlock, const byte *minColor, const byte
     colors[3][1] = ( 1 * colors[0][1] + 2 * colors[1][1] ) / 3;
     colors[3][2] = ( 1 * colors[0][2] + 2 * colors[1][2] ) / 3;
     colors[3][3] = 0;
+}
+
+void EmitColorIndices( const byte *colorBlock, const byte *minColor, const byte *maxColor, byte*& outData )
+{
+    word colors[4][4];
+    unsigned int result = 0;
+    
+    GetColorIndexTable( minColor, maxColor, colors );
     
     for ( int i = 15; i >= 0; i-- )
     {
@@ -518,14 +764,383 @@ void EmitColorIndices( const byte *colorBlock, const byte *minColor, const byte
         result |= indexFinal;
     }
     
-    EmitUInt( result );
+    EmitUInt( result, outData );
+}
+
+// The C version of the block encoder. The block is modified.
+static void EncodeYCoCgDXT5Block( byte *block, byte*& outData )
+{
+    byte minColor[4];
+    byte maxColor[4];
+
+    // A simple min max extract for each color channel including alpha             
+    GetMinMaxYCoCg( block, minColor, maxColor );
+    ScaleYCoCg( block, minColor, maxColor );    // Sets the scale in the min[2] and max[2] offset
+    InsetYCoCgBBox( minColor, maxColor );
+    SelectYCoCgDiagonal( block, minColor, maxColor );
+    
+    EmitByte( maxColor[3], outData );    // Note: the luma is stored in the alpha channel
+    EmitByte( minColor[3], outData );
+
+    EmitAlphaIndices( block, minColor[3], maxColor[3], outData );
+    
+    EmitUShort( ColorTo565( maxColor ), outData );
+    EmitUShort( ColorTo565( minColor ), outData );
+    
+    EmitColorIndices( block, minColor, maxColor, outData );
+}
+
+#if defined(USE_DXT_SSE2) || defined(USE_DXT_NEON)
+// Moves bit i of a 16 bit value to bit i * 2.
+static ALWAYS_INLINE unsigned int SpreadBits16( unsigned int x )
+{
+    x = ( x | ( x << 8 ) ) & 0x00ff00ff;
+    x = ( x | ( x << 4 ) ) & 0x0f0f0f0f;
+    x = ( x | ( x << 2 ) ) & 0x33333333;
+    x = ( x | ( x << 1 ) ) & 0x55555555;
+    return x;
+}
+#endif
+
+#if defined(USE_DXT_SSE2)
+
+// The SSE2 block encoder keeps the 4 rows of the block in registers and works on all 16 texels at once. The bounding box
+// inset and the diagonal selection stay in C since they only deal with a couple of colors.
+
+static ALWAYS_INLINE void GetMinMaxYCoCgSSE2( const __m128i *rows, byte *minColor, byte *maxColor )
+{
+    __m128i minTexels = _mm_min_epu8( _mm_min_epu8( rows[0], rows[1] ), _mm_min_epu8( rows[2], rows[3] ) );
+    __m128i maxTexels = _mm_max_epu8( _mm_max_epu8( rows[0], rows[1] ), _mm_max_epu8( rows[2], rows[3] ) );
+    minTexels = _mm_min_epu8( minTexels, _mm_shuffle_epi32( minTexels, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+    maxTexels = _mm_max_epu8( maxTexels, _mm_shuffle_epi32( maxTexels, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+    minTexels = _mm_min_epu8( minTexels, _mm_shuffle_epi32( minTexels, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+    maxTexels = _mm_max_epu8( maxTexels, _mm_shuffle_epi32( maxTexels, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+
+    const unsigned int minTexel = (unsigned int) _mm_cvtsi128_si32( minTexels );
+    const unsigned int maxTexel = (unsigned int) _mm_cvtsi128_si32( maxTexels );
+
+    // Like GetMinMaxYCoCg, the alpha (offset 2) is left out.
+    minColor[0] = (byte) minTexel;
+    minColor[1] = (byte) ( minTexel >> 8 );
+    minColor[2] = 255;
+    minColor[3] = (byte) ( minTexel >> 24 );
+    maxColor[0] = (byte) maxTexel;
+    maxColor[1] = (byte) ( maxTexel >> 8 );
+    maxColor[2] = 0;
+    maxColor[3] = (byte) ( maxTexel >> 24 );
+}
+
+static ALWAYS_INLINE void ScaleYCoCgSSE2( __m128i *rows, const int scale )
+{
+    // ( c - 128 ) * scale + 128 wraps to c * scale + 128 in a byte when the scale is 2 or 4.
+    const __m128i chromaMask = _mm_set1_epi32( 0xffff );
+    const __m128i center = _mm_set1_epi32( 0x8080 );
+
+    for ( int j = 0; j < 4; ++j )
+    {
+        __m128i scaled = _mm_add_epi8( rows[j], rows[j] );
+        if ( scale == 4 )
+            scaled = _mm_add_epi8( scaled, scaled );
+        scaled = _mm_add_epi8( scaled, center );
+        rows[j] = _mm_or_si128( _mm_and_si128( scaled, chromaMask ), _mm_andnot_si128( chromaMask, rows[j] ) );
+    }
+}
+
+static ALWAYS_INLINE void EmitAlphaIndicesSSE2( const __m128i *rows, const byte minAlpha, const byte maxAlpha, byte*& outData )
+{
+    byte ab[8];
+    byte indexes[16];
+
+    GetAlphaIndexBounds( minAlpha, maxAlpha, ab );
+
+    const __m128i alpha = _mm_packus_epi16( _mm_packs_epi32( _mm_srli_epi32( rows[0], 24 ), _mm_srli_epi32( rows[1], 24 ) ),
+                                            _mm_packs_epi32( _mm_srli_epi32( rows[2], 24 ), _mm_srli_epi32( rows[3], 24 ) ) );
+
+    // Count the bounds each alpha is under. a <= ab when min( a, ab ) == a.
+    __m128i count = _mm_setzero_si128();
+    for ( int i = 1; i < 8; ++i )
+        count = _mm_sub_epi8( count, _mm_cmpeq_epi8( _mm_min_epu8( alpha, _mm_set1_epi8( (char) ab[i] ) ), alpha ) );
+
+    __m128i index = _mm_and_si128( _mm_add_epi8( count, _mm_set1_epi8( 1 ) ), _mm_set1_epi8( 7 ) );
+    index = _mm_xor_si128( index, _mm_and_si128( _mm_cmpgt_epi8( _mm_set1_epi8( 2 ), index ), _mm_set1_epi8( 1 ) ) );
+    _mm_storeu_si128( (__m128i*) indexes, index );
+
+    EmitAlphaIndexBytes( indexes, outData );
+}
+
+static ALWAYS_INLINE void EmitColorIndicesSSE2( const __m128i *rows, const byte *minColor, const byte *maxColor, byte*& outData )
+{
+    word colors[4][4];
+    GetColorIndexTable( minColor, maxColor, colors );
+
+    __m128i table[4];
+    for ( int k = 0; k < 4; ++k )
+        table[k] = _mm_set1_epi32( colors[k][0] | ( colors[k][1] << 8 ) );
+
+    const __m128i chromaMask = _mm_set1_epi32( 0xffff );
+    const __m128i byteMask = _mm_set1_epi32( 0xff );
+    __m128i lowBits[4];
+    __m128i highBits[4];
+
+    for ( int j = 0; j < 4; ++j )
+    {
+        const __m128i chroma = _mm_and_si128( rows[j], chromaMask );
+        __m128i d[4];
+        for ( int k = 0; k < 4; ++k )
+        {
+            const __m128i diff = _mm_or_si128( _mm_subs_epu8( chroma, table[k] ), _mm_subs_epu8( table[k], chroma ) );
+            d[k] = _mm_add_epi32( _mm_and_si128( diff, byteMask ), _mm_srli_epi32( diff, 8 ) );
+        }
+
+        const __m128i b0 = _mm_cmpgt_epi32( d[0], d[3] );
+        const __m128i b1 = _mm_cmpgt_epi32( d[1], d[2] );
+        const __m128i b2 = _mm_cmpgt_epi32( d[0], d[2] );
+        const __m128i b3 = _mm_cmpgt_epi32( d[1], d[3] );
+        const __m128i b4 = _mm_cmpgt_epi32( d[2], d[3] );
+
+        lowBits[j] = _mm_and_si128( b0, b4 );
+        highBits[j] = _mm_or_si128( _mm_and_si128( b1, b2 ), _mm_and_si128( b0, b3 ) );
+    }
+
+    const unsigned int low = _mm_movemask_epi8( _mm_packs_epi16( _mm_packs_epi32( lowBits[0], lowBits[1] ), _mm_packs_epi32( lowBits[2], lowBits[3] ) ) );
+    const unsigned int high = _mm_movemask_epi8( _mm_packs_epi16( _mm_packs_epi32( highBits[0], highBits[1] ), _mm_packs_epi32( highBits[2], highBits[3] ) ) );
+
+    EmitUInt( SpreadBits16( low ) | ( SpreadBits16( high ) << 1 ), outData );
+}
+
+static void EncodeYCoCgDXT5BlockSSE2( byte *block, byte*& outData )
+{
+    byte minColor[4];
+    byte maxColor[4];
+    __m128i rows[4];
+
+    for ( int j = 0; j < 4; ++j )
+        rows[j] = _mm_loadu_si128( (const __m128i*) ( block + j * 16 ) );
+
+    GetMinMaxYCoCgSSE2( rows, minColor, maxColor );
+    const int scale = ScaleYCoCgBBox( minColor, maxColor );
+    if ( scale != 1 )
+    {
+        ScaleYCoCgSSE2( rows, scale );
+        for ( int j = 0; j < 4; ++j )
+            _mm_storeu_si128( (__m128i*) ( block + j * 16 ), rows[j] );
+    }
+    InsetYCoCgBBox( minColor, maxColor );
+    SelectYCoCgDiagonal( block, minColor, maxColor );
+    
+    EmitByte( maxColor[3], outData );
+    EmitByte( minColor[3], outData );
+
+    EmitAlphaIndicesSSE2( rows, minColor[3], maxColor[3], outData );
+    
+    EmitUShort( ColorTo565( maxColor ), outData );
+    EmitUShort( ColorTo565( minColor ), outData );
+    
+    EmitColorIndicesSSE2( rows, minColor, maxColor, outData );
+}
+
+#elif defined(USE_DXT_NEON)
+
+// The NEON block encoder loads the block split into its 4 channels of 16 texels.
+
+static ALWAYS_INLINE byte MinBytesNEON( uint8x16_t a )
+{
+    uint8x8_t m = vmin_u8( vget_low_u8( a ), vget_high_u8( a ) );
+    m = vpmin_u8( m, m );
+    m = vpmin_u8( m, m );
+    m = vpmin_u8( m, m );
+    return vget_lane_u8( m, 0 );
+}
+
+static ALWAYS_INLINE byte MaxBytesNEON( uint8x16_t a )
+{
+    uint8x8_t m = vmax_u8( vget_low_u8( a ), vget_high_u8( a ) );
+    m = vpmax_u8( m, m );
+    m = vpmax_u8( m, m );
+    m = vpmax_u8( m, m );
+    return vget_lane_u8( m, 0 );
+}
+
+// Returns a 16 bit value with bit i set if byte i of low:high is set.
+static ALWAYS_INLINE unsigned int MoveMaskNEON( uint8x8_t low, uint8x8_t high )
+{
+    static const byte kBitWeights[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+    const uint8x8_t weights = vld1_u8( kBitWeights );
+
+    uint8x8_t bits = vpadd_u8( vand_u8( low, weights ), vand_u8( high, weights ) );
+    bits = vpadd_u8( bits, bits );
+    bits = vpadd_u8( bits, bits );
+    return vget_lane_u8( bits, 0 ) | ( vget_lane_u8( bits, 1 ) << 8 );
+}
+
+static ALWAYS_INLINE uint8x16_t ScaleChromaNEON( uint8x16_t c, const int scale )
+{
+    // ( c - 128 ) * scale + 128 wraps to c * scale + 128 in a byte when the scale is 2 or 4.
+    uint8x16_t scaled = vaddq_u8( c, c );
+    if ( scale == 4 )
+        scaled = vaddq_u8( scaled, scaled );
+    return vaddq_u8( scaled, vdupq_n_u8( 128 ) );
+}
+
+static ALWAYS_INLINE void EmitAlphaIndicesNEON( uint8x16_t alpha, const byte minAlpha, const byte maxAlpha, byte*& outData )
+{
+    byte ab[8];
+    byte indexes[16];
+
+    GetAlphaIndexBounds( minAlpha, maxAlpha, ab );
+
+    uint8x16_t count = vdupq_n_u8( 0 );
+    for ( int i = 1; i < 8; ++i )
+        count = vsubq_u8( count, vcleq_u8( alpha, vdupq_n_u8( ab[i] ) ) );
+
+    uint8x16_t index = vandq_u8( vaddq_u8( count, vdupq_n_u8( 1 ) ), vdupq_n_u8( 7 ) );
+    index = veorq_u8( index, vandq_u8( vcltq_u8( index, vdupq_n_u8( 2 ) ), vdupq_n_u8( 1 ) ) );
+    vst1q_u8( indexes, index );
+
+    EmitAlphaIndexBytes( indexes, outData );
+}
+
+static ALWAYS_INLINE void SelectColorIndexBitsNEON( const uint16x8_t *d, uint8x8_t& lowBits, uint8x8_t& highBits )
+{
+    const uint16x8_t b0 = vcgtq_u16( d[0], d[3] );
+    const uint16x8_t b1 = vcgtq_u16( d[1], d[2] );
+    const uint16x8_t b2 = vcgtq_u16( d[0], d[2] );
+    const uint16x8_t b3 = vcgtq_u16( d[1], d[3] );
+    const uint16x8_t b4 = vcgtq_u16( d[2], d[3] );
+
+    lowBits = vmovn_u16( vandq_u16( b0, b4 ) );
+    highBits = vmovn_u16( vorrq_u16( vandq_u16( b1, b2 ), vandq_u16( b0, b3 ) ) );
+}
+
+static ALWAYS_INLINE void EmitColorIndicesNEON( uint8x16_t co, uint8x16_t cg, const byte *minColor, const byte *maxColor, byte*& outData )
+{
+    word colors[4][4];
+    GetColorIndexTable( minColor, maxColor, colors );
+
+    uint16x8_t dLow[4];
+    uint16x8_t dHigh[4];
+    for ( int k = 0; k < 4; ++k )
+    {
+        const uint8x16_t d0 = vabdq_u8( co, vdupq_n_u8( (byte) colors[k][0] ) );
+        const uint8x16_t d1 = vabdq_u8( cg, vdupq_n_u8( (byte) colors[k][1] ) );
+        dLow[k] = vaddl_u8( vget_low_u8( d0 ), vget_low_u8( d1 ) );
+        dHigh[k] = vaddl_u8( vget_high_u8( d0 ), vget_high_u8( d1 ) );
+    }
+
+    uint8x8_t lowBitsLow, highBitsLow, lowBitsHigh, highBitsHigh;
+    SelectColorIndexBitsNEON( dLow, lowBitsLow, highBitsLow );
+    SelectColorIndexBitsNEON( dHigh, lowBitsHigh, highBitsHigh );
+
+    const unsigned int low = MoveMaskNEON( lowBitsLow, lowBitsHigh );
+    const unsigned int high = MoveMaskNEON( highBitsLow, highBitsHigh );
+
+    EmitUInt( SpreadBits16( low ) | ( SpreadBits16( high ) << 1 ), outData );
+}
+
+static void EncodeYCoCgDXT5BlockNEON( byte *block, byte*& outData )
+{
+    byte minColor[4];
+    byte maxColor[4];
+    uint8x16x4_t channels = vld4q_u8( block );
+
+    // Like GetMinMaxYCoCg, the alpha (offset 2) is left out.
+    minColor[0] = MinBytesNEON( channels.val[0] );
+    minColor[1] = MinBytesNEON( channels.val[1] );
+    minColor[2] = 255;
+    minColor[3] = MinBytesNEON( channels.val[3] );
+    maxColor[0] = MaxBytesNEON( channels.val[0] );
+    maxColor[1] = MaxBytesNEON( channels.val[1] );
+    maxColor[2] = 0;
+    maxColor[3] = MaxBytesNEON( channels.val[3] );
+
+    const int scale = ScaleYCoCgBBox( minColor, maxColor );
+    if ( scale != 1 )
+    {
+        channels.val[0] = ScaleChromaNEON( channels.val[0], scale );
+        channels.val[1] = ScaleChromaNEON( channels.val[1], scale );
+        vst4q_u8( block, channels );
+    }
+    InsetYCoCgBBox( minColor, maxColor );
+    SelectYCoCgDiagonal( block, minColor, maxColor );
+    
+    EmitByte( maxColor[3], outData );
+    EmitByte( minColor[3], outData );
+
+    EmitAlphaIndicesNEON( channels.val[3], minColor[3], maxColor[3], outData );
+    
+    EmitUShort( ColorTo565( maxColor ), outData );
+    EmitUShort( ColorTo565( minColor ), outData );
+    
+    EmitColorIndicesNEON( channels.val[0], channels.val[1], minColor, maxColor, outData );
+}
+
+#endif
+
+typedef void (*EncodeYCoCgDXT5BlockFunc)( byte *block, byte*& outData );
+typedef void (*ConvertRowFunc)( byte *pImageRow, int width );
+
+struct YCoCgDXT5Kernels
+{
+    EncodeYCoCgDXT5BlockFunc mEncodeBlock;
+    ConvertRowFunc           mRGBToCoCg_Y;
+    ConvertRowFunc           mCoCg_YToRGBNoAlpha;
+
+    YCoCgDXT5Kernels()
+        : mEncodeBlock(EncodeYCoCgDXT5Block)
+        , mRGBToCoCg_Y(ConvertRowRGBToCoCg_Y)
+        , mCoCg_YToRGBNoAlpha(ConvertRowCoCg_YToRGBNoAlpha)
+    {
+        #if defined(USE_DXT_SSE2)
+            if (HasSSE2())
+            {
+                mEncodeBlock        = EncodeYCoCgDXT5BlockSSE2;
+                mRGBToCoCg_Y        = ConvertRowRGBToCoCg_YSSE2;
+                mCoCg_YToRGBNoAlpha = ConvertRowCoCg_YToRGBNoAlphaSSE2;
+            }
+        #elif defined(USE_DXT_NEON)
+            mEncodeBlock        = EncodeYCoCgDXT5BlockNEON;
+            mRGBToCoCg_Y        = ConvertRowRGBToCoCg_YNEON;
+            mCoCg_YToRGBNoAlpha = ConvertRowCoCg_YToRGBNoAlphaNEON;
+        #endif
+    }
+};
+
+// The best kernels for the processor we run on, picked on first use. The first use is on the main thread and the
+// kernels are handed to the jobs from there.
+static const YCoCgDXT5Kernels& GetYCoCgDXT5Kernels()
+{
+    static YCoCgDXT5Kernels sKernels;
+    return sKernels;
+}
+
+static void ConvertRGBToCoCg_Y(const YCoCgDXT5Kernels& kernels, byte *pImage, int width, int height, int stride)
+{
+    byte *pImageRow = pImage;
+    
+    for (int h = 0; h < height; ++h)
+    {
+        kernels.mRGBToCoCg_Y(pImageRow, width);
+        pImageRow += stride;            // Next line
+    }
+}
+
+static void ConvertCoCg_YToRGBNoAlpha(const YCoCgDXT5Kernels& kernels, byte *pImage, int width, int height, int strideIn)
+{
+    byte *pImageRow = pImage;
+    
+    for (int h = 0; h < height; ++h)
+    {
+        kernels.mCoCg_YToRGBNoAlpha(pImageRow, width);
+        pImageRow += strideIn;             // Next line
+    }
 }
 
 /*F*************************************************************************************************/
 /*!
-    \Function    CompressToYCoCgDXT5( const byte *inBuf, byte *outBuf, const int width, const int height, const int stride ) 
+    \Function    CompressToYCoCgDXT5( const YCoCgDXT5Kernels& kernels, const byte *inBuf, byte *outBuf, const int width, const int height, const int stride ) 
 
-    \Description        This is the C version of the YcoCgDXT5.  
+    \Description        This is the C version of the YcoCgDXT5. The blocks are encoded with the SSE2 or NEON kernels when
+                        the processor has them.
                   
                         Input data needs to be converted from ARGB to YCoCg before calling this function.
                         
@@ -547,6 +1162,7 @@ void EmitColorIndices( const byte *colorBlock, const byte *minColor, const byte
                         4 bytes of indexes into the Chroma CocG table 
                             2 bits per index so 16 indexes total
 
+    \Input              const YCoCgDXT5Kernels& kernels  Kernels from GetYCoCgDXT5Kernels
     \Input              const byte *inBuf   Input buffer of the YCoCG textel data
     \Input              const byte *outBuf  Output buffer for the compressed data
     \Input              int width           in source width 
@@ -557,14 +1173,12 @@ void EmitColorIndices( const byte *colorBlock, const byte *minColor, const byte
 
 */
 /*************************************************************************************************F*/
-int CompressToYCoCgDXT5( const byte *inBuf, byte *outBuf, const int width, const int height , const int stride)
+static int CompressToYCoCgDXT5( const YCoCgDXT5Kernels& kernels, const byte *inBuf, byte *outBuf, const int width, const int height , const int stride)
 {
     int outputBytes = 0;
     byte block[64];
-    byte minColor[4];
-    byte maxColor[4];
+    byte *outData = outBuf;
     
-    globalOutData = outBuf;
     int blockLineSize = stride * 4;  // 4 lines per loop
 
     for ( int j = 0; j < height; j += 4, inBuf +=blockLineSize )
@@ -583,25 +1197,11 @@ int CompressToYCoCgDXT5( const byte *inBuf, byte *outBuf, const int width, const
             {
                 ExtractBlock( inBuf + i * 4, width, stride, block );
             }
-            // A simple min max extract for each color channel including alpha             
-            GetMinMaxYCoCg( block, minColor, maxColor );
-            ScaleYCoCg( block, minColor, maxColor );    // Sets the scale in the min[2] and max[2] offset
-            InsetYCoCgBBox( minColor, maxColor );
-            SelectYCoCgDiagonal( block, minColor, maxColor );
-            
-            EmitByte( maxColor[3] );    // Note: the luma is stored in the alpha channel
-            EmitByte( minColor[3] );
-  
-            EmitAlphaIndices( block, minColor[3], maxColor[3] );
-            
-            EmitUShort( ColorTo565( maxColor ) );
-            EmitUShort( ColorTo565( minColor ) );
-            
-            EmitColorIndices( block, minColor, maxColor );
+            kernels.mEncodeBlock( block, outData );
         }
     }
     
-    outputBytes = globalOutData - outBuf;
+    outputBytes = outData - outBuf;
     
     return outputBytes;
 }
@@ -692,10 +1292,11 @@ static void RestoreChromaBlock( const void * pSource, byte *colorBlock)
     Convert565ToColor( rawColor , &color[1][0] ); 
 
     // EA/Alex Mole: mixing float & int operations is horrifyingly slow on some platforms, so we do it different!
-    color[2][0] = (byte) ( (color[0][0] * 0.75f) + (color[1][0] * 0.25f) );
-    color[2][1] = (byte) ( (color[0][1] * 0.75f) + (color[1][1] * 0.25f) );
-    color[3][0] = (byte) ( (color[0][0] * 0.25f) + (color[1][0] * 0.75f) );
-    color[3][1] = (byte) ( (color[0][1] * 0.25f) + (color[1][1] * 0.75f) );
+    // The 3/4 and 1/4 mixes are done with shifts. They match the float version exactly since it never rounds.
+    color[2][0] = (byte) ( (3 * color[0][0] + color[1][0]) >> 2 );
+    color[2][1] = (byte) ( (3 * color[0][1] + color[1][1]) >> 2 );
+    color[3][0] = (byte) ( (color[0][0] + 3 * color[1][0]) >> 2 );
+    color[3][1] = (byte) ( (color[0][1] + 3 * color[1][1]) >> 2 );
     
     byte scale = ((color[0][2] >> 3) + 1) >> 1; // Adjust for shifts instead of divide
 
@@ -875,6 +1476,116 @@ int DecompressDXT(const byte *inBuf, byte *outBuf, const int width, const int he
     return outByteCount;
 }
 
+// A band of block rows of an image. Every block row has a known place in the compressed data so the bands can be
+// compressed or decompressed on different threads.
+struct YCoCgDXT5Band
+{
+    const YCoCgDXT5Kernels* mpKernels;
+    byte*   mpImage;        // First texel row of the band
+    byte*   mpBlocks;       // First compressed block of the band
+    int     mWidth;
+    int     mHeight;        // Texel rows in the band
+    int     mStride;
+    int     mSize;          // Bytes output by the band
+};
+
+// Converts the band to YCoCg in place and compresses it. This is done a block row at a time so the rows are still in
+// the cache when compressed.
+static void CompressYCoCgDXT5Band(void* pContext)
+{
+    YCoCgDXT5Band* pBand = static_cast<YCoCgDXT5Band*> (pContext);
+    const int blockLineSize = pBand->mStride * 4;
+    byte* pImage = pBand->mpImage;
+    byte* pBlocks = pBand->mpBlocks;
+
+    pBand->mSize = 0;
+    for (int j = 0; j < pBand->mHeight; j += 4, pImage += blockLineSize)
+    {
+        const int rows = (pBand->mHeight - j) < 4 ? (pBand->mHeight - j) : 4;
+        ConvertRGBToCoCg_Y(*pBand->mpKernels, pImage, pBand->mWidth, rows, pBand->mStride);
+        const int size = CompressToYCoCgDXT5(*pBand->mpKernels, pImage, pBlocks, pBand->mWidth, rows, pBand->mStride);
+        pBlocks += size;
+        pBand->mSize += size;
+    }
+}
+
+// Decompresses the band and converts it back to RGB a block row at a time.
+static void DecompressYCoCgDXT5Band(void* pContext)
+{
+    YCoCgDXT5Band* pBand = static_cast<YCoCgDXT5Band*> (pContext);
+    const int blockLineSize = pBand->mStride * 4;
+    const int blockRowSize = ((pBand->mWidth + 3) >> 2) * 16;  // 16 bytes per block of compressed data
+    byte* pImage = pBand->mpImage;
+    const byte* pBlocks = pBand->mpBlocks;
+
+    pBand->mSize = 0;
+    for (int j = 0; j < pBand->mHeight; j += 4, pImage += blockLineSize, pBlocks += blockRowSize)
+    {
+        const int rows = (pBand->mHeight - j) < 4 ? (pBand->mHeight - j) : 4;
+        pBand->mSize += DecompressDXT(pBlocks, pImage, pBand->mWidth, rows, pBand->mStride);
+        ConvertCoCg_YToRGBNoAlpha(*pBand->mpKernels, pImage, pBand->mWidth, rows, pBand->mStride);
+    }
+}
+
+// Runs bandFunction over the image and returns the sum of the band sizes. If mEnableParallelImageCompression is set,
+// large images are split in bands that run on the thread pool, with the calling thread taking the first band.
+static int RunYCoCgDXT5Bands(DoWorkEntryPoint bandFunction, byte* pImage, byte* pBlocks, const int width, const int height, const int stride)
+{
+    static const int kMinBandBlockRows = 16;    // 64 texel rows. Smaller bands are not worth the scheduling.
+    static const int kMaxBandCount = 16;
+
+    if ((width <= 0) || (height <= 0))
+        return 0;
+
+    const YCoCgDXT5Kernels& kernels = GetYCoCgDXT5Kernels();
+    const int blockRows = (height + 3) >> 2;
+    const int blockRowSize = ((width + 3) >> 2) * 16;
+
+    int bandCount = 1;
+    if (EA::WebKit::GetParameters().mEnableParallelImageCompression && (blockRows >= (kMinBandBlockRows * 2)))
+    {
+        bandCount = (int) EA::WebKit::ThreadPool::GetInstance().GetWorkerCount() + 1;
+        if (bandCount > (blockRows / kMinBandBlockRows))
+            bandCount = blockRows / kMinBandBlockRows;
+        if (bandCount > kMaxBandCount)
+            bandCount = kMaxBandCount;
+    }
+
+    YCoCgDXT5Band bands[kMaxBandCount];
+    const int bandBlockRows = (blockRows + bandCount - 1) / bandCount;
+    bandCount = 0;
+    for (int blockRow = 0; blockRow < blockRows; blockRow += bandBlockRows)
+    {
+        YCoCgDXT5Band& band = bands[bandCount++];
+        band.mpKernels = &kernels;
+        band.mpImage = pImage + blockRow * 4 * stride;
+        band.mpBlocks = pBlocks + blockRow * blockRowSize;
+        band.mWidth = width;
+        band.mHeight = ((blockRow + bandBlockRows) * 4 < height) ? (bandBlockRows * 4) : (height - blockRow * 4);
+        band.mStride = stride;
+        band.mSize = 0;
+    }
+
+    if (bandCount > 1)
+    {
+        EA::WebKit::ThreadPool& threadPool = EA::WebKit::ThreadPool::GetInstance();
+        EA::WebKit::ThreadPoolWorkGroup workGroup;
+        for (int i = 1; i < bandCount; ++i)
+            threadPool.ScheduleWork(bandFunction, &bands[i], &workGroup);
+        bandFunction(&bands[0]);
+        threadPool.Wait(&workGroup);
+    }
+    else
+    {
+        bandFunction(&bands[0]);
+    }
+
+    int size = 0;
+    for (int i = 0; i < bandCount; ++i)
+        size += bands[i].mSize;
+    return size;
+}
+
 /*F*************************************************************************************************/
 /*!
     \Function           CompressDXT()
@@ -895,18 +1606,18 @@ int DecompressDXT(const byte *inBuf, byte *outBuf, const int width, const int he
 /*************************************************************************************************F*/
 static int CompressDXT(void* pSource,const int sourceSize, const int width, const int height, const int stride, void* pOut, const int outSize)
 {
-    // At this point, we have everything we need so can use the old ARGB buffer directly and modify it
-	ConvertRGBToCoCg_Y((byte*)pSource, width, height, stride);
+    // At this point, we have everything we need so can use the old ARGB buffer directly and modify it.
+    // The bands convert it to YCoCg as they compress it.
     const int headerSize = sizeof(CompressionHeader);
     int outputSize = 0;
     byte* pOutBuffer = (byte*) pOut + headerSize;
 
-    outputSize = CompressToYCoCgDXT5((byte*)pSource, pOutBuffer, width, height, stride); 
+    outputSize = RunYCoCgDXT5Bands(CompressYCoCgDXT5Band, (byte*)pSource, pOutBuffer, width, height, stride); 
     if (outputSize <= 0)
     {
         // Compression failed. This is almost impossible unless the height or width is 0?  
         // Restore colors just in case...
-        ConvertCoCg_YToRGBNoAlpha((byte*)pSource, width, height, stride);
+        ConvertCoCg_YToRGBNoAlpha(GetYCoCgDXT5Kernels(), (byte*)pSource, width, height, stride);
         return 0;
     }
 
@@ -1247,6 +1958,16 @@ static int CompressRLE(const void* pSource,const int sourceSize, const int w, co
 // Release the buffer which has the compressed image.
 void ImageCompressionReleaseBuffer(void* pBuffer)
 {
+    // Drop the decompressed copy first since it is keyed by the buffer address.
+    DecompressedImageCache::GetInstance().Remove(pBuffer);
+
+    const CompressionHeader* pHeader = reinterpret_cast<const CompressionHeader*> (pBuffer);
+    ImageCompressionStats& stats = sImageCompressionStats;
+    ASSERT(stats.mCompressedImageCount && (stats.mCompressedBytes >= (uint32_t) pHeader->mSize));
+    stats.mCompressedImageCount--;
+    stats.mCompressedBytes -= pHeader->mSize;
+    stats.mUncompressedBytes -= pHeader->mWidth * pHeader->mHeight * 4;
+
     EA::WebKit::Allocator* pAllocator = EA::WebKit::GetAllocator();
     pAllocator->Free(pBuffer, 0);
 }
@@ -1254,13 +1975,31 @@ void ImageCompressionReleaseBuffer(void* pBuffer)
 // Release the decompressed ARGB buffer used by the surface.
 void ImageCompressionReleaseNativeSurfaceBuffer(void* pBuffer)
 {
-   delete [] (unsigned char*) pBuffer;
+    DecompressedImageCache::GetInstance().ReleaseBuffer((unsigned char*) pBuffer);
+}
+
+void ImageCompressionGetUsage(EA::WebKit::ImageCompressionUsageInfo& usageInfo)
+{
+    const ImageCompressionStats& stats = sImageCompressionStats;
+    usageInfo.mCompressedImageCount = stats.mCompressedImageCount;
+    usageInfo.mCompressedBytes = stats.mCompressedBytes;
+    usageInfo.mSavedBytes = stats.mUncompressedBytes - stats.mCompressedBytes;
+    usageInfo.mCompressions = stats.mCompressions;
+    usageInfo.mDecompressions = stats.mDecompressions;
+
+    DecompressedImageCache::GetInstance().GetUsage(usageInfo);
 }
 
 NativeImagePtr  DecompressImage(void* pIn)
 {
     if (!pIn)
         return 0;
+
+    // Frames that are drawn over and over are only decompressed once.
+    DecompressedImageCache& cache = DecompressedImageCache::GetInstance();
+    NativeImagePtr pCachedImage = cache.Find(pIn);
+    if (pCachedImage)
+        return pCachedImage;
     
     int outSize = 0;
     int curIndex = 0; 
@@ -1271,10 +2010,11 @@ NativeImagePtr  DecompressImage(void* pIn)
     const int h = pHeader->mHeight;
     const int stride = w * 4; 
     const int curStride = (stride >> 2);    
+    ImageCompressionProcessScope processScope(EA::WebKit::kVProcessTypeImageCompressionUnPack, w * h);
 
-    // Allocate the out buffer
+    // Allocate the out buffer (possibly a pooled one of the same size)
     const int bufferSize = stride * h;
-    unsigned char* pOut = new unsigned char[bufferSize];
+    unsigned char* pOut = cache.AllocateBuffer(bufferSize);
     if (!pOut)
         return NULL;
 
@@ -1309,6 +2049,7 @@ NativeImagePtr  DecompressImage(void* pIn)
                 if (sizeCheck > maxBufferSize)
                 {
                     ASSERT(0);                
+                    cache.ReleaseBuffer(pOut);
                     return 0;
                 }
 
@@ -1362,6 +2103,7 @@ NativeImagePtr  DecompressImage(void* pIn)
                 if (sizeCheck > maxBufferSize)
                 {
                     ASSERT(0);           
+                    cache.ReleaseBuffer(pOut);
                     return 0;
                 }
 
@@ -1392,8 +2134,7 @@ NativeImagePtr  DecompressImage(void* pIn)
         {
             char* pCompressed = (char*) (pHeader + 1);    
 
-            outSize = DecompressDXT((byte*) pCompressed, (byte*) pOut, w, h, stride); 
-            ConvertCoCg_YToRGBNoAlpha((byte*)pOut, w, h, stride);
+            outSize = RunYCoCgDXT5Bands(DecompressYCoCgDXT5Band, (byte*) pOut, (byte*) pCompressed, w, h, stride); 
         }
         break;
 
@@ -1402,6 +2143,8 @@ NativeImagePtr  DecompressImage(void* pIn)
             break;
     }
 
+    sImageCompressionStats.mDecompressions++;
+
     // Create the Cairo surface.
     NativeImagePtr pImage = cairo_image_surface_create_for_data(pOut,CAIRO_FORMAT_ARGB32, w, h, stride);
     
@@ -1409,6 +2152,9 @@ NativeImagePtr  DecompressImage(void* pIn)
     cairo_status_t status = cairo_surface_set_user_data(pImage,(cairo_user_data_key_t*) ImageCompressionGetUserDataKey(), pOut, ImageCompressionReleaseNativeSurfaceBuffer);
     (void) status;
     ASSERT (status == CAIRO_STATUS_SUCCESS); // If this fails, the surface data buffer will leak.
+
+    // The cache keeps its own reference. The caller still destroys the surface when done with it.
+    cache.Add(pIn, pImage, bufferSize);
     
     return pImage;
 }
@@ -1429,6 +2175,7 @@ void* CompressImage(NativeImagePtr pImage, bool hasAlpha, int& outSize)
     int height = cairo_image_surface_get_height(pImage);
     int stride = cairo_image_surface_get_stride (pImage);
     const int sourceSize = width * height * 4;                                  
+    ImageCompressionProcessScope processScope(EA::WebKit::kVProcessTypeImageCompressionPack, width * height);
     const int headerSize = sizeof(CompressionHeader);
 
     // Set up the compressed buffer.  The size depends on if we have alpha or not.
@@ -1457,11 +2204,19 @@ void* CompressImage(NativeImagePtr pImage, bool hasAlpha, int& outSize)
         return 0;   
 
     // RLE compression
+    ImageCompressionStats& stats = sImageCompressionStats;
     int compressedSize = CompressRLE(pSource, sourceSize, width, height, stride, hasAlpha, pDest, destSize);
     if (compressedSize)
     {
         // Resize to compressed size
-        pAllocator->Realloc(pDest, compressedSize, 0);
+        void* pResized = pAllocator->Realloc(pDest, compressedSize, 0);
+        if (pResized)
+            pDest = pResized;
+        outSize = compressedSize;
+        stats.mCompressions++;
+        stats.mCompressedImageCount++;
+        stats.mCompressedBytes += compressedSize;
+        stats.mUncompressedBytes += sourceSize;
         return pDest;
     }
    
@@ -1470,11 +2225,18 @@ void* CompressImage(NativeImagePtr pImage, bool hasAlpha, int& outSize)
     if (!hasAlpha)
     {
         compressedSize = CompressDXT(pSource, sourceSize, width, height, stride, pDest, destSize);
-        outSize = compressedSize;
-        return pDest;
+        if (compressedSize)
+        {
+            outSize = compressedSize;
+            stats.mCompressions++;
+            stats.mCompressedImageCount++;
+            stats.mCompressedBytes += compressedSize;
+            stats.mUncompressedBytes += sourceSize;
+            return pDest;
+        }
     }
 
-    // Failed (this can happen if the RLE failed and the image had alpha so DXT was not used)
+    // Failed (this can happen if the RLE failed and the image had alpha so DXT was not used, or if DXT had nothing to compress)
     if (!compressedSize)
     {
         // Failed to RLE within the memory budget        
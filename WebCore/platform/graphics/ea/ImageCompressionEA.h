@@ -32,11 +32,16 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cairo.h>
 #include "ImageSource.h"
 
+namespace EA { namespace WebKit {
+    struct ImageCompressionUsageInfo;
+}}
+
 namespace WebCore {
     void* CompressImage(NativeImagePtr pImage, bool hasAlpha, int& outSize);
     NativeImagePtr DecompressImage(void* compressedBuffer);
     void ImageCompressionReleaseBuffer(void* pBuffer);
     void* ImageCompressionGetUserDataKey(void);
+    void ImageCompressionGetUsage(EA::WebKit::ImageCompressionUsageInfo& usageInfo);
 
 } // namespace
 
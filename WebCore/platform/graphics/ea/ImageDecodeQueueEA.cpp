@@ -0,0 +1,162 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "config.h"
+#include "ImageDecodeQueueEA.h"
+
+#include "BitmapImage.h"
+#include "ImageDecoder.h"
+#include "SharedBuffer.h"
+#include <EASTL/algorithm.h>
+#include <EAWebKit/EAWebKit.h>
+#include <EAWebKit/EAWebKitClient.h>
+#include <internal/include/EAWebKitAssert.h>
+#include <internal/include/EAWebKit_p.h>
+#include <wtf/MainThread.h>
+
+namespace WebCore 
+{
+
+ImageDecodeQueue& ImageDecodeQueue::GetInstance()
+{
+    static ImageDecodeQueue instance;
+    return instance;
+}
+
+ImageDecodeQueue::ImageDecodeQueue()
+{
+}
+
+ImageDecodeQueue::~ImageDecodeQueue()
+{
+    EAW_ASSERT_MSG(mJobs.empty(), "ImageDecodeQueue::Clear needs to be called on shutdown");
+}
+
+ImageDecodeJob* ImageDecodeQueue::Schedule(BitmapImage* pImage, NativeImageSourcePtr pDecoder, SharedBuffer* pData)
+{
+    // Merge the segments of the buffer now. Reading it has to be free of side effects once the worker shares it.
+    pData->data();
+
+    ImageDecodeJob* pJob = new ImageDecodeJob;
+    pJob->mpImage       = pImage;
+    pJob->mpDecoder     = pDecoder;
+    pJob->mData         = pData;
+    pJob->mDecodeTime   = 0.0;
+    pJob->mbDecoded     = false;
+    mJobs.push_back(pJob);
+
+    EA::WebKit::ThreadPool::GetInstance().ScheduleWork(DecodeJob, pJob, &pJob->mWorkGroup);
+    return pJob;
+}
+
+NativeImageSourcePtr ImageDecodeQueue::Finish(ImageDecodeJob* pJob)
+{
+    EA::WebKit::ThreadPool::GetInstance().Wait(&pJob->mWorkGroup);
+    return Complete(pJob);
+}
+
+void ImageDecodeQueue::Cancel(ImageDecodeJob* pJob)
+{
+    pJob->mpImage = NULL;
+}
+
+void ImageDecodeQueue::Clear()
+{
+    while (!mJobs.empty())
+    {
+        ImageDecodeJob* pJob = mJobs.back();
+        BitmapImage* pImage = pJob->mpImage;
+        NativeImageSourcePtr pDecoder = Finish(pJob);
+        if (pImage)
+            pImage->asyncDecodeCompleted(pDecoder);
+        else
+            delete pDecoder;
+    }
+}
+
+void ImageDecodeQueue::DecodeJob(void* pContext)
+{
+    ImageDecodeJob* pJob = static_cast<ImageDecodeJob*>(pContext);
+    
+    const double startTime = EA::WebKit::GetTime();
+    pJob->mpDecoder->frameBufferAtIndex(0); // All the data is there, so this decodes the whole frame.
+    pJob->mDecodeTime = EA::WebKit::GetTime() - startTime;
+    pJob->mbDecoded = true;
+
+    // The job may be finished and deleted by the main thread from here on, so the pickup only refers to the queue.
+    WTF::callOnMainThread(DecodesCompleted, NULL);
+}
+
+void ImageDecodeQueue::DecodesCompleted(void*)
+{
+    GetInstance().PickUpDecodedJobs();
+}
+
+NativeImageSourcePtr ImageDecodeQueue::Complete(ImageDecodeJob* pJob)
+{
+    JobList::iterator it = eastl::find(mJobs.begin(), mJobs.end(), pJob);
+    EAW_ASSERT(it != mJobs.end());
+    mJobs.erase(it);
+
+    EA::WebKit::ViewProcessInfo processInfo(EA::WebKit::kVProcessTypeImageDecoder, EA::WebKit::kVProcessStatusNone);
+    processInfo.mpUserData = NULL;
+    processInfo.mSize = (int) (pJob->mDecodeTime * 1000000.0);
+    NOTIFY_PROCESS_STATUS(processInfo, EA::WebKit::kVProcessStatusEnded);
+
+    NativeImageSourcePtr pDecoder = pJob->mpDecoder;
+    delete pJob;    // Releases the data on the main thread.
+    return pDecoder;
+}
+
+void ImageDecodeQueue::PickUpDecodedJobs()
+{
+    EA::WebKit::ThreadPool& threadPool = EA::WebKit::ThreadPool::GetInstance();
+    
+    // An image may schedule a new decode from its completion, so go over the list by index. A pickup can find jobs that
+    // an earlier one already took, or that were finished meanwhile, so finding nothing to do is expected.
+    for (eastl_size_t i = 0; i < mJobs.size(); )
+    {
+        ImageDecodeJob* pJob = mJobs[i];
+        if (!pJob->mbDecoded)
+        {
+            ++i;
+            continue;
+        }
+
+        // The worker may still be on its way out of the job, which the wait covers.
+        threadPool.Wait(&pJob->mWorkGroup);
+        BitmapImage* pImage = pJob->mpImage;
+        NativeImageSourcePtr pDecoder = Complete(pJob);
+        if (pImage)
+            pImage->asyncDecodeCompleted(pDecoder);
+        else
+            delete pDecoder;
+    }
+}
+
+}
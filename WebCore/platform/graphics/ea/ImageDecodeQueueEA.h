@@ -0,0 +1,85 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef ImageDecodeQueueEA_h
+#define ImageDecodeQueueEA_h
+
+#include "ImageSource.h"
+#include <wtf/RefPtr.h>
+#include <EASTL/vector.h>
+#include <EAWebKit/EAWebkitAllocator.h>
+#include <internal/include/EAWebKitThreadPool.h>
+
+namespace WebCore 
+{
+    class BitmapImage;
+    class SharedBuffer;
+
+    // The decode of a frame on the thread pool. The worker only touches the decoder and the decode time; everything else
+    // belongs to the main thread.
+    struct ImageDecodeJob
+    {
+        BitmapImage*                    mpImage;        // NULL once the image gave up on the frame.
+        NativeImageSourcePtr            mpDecoder;      // Made from the complete data, so that the worker never shares a decoder with the main thread.
+        RefPtr<SharedBuffer>            mData;          // Keeps the encoded data alive until the decoder is done with it.
+        double                          mDecodeTime;    // In seconds, set by the worker.
+        volatile bool                   mbDecoded;      // Set by the worker once the decode is done, before it posts the pickup.
+        EA::WebKit::ThreadPoolWorkGroup mWorkGroup;
+    };
+
+    // Decodes the frames of complete images on the EAWebKit thread pool so that painting a large image does not stall
+    // the main thread (Parameters::mEnableAsyncImageDecoding). Each worker posts a pickup to the main thread with
+    // callOnMainThread when its decode is done, which hands the decoder to its image on the next tick, so nothing runs on the
+    // main thread while the decodes are in progress. Each decode is reported as kVProcessTypeImageDecoder with its worker
+    // time. Main thread only.
+    class ImageDecodeQueue
+    {
+    public:
+        static ImageDecodeQueue& GetInstance();
+
+        ImageDecodeJob* Schedule(BitmapImage* pImage, NativeImageSourcePtr pDecoder, SharedBuffer* pData); // Takes the decoder.
+        NativeImageSourcePtr Finish(ImageDecodeJob* pJob);    // Waits for the job and returns its decoder. The job is deleted.
+        void Cancel(ImageDecodeJob* pJob);  // The job is deleted along with its decoder once the worker is done with it.
+        void Clear();   // Waits for all the jobs. Needs to be called before shutdown, as the images belong to WebCore.
+
+    private:
+        ImageDecodeQueue();
+        ~ImageDecodeQueue();
+
+        static void DecodeJob(void* pContext);
+        static void DecodesCompleted(void* pContext);
+        NativeImageSourcePtr Complete(ImageDecodeJob* pJob);
+        void PickUpDecodedJobs();
+
+        typedef eastl::vector<ImageDecodeJob*, EA::WebKit::EASTLAllocator> JobList;
+
+        JobList mJobs;  // Oldest first.
+    };
+}
+
+#endif // ImageDecodeQueueEA_h
@@ -27,6 +27,10 @@
 #include "config.h"
 #include "BitmapImage.h"
 
+#include "ImageDecodeQueueEA.h"
+#include "ImageDecoder.h"
+#include "ImageObserver.h"
+#include "IntRect.h"
 #include <cairo/cairo.h>
 #include <internal/include/EAWebKit_p.h>
 
@@ -67,6 +71,148 @@ void BitmapImage::invalidatePlatformData()
 {
 }
 
+// Smaller images decode faster than the frame they would otherwise be missing from.
+static const int kMinAsyncDecodePixels = 128 * 128;
+
+bool BitmapImage::decodeCurrentFrameAsync()
+{
+    if (m_decodeJob)
+        return true;
+
+    if (m_currentFrame || !m_allDataReceived || !EA::WebKit::GetParameters().mEnableAsyncImageDecoding)
+        return false;
+
+    // Already decoded (or compressed), and animations keep decoding their frames in sequence on the main thread.
+    if (!m_frames.isEmpty() && (m_frames[0].m_frame || m_frames[0].m_compressedDataBuffer))
+        return false;
+    if (frameCount() != 1)
+        return false;
+
+    const IntSize imageSize = size();
+    if (imageSize.width() * imageSize.height() < kMinAsyncDecodePixels)
+        return false;
+
+    // A decoder that failed would fail again on a worker, over and over.
+    if (!m_source.initialized() || m_source.GetDecoder()->failed())
+        return false;
+
+    // Without worker threads, the pool would decode right here anyway.
+    if (!EA::WebKit::ThreadPool::GetInstance().GetWorkerCount())
+        return false;
+
+    NativeImageSourcePtr decoder = m_source.createDecoder(data());
+    if (!decoder)
+        return false;
+
+    m_decodeJob = ImageDecodeQueue::GetInstance().Schedule(this, decoder, data());
+    return true;
+}
+
+void BitmapImage::asyncDecodeCompleted(NativeImageSourcePtr decoder)
+{
+    m_decodeJob = 0;
+    m_source.adoptDecoder(decoder);
+    cacheFrame(0);
+
+    // The renderers drew nothing while the frame was decoding.
+    if (imageObserver())
+        imageObserver()->changedInRect(this, IntRect(IntPoint(), size()));
+}
+
+void BitmapImage::finishAsyncDecode()
+{
+    if (!m_decodeJob)
+        return;
+
+    ImageDecodeJob* job = m_decodeJob;
+    m_decodeJob = 0;
+    m_source.adoptDecoder(ImageDecodeQueue::GetInstance().Finish(job));
+
+    if (imageObserver())
+        imageObserver()->changedInRect(this, IntRect(IntPoint(), size()));
+}
+
+void BitmapImage::cancelAsyncDecode()
+{
+    if (!m_decodeJob)
+        return;
+
+    ImageDecodeQueue::GetInstance().Cancel(m_decodeJob);
+    m_decodeJob = 0;
+}
+
+// Decode to display size usage, over all images. Only first frames decoded smaller than their image are counted.
+static unsigned sDecodeSavedBytes = 0;
+static unsigned sReducedImageCount = 0;
+static unsigned sRedecodeCount = 0;
+
+void BitmapImage::requestDecodedSize(const IntSize& displaySize)
+{
+    if (!EA::WebKit::GetParameters().mEnableDecodeToDisplaySize)
+        return;
+
+    // Animations decode their frames one after the other out of a single decoder, always at full size.
+    if (m_currentFrame || !m_allDataReceived || frameCount() != 1)
+        return;
+
+    const IntSize imageSize = size();
+    const IntSize requestedSize = displaySize.shrunkTo(imageSize);
+    if (requestedSize.isEmpty())
+        return;
+
+    const bool decoded = !m_frames.isEmpty() && (m_frames[0].m_frame || m_frames[0].m_compressedDataBuffer);
+    if (decoded && m_decodedFrameSize.width() >= requestedSize.width() && m_decodedFrameSize.height() >= requestedSize.height())
+        return;
+
+    // A pending decode is left alone. Should its frame come out too small, the next draw asks again.
+    if (m_decodeJob)
+        return;
+
+    // The target only grows, so an image shown smaller than before keeps the frame it has.
+    const IntSize targetSize = m_decodeTargetSize.expandedTo(requestedSize);
+    if (targetSize == m_decodeTargetSize)
+        return;
+    m_decodeTargetSize = targetSize;
+
+    // An empty target has the decoder produce the full image.
+    m_source.setDecodeTargetSize(targetSize == imageSize ? IntSize() : targetSize);
+
+    if (decoded) {
+        // Drawn larger than the frame was decoded for: drop it and decode again, at the new target.
+        ++sRedecodeCount;
+        destroyDecodedData(true);
+    }
+}
+
+IntSize BitmapImage::decodedFrameSize(size_t index) const
+{
+    // Only the first frame of a still image is ever decoded smaller than the image.
+    return (index || m_decodedFrameSize.isEmpty()) ? m_size : m_decodedFrameSize;
+}
+
+void BitmapImage::setDecodedFrameSize(const IntSize& frameSize)
+{
+    if (m_decodeSavedBytes) {
+        sDecodeSavedBytes -= m_decodeSavedBytes;
+        --sReducedImageCount;
+        m_decodeSavedBytes = 0;
+    }
+
+    m_decodedFrameSize = frameSize;
+    if (!frameSize.isEmpty() && frameSize != m_size) {
+        m_decodeSavedBytes = (m_size.width() * m_size.height() - frameSize.width() * frameSize.height()) * 4;
+        sDecodeSavedBytes += m_decodeSavedBytes;
+        ++sReducedImageCount;
+    }
+}
+
+void BitmapImage::getDecodeToDisplaySizeUsage(unsigned& savedBytes, unsigned& reducedImageCount, unsigned& redecodeCount)
+{
+    savedBytes = sDecodeSavedBytes;
+    reducedImageCount = sReducedImageCount;
+    redecodeCount = sRedecodeCount;
+}
+
 PassRefPtr<Image> Image::loadPlatformResource(const char *name)
 {
     RefPtr<BitmapImage> img = 0;
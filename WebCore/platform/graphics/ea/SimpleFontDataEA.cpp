@@ -24,6 +24,7 @@
 
 #include <EAWebKit/EAWebKitTextInterface.h>
 #include <internal/include/EAWebKitAssert.h>
+#include <internal/include/EAWebKit_p.h>
 
 namespace WebCore {
 
@@ -144,8 +145,18 @@ float SimpleFontData::platformWidthForGlyph(Glyph glyphId) const
     EA::WebKit::GlyphMetrics glyphMetrics;
     glyphMetrics.mfHAdvanceX = m_spaceWidth; // Default value.
     if(pFont)
+    {
 		pFont->GetGlyphMetrics(glyphId, glyphMetrics);
 
+        // This is the first time layout measures this glyph with this font, so it is likely to be drawn soon. Let the 
+        // text system rasterize it ahead of the paint.
+        if(EA::WebKit::ITextSystem* pTextSystem = EA::WebKit::GetTextSystem())
+        {
+            const EA::WebKit::GlyphId glyphIdEA = glyphId;
+            pTextSystem->PrefetchGlyphs(pFont, &glyphIdEA, 1);
+        }
+    }
+
     return glyphMetrics.mfHAdvanceX;
 }
 
@@ -40,9 +40,12 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Page.h"
 #include "WebPage.h"
 #include "WebFrame_p.h"
+#include "TileSurfacePoolEA.h"
 
 #include <EAWebkit/EAWebKitHardwareRenderer.h>
 #include <EAWebkit/EAWebKitSurface.h>
+#include <EAWebkit/EAWebKitClient.h>
+#include <internal/include/EAWebKit_p.h>
 
 #include "RefPtrCairo.h"
 #include "PlatformContextCairo.h"
@@ -57,15 +60,21 @@ TileEA::TileEA(TiledBackingStore* backingStore, const Coordinate& tileCoordinate
 , mSurface(NULL)
 , mRenderer(view->GetHardwareRenderer())
 , mView(view)
+, mRasterTime(0.0)
 {
+    mLockedSurface.mData = NULL;
+    mLockedSurface.mStride = 0;
+
     mView->AddTile(this);
 }
 
 TileEA::~TileEA(void)
 {
+    finishRasterization();
+
     if (mSurface)
     {
-        mSurface->Release();
+        mView->GetTileSurfacePool()->Release(mSurface, mRect.width(), mRect.height());
         mSurface = NULL;
     }
 	mView->RemoveTile(this);
@@ -97,53 +106,52 @@ Vector<IntRect> TileEA::updateBackBuffer(void)
 
     if (isDirty())
     {
+        // A tile is only updated once per TiledBackingStore::updateTileBuffers, but be safe.
+        finishRasterization();
+
         if (!mSurface)
-        {
-            mSurface = mRenderer->CreateSurface();
-            mSurface->SetContentDimensions(mRect.width(), mRect.height());
-        }
+            mSurface = mView->GetTileSurfacePool()->Acquire(mRect.width(), mRect.height());
 
         EA::WebKit::ISurface::SurfaceDescriptor surfaceDescriptor = {0};
         // Only lock the portion of the surface that is being rendered to.
         EA::WebKit::IntRect eaRect(0, 0, mRect.width(), mRect.height());
         mSurface->Lock(&surfaceDescriptor, &eaRect);
 
-        RefPtr<cairo_surface_t> cairoSurface = adoptRef(cairo_image_surface_create_for_data((unsigned char*)surfaceDescriptor.mData, CAIRO_FORMAT_ARGB32, eaRect.mSize.mWidth, eaRect.mSize.mHeight, surfaceDescriptor.mStride));    
-        RefPtr<cairo_t> cairoContext = adoptRef(cairo_create(cairoSurface.get()));
-
-        WebCore::GraphicsContext graphicsContext(cairoContext.get());
-
-        // The movie system calls back to the app and needs the offset of the dirty rect.  
-        // It cannot extract it if it is combined with the general translation so we use the device offset instead.
-        cairo_surface_set_device_offset(cairoSurface.get(), -mRect.x(), -mRect.y());
-
-        graphicsContext.clip(mDirtyRect);
-        graphicsContext.scale(FloatSize(mBackingStore->contentsScale(), mBackingStore->contentsScale()));
-        mBackingStore->client()->tiledBackingStorePaint(&graphicsContext, mBackingStore->mapToContents(mDirtyRect));
-
-		if(mView->ShouldDrawDebugVisuals())
-		{
-			const int kLineWidth = 3; 
-			
-			// Draw dirty rects first
-			cairo_save(cairoContext.get());
-			cairo_set_source_rgb(cairoContext.get(), 0, 255, 0);
-			// The width is adjusted below to be thicker when drawing a normal dirty rect which is not full tile. When dirty rect is full tile, we use 
-			// lower width so that the green lines get overridden by blue lines of the tile draw just below and we get nice solid blue lines for tiles.
-			cairo_set_line_width(cairoContext.get(), ((mDirtyRect != mRect) ? 2*kLineWidth : kLineWidth));
-			cairo_rectangle(cairoContext.get(), mDirtyRect.x(), mDirtyRect.y(), mDirtyRect.width(), mDirtyRect.height());
-			cairo_stroke(cairoContext.get());
-
-			// Draw tiles after dirty rects so that we can see them all the time.
-			// Tiles appear to have same thickness even though their line width is half of dirty rects because they are adjacent to each other.
-			cairo_set_source_rgb(cairoContext.get(), 0, 0, 255);
-			cairo_set_line_width(cairoContext.get(), kLineWidth);
-			cairo_rectangle(cairoContext.get(), mRect.x(), mRect.y(), mRect.width(), mRect.height());
-			cairo_stroke(cairoContext.get());
-			cairo_restore(cairoContext.get());
-		}
-
-        mSurface->Unlock();
+        if (EA::WebKit::GetParameters().mEnableParallelTilePainting && EA::WebKit::ThreadPool::GetInstance().GetWorkerCount())
+        {
+            NOTIFY_PROCESS_STATUS(EA::WebKit::kVProcessTypePaintTileRecord, EA::WebKit::kVProcessStatusStarted, mView);
+
+            // The recording gets the same device offset as the tile surface (see below), so the paint sees the same device space either way.
+            cairo_rectangle_t extents;
+            extents.x = mDirtyRect.x() - mRect.x();
+            extents.y = mDirtyRect.y() - mRect.y();
+            extents.width = mDirtyRect.width();
+            extents.height = mDirtyRect.height();
+            mRecording = adoptRef(cairo_recording_surface_create(CAIRO_CONTENT_COLOR_ALPHA, &extents));
+            cairo_surface_set_device_offset(mRecording.get(), -mRect.x(), -mRect.y());
+            RefPtr<cairo_t> cairoContext = adoptRef(cairo_create(mRecording.get()));
+            paintContents(cairoContext.get());
+
+            NOTIFY_PROCESS_STATUS(EA::WebKit::kVProcessTypePaintTileRecord, EA::WebKit::kVProcessStatusEnded, mView);
+
+            mRecordedRect = mDirtyRect;
+            mLockedSurface = surfaceDescriptor;
+            mRasterTime = 0.0;
+            EA::WebKit::ThreadPool::GetInstance().ScheduleWork(rasterizeRecording, this, &mRasterWorkGroup);
+        }
+        else
+        {
+            RefPtr<cairo_surface_t> cairoSurface = adoptRef(cairo_image_surface_create_for_data((unsigned char*)surfaceDescriptor.mData, CAIRO_FORMAT_ARGB32, eaRect.mSize.mWidth, eaRect.mSize.mHeight, surfaceDescriptor.mStride));    
+            RefPtr<cairo_t> cairoContext = adoptRef(cairo_create(cairoSurface.get()));
+
+            // The movie system calls back to the app and needs the offset of the dirty rect.  
+            // It cannot extract it if it is combined with the general translation so we use the device offset instead.
+            cairo_surface_set_device_offset(cairoSurface.get(), -mRect.x(), -mRect.y());
+
+            paintContents(cairoContext.get());
+
+            mSurface->Unlock();
+        }
 
         returnRects.append(mDirtyRect);
         mDirtyRect = IntRect();
@@ -152,9 +160,78 @@ Vector<IntRect> TileEA::updateBackBuffer(void)
     return returnRects;
 }
 
+void TileEA::paintContents(cairo_t* cairoContext)
+{
+    WebCore::GraphicsContext graphicsContext(cairoContext);
+
+    graphicsContext.clip(mDirtyRect);
+    graphicsContext.scale(FloatSize(mBackingStore->contentsScale(), mBackingStore->contentsScale()));
+    mBackingStore->client()->tiledBackingStorePaint(&graphicsContext, mBackingStore->mapToContents(mDirtyRect));
+
+	if(mView->ShouldDrawDebugVisuals())
+	{
+		const int kLineWidth = 3; 
+		
+		// Draw dirty rects first
+		cairo_save(cairoContext);
+		cairo_set_source_rgb(cairoContext, 0, 255, 0);
+		// The width is adjusted below to be thicker when drawing a normal dirty rect which is not full tile. When dirty rect is full tile, we use 
+		// lower width so that the green lines get overridden by blue lines of the tile draw just below and we get nice solid blue lines for tiles.
+		cairo_set_line_width(cairoContext, ((mDirtyRect != mRect) ? 2*kLineWidth : kLineWidth));
+		cairo_rectangle(cairoContext, mDirtyRect.x(), mDirtyRect.y(), mDirtyRect.width(), mDirtyRect.height());
+		cairo_stroke(cairoContext);
+
+		// Draw tiles after dirty rects so that we can see them all the time.
+		// Tiles appear to have same thickness even though their line width is half of dirty rects because they are adjacent to each other.
+		cairo_set_source_rgb(cairoContext, 0, 0, 255);
+		cairo_set_line_width(cairoContext, kLineWidth);
+		cairo_rectangle(cairoContext, mRect.x(), mRect.y(), mRect.width(), mRect.height());
+		cairo_stroke(cairoContext);
+		cairo_restore(cairoContext);
+	}
+}
+
+// Runs on a worker. Only Cairo is used here, on surfaces no other thread touches until the work group is waited on.
+void TileEA::rasterizeRecording(void* pTile)
+{
+    TileEA* tile = static_cast<TileEA*>(pTile);
+    const double startTime = EA::WebKit::GetTime();
+
+    cairo_surface_t* cairoSurface = cairo_image_surface_create_for_data((unsigned char*)tile->mLockedSurface.mData, CAIRO_FORMAT_ARGB32, tile->mRect.width(), tile->mRect.height(), tile->mLockedSurface.mStride);
+    cairo_surface_set_device_offset(cairoSurface, -tile->mRect.x(), -tile->mRect.y());
+    cairo_t* cairoContext = cairo_create(cairoSurface);
+
+    const IntRect& rect = tile->mRecordedRect;
+    cairo_rectangle(cairoContext, rect.x(), rect.y(), rect.width(), rect.height());
+    cairo_clip(cairoContext);
+    cairo_set_source_surface(cairoContext, tile->mRecording.get(), 0, 0);
+    cairo_paint(cairoContext);
+
+    cairo_destroy(cairoContext);
+    cairo_surface_flush(cairoSurface);
+    cairo_surface_destroy(cairoSurface);
+
+    tile->mRasterTime = EA::WebKit::GetTime() - startTime;
+}
+
+void TileEA::finishRasterization()
+{
+    if (!mRecording)
+        return;
+
+    EA::WebKit::ThreadPool::GetInstance().Wait(&mRasterWorkGroup);
+    mRecording = 0;
+    mSurface->Unlock();
+
+    EA::WebKit::ViewProcessInfo processInfo(EA::WebKit::kVProcessTypePaintTileRaster, EA::WebKit::kVProcessStatusNone, mView);
+    processInfo.mpUserData = mView->GetUserData();
+    processInfo.mSize = (int) (mRasterTime * 1000000.0);
+    NOTIFY_PROCESS_STATUS(processInfo, EA::WebKit::kVProcessStatusEnded);
+}
+
 void TileEA::swapBackBufferToFront(void)
 {
-    // We don't need this.
+    finishRasterization();
 }
 
 void TileEA::paint(GraphicsContext* context, const IntRect& rect)
@@ -174,12 +251,15 @@ void TileEA::paint(GraphicsContext* context, const IntRect& rect)
 
 void TileEA::resize(const IntSize& newSize)
 {
+    finishRasterization();
+
+    // Hand the old surface back rather than resizing it; updateBackBuffer picks up one of the new size, possibly a recycled one.
     if (mSurface)
     {
-        mSurface->SetContentDimensions(newSize.width(), newSize.height());
+        mView->GetTileSurfacePool()->Release(mSurface, mRect.width(), mRect.height());
+        mSurface = NULL;
     }
 
-
 //    IntRect oldRect = mRect;
     mRect = IntRect(mRect.location(), newSize);
     invalidate(mRect);
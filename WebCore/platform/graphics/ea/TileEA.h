@@ -32,9 +32,12 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "IntPoint.h"
 #include "IntRect.h"
+#include "RefPtrCairo.h"
 #include "Tile.h"
 #include <wtf/PassRefPtr.h>
 #include <wtf/RefCounted.h>
+#include <EAWebkit/EAWebKitSurface.h>
+#include <internal/include/EAWebKitThreadPool.h>
 
 namespace EA { namespace WebKit {
     class View;
@@ -49,6 +52,10 @@ namespace WebCore
     // This is our Tiled Backing Store implementation. It just uses Cairo to paint into the tiles, and then
     // it uses our IHardwareRenderer interface to send the tiles to the GPU. The WebCore TiledBackingStore class
     // does most of the heavy lifting.
+    //
+    // With Parameters::mEnableParallelTilePainting, updateBackBuffer only records the paint into a Cairo recording
+    // surface and leaves the tile surface locked. The recording is rasterized into it on the thread pool, and
+    // swapBackBufferToFront waits for that before unlocking the surface.
     class TileEA : public Tile 
     {
     public:
@@ -76,6 +83,10 @@ namespace WebCore
     private:
         TileEA(TiledBackingStore*, const Coordinate&, EA::WebKit::View*);
 
+        void paintContents(cairo_t*);
+        void finishRasterization();
+        static void rasterizeRecording(void* pTile);
+
         TiledBackingStore* mBackingStore;
         Coordinate mCoordinate;
         IntRect mRect;
@@ -83,6 +94,12 @@ namespace WebCore
         EA::WebKit::ISurface *mSurface;
         EA::WebKit::IHardwareRenderer *mRenderer;
 		EA::WebKit::View* mView;
+
+        RefPtr<cairo_surface_t> mRecording;                     // Not null while the rasterization is pending.
+        IntRect mRecordedRect;                                  // The dirty rect painted into mRecording.
+        EA::WebKit::ISurface::SurfaceDescriptor mLockedSurface; // mSurface data, locked until the rasterization is done.
+        double mRasterTime;                                     // Seconds spent by the worker on the rasterization.
+        EA::WebKit::ThreadPoolWorkGroup mRasterWorkGroup;
     };
 }
 #endif
@@ -0,0 +1,127 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "config.h"
+
+#if ENABLE(TILED_BACKING_STORE)
+
+#include "TileSurfacePoolEA.h"
+
+#include <EAWebkit/EAWebKitHardwareRenderer.h>
+#include <EAWebkit/EAWebKitSurface.h>
+#include <internal/include/EAWebKitAssert.h>
+
+namespace WebCore {
+
+static uint32_t GetSurfaceSize(int width, int height)
+{
+    return (uint32_t) (width * height * 4);
+}
+
+TileSurfacePool::TileSurfacePool()
+    : mpRenderer(NULL)
+    , mBudget(0)
+    , mUsedSize(0)
+    , mPooledSize(0)
+{
+}
+
+TileSurfacePool::~TileSurfacePool()
+{
+    EAW_ASSERT_MSG(mPooledSurfaces.empty(), "Tile surfaces left in the pool. Clear should be called before the renderer goes away.");
+    Clear();
+}
+
+EA::WebKit::ISurface* TileSurfacePool::Acquire(int width, int height)
+{
+    const uint32_t size = GetSurfaceSize(width, height);
+    mUsedSize += size;
+
+    // Most recently released first, as it is the most likely to still be resident.
+    for (int i = (int) mPooledSurfaces.size() - 1; i >= 0; --i)
+    {
+        const PooledSurface& pooledSurface = mPooledSurfaces[i];
+        if ((pooledSurface.mWidth == width) && (pooledSurface.mHeight == height))
+        {
+            EA::WebKit::ISurface* pSurface = pooledSurface.mpSurface;
+            mPooledSurfaces.erase(mPooledSurfaces.begin() + i);
+            mPooledSize -= size;
+            return pSurface;
+        }
+    }
+
+    // Release the pooled surfaces the new one needs the room of.
+    if (mBudget)
+        Trim((mUsedSize < mBudget) ? (mBudget - mUsedSize) : 0);
+
+    EAW_ASSERT(mpRenderer);
+    EA::WebKit::ISurface* pSurface = mpRenderer->CreateSurface();
+    pSurface->SetContentDimensions(width, height);
+    return pSurface;
+}
+
+void TileSurfacePool::Release(EA::WebKit::ISurface* pSurface, int width, int height)
+{
+    const uint32_t size = GetSurfaceSize(width, height);
+    EAW_ASSERT(mUsedSize >= size);
+    mUsedSize -= size;
+
+    if (mBudget && ((mUsedSize + mPooledSize + size) > mBudget))
+    {
+        pSurface->Release();
+        return;
+    }
+
+    if (mPooledSurfaces.size() >= kMaxPooledSurfaceCount)
+        Trim(mPooledSize - GetSurfaceSize(mPooledSurfaces.front().mWidth, mPooledSurfaces.front().mHeight));
+
+    PooledSurface pooledSurface = { pSurface, width, height };
+    mPooledSurfaces.push_back(pooledSurface);
+    mPooledSize += size;
+}
+
+void TileSurfacePool::Clear()
+{
+    Trim(0);
+}
+
+// Releases the oldest pooled surfaces until they fit in pooledSize bytes.
+void TileSurfacePool::Trim(uint32_t pooledSize)
+{
+    while (!mPooledSurfaces.empty() && (mPooledSize > pooledSize))
+    {
+        const PooledSurface& pooledSurface = mPooledSurfaces.front();
+        mPooledSize -= GetSurfaceSize(pooledSurface.mWidth, pooledSurface.mHeight);
+        pooledSurface.mpSurface->Release();
+        mPooledSurfaces.erase(mPooledSurfaces.begin());
+    }
+}
+
+} // namespace WebCore
+
+#endif // ENABLE(TILED_BACKING_STORE)
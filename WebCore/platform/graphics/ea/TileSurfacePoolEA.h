@@ -0,0 +1,89 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TileSurfacePoolEA_h
+#define TileSurfacePoolEA_h
+
+#if ENABLE(TILED_BACKING_STORE)
+
+#include <EABase/eabase.h>
+#include <EASTL/vector.h>
+#include <EAWebKit/EAWebkitAllocator.h>
+
+namespace EA { namespace WebKit {
+    class IHardwareRenderer;
+    class ISurface;
+}}
+
+namespace WebCore 
+{
+    // Recycles the surfaces of the tiles of a view, so that scrolling does not create and release a hardware surface for every
+    // tile that goes in and out of the backing store. Surfaces are only reused for tiles of the same dimensions.
+    //
+    // Released surfaces are kept while the surfaces in use plus the ones kept fit the tile memory budget of the view
+    // (TileParameters::mTileMemoryBudget). The oldest kept surfaces are released first when a tile needs the room. 
+    class TileSurfacePool
+    {
+    public:
+        TileSurfacePool();
+        ~TileSurfacePool();
+
+        void SetRenderer(EA::WebKit::IHardwareRenderer* pRenderer) { mpRenderer = pRenderer; }
+        void SetBudget(uint32_t budget) { mBudget = budget; }  // In bytes, 0 means no limit.
+
+        EA::WebKit::ISurface* Acquire(int width, int height);  // Returns a surface with its content dimensions set.
+        void Release(EA::WebKit::ISurface* pSurface, int width, int height);
+        void Clear();   // Needs to be called before the renderer goes away.
+
+        uint32_t GetUsedSize() const { return mUsedSize; }
+        uint32_t GetPooledSize() const { return mPooledSize; }
+
+    private:
+        struct PooledSurface
+        {
+            EA::WebKit::ISurface* mpSurface;
+            int mWidth;
+            int mHeight;
+        };
+        typedef eastl::vector<PooledSurface, EA::WebKit::EASTLAllocator> PooledSurfaces;
+
+        static const uint32_t kMaxPooledSurfaceCount = 16;
+
+        void Trim(uint32_t pooledSize);
+
+        EA::WebKit::IHardwareRenderer* mpRenderer;
+        PooledSurfaces  mPooledSurfaces;    // Oldest first.
+        uint32_t        mBudget;
+        uint32_t        mUsedSize;          // Bytes of the surfaces handed out.
+        uint32_t        mPooledSize;        // Bytes of the surfaces in mPooledSurfaces.
+    };
+}
+
+#endif // ENABLE(TILED_BACKING_STORE)
+
+#endif // TileSurfacePoolEA_h
@@ -311,6 +311,21 @@ void ImageDecoder::prepareScaleDataIfNecessary()
     fillScaledValues(m_scaledRows, scale, height);
 }
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+unsigned ImageDecoder::decodeReductionFactor(unsigned maxFactor) const
+{
+    // Down sampling to a pixel count already picked the columns and rows to decode.
+    if (m_decodeTargetSize.isEmpty() || m_scaled)
+        return 1;
+
+    const unsigned factor = min(size().width() / m_decodeTargetSize.width(), size().height() / m_decodeTargetSize.height());
+    return max(1u, min(factor, maxFactor));
+}
+#endif
+//-EAWebKitChange
+
 int ImageDecoder::upperBoundScaledX(int origX, int searchStart)
 {
     return getScaledValue<UpperBound>(m_scaledColumns, origX, searchStart);
@@ -290,6 +290,13 @@ namespace WebCore {
 
         IntSize scaledSize() const
         {
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+            if (!m_reducedSize.isEmpty())
+                return m_reducedSize;
+#endif
+//-EAWebKitChange
             return m_scaled ? IntSize(m_scaledColumns.size(), m_scaledRows.size()) : size();
         }
 
@@ -350,7 +357,25 @@ namespace WebCore {
         void setMaxNumPixels(int m) { m_maxNumPixels = m; }
 #endif
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+        // Decode-to-display-size. The JPEG and (non interlaced) PNG decoders reduce their frame by an integer factor while
+        // decoding, as long as the frame still covers the target size, and scaledSize() then returns the size of the frame.
+        // Only used when set before the frame is decoded. An empty size decodes at full size.
+        void setDecodeTargetSize(const IntSize& targetSize) { m_decodeTargetSize = targetSize; }
+#endif
+//-EAWebKitChange
+
     protected:
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+        unsigned decodeReductionFactor(unsigned maxFactor) const;  // 1 when there is no target size.
+        IntSize m_decodeTargetSize;
+        IntSize m_reducedSize;  // The size of the frame when reduced while decoding, empty otherwise.
+#endif
+//-EAWebKitChange
         void prepareScaleDataIfNecessary();
         int upperBoundScaledX(int origX, int searchStart = 0);
         int lowerBoundScaledX(int origX, int searchStart = 0);
@@ -283,6 +283,22 @@ public:
             m_info.enable_2pass_quant = false;
             m_info.do_block_smoothing = true;
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+            // Reducing the image in the inverse DCT skips most of the work of decoding at full size.
+            if (m_info.scale_denom == 1) {
+                const unsigned scaleDenominator = m_decoder->scaleDenominator();
+                if (scaleDenominator > 1) {
+                    m_info.scale_num = 1;
+                    m_info.scale_denom = scaleDenominator;
+                    jpeg_calc_output_dimensions(&m_info);
+                    m_decoder->setScaledOutputSize(IntSize(m_info.output_width, m_info.output_height));
+                }
+            }
+#endif
+//-EAWebKitChange
+
             // Start decompressor.
             if (!jpeg_start_decompress(&m_info))
                 return false; // I/O suspension.
@@ -466,6 +482,21 @@ ImageFrame* JPEGImageDecoder::frameBufferAtIndex(size_t index)
     return &frame;
 }
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+unsigned JPEGImageDecoder::scaleDenominator() const
+{
+    const unsigned factor = decodeReductionFactor(8);
+    if (factor >= 8)
+        return 8;
+    if (factor >= 4)
+        return 4;
+    return (factor >= 2) ? 2 : 1;
+}
+#endif
+//-EAWebKitChange
+
 bool JPEGImageDecoder::setFailed()
 {
     m_reader.clear();
@@ -55,6 +55,15 @@ namespace WebCore {
 
         void setColorProfile(const ColorProfile& colorProfile) { m_colorProfile = colorProfile; }
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+        // Decode-to-display-size goes through the DCT scaling of libjpeg, which only reduces by 2, 4 or 8.
+        unsigned scaleDenominator() const;
+        void setScaledOutputSize(const IntSize& outputSize) { m_reducedSize = outputSize; }
+#endif
+//-EAWebKitChange
+
     private:
         // Decodes the image.  If |onlySize| is true, stops decoding after
         // calculating the image size.  If decoding fails but there is no more
@@ -176,6 +176,12 @@ PNGImageDecoder::PNGImageDecoder(ImageSource::AlphaOption alphaOption,
                                  ImageSource::GammaAndColorProfileOption gammaAndColorProfileOption)
     : ImageDecoder(alphaOption, gammaAndColorProfileOption)
     , m_doNothingOnFailure(false)
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    , m_boxFactor(1)
+#endif
+//-EAWebKitChange
 {
 }
 
@@ -361,6 +367,20 @@ void PNGImageDecoder::rowAvailable(unsigned char* rowBuffer, unsigned rowIndex,
     // Initialize the framebuffer if needed.
     ImageFrame& buffer = m_frameBufferCache[0];
     if (buffer.status() == ImageFrame::FrameEmpty) {
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+        // The box filter needs each row once and in order, which an interlaced image only gets on its last pass.
+        static const unsigned maxBoxFactor = 128; // Keeps the sums of a box within 32 bits.
+        if (png_get_interlace_type(m_reader->pngPtr(), m_reader->infoPtr()) == PNG_INTERLACE_NONE) {
+            m_boxFactor = decodeReductionFactor(maxBoxFactor);
+            if (m_boxFactor > 1) {
+                m_reducedSize = IntSize((size().width() + m_boxFactor - 1) / m_boxFactor, (size().height() + m_boxFactor - 1) / m_boxFactor);
+                m_boxSums.fill(0, m_reducedSize.width() * 4);
+            }
+        }
+#endif
+//-EAWebKitChange
         if (!buffer.setSize(scaledSize().width(), scaledSize().height())) {
             longjmp(JMPBUF(m_reader->pngPtr()), 1);
             return;
@@ -418,6 +438,16 @@ void PNGImageDecoder::rowAvailable(unsigned char* rowBuffer, unsigned rowIndex,
     } else
         row = rowBuffer;
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    if (m_boxFactor > 1) {
+        boxFilterRow(buffer, row, rowIndex, hasAlpha);
+        return;
+    }
+#endif
+//-EAWebKitChange
+
     // Copy the data into our buffer.
     int width = scaledSize().width();
     int destY = scaledY(rowIndex);
@@ -461,10 +491,78 @@ void PNGImageDecoder::rowAvailable(unsigned char* rowBuffer, unsigned rowIndex,
 	//-EAWebKitChange
 }
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+void PNGImageDecoder::boxFilterRow(ImageFrame& buffer, const unsigned char* row, unsigned rowIndex, bool hasAlpha)
+{
+    const int sourceWidth = size().width();
+    const int sourceHeight = size().height();
+    if (static_cast<int>(rowIndex) >= sourceHeight) // LibPNG may supply an extra row.
+        return;
+
+    // Colors are weighted by alpha so that transparent pixels, whatever their color, do not bleed into the average.
+    const unsigned colorChannels = hasAlpha ? 4 : 3;
+    unsigned* sum = m_boxSums.data();
+    unsigned boxColumn = 0;
+    for (int x = 0; x < sourceWidth; ++x) {
+        const unsigned char* pixel = row + x * colorChannels;
+        const unsigned alpha = hasAlpha ? pixel[3] : 255;
+        sum[0] += pixel[0] * alpha;
+        sum[1] += pixel[1] * alpha;
+        sum[2] += pixel[2] * alpha;
+        sum[3] += alpha;
+        if (++boxColumn == m_boxFactor) {
+            boxColumn = 0;
+            sum += 4;
+        }
+    }
+
+    // The last row of the image may close a box short of m_boxFactor rows, like the last column.
+    const unsigned boxRows = rowIndex % m_boxFactor + 1;
+    if (boxRows < m_boxFactor && static_cast<int>(rowIndex) + 1 < sourceHeight)
+        return;
+
+    const int destY = rowIndex / m_boxFactor;
+    const int width = m_reducedSize.width();
+    bool nonTrivialAlpha = false;
+    sum = m_boxSums.data();
+    for (int x = 0; x < width; ++x, sum += 4) {
+        const unsigned boxColumns = std::min(m_boxFactor, static_cast<unsigned>(sourceWidth - x * m_boxFactor));
+        const unsigned pixelCount = boxRows * boxColumns;
+        const unsigned alphaSum = sum[3];
+        unsigned r = 0, g = 0, b = 0;
+        if (alphaSum) {
+            r = (sum[0] + alphaSum / 2) / alphaSum;
+            g = (sum[1] + alphaSum / 2) / alphaSum;
+            b = (sum[2] + alphaSum / 2) / alphaSum;
+        }
+
+        if (hasAlpha) {
+            const unsigned alpha = (alphaSum + pixelCount / 2) / pixelCount;
+            buffer.setRGBA(x, destY, r, g, b, alpha);
+            nonTrivialAlpha |= alpha < 255;
+        } else
+            buffer.setRGBWithSolidAlpha(x, destY, r, g, b);
+
+        sum[0] = sum[1] = sum[2] = sum[3] = 0;
+    }
+    if (nonTrivialAlpha && !buffer.hasAlpha())
+        buffer.setHasAlpha(nonTrivialAlpha);
+}
+#endif
+//-EAWebKitChange
+
 void PNGImageDecoder::pngComplete()
 {
     if (!m_frameBufferCache.isEmpty())
         m_frameBufferCache.first().setStatus(ImageFrame::FrameComplete);
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+    m_boxSums.clear();
+#endif
+//-EAWebKitChange
 }
 
 //+EAWebKitChange
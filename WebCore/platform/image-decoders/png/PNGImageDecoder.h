@@ -65,8 +65,24 @@ namespace WebCore {
         // data coming, sets the "decode failure" flag.
         void decode(bool onlySize);
 
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+        // Decode-to-display-size. Each box of m_boxFactor x m_boxFactor pixels becomes one pixel of the frame, averaged as
+        // the rows stream in.
+        void boxFilterRow(ImageFrame& buffer, const unsigned char* row, unsigned rowIndex, bool hasAlpha);
+#endif
+//-EAWebKitChange
+
         OwnPtr<PNGImageReader> m_reader;
         bool m_doNothingOnFailure;
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+        unsigned m_boxFactor;
+        Vector<unsigned> m_boxSums;     // Alpha weighted color and alpha sums for each column of the frame row being filtered.
+#endif
+//-EAWebKitChange
     };
 
 } // namespace WebCore
@@ -146,7 +146,14 @@ namespace WebCore {
             , m_reportUploadProgress(false)
             , m_reportLoadTiming(false)
             , m_reportRawHeaders(false)
+//+EAWebKitChange
+//10/18/2026 - Leave the priority unresolved until a loader sets it. The EA transport job scheduler runs such requests (main resources, XHRs) first.
+#if PLATFORM(EA)
+            , m_priority(ResourceLoadPriorityUnresolved)
+#else
             , m_priority(ResourceLoadPriorityLow)
+#endif
+//-EAWebKitChange
         {
         }
 
@@ -161,7 +168,14 @@ namespace WebCore {
             , m_reportUploadProgress(false)
             , m_reportLoadTiming(false)
             , m_reportRawHeaders(false)
+//+EAWebKitChange
+//10/18/2026
+#if PLATFORM(EA)
+            , m_priority(ResourceLoadPriorityUnresolved)
+#else
             , m_priority(ResourceLoadPriorityLow)
+#endif
+//-EAWebKitChange
         {
         }
 
@@ -42,10 +42,12 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <EAWebkit/EAWebKitTransport.h>
 #include <EAWebKit/EAWebKitFileSystem.h>
+#include <EAWebKit/EAWebKitThreadInterface.h>
 #include <internal/include/EAWebKitAssert.h>
 #include <internal/include/EAWebKitString.h>
 #include <internal/include/EAWebKitNewDelete.h>
 #include <EASTL/sort.h>
+#include <EASTL/algorithm.h>
 #include <eastl/fixed_vector.h>
 
 #include <EAIO/PathString.h>
@@ -68,9 +70,35 @@ namespace EA
     {
 		// Updated the version from 1.1 to 1.2 on adding the checksum to the cookie file.
 		// Updated the version from 1.2 to 1.3 on adding the httpOnly support
+		// Text cookie files are only read now, to migrate them to the binary cookie file below.
 		const char8_t* gEAWebKitCookieFormatVersion = "CookieFormat:1.3"; 
 
 		const char8_t* COOKIE_DELIMITER = "\n";
+
+		// Binary cookie file. Cookie files of older versions (text, starting with a checksum line) are read once and rewritten in this format.
+		const uint32_t kCookieFileMagic					= 0x4B435745;	// 'EWCK'
+		const uint32_t kCookieFileVersion				= 1;			// Change version # if format changes.
+		const uint32_t kCookieFileHeaderSize			= 8;			// Magic + version
+		const uint32_t kCookieFileMinRecordsToCompact	= 64;			// Don't bother compacting small journals.
+		const uint32_t kCookieRecordHeaderSize			= 5;			// Type + payload size
+
+		// Every record is: uint8 type, uint32 payload size, payload, uint32 checksum of the payload.
+		// Integers are little endian. Strings are a uint32 length followed by UTF8 bytes with no terminator.
+		// A record with a bad size or checksum ends the journal; everything before it is kept.
+		enum CookieRecordType
+		{
+			kCookieRecordSet	= 1,	// All persistent Cookie fields.
+			kCookieRecordRemove	= 2		// Cookie key (see CookieManagerHelp::GetCookieKey).
+		};
+
+		// Flags of a set record.
+		enum CookieRecordFlags
+		{
+			kCookieRecordFlagDomainDefaulted	= 0x01,
+			kCookieRecordFlagPathDefaulted		= 0x02,
+			kCookieRecordFlagSecure				= 0x04,
+			kCookieRecordFlagHttpOnly			= 0x08
+		};
 		
 		namespace CookieManagerHelp
         {
@@ -200,27 +228,153 @@ namespace EA
                 return false;
             }
 
-			bool DomainsMatch(const FixedString8_128& domain1, const FixedString8_128& domain2)
+			// Returns the key of a cookie domain or host in the CookieManager domain index: the lower case domain without a leading dot.
+			// A cookie matches a host (see EndsWithDomain) if its key is the key of the host or a suffix of it that follows a dot.
+			// Some non-conforming Javascript code may send us domains not prefixed with a "." but their http servers expects the domain
+			// to be referred with a prefixed ".". It is also possible in reverse manner. So domains with equal keys are the same cookie domain.
+			void GetDomainKey(const FixedString8_128& domain, FixedString8_128& key)
 			{
-				if(domain1.comparei(domain2) == 0)
-					return true;
+				key.assign(domain.c_str() + ((domain[0] == '.') ? 1 : 0));
+				key.make_lower();
+			}
+
+			// Returns the key identifying a cookie: a cookie replaces the cookie with the same key (see ProcessCookieHeader).
+			void GetCookieKey(const Cookie& cookie, FixedString8_256& key)
+			{
+				FixedString8_128 domainKey;
+				GetDomainKey(cookie.mDomain, domainKey);
+				key.assign(domainKey.c_str());
+				key.append(1, '\n');
+				key.append(cookie.mPath.c_str());
+				key.append(1, '\n');
+				key.append(cookie.mName.c_str());
+			}
+
+			void CookieFileWriteU32(eastl::vector<char, EASTLAllocator>& buffer, uint32_t value)
+			{
+				buffer.push_back((char)(value));
+				buffer.push_back((char)(value >> 8));
+				buffer.push_back((char)(value >> 16));
+				buffer.push_back((char)(value >> 24));
+			}
 
-				// Some non-conforming Javascript code may send us domains not prefixed with a "."  but
-				// their http servers expects the domain to be referred with a prefixed ".". It is also possible in reverse manner.
-				FixedString8_128 domain1WithoutDot(domain1);
-				if(domain1WithoutDot[0] == '.')
-					domain1WithoutDot.erase(0,1);
+			void CookieFileWriteString(eastl::vector<char, EASTLAllocator>& buffer, const char8_t* pString, uint32_t length)
+			{
+				CookieFileWriteU32(buffer, length);
+				buffer.insert(buffer.end(), pString, pString + length);
+			}
 
-				FixedString8_128 domain2WithoutDot(domain2);
-				if(domain2WithoutDot[0] == '.')
-					domain2WithoutDot.erase(0,1);
+			class CookieFileReader
+			{
+			public:
+				CookieFileReader(const char* pData, int64_t size)
+					: mpCurrent((const uint8_t*)pData)
+					, mpEnd((const uint8_t*)pData + size)
+				{
+				}
 
-				if(domain1WithoutDot.comparei(domain2WithoutDot) == 0)
+				bool        AtEnd() const           { return mpCurrent >= mpEnd; }
+				uint32_t    Remaining() const       { return (uint32_t)(mpEnd - mpCurrent); }
+				const char* Current() const         { return (const char*)mpCurrent; }
+				void        Skip(uint32_t size)     { mpCurrent += size; }
+
+				bool ReadU8(uint8_t& value)
+				{
+					if(Remaining() < 1)
+						return false;
+					value = *mpCurrent++;
 					return true;
+				}
 
-				return false;
+				bool ReadU32(uint32_t& value)
+				{
+					if(Remaining() < 4)
+						return false;
+					value = (uint32_t)mpCurrent[0] | ((uint32_t)mpCurrent[1] << 8) | ((uint32_t)mpCurrent[2] << 16) | ((uint32_t)mpCurrent[3] << 24);
+					mpCurrent += 4;
+					return true;
+				}
+
+				template <typename String>
+				bool ReadString(String& value)
+				{
+					uint32_t length = 0;
+					if(!ReadU32(length) || (Remaining() < length))
+						return false;
+					value.assign((const char8_t*)mpCurrent, (const char8_t*)mpCurrent + length);
+					mpCurrent += length;
+					return true;
+				}
+
+			private:
+				const uint8_t* mpCurrent;
+				const uint8_t* mpEnd;
+			};
+
+			// Reads the payload of a set record. Returns NULL if it is malformed.
+			Cookie* ReadCookieRecord(CookieFileReader& payload)
+			{
+				char8_t emptyName[1] = { 0 };
+				Cookie* cookie = new Cookie(emptyName);
+
+				uint32_t expirationTimeLow  = 0;
+				uint32_t expirationTimeHigh = 0;
+				uint32_t version   = 0;
+				uint8_t  flags     = 0;
+				uint8_t  portCount = 0;
+				bool bValid = payload.ReadString(cookie->mName) &&
+							  payload.ReadString(cookie->mValue) &&
+							  payload.ReadString(cookie->mDomain) &&
+							  payload.ReadString(cookie->mPath) &&
+							  payload.ReadString(cookie->mComment) &&
+							  payload.ReadString(cookie->mCommentURL) &&
+							  payload.ReadU32(expirationTimeLow) &&
+							  payload.ReadU32(expirationTimeHigh) &&
+							  payload.ReadU32(version) &&
+							  payload.ReadU8(flags) &&
+							  payload.ReadU8(portCount) &&
+							  (portCount <= Cookie::MAX_NUM_PORTS);
+
+				for(uint8_t i = 0; bValid && (i < portCount); ++i)
+					bValid = payload.ReadU32(cookie->mPorts[i]);
+
+				if(!bValid)
+				{
+					delete cookie;
+					return NULL;
+				}
+
+				if(portCount < Cookie::MAX_NUM_PORTS)
+					cookie->mPorts[portCount] = 0;
+
+				cookie->mExpirationTime        = (time_t)(int64_t)(((uint64_t)expirationTimeHigh << 32) | expirationTimeLow);
+				cookie->mVersion               = (uint16_t)version;
+				cookie->mDomainDefaulted       = (flags & kCookieRecordFlagDomainDefaulted) != 0;
+				cookie->mPathDefaulted         = (flags & kCookieRecordFlagPathDefaulted) != 0;
+				cookie->mSecure                = (flags & kCookieRecordFlagSecure) != 0;
+				cookie->mHttpOnly              = (flags & kCookieRecordFlagHttpOnly) != 0;
+				cookie->mExpiresAtEndOfSession = false;
+				return cookie;
 			}
 
+			// A cookie being read from the cookie file, and the position of the record that first set its key.
+			struct CookieFileEntry
+			{
+				Cookie*  mpCookie;
+				uint32_t mOrder;
+
+				CookieFileEntry() : mpCookie(0), mOrder(0) { }
+			};
+			typedef eastl::hash_map<FixedString8_256, CookieFileEntry, eastl::string_hash<FixedString8_256>, eastl::equal_to<FixedString8_256>, EASTLAllocator> CookieFileEntryMap;
+
+			struct CookieFileEntryOrderLess
+			{
+				bool operator()(const CookieFileEntry& a, const CookieFileEntry& b) const
+				{
+					return a.mOrder < b.mOrder;
+				}
+			};
+
             ///////////////////////////////////////////////////////////////////////////////
             // Trim
             //
@@ -332,8 +486,241 @@ namespace EA
             return (timeNow >= mExpirationTime); // >= in case the server sends a 0 delta tick time.
         }
 
+        // CookieFileWriter
+        //
+        // Appends records to the cookie file or rewrites it. If the thread system can create threads, the file is written
+        // by a background thread and a flush only hands over the records, so the main thread never waits on the file system.
+        // The writer only ever touches the file through its own file object, opened on the first write.
+        class CookieManager::CookieFileWriter
+        {
+        public:
+            explicit CookieFileWriter(const char8_t* pFilePath)
+                : mFilePath(pFilePath)
+                , mFileObject(FileSystem::kFileObjectInvalid)
+                , mpThreadSystem(NULL)
+                , mpThread(NULL)
+                , mpMutex(NULL)
+                , mpCondition(NULL)
+                , mPending()
+                , mbPendingRewrite(false)
+                , mbStop(false)
+                , mbWriteFailed(false)
+            {
+            }
+
+            ~CookieFileWriter()
+            {
+                Stop();
+            }
+
+            bool StartThread()
+            {
+                mpThreadSystem = GetThreadSystem();
+
+                // A thread system that can't create threads reports kThreadIdInvalid (see DefaultThreadSystem::CurrentThreadId).
+                if(!mpThreadSystem || (mpThreadSystem->CurrentThreadId() == EA::WebKit::kThreadIdInvalid))
+                    return false;
+
+                mpMutex     = mpThreadSystem->CreateAMutex();
+                mpCondition = mpThreadSystem->CreateAThreadCondition();
+                mpThread    = mpThreadSystem->CreateAThread();
+                if(mpMutex && mpCondition && mpThread)
+                {
+                    if(mpThread->Begin(ThreadFunction, this) != EA::WebKit::kThreadIdInvalid)
+                    {
+                        mpThread->SetName("EAWebKit cookie file");
+                        return true;
+                    }
+                }
+
+                DestroyThread();
+                return false;
+            }
+
+            // Writes whatever is pending and closes the file.
+            void Stop()
+            {
+                if(mpThread)
+                {
+                    mpMutex->Lock();
+                    mbStop = true;
+                    mpCondition->Signal(true);
+                    mpMutex->Unlock();
+
+                    intptr_t result = 0;
+                    mpThread->WaitForEnd(&result);
+                }
+                DestroyThread();
+                CloseFile();
+            }
+
+            // Takes the records in buffer and leaves it empty. A rewrite truncates the file first, so pending appends are dropped.
+            void Write(CookieFileBuffer& buffer, bool bRewrite)
+            {
+                if(!mpThread)
+                {
+                    if(!WriteFile(buffer, bRewrite))
+                        mbWriteFailed = true;
+                    buffer.clear();
+                    return;
+                }
+
+                mpMutex->Lock();
+                if(bRewrite)
+                {
+                    mPending.swap(buffer);
+                    mbPendingRewrite = true;
+                }
+                else
+                {
+                    mPending.insert(mPending.end(), buffer.begin(), buffer.end());
+                }
+                mpCondition->Signal(false);
+                mpMutex->Unlock();
+                buffer.clear();
+            }
+
+            // Returns true once after a write failed. The file is then suspect and should be rewritten.
+            bool TakeWriteFailed()
+            {
+                if(mpMutex)
+                    mpMutex->Lock();
+                const bool bWriteFailed = mbWriteFailed;
+                mbWriteFailed = false;
+                if(mpMutex)
+                    mpMutex->Unlock();
+                return bWriteFailed;
+            }
+
+        private:
+            static void* ThreadFunction(void* pContext)
+            {
+                static_cast<CookieFileWriter*>(pContext)->Run();
+                return NULL;
+            }
+
+            void Run()
+            {
+                CookieFileBuffer buffer;
+
+                mpMutex->Lock();
+                for(;;)
+                {
+                    while(mPending.empty() && !mbPendingRewrite && !mbStop)
+                        mpCondition->Wait(mpMutex);
+
+                    if(mPending.empty() && !mbPendingRewrite)
+                        break; // Stopping and nothing left to write.
+
+                    buffer.swap(mPending);
+                    const bool bRewrite = mbPendingRewrite;
+                    mbPendingRewrite = false;
+                    mpMutex->Unlock();
+
+                    const bool bResult = WriteFile(buffer, bRewrite);
+                    buffer.clear();
+
+                    mpMutex->Lock();
+                    if(!bResult)
+                        mbWriteFailed = true;
+                }
+                mpMutex->Unlock();
+            }
+
+            bool WriteFile(const CookieFileBuffer& buffer, bool bRewrite)
+            {
+                FileSystem* pFS = GetFileSystem();
+                if(!pFS)
+                    return false;
+
+                if(bRewrite)
+                    CloseFile();
+
+                if(mFileObject == FileSystem::kFileObjectInvalid)
+                {
+                    const char8_t* pCookieFilePath = mFilePath.c_str();
+                    if(bRewrite && !pFS->FileExists(pCookieFilePath))
+                    {
+                        EA::IO::Path::PathString8 pathStr(pCookieFilePath);
+                        const EA::IO::Path::PathString8::iterator fileIter = EA::IO::Path::GetFileName(pathStr.begin(),pathStr.end());
+                        EA::IO::Path::PathString8 dirStr;
+                        dirStr.assign(pathStr.begin(),fileIter);
+                        if(!pFS->MakeDirectory(dirStr.c_str()))//Create a Directory(not the file). File creation fails without the pre-existing directory path.
+                        {
+                            EAW_ASSERT_FORMATTED(false,"Could not create directory for cookie file path %s\n",pCookieFilePath);
+                        }
+                    }
+
+                    mFileObject = pFS->CreateFileObject();
+                    if(mFileObject == FileSystem::kFileObjectInvalid)
+                        return false;
+
+                    bool bOpened = pFS->OpenFile(mFileObject, pCookieFilePath, FileSystem::kWrite, bRewrite ? FileSystem::kCDOCreateAlways : FileSystem::kCDOOpenAlways);
+                    if(bOpened && !bRewrite)
+                        bOpened = pFS->SetFilePosition(mFileObject, pFS->GetFileSize(mFileObject));
+                    if(!bOpened)
+                    {
+                        pFS->DestroyFileObject(mFileObject);
+                        mFileObject = FileSystem::kFileObjectInvalid;
+                        return false;
+                    }
+                }
+
+                bool bResult = buffer.empty() || pFS->WriteFile(mFileObject, buffer.data(), (int64_t)buffer.size());
+                pFS->FlushFile(mFileObject);
+                return bResult;
+            }
+
+            void CloseFile()
+            {
+                if(mFileObject != FileSystem::kFileObjectInvalid)
+                {
+                    FileSystem* pFS = GetFileSystem();
+                    if(pFS)
+                    {
+                        pFS->CloseFile(mFileObject);
+                        pFS->DestroyFileObject(mFileObject);
+                    }
+                    mFileObject = FileSystem::kFileObjectInvalid;
+                }
+            }
+
+            void DestroyThread()
+            {
+                if(mpThreadSystem)
+                {
+                    if(mpThread)
+                        mpThreadSystem->DestroyAThread(mpThread);
+                    if(mpCondition)
+                        mpThreadSystem->DestroyAThreadCondition(mpCondition);
+                    if(mpMutex)
+                        mpThreadSystem->DestroyAMutex(mpMutex);
+                }
+                mpThread    = NULL;
+                mpCondition = NULL;
+                mpMutex     = NULL;
+            }
+
+            FixedString8_128                mFilePath;
+            FileSystem::FileObject          mFileObject;        // Writer thread, if any.
+            EA::WebKit::IThreadSystem*      mpThreadSystem;
+            EA::WebKit::IThread*            mpThread;
+            EA::WebKit::IMutex*             mpMutex;
+            EA::WebKit::IThreadCondition*   mpCondition;
+            CookieFileBuffer                mPending;           // Protected by mpMutex.
+            bool                            mbPendingRewrite;   // Protected by mpMutex.
+            bool                            mbStop;             // Protected by mpMutex.
+            bool                            mbWriteFailed;      // Protected by mpMutex.
+        };
+
         CookieManager::CookieManager()
             : mParams()
+            , mCookieCount(0)
+            , mCookieSequence(0)
+            , mCookieFileWriter(NULL)
+            , mCookieFileSize(0)
+            , mCookieRecordCount(0)
+            , mCookieFileValid(false)
             , mCookieParseBuffer(NULL)
             , mInitialized(false)
         {
@@ -341,6 +728,12 @@ namespace EA
 
         CookieManager::CookieManager(const CookieManagerParameters& params, WebCore::ResourceHandleManager* /*rhm*/)
             : mParams(params)
+            , mCookieCount(0)
+            , mCookieSequence(0)
+            , mCookieFileWriter(NULL)
+            , mCookieFileSize(0)
+            , mCookieRecordCount(0)
+            , mCookieFileValid(false)
             , mCookieParseBuffer(NULL)
             , mInitialized(false)
         { 
@@ -364,6 +757,11 @@ namespace EA
 					mCookieParseBuffer = EAWEBKIT_NEW("CookieParseBuffer") char8_t[mParams.mMaxIndividualCookieSize];//WTF::fastNewArray<char8_t>(mParams.mMaxIndividualCookieSize);
                 
 				ReadCookiesFromFile();
+				StartCookieFileWriter();
+
+				// Migrate a cookie file of an older version, or drop a torn journal tail, right away.
+				if(mCookieCount && (!mCookieFileValid || CookieFileNeedsCompaction()))
+					CompactCookieFile();
             }
             return true;
         }
@@ -378,10 +776,15 @@ namespace EA
                 mCookieParseBuffer = 0;
 
                 if(mParams.mMaxCookieCount)
-                    WriteCookiesToFile();
+                {
+                    FlushCookieFile();
+                    if(CookieFileNeedsCompaction())
+                        CompactCookieFile();
+                }
                 else
                     RemoveCookies();
                 
+                StopCookieFileWriter();
                 ClearCookies();
             }
             return true;
@@ -389,18 +792,101 @@ namespace EA
 
         void CookieManager::ClearCookies()
         {
-            for(CookieList::const_iterator iter = mCookies.begin(); iter != mCookies.end(); ++iter)
-                delete *iter;
+            while(!mCookies.empty())
+            {
+                Cookie* cookie = &mCookies.front();
+                mCookies.pop_front();
+                delete cookie;
+            }
             
-			mCookies.clear();
+			mCookieDomainIndex.clear();
+			mCookieCount = 0;
+			mDirtyCookies.clear();
+        }
+
+        void CookieManager::AddCookie(Cookie* cookie)
+        {
+            cookie->mSequence = mCookieSequence++;
+            mCookies.push_back(*cookie);
+            ++mCookieCount;
+            AddCookieToDomainIndex(cookie);
+            MarkCookieDirty(cookie, false);
+        }
+
+        void CookieManager::RemoveCookie(Cookie* cookie)
+        {
+            MarkCookieDirty(cookie, true);
+            RemoveCookieFromDomainIndex(cookie);
+            CookieList::remove(*cookie);
+            --mCookieCount;
+            delete cookie;
+        }
+
+        // The new cookie takes the place of the old one, both in age and in the domain index, as they have the same domain key and path.
+        void CookieManager::ReplaceCookie(Cookie* oldCookie, Cookie* newCookie)
+        {
+            using namespace CookieManagerHelp;
+
+            newCookie->mSequence  = oldCookie->mSequence;
+            newCookie->mPersisted = oldCookie->mPersisted;
+            mCookies.insert(mCookies.locate(*oldCookie), *newCookie);
+            CookieList::remove(*oldCookie);
+
+            FixedString8_128 key;
+            GetDomainKey(oldCookie->mDomain, key);
+            CookieBucket& bucket = mCookieDomainIndex[key];
+            *eastl::find(bucket.begin(), bucket.end(), oldCookie) = newCookie;
+
+            MarkCookieDirty(newCookie, false);
+            delete oldCookie;
+        }
+
+        void CookieManager::AddCookieToDomainIndex(Cookie* cookie)
+        {
+            using namespace CookieManagerHelp;
+
+            FixedString8_128 key;
+            GetDomainKey(cookie->mDomain, key);
+            CookieBucket& bucket = mCookieDomainIndex[key];
+            bucket.insert(eastl::upper_bound(bucket.begin(), bucket.end(), cookie, CookiePathSorter()), cookie);
+        }
+
+        void CookieManager::RemoveCookieFromDomainIndex(Cookie* cookie)
+        {
+            using namespace CookieManagerHelp;
+
+            FixedString8_128 key;
+            GetDomainKey(cookie->mDomain, key);
+            CookieDomainIndex::iterator bucketIt = mCookieDomainIndex.find(key);
+            EAW_ASSERT(bucketIt != mCookieDomainIndex.end());
+            if(bucketIt != mCookieDomainIndex.end())
+            {
+                CookieBucket& bucket = bucketIt->second;
+                CookieBucket::iterator it = eastl::find(bucket.begin(), bucket.end(), cookie);
+                if(it != bucket.end())
+                    bucket.erase(it);
+                if(bucket.empty())
+                    mCookieDomainIndex.erase(bucketIt);
+            }
         }
 
         void CookieManager::DeleteCookiesFile()
         {
             if(!mParams.mCookieFilePath.empty())
             {
+                // Writes still pending must not recreate the file.
+                const bool bWriterStarted = (mCookieFileWriter != NULL);
+                StopCookieFileWriter();
+
                 EA::WebKit::FileSystem* fileSystem = EA::WebKit::GetFileSystem();
                 fileSystem->RemoveFile(mParams.mCookieFilePath.c_str());
+
+                // The next flush writes all the persistent cookies to a new file.
+                mCookieFileSize    = 0;
+                mCookieRecordCount = 0;
+                mCookieFileValid   = false;
+                if(bWriterStarted)
+                    StartCookieFileWriter();
             }
         }
 
@@ -412,144 +898,410 @@ namespace EA
 
         void CookieManager::ReadCookiesFromFile()
         {
-            using namespace CookieManagerHelp;
-            
+            mCookieFileSize    = 0;
+            mCookieRecordCount = 0;
+            mCookieFileValid   = false;
+
             if(!mParams.mCookieFilePath.empty())
             {
-                //Parse and cache the cookies in the memory
+                //Parse and cache the cookies in the memory. Try a single mapping of the file first.
                 EA::WebKit::FileSystem* fileSystem = EA::WebKit::GetFileSystem();
+                int64_t numBytes = 0;
+                const void* pMappedData = fileSystem->MapFile(mParams.mCookieFilePath.c_str(), numBytes);
+                if(pMappedData)
+                {
+                    const bool bParsed = ParseCookieFile((const char*)pMappedData, numBytes);
+                    fileSystem->UnmapFile(pMappedData, numBytes);
+                    if(bParsed)
+                        return;
+                }
+
+                // The file system can't map files, or this is a text cookie file of an older version, which is parsed in place.
                 EA::WebKit::FileSystem::FileObject fileObject = fileSystem->CreateFileObject();
                 if(fileSystem->OpenFile(fileObject, mParams.mCookieFilePath.c_str(), FileSystem::kRead, FileSystem::kCDOOpenExisting))
                 {
-                    int64_t numBytes = 0;
+                    numBytes = 0;
                     fileSystem->GetFileSize(mParams.mCookieFilePath.c_str(),numBytes);
                     if(numBytes>0) //Have something to read
                     {
                         char* pCookieFileBuffer = EAWEBKIT_NEW("CookieFileBuffer") char8_t[numBytes+1];//WTF::fastNewArray<char8_t> (numBytes+1);  // +1 so we can put a \0 at the end.
-                        fileSystem->ReadFile(fileObject, pCookieFileBuffer, numBytes);
+                        const int64_t readSize = fileSystem->ReadFile(fileObject, pCookieFileBuffer, numBytes);
                         fileSystem->CloseFile(fileObject);
                         pCookieFileBuffer[numBytes] = '\0';
 
-                        char8_t* ctx = NULL;
-						char8_t* cookieFormatVersion = NULL;
-						char8_t* cookieHeader = NULL;
-                        Cookie* cookie = NULL;
-                        //Create Cookies from the cookie file buffer here
-                        //First line is the header line which contains checksum for the file.
-						char8_t* cookieChecksumFromFile = Strtok(pCookieFileBuffer, COOKIE_DELIMITER, &ctx);
-						if(cookieChecksumFromFile)
-						{
-							uint32_t checksum = GetChecksum(ctx, (numBytes - EA::Internal::Strlen(cookieChecksumFromFile)));
-							char8_t cookieChecksumData[256];
-							sprintf(cookieChecksumData, "%d", checksum);
-
-							//Second line is the header line which contains the version info for the file.
-							cookieFormatVersion = Strtok(NULL, COOKIE_DELIMITER, &ctx );
-							//read cookies only if the format matches and the checksum was found matched.
-							if(cookieFormatVersion && EA::Internal::Stricmp(cookieFormatVersion, gEAWebKitCookieFormatVersion) == 0
-								&& cookieChecksumFromFile && EA::Internal::Stricmp(cookieChecksumFromFile, cookieChecksumData) == 0)
-							{
-								//The file format is really simple. You have 1 cookie per line. The cookies are separated from each other by
-								//a new line character.
-								while( NULL != (cookieHeader = Strtok( NULL, COOKIE_DELIMITER, &ctx )) )
-								{
-									cookie = ParseCookieHeader(cookieHeader);
-									EAW_ASSERT_MSG(cookie, "Looks like the cookie is corrupted");
-									if(cookie) //Add an extra check to make sure that the pointer is valid
-										mCookies.push_back(cookie);
-								}
-							}
-							else
-							{
-								// If the checksum fails, then delete the invalid cookie file.
-								RemoveCookies();
-							}
-						}
-						else
-						{
-							// Somehow even though we have a file with valid size but no checksum found (For example, if the user manually hex edited the file), Get rid of the cookies.
-							RemoveCookies();
-						}
-						
+                        if((readSize == numBytes) && !ParseCookieFile(pCookieFileBuffer, numBytes))
+                            ParseLegacyCookieFile(pCookieFileBuffer, numBytes);
+
                         EAWEBKIT_DELETE[] pCookieFileBuffer;//WTF::fastDeleteArray<char8_t> (pCookieFileBuffer);
                         pCookieFileBuffer = NULL;
                     }
+                    else
+                    {
+                        fileSystem->CloseFile(fileObject);
+                    }
                 }
                 fileSystem->DestroyFileObject(fileObject);  // 2/25/09 CSidhall - Moved up one bracket for minor leak fix
             }
         }
 
-        void CookieManager::WriteCookiesToFile()
+        bool CookieManager::ParseCookieFile(const char* pData, int64_t size)
         {
+            // Returns false if this is not a binary cookie file. The journal is replayed into a map of cookie key to cookie, and the
+            // surviving cookies are added in the order they were first set so that the oldest cookies are still evicted first.
             using namespace CookieManagerHelp;
-            
-            if(!mParams.mCookieFilePath.empty() && mCookies.size())
+
+            CookieFileReader reader(pData, size);
+
+            uint32_t magic = 0;
+            uint32_t version = 0;
+            if(!reader.ReadU32(magic) || (magic != kCookieFileMagic))
+                return false;
+            if(!reader.ReadU32(version) || (version != kCookieFileVersion))
+                return true; // Not readable by this version. mCookieFileValid is false, so it is rewritten.
+
+            mCookieFileSize    = kCookieFileHeaderSize;
+            mCookieRecordCount = 0;
+
+            CookieFileEntryMap entries;
+            uint32_t nextOrder = 0;
+            FixedString8_256 key;
+
+            while(!reader.AtEnd())
             {
-                EA::WebKit::FileSystem* fileSystem = EA::WebKit::GetFileSystem();
-                EA::WebKit::FileSystem::FileObject fileObject = fileSystem->CreateFileObject();
-                
-				const char8_t* pCookieFilePath = mParams.mCookieFilePath.c_str();
-				if(!fileSystem->FileExists(pCookieFilePath))
+                uint8_t  recordType  = 0;
+                uint32_t payloadSize = 0;
+                uint32_t checksum    = 0;
+
+                if(!reader.ReadU8(recordType) || !reader.ReadU32(payloadSize) || (payloadSize > reader.Remaining()) || ((reader.Remaining() - payloadSize) < 4))
+                    break;  // Torn write at the end of the journal.
+
+                const char* pPayload = reader.Current();
+                reader.Skip(payloadSize);
+                reader.ReadU32(checksum);
+                if(checksum != GetChecksum(pPayload, payloadSize))
+                    break;
+
+                CookieFileReader payload(pPayload, payloadSize);
+                bool bValid = true;
+                switch(recordType)
+                {
+                    case kCookieRecordSet:
+                    {
+                        Cookie* cookie = ReadCookieRecord(payload);
+                        bValid = (cookie != NULL);
+                        if(bValid)
+                        {
+                            GetCookieKey(*cookie, key);
+                            CookieFileEntry& entry = entries[key];
+                            if(entry.mpCookie)
+                                delete entry.mpCookie;
+                            else
+                                entry.mOrder = nextOrder++;
+                            entry.mpCookie = cookie;
+                        }
+                        break;
+                    }
+
+                    case kCookieRecordRemove:
+                    {
+                        bValid = payload.ReadString(key);
+                        if(bValid)
+                        {
+                            CookieFileEntryMap::iterator it = entries.find(key);
+                            if(it != entries.end())
+                            {
+                                delete it->second.mpCookie;
+                                entries.erase(it);
+                            }
+                        }
+                        break;
+                    }
+
+                    default:
+                        bValid = false;
+                        break;
+                }
+
+                if(!bValid)
+                    break;
+
+                ++mCookieRecordCount;
+                mCookieFileSize = size - reader.Remaining();
+            }
+
+            // If we stopped early, the next flush rewrites the file.
+            mCookieFileValid = (mCookieFileSize == size);
+
+            typedef eastl::vector<CookieFileEntry, EASTLAllocator> CookieFileEntryVector;
+            CookieFileEntryVector sortedEntries;
+            sortedEntries.reserve(entries.size());
+
+            const time_t timeNow = ::time(NULL);
+            for(CookieFileEntryMap::iterator it = entries.begin(); it != entries.end(); ++it)
+            {
+                if(it->second.mpCookie->IsCookieExpired(timeNow))
+                    delete it->second.mpCookie;
+                else
+                    sortedEntries.push_back(it->second);
+            }
+
+            eastl::sort(sortedEntries.begin(), sortedEntries.end(), CookieFileEntryOrderLess());
+
+            for(CookieFileEntryVector::iterator it = sortedEntries.begin(); it != sortedEntries.end(); ++it)
+            {
+                AddCookie(it->mpCookie);
+                it->mpCookie->mPersisted = true;
+            }
+
+            mDirtyCookies.clear();  // Nothing changed since the file was written.
+            return true;
+        }
+
+        void CookieManager::ParseLegacyCookieFile(char8_t* pCookieFileBuffer, int64_t numBytes)
+        {
+            // Text cookie file of an older version. Init rewrites it in the binary format.
+            using namespace CookieManagerHelp;
+
+            char8_t* ctx = NULL;
+			char8_t* cookieFormatVersion = NULL;
+			char8_t* cookieHeader = NULL;
+            Cookie* cookie = NULL;
+            //Create Cookies from the cookie file buffer here
+            //First line is the header line which contains checksum for the file.
+			char8_t* cookieChecksumFromFile = Strtok(pCookieFileBuffer, COOKIE_DELIMITER, &ctx);
+			if(cookieChecksumFromFile)
+			{
+				uint32_t checksum = GetChecksum(ctx, (numBytes - EA::Internal::Strlen(cookieChecksumFromFile)));
+				char8_t cookieChecksumData[256];
+				sprintf(cookieChecksumData, "%d", checksum);
+
+				//Second line is the header line which contains the version info for the file.
+				cookieFormatVersion = Strtok(NULL, COOKIE_DELIMITER, &ctx );
+				//read cookies only if the format matches and the checksum was found matched.
+				if(cookieFormatVersion && EA::Internal::Stricmp(cookieFormatVersion, gEAWebKitCookieFormatVersion) == 0
+					&& cookieChecksumFromFile && EA::Internal::Stricmp(cookieChecksumFromFile, cookieChecksumData) == 0)
 				{
-					EA::IO::Path::PathString8 pathStr(pCookieFilePath);
-					const EA::IO::Path::PathString8::iterator fileIter = EA::IO::Path::GetFileName(pathStr.begin(),pathStr.end());
-					EA::IO::Path::PathString8 dirStr;
-					dirStr.assign(pathStr.begin(),fileIter);
-					if(!fileSystem->MakeDirectory(dirStr.c_str()))//Create a Directory(not the file). File creation fails without the pre-existing directory path.
+					//The file format is really simple. You have 1 cookie per line. The cookies are separated from each other by
+					//a new line character.
+					while( NULL != (cookieHeader = Strtok( NULL, COOKIE_DELIMITER, &ctx )) )
 					{
-						EAW_ASSERT_FORMATTED(false,"Could not create directory for cookie file path %s\n",pCookieFilePath);
+						cookie = ParseCookieHeader(cookieHeader);
+						EAW_ASSERT_MSG(cookie, "Looks like the cookie is corrupted");
+						if(cookie) //Add an extra check to make sure that the pointer is valid
+							AddCookie(cookie);
 					}
 				}
-				// abaldeva: 05/23/2011. Safeguard against cookie file growing too big or if a really small size is specified.
-				// Earlier, it could crash in some circumstances. 
-				const size_t maxCookieFileOverhead = 256;//256 bytes
-				if(fileSystem->OpenFile(fileObject, mParams.mCookieFilePath.c_str(), FileSystem::kWrite, FileSystem::kCDOCreateAlways) && maxCookieFileOverhead < mParams.mMaxCookieFileSize)
+				else
+				{
+					// If the checksum fails, then delete the invalid cookie file.
+					RemoveCookies();
+				}
+			}
+			else
+			{
+				// Somehow even though we have a file with valid size but no checksum found (For example, if the user manually hex edited the file), Get rid of the cookies.
+				RemoveCookies();
+			}
+        }
+
+        void CookieManager::MarkCookieDirty(Cookie* cookie, bool removed)
+        {
+            using namespace CookieManagerHelp;
+
+            FixedString8_256 key;
+            GetCookieKey(*cookie, key);
+
+            DirtyCookie& dirty = mDirtyCookies[key];
+            dirty.mpCookie     = removed ? NULL : cookie;
+            dirty.mbPersisted |= cookie->mPersisted;
+        }
+
+        bool CookieManager::CookieFileNeedsCompaction() const
+        {
+            return ((mCookieRecordCount > kCookieFileMinRecordsToCompact) && (mCookieRecordCount > (mCookieCount * 2))) ||
+                   (mCookieFileSize > ((int64_t)mParams.mMaxCookieFileSize * 2));
+        }
+
+        void CookieManager::FlushCookieFile()
+        {
+            // Appends a record for every cookie changed since the last flush. Session cookies are never saved, but they get a
+            // remove record if they replaced a saved cookie.
+            if(!mCookieFileWriter)
+            {
+                mDirtyCookies.clear();
+                return;
+            }
+
+            if(mCookieFileWriter->TakeWriteFailed())
+                mCookieFileValid = false;
+
+            if(!mCookieFileValid || CookieFileNeedsCompaction())
+            {
+                CompactCookieFile();
+                return;
+            }
+
+            if(mDirtyCookies.empty())
+                return;
+
+            const time_t timeNow = ::time(NULL);
+            mCookieFileBuffer.clear();
+
+            for(DirtyCookieMap::iterator it = mDirtyCookies.begin(); it != mDirtyCookies.end(); ++it)
+            {
+                const DirtyCookie& dirty = it->second;
+                Cookie* cookie = dirty.mpCookie;
+
+                if(cookie && !cookie->mExpiresAtEndOfSession && !cookie->IsCookieExpired(timeNow))
                 {
-					// Create the file buffer initially so as the checksum can be calculated.
-					char* pCookieFileBuffer = EAWEBKIT_NEW("CookieFileBuffer") char8_t[mParams.mMaxCookieFileSize];
-					int64_t numBytes = 0;
-
-					strcpy(pCookieFileBuffer, gEAWebKitCookieFormatVersion);
-					strcat(pCookieFileBuffer, COOKIE_DELIMITER);
-					numBytes += (EA::Internal::Strlen(gEAWebKitCookieFormatVersion) + 1);
-
-					time_t timeNow = ::time(NULL);
-                    // To consider: Write the cookies in order from newest to oldest received, so that if 
-                    // we have to purge some of them due to lack of space then we lose just the oldest ones.
-                    for(CookieList::const_iterator iter = mCookies.begin(); iter != mCookies.end(); ++iter)
-                    {
-                        const Cookie* cookie = *iter;
-                        //Don't write these cookies to the file. Not intended to be saved.
-                        if(cookie->IsCookieExpired(timeNow) || cookie->mExpiresAtEndOfSession) 
-                            continue;
+                    AppendCookieSetRecord(*cookie);
+                    cookie->mPersisted = true;
+                }
+                else if(dirty.mbPersisted)
+                {
+                    AppendCookieRemoveRecord(it->first);
+                    if(cookie)
+                        cookie->mPersisted = false;
+                }
+            }
+            mDirtyCookies.clear();
 
-                        CookieFullTextFixedString8 cookieText = cookie->CreateCookieString();
-						bool hasEnoughSpaceToWriteCookie = (mParams.mMaxCookieFileSize - numBytes ) > (cookieText.length() + 1 + maxCookieFileOverhead);
-						if(hasEnoughSpaceToWriteCookie)
-						{
-							strcat(pCookieFileBuffer, cookieText.c_str());
-							strcat(pCookieFileBuffer, COOKIE_DELIMITER);
-							numBytes += (cookieText.length() + 1);
-						}
-					}
+            if(!mCookieFileBuffer.empty())
+            {
+                mCookieFileSize += (int64_t)mCookieFileBuffer.size();
+                mCookieFileWriter->Write(mCookieFileBuffer, false);
+            }
+        }
 
-					// Calculate the checksum for the file buffer.
-					uint32_t cookieChecksum = GetChecksum(pCookieFileBuffer, numBytes);
-					char8_t cookieChecksumData[maxCookieFileOverhead];
+        void CookieManager::CompactCookieFile()
+        {
+            // Rewrites the file with a single set record per saved cookie, oldest first.
+            using namespace CookieManagerHelp;
+
+            if(!mCookieFileWriter)
+                return;
 
-					sprintf(cookieChecksumData, "%d", cookieChecksum);
+            mCookieFileBuffer.clear();
+            CookieFileWriteU32(mCookieFileBuffer, kCookieFileMagic);
+            CookieFileWriteU32(mCookieFileBuffer, kCookieFileVersion);
+            mCookieRecordCount = 0;
 
-					// Write the checksum first and then version and the remaining data in the file.
-					fileSystem->WriteFile(fileObject, cookieChecksumData, EA::Internal::Strlen(cookieChecksumData));
-					fileSystem->WriteFile(fileObject, COOKIE_DELIMITER, 1);//strlen(COOKIE_DELIMITER) = 1
+            const time_t timeNow = ::time(NULL);
+            for(CookieList::iterator iter = mCookies.begin(); iter != mCookies.end(); ++iter)
+            {
+                Cookie* cookie = &*iter;
+                cookie->mPersisted = false;
 
-					fileSystem->WriteFile(fileObject, pCookieFileBuffer, numBytes);
-                    fileSystem->CloseFile(fileObject);
+                //Don't write these cookies to the file. Not intended to be saved.
+                if(cookie->IsCookieExpired(timeNow) || cookie->mExpiresAtEndOfSession) 
+                    continue;
 
-					EAWEBKIT_DELETE[] pCookieFileBuffer;//WTF::fastDeleteArray<char8_t> (pCookieFileBuffer);
-					pCookieFileBuffer = NULL;
+                // As before, cookies that don't fit in mMaxCookieFileSize are not saved.
+                const eastl_size_t recordStart = mCookieFileBuffer.size();
+                AppendCookieSetRecord(*cookie);
+                if(mCookieFileBuffer.size() > mParams.mMaxCookieFileSize)
+                {
+                    mCookieFileBuffer.resize(recordStart);
+                    --mCookieRecordCount;
+                    continue;
                 }
-                fileSystem->DestroyFileObject(fileObject);
+                cookie->mPersisted = true;
+            }
+            mDirtyCookies.clear();
+
+            mCookieFileSize  = (int64_t)mCookieFileBuffer.size();
+            mCookieFileValid = true;
+            mCookieFileWriter->Write(mCookieFileBuffer, true);
+        }
+
+        void CookieManager::AppendCookieSetRecord(const Cookie& cookie)
+        {
+            using namespace CookieManagerHelp;
+
+            const eastl_size_t recordStart = mCookieFileBuffer.size();
+            mCookieFileBuffer.resize(recordStart + kCookieRecordHeaderSize); // Written by EndCookieRecord.
+
+            CookieFileWriteString(mCookieFileBuffer, cookie.mName.c_str(), (uint32_t)cookie.mName.size());
+            CookieFileWriteString(mCookieFileBuffer, cookie.mValue.c_str(), (uint32_t)cookie.mValue.size());
+            CookieFileWriteString(mCookieFileBuffer, cookie.mDomain.c_str(), (uint32_t)cookie.mDomain.size());
+            CookieFileWriteString(mCookieFileBuffer, cookie.mPath.c_str(), (uint32_t)cookie.mPath.size());
+            CookieFileWriteString(mCookieFileBuffer, cookie.mComment.c_str(), (uint32_t)cookie.mComment.size());
+            CookieFileWriteString(mCookieFileBuffer, cookie.mCommentURL.c_str(), (uint32_t)cookie.mCommentURL.size());
+
+            const uint64_t expirationTime = (uint64_t)(int64_t)cookie.mExpirationTime;
+            CookieFileWriteU32(mCookieFileBuffer, (uint32_t)expirationTime);
+            CookieFileWriteU32(mCookieFileBuffer, (uint32_t)(expirationTime >> 32));
+            CookieFileWriteU32(mCookieFileBuffer, cookie.mVersion);
+
+            uint8_t flags = 0;
+            if(cookie.mDomainDefaulted)
+                flags |= kCookieRecordFlagDomainDefaulted;
+            if(cookie.mPathDefaulted)
+                flags |= kCookieRecordFlagPathDefaulted;
+            if(cookie.mSecure)
+                flags |= kCookieRecordFlagSecure;
+            if(cookie.mHttpOnly)
+                flags |= kCookieRecordFlagHttpOnly;
+            mCookieFileBuffer.push_back((char)flags);
+
+            uint8_t portCount = 0;
+            while((portCount < Cookie::MAX_NUM_PORTS) && cookie.mPorts[portCount])
+                ++portCount;
+            mCookieFileBuffer.push_back((char)portCount);
+            for(uint8_t i = 0; i < portCount; ++i)
+                CookieFileWriteU32(mCookieFileBuffer, cookie.mPorts[i]);
+
+            EndCookieRecord(kCookieRecordSet, recordStart);
+        }
+
+        void CookieManager::AppendCookieRemoveRecord(const FixedString8_256& key)
+        {
+            using namespace CookieManagerHelp;
+
+            const eastl_size_t recordStart = mCookieFileBuffer.size();
+            mCookieFileBuffer.resize(recordStart + kCookieRecordHeaderSize); // Written by EndCookieRecord.
+            CookieFileWriteString(mCookieFileBuffer, key.c_str(), (uint32_t)key.size());
+            EndCookieRecord(kCookieRecordRemove, recordStart);
+        }
+
+        void CookieManager::EndCookieRecord(uint8_t recordType, eastl_size_t recordStart)
+        {
+            using namespace CookieManagerHelp;
+
+            const uint32_t payloadSize = (uint32_t)(mCookieFileBuffer.size() - recordStart - kCookieRecordHeaderSize);
+            const uint32_t checksum    = GetChecksum(mCookieFileBuffer.data() + recordStart + kCookieRecordHeaderSize, payloadSize);
+            CookieFileWriteU32(mCookieFileBuffer, checksum);
+
+            char* pHeader = mCookieFileBuffer.data() + recordStart;
+            pHeader[0] = (char)recordType;
+            pHeader[1] = (char)(payloadSize);
+            pHeader[2] = (char)(payloadSize >> 8);
+            pHeader[3] = (char)(payloadSize >> 16);
+            pHeader[4] = (char)(payloadSize >> 24);
+
+            ++mCookieRecordCount;
+        }
+
+        void CookieManager::StartCookieFileWriter()
+        {
+            if(mCookieFileWriter || mParams.mCookieFilePath.empty())
+                return;
+
+            mCookieFileWriter = EAWEBKIT_NEW("CookieFileWriter") CookieFileWriter(mParams.mCookieFilePath.c_str());
+            if(mParams.mAsyncFileIO)
+                mCookieFileWriter->StartThread();   // Writes synchronously if this fails.
+        }
+
+        void CookieManager::StopCookieFileWriter()
+        {
+            if(mCookieFileWriter)
+            {
+                mCookieFileWriter->Stop();
+                if(mCookieFileWriter->TakeWriteFailed())
+                    mCookieFileValid = false;
+
+                EAWEBKIT_DELETE mCookieFileWriter;
+                mCookieFileWriter = NULL;
             }
         }
 
@@ -567,11 +1319,9 @@ namespace EA
 				return;
 			}
 
-            if(parameters.mMaxCookieCount < mCookies.size())
-            {
-                // This is a crude way to reduce the cookie count. Would be better if we chose based on dates.
-                mCookies.resize(parameters.mMaxCookieCount);
-            }
+            // This is a crude way to reduce the cookie count. Would be better if we chose based on dates.
+            while(parameters.mMaxCookieCount < mCookieCount)
+                RemoveCookie(&mCookies.back());
 
             if(parameters.mMaxIndividualCookieSize != mParams.mMaxIndividualCookieSize)
             {
@@ -631,6 +1381,8 @@ namespace EA
                     ProcessCookieHeader(headerValue.c_str(),uri.c_str());
                 }
             }
+
+            FlushCookieFile();
             return true;
         }
 
@@ -669,6 +1421,9 @@ namespace EA
                 EA::WebKit::HeaderMap::value_type eaValue(cookieHdr, cookieVal);
                 GetHeaderMap(tInfo->mHeaderMapOut)->insert(eaValue);
             }    
+
+            // Also saves the cookies set by scripts since the last response.
+            FlushCookieFile();
             return true;
         }
 
@@ -707,61 +1462,74 @@ namespace EA
                 typedef eastl::fixed_vector<const Cookie*, 8, true, EASTLAllocator> LocalMatches;
                 LocalMatches matches;
 
-                for( CookieList::const_iterator it = mCookies.begin(); it != mCookies.end(); ++it )
+                //Match the domain first. Only the buckets of the host and of its parent domains can hold matching cookies.
+                FixedString8_128 hostKey;
+                GetDomainKey(host, hostKey);
+
+                for(FixedString8_128::size_type keyStart = 0; keyStart != FixedString8_128::npos; )
                 {
-                    const Cookie* cookie = *it;
+                    const FixedString8_128 key(hostKey.c_str() + keyStart);
+                    keyStart = hostKey.find('.', keyStart);
+                    if(keyStart != FixedString8_128::npos)
+                        ++keyStart;
 
-                    //Match the domain first. 
-                    if(!EndsWithDomain(host, cookie->mDomain))
+                    CookieDomainIndex::const_iterator bucketIt = mCookieDomainIndex.find(key);
+                    if(bucketIt == mCookieDomainIndex.end())
                         continue;
 
-                    //Now match the path
-                    if(path.find(cookie->mPath) != 0)
-                        continue;
+                    const CookieBucket& bucket = bucketIt->second;
+                    for( CookieBucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it )
+                    {
+                        const Cookie* cookie = *it;
 
-                    //Check if the cookie expired
-                    if(cookie->IsCookieExpired(timeNow))
-                        continue;
+                        //Now match the path
+                        if(path.find(cookie->mPath) != 0)
+                            continue;
 
-                    //Check if the cookie is secure and if it is, what is the connection type
-                    if(cookie->mSecure && scheme.comparei("https") != 0)
-                        continue;
+                        //Check if the cookie expired
+                        if(cookie->IsCookieExpired(timeNow))
+                            continue;
 
-					//If requested by JavaScript and the cookie is set to HttpOnly, don't send it.
-					if(ignoreHttpOnlyCookies && cookie->mHttpOnly)
-						continue;
+                        //Check if the cookie is secure and if it is, what is the connection type
+                        if(cookie->mSecure && scheme.comparei("https") != 0)
+                            continue;
 
-                    //Check if the cookie is being sent to a valid port
-                    if(cookie->mPorts[0])
-                    {
-                        uint16_t urlPort(80);
-                        if(url.port())
-                            urlPort = url.port();
-                        uint16_t index = 0;
-                        for(; index < Cookie::MAX_NUM_PORTS ; ++index)
+						//If requested by JavaScript and the cookie is set to HttpOnly, don't send it.
+						if(ignoreHttpOnlyCookies && cookie->mHttpOnly)
+							continue;
+
+                        //Check if the cookie is being sent to a valid port
+                        if(cookie->mPorts[0])
                         {
-                            if(cookie->mPorts[index] == urlPort)
-                                break;
+                            uint16_t urlPort(80);
+                            if(url.port())
+                                urlPort = url.port();
+                            uint16_t index = 0;
+                            for(; index < Cookie::MAX_NUM_PORTS ; ++index)
+                            {
+                                if(cookie->mPorts[index] == urlPort)
+                                    break;
+                            }
+                            if(index == Cookie::MAX_NUM_PORTS)
+                                continue;
                         }
-                        if(index == Cookie::MAX_NUM_PORTS)
-                            continue;
-                    }
 
-                    //Congratulations! Cookies passed all the criteria.
+                        //Congratulations! Cookies passed all the criteria.
 
-                    // So figure out the lowest version cookie for the cookies matching with this server. If the server did not specify a version
-                    //for the cookie, this would result in the lowestVersion being set to 0.
-                    if( lowestVersion > cookie->mVersion )
-                        lowestVersion = cookie->mVersion;
+                        // So figure out the lowest version cookie for the cookies matching with this server. If the server did not specify a version
+                        //for the cookie, this would result in the lowestVersion being set to 0.
+                        if( lowestVersion > cookie->mVersion )
+                            lowestVersion = cookie->mVersion;
 
-                    matches.push_back(cookie);
+                        matches.push_back(cookie);
+                    }
                 }
 
                 if( !matches.empty() )
                 {
-                    //sort by path length for specificity but don't change the order otherwise
-					EA::WebKit::EASTLAllocator allocator;
-					eastl::stable_sort(matches.begin(),matches.end(),allocator, CookiePathSorter());
+                    //sort by path length for specificity but don't change the order otherwise. Each bucket is already sorted, so this
+					//only merges the buckets of the parent domains.
+					eastl::insertion_sort(matches.begin(),matches.end(),CookiePathSorter());
 
                     //Only send the version string if we received one at the first place.
                     //Not sure what number to send in case of mixed versions. Sending the lowest at the moment.
@@ -811,13 +1579,13 @@ namespace EA
 
         uint16_t CookieManager::EnumerateCookies(Cookie** cookiePtrArray, uint16_t& numCookies)
         {
-            if(numCookies > mCookies.size())
-                numCookies = mCookies.size();
+            if(numCookies > mCookieCount)
+                numCookies = mCookieCount;
 
             int index = 0;
 
-            for(CookieList::const_iterator iter = mCookies.begin(); (iter != mCookies.end() && index<numCookies); ++iter, ++index)
-                cookiePtrArray[index] = *iter;
+            for(CookieList::iterator iter = mCookies.begin(); (iter != mCookies.end() && index<numCookies); ++iter, ++index)
+                cookiePtrArray[index] = &*iter;
 
             return numCookies;
         }
@@ -828,7 +1596,7 @@ namespace EA
 			int index = 0;
 
 			for(CookieList::const_iterator iter = mCookies.begin(); (iter != mCookies.end() && index< numCookiesToRead) ; ++iter, ++index)
-				strcpy(rawCookieData[index],(*iter)->CreateCookieString().c_str());
+				strcpy(rawCookieData[index],iter->CreateCookieString().c_str());
 
 			return index;
 		}
@@ -841,21 +1609,38 @@ namespace EA
 
 			if( !host.empty() )
 			{
-				CookieList::iterator it = mCookies.begin();
-				while( it!= mCookies.end())
+				typedef eastl::fixed_vector<Cookie*, 8, true, EASTLAllocator> LocalMatches;
+				LocalMatches matches;
+
+				FixedString8_128 hostKey;
+				GetDomainKey(host, hostKey);
+
+				for(FixedString8_128::size_type keyStart = 0; keyStart != FixedString8_128::npos; )
 				{
-					const Cookie* cookie = *it;
+					const FixedString8_128 key(hostKey.c_str() + keyStart);
+					keyStart = hostKey.find('.', keyStart);
+					if(keyStart != FixedString8_128::npos)
+						++keyStart;
+
+					CookieDomainIndex::const_iterator bucketIt = mCookieDomainIndex.find(key);
+					if(bucketIt == mCookieDomainIndex.end())
+						continue;
 
-					if(WTF::String(cookie->mName.c_str()) ==  name 
-						&& EndsWithDomain(host, cookie->mDomain) 
-						&& url.path().find(cookie->mPath.c_str()) == 0)
+					const CookieBucket& bucket = bucketIt->second;
+					for(CookieBucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it)
 					{
-						delete cookie;
-						it = mCookies.erase(it);
-					}
+						Cookie* cookie = *it;
 
-					
+						if(WTF::String(cookie->mName.c_str()) ==  name 
+							&& url.path().find(cookie->mPath.c_str()) == 0)
+						{
+							matches.push_back(cookie);
+						}
+					}
 				}
+
+				for(LocalMatches::iterator it = matches.begin(); it != matches.end(); ++it)
+					RemoveCookie(*it);
 			}
 		}
 		
@@ -869,15 +1654,17 @@ namespace EA
 
             if( cookie && ValidateCookie( cookie, pURI ) )
             {
-                // see if this cookie is replacing or removing an existing one
-                for( CookieList::iterator it = mCookies.begin(); it != mCookies.end(); it++ )
+                // see if this cookie is replacing or removing an existing one. It has the same domain key.
+                FixedString8_128 key;
+                CookieManagerHelp::GetDomainKey(cookie->mDomain, key);
+                CookieDomainIndex::const_iterator bucketIt = mCookieDomainIndex.find(key);
+                const CookieBucket* pBucket = (bucketIt != mCookieDomainIndex.end()) ? &bucketIt->second : NULL;
+                for( eastl_size_t i = 0; pBucket && (i < pBucket->size()); ++i )
                 {
-                    Cookie* c = *it;
-					if( 0 == c->mName.compare( cookie->mName ) && CookieManagerHelp::DomainsMatch(c->mDomain,cookie->mDomain)
-                        && 0 == c->mPath.compare( cookie->mPath ) )
+                    Cookie* c = (*pBucket)[i];
+					if( 0 == c->mName.compare( cookie->mName ) && 0 == c->mPath.compare( cookie->mPath ) )
                     {
                         //Found an existing cookie to match the new cookie. Delete existing cookie. 
-                        delete *it;
                         //An existing cookie has to come from a server. 
                         //1. If the server does not set the expire/max-age attribute, it is a session cookie. Just replace the existing one.
                         //2. If the server does set the expire/max-age attribute, check if the cookie has expired (Servers do it by setting 0 as max-age
@@ -886,11 +1673,11 @@ namespace EA
                         if(cookie->IsCookieExpired(timeNow) && !cookie->mExpiresAtEndOfSession)
                         {
                                 delete cookie;
-                                mCookies.erase( it );
+                                RemoveCookie( c );
                         }
                         else //Just overwrite the existing cookie
                         {
-                            *it = cookie;
+                            ReplaceCookie( c, cookie );
                         }
 
                         return; // stop processing we are done
@@ -912,16 +1699,12 @@ namespace EA
                 else
                 {
                     // add a new cookie
-                    mCookies.push_back( cookie );
+                    AddCookie( cookie );
 
                     // enforce the maximum number of cookies
                     //AJBTODO: We can code something like delete least frequently used cookie here rather than the oldest cookie.
-                    if( mCookies.size() > mParams.mMaxCookieCount )
-					{
-						Cookie* c = mCookies.front();
-						mCookies.pop_front();
-						delete c;
-					}
+                    if( mCookieCount > mParams.mMaxCookieCount )
+						RemoveCookie( &mCookies.front() );
                 }
                 
             }
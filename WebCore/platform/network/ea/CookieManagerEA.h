@@ -38,9 +38,12 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define CookieManagerEA_h
 
 #include <EASTL/string.h>
-#include <EASTL/list.h>
+#include <EASTL/intrusive_list.h>
+#include <EASTL/hash_map.h>
+#include <EASTL/vector.h>
 
 #include <EAWebKit/EAWebKit.h>
+#include <EAWebKit/EAWebKitFileSystem.h>
 #include <internal/include/EAWebKitEASTLHelpers.h>
 #include <time.h>
 
@@ -68,17 +71,20 @@ namespace EA
                 , mMaxIndividualCookieSize(kMaxIndividualCookieSizeDefault)
                 , mMaxCookieFileSize(kMaxCookieFileSizeDefault)
                 , mMaxCookieCount(kMaxCookieCountDefault)
+                , mAsyncFileIO(false)
             {
             }
             
             explicit CookieManagerParameters(const char* cookieFilePath,
                                              uint32_t maxIndividualCookieSize = kMaxIndividualCookieSizeDefault,
                                              uint32_t maxCookieFileSize = kMaxCookieFileSizeDefault,
-                                             uint32_t maxCookieCount = kMaxCookieCountDefault)
+                                             uint32_t maxCookieCount = kMaxCookieCountDefault,
+                                             bool asyncFileIO = false)
                 : mCookieFilePath(cookieFilePath ? cookieFilePath : "")
                 , mMaxIndividualCookieSize(maxIndividualCookieSize)
                 , mMaxCookieFileSize(maxCookieFileSize)
                 , mMaxCookieCount((uint16_t)maxCookieCount)
+                , mAsyncFileIO(asyncFileIO)
             {
             }
             
@@ -86,6 +92,7 @@ namespace EA
             uint32_t     mMaxIndividualCookieSize;  // The maximum size of an individual cookie.
             uint32_t     mMaxCookieFileSize;        // Max size of persistent cookie file.
             uint16_t     mMaxCookieCount;           // Max number of concurrent cookies.
+            bool         mAsyncFileIO;              // Write the cookie file from a background thread (see Parameters::mCookieAsyncFileIO).
         };
 
         typedef FixedString8_256 CookieFullTextFixedString8;
@@ -95,7 +102,7 @@ namespace EA
         ///
         /// class for holding cookie data stored by CookieManager
         ///
-        class Cookie /*: public WTF::FastAllocBase*/
+        class Cookie : public eastl::intrusive_list_node/*, public WTF::FastAllocBase*/
         {
         public:
             static const uint16_t MAX_NUM_PORTS = 16;
@@ -116,6 +123,8 @@ namespace EA
             bool          mExpiresAtEndOfSession;    
             bool          mSecure;
 			bool		  mHttpOnly;
+            uint32_t      mSequence;                 // Order in which the CookieManager stored the cookie. A cookie replacing another keeps its sequence.
+            bool          mPersisted;                // The cookie file holds this cookie. A cookie replacing another keeps this flag.
 
         public:
             explicit Cookie(char8_t* name)
@@ -132,6 +141,8 @@ namespace EA
                 , mExpiresAtEndOfSession(true)
                 , mSecure(false)
 				, mHttpOnly(false)
+                , mSequence(0)
+                , mPersisted(false)
             {
                 mPorts[0] = 0;
             }
@@ -164,8 +175,10 @@ namespace EA
         public:
             bool operator() (const Cookie* cookie1, const Cookie* cookie2) const
             {
-                // Sort longest first.
-                return (cookie2->mPath.length() < cookie1->mPath.length()); 
+                // Sort longest first. Cookies with paths of the same length are sorted oldest first.
+                if(cookie1->mPath.length() != cookie2->mPath.length())
+                    return (cookie2->mPath.length() < cookie1->mPath.length()); 
+                return (cookie1->mSequence < cookie2->mSequence);
             }
         };
         
@@ -214,23 +227,67 @@ namespace EA
 			void deleteCookie(const WebCore::KURL& url, const WTF::String& name);
 
         protected:
-            typedef eastl::list<Cookie*, EASTLAllocator> CookieList;
+            typedef eastl::intrusive_list<Cookie> CookieList;
+            typedef eastl::vector<Cookie*, EASTLAllocator> CookieBucket; // Sorted by CookiePathSorter.
+            typedef eastl::hash_map<FixedString8_128, CookieBucket, eastl::string_hash<FixedString8_128>, eastl::equal_to<FixedString8_128>, EASTLAllocator> CookieDomainIndex;
+            typedef eastl::vector<char, EASTLAllocator> CookieFileBuffer;
+
+            // A cookie changed since the cookie file was last written. mpCookie is NULL if the cookie was removed.
+            struct DirtyCookie
+            {
+                Cookie* mpCookie;
+                bool    mbPersisted;    // The cookie file holds the cookie of this key.
+
+                DirtyCookie() : mpCookie(0), mbPersisted(false) { }
+            };
+            typedef eastl::hash_map<FixedString8_256, DirtyCookie, eastl::string_hash<FixedString8_256>, eastl::equal_to<FixedString8_256>, EASTLAllocator> DirtyCookieMap;
+
+            class CookieFileWriter;
 
             CookieManager(const CookieManager& mgr);
             CookieManager& operator = (const CookieManager& mgr);
             
             /// Clear the stored cookies
             void ReadCookiesFromFile();
-            void WriteCookiesToFile();
+            bool ParseCookieFile(const char* pData, int64_t size);
+            void ParseLegacyCookieFile(char8_t* pCookieFileBuffer, int64_t numBytes);
+
+            // The cookie file is a small header followed by an append-only journal of set and remove records. Changed cookies are
+            // collected in mDirtyCookies and appended as a batch by FlushCookieFile. The file is only rewritten (compacted) once the
+            // journal has grown well past the cookie count.
+            void FlushCookieFile();
+            void CompactCookieFile();
+            bool CookieFileNeedsCompaction() const;
+            void AppendCookieSetRecord(const Cookie& cookie);
+            void AppendCookieRemoveRecord(const FixedString8_256& key);
+            void EndCookieRecord(uint8_t recordType, eastl_size_t recordStart);
+            void MarkCookieDirty(Cookie* cookie, bool removed);
+            void StartCookieFileWriter();
+            void StopCookieFileWriter();
+
             /// Deletes the cookies file. It does not remove any existing session cookies.
             void DeleteCookiesFile();
             void ClearCookies();
+            void AddCookie(Cookie* cookie);
+            void RemoveCookie(Cookie* cookie);
+            void ReplaceCookie(Cookie* oldCookie, Cookie* newCookie);
+            void AddCookieToDomainIndex(Cookie* cookie);
+            void RemoveCookieFromDomainIndex(Cookie* cookie);
             Cookie* ParseCookieHeader( const CookieFullTextFixedString8& headerValue, const char8_t* pURI = 0,bool ignoreHttpOnlyHeader = false );
             bool ValidateCookie( Cookie* cookie, const char8_t* pURI );
 			uint32_t GetChecksum(const char* buffer, const int64_t size); 
         protected:
             CookieManagerParameters mParams;            // 
-            CookieList              mCookies;           // All cookies that we have.
+            CookieList              mCookies;           // All cookies that we have, oldest first.
+            CookieDomainIndex       mCookieDomainIndex; // The cookies by domain key (see CookieManagerHelp::GetDomainKey), so that a request only looks at the cookies of its host.
+            uint32_t                mCookieCount;       // Size of mCookies, as intrusive_list::size is linear.
+            uint32_t                mCookieSequence;    // Next Cookie::mSequence.
+            DirtyCookieMap          mDirtyCookies;      // Cookies changed since the last flush, by cookie key (see CookieManagerHelp::GetCookieKey).
+            CookieFileBuffer        mCookieFileBuffer;  // Records being built by FlushCookieFile or CompactCookieFile.
+            CookieFileWriter*       mCookieFileWriter;  // Writes the cookie file, on a background thread if possible.
+            int64_t                 mCookieFileSize;    // Bytes written to the cookie file.
+            uint32_t                mCookieRecordCount; // Records in the cookie file, including superseded ones.
+            bool                    mCookieFileValid;   // The cookie file can be appended to. If not, the next flush rewrites it.
             char8_t*                mCookieParseBuffer; // Holds an individual cookie for parsing. Corresponds to CookieManagerParameters::mMaxIndividualCookieSize
             bool                    mInitialized;       // 
         };
@@ -0,0 +1,251 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+its contributors may be used to endorse or promote products derived
+from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// HttpConnectionPoolEA.cpp
+//
+// Maintained by EAWebKit Team
+///////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "HttpConnectionPoolEA.h"
+
+#include <EAWebKit/EAWebKit.h>
+#include <internal/include/EAWebKit_p.h>
+#include <EAAssert/eaassert.h>
+
+namespace EA
+{
+namespace WebKit
+{
+const uint32_t	kPipeliningMinPersistentResponses	= 2;		// A server has to keep a connection open this many times in a row before it is sent pipelined requests.
+const double	kOriginForgetSeconds				= 300.0;	// An origin with nothing active or idle is dropped after this long, along with what was learned about it.
+const double	kTickIntervalSeconds				= 1.0;
+
+HttpConnectionPool::Origin::Origin()
+	: mIdleExpiry()
+	, mActiveCount(0)
+	, mPersistentResponses(0)
+	, mPipelining(kPipeliningUnknown)
+	, mLastUseTime(0.0)
+{
+}
+
+HttpConnectionPool::HttpConnectionPool()
+	: mOrigins()
+	, mNextTickTime(0.0)
+	, mIdleCount(0)
+	, mConnectionsOpened(0)
+	, mConnectionsReused(0)
+	, mTLSHandshakesAvoided(0)
+	, mConnectionsExpired(0)
+	, mPipelinedRequests(0)
+{
+}
+
+bool HttpConnectionPool::GetOrigin(const char8_t* pURI, OriginString& origin, bool& bSecure)
+{
+	origin.clear();
+
+	const char8_t* pScheme = pURI;
+	while(*pURI && (*pURI != ':'))
+		++pURI;
+	if((pURI[0] != ':') || (pURI[1] != '/') || (pURI[2] != '/') || (pURI == pScheme))
+		return false;
+
+	origin.assign(pScheme, pURI);
+	bSecure = (origin.comparei("https") == 0);
+	origin += "://";
+	pURI += 3;
+
+	const char8_t* pHost = pURI;
+	while(*pURI && (*pURI != ':') && (*pURI != '/') && (*pURI != '?') && (*pURI != '#'))
+		++pURI;
+	if(pURI == pHost)
+		return false;
+
+	origin.append(pHost, pURI);
+	origin.make_lower();
+	origin += ':';
+	if((*pURI == ':') && (pURI[1] >= '0') && (pURI[1] <= '9'))
+	{
+		for(++pURI; (*pURI >= '0') && (*pURI <= '9'); ++pURI)
+			origin += *pURI;
+	}
+	else
+		origin += (bSecure ? "443" : "80");
+
+	return true;
+}
+
+bool HttpConnectionPool::Acquire(const OriginString& origin, bool bSecure)
+{
+	const Parameters& params = GetParameters();
+	const double currentTime = GetTime();
+
+	Origin& entry = mOrigins[origin];
+	ExpireIdle(entry, currentTime);
+	entry.mLastUseTime = currentTime;
+
+	// The HttpManager picks an open connection to the origin if there is one. The most recently idle one has the most time left.
+	if(!entry.mIdleExpiry.empty())
+	{
+		entry.mIdleExpiry.pop_back();
+		--mIdleCount;
+		++mConnectionsReused;
+		if(bSecure)
+			++mTLSHandshakesAvoided;
+	}
+	else
+		++mConnectionsOpened;
+
+	++entry.mActiveCount;
+
+	// Connections past the limit are closed by the server once their request is done, instead of sitting idle.
+	if(!params.mHttpKeepAliveTimeoutSeconds || !params.mMaxKeepAliveConnectionsPerHost)
+		return false;
+	return (entry.mActiveCount + entry.mIdleExpiry.size()) <= params.mMaxKeepAliveConnectionsPerHost;
+}
+
+void HttpConnectionPool::Release(const OriginString& origin, bool bKeepAliveRequested, bool bSucceeded, bool bHttp11, bool bPersistent, double keepAliveSeconds, bool bPipelined)
+{
+	OriginMap::iterator it = mOrigins.find(origin);
+	if(it == mOrigins.end())
+		return;
+
+	Origin& entry = it->second;
+	const double currentTime = GetTime();
+	EA_ASSERT(entry.mActiveCount);
+	--entry.mActiveCount;
+	entry.mLastUseTime = currentTime;
+
+	if(!bSucceeded)
+	{
+		// DirtySDK drops a connection whose transaction failed. A server that failed a pipelined request is not sent any more.
+		entry.mPersistentResponses = 0;
+		if(bPipelined)
+			entry.mPipelining = kPipeliningIncapable;
+		return;
+	}
+
+	// Closing a connection we asked to close says nothing about the server.
+	if(!bKeepAliveRequested)
+		return;
+
+	if(!bHttp11)
+		entry.mPipelining = kPipeliningIncapable;
+	else if(!bPersistent)
+		entry.mPersistentResponses = 0;
+	else if((++entry.mPersistentResponses >= kPipeliningMinPersistentResponses) && (entry.mPipelining == kPipeliningUnknown))
+		entry.mPipelining = kPipeliningCapable;
+
+	if(bPersistent)
+	{
+		const Parameters& params = GetParameters();
+		double idleSeconds = (double)params.mHttpKeepAliveTimeoutSeconds;
+		if((keepAliveSeconds > 0.0) && (keepAliveSeconds < idleSeconds))
+			idleSeconds = keepAliveSeconds;
+
+		if((entry.mActiveCount + entry.mIdleExpiry.size()) < params.mMaxKeepAliveConnectionsPerHost)
+		{
+			entry.mIdleExpiry.push_back(currentTime + idleSeconds);
+			++mIdleCount;
+		}
+	}
+}
+
+bool HttpConnectionPool::CanPipeline(const OriginString& origin) const
+{
+	OriginMap::const_iterator it = mOrigins.find(origin);
+	return (it != mOrigins.end()) && (it->second.mPipelining == kPipeliningCapable);
+}
+
+uint32_t HttpConnectionPool::ExpireIdle(Origin& origin, double currentTime)
+{
+	// Connections go idle in order but the server timeouts differ, so any of them may be past its time.
+	uint32_t expired = 0;
+	for(ExpiryList::iterator it = origin.mIdleExpiry.begin(); it != origin.mIdleExpiry.end(); )
+	{
+		if(*it <= currentTime)
+		{
+			it = origin.mIdleExpiry.erase(it);
+			++expired;
+		}
+		else
+			++it;
+	}
+
+	mIdleCount -= expired;
+	mConnectionsExpired += expired;
+	return expired;
+}
+
+void HttpConnectionPool::Tick()
+{
+	const double currentTime = GetTime();
+	if(currentTime < mNextTickTime)
+		return;
+	mNextTickTime = currentTime + kTickIntervalSeconds;
+
+	for(OriginMap::iterator it = mOrigins.begin(); it != mOrigins.end(); )
+	{
+		Origin& entry = it->second;
+		ExpireIdle(entry, currentTime);
+		if(!entry.mActiveCount && entry.mIdleExpiry.empty() && ((currentTime - entry.mLastUseTime) > kOriginForgetSeconds))
+			it = mOrigins.erase(it);
+		else
+			++it;
+	}
+}
+
+void HttpConnectionPool::Clear()
+{
+	mOrigins.clear();
+	mIdleCount = 0;
+}
+
+void HttpConnectionPool::GetUsage(HttpConnectionUsageInfo& usageInfo) const
+{
+	usageInfo.mConnectionsOpened	= mConnectionsOpened;
+	usageInfo.mConnectionsReused	= mConnectionsReused;
+	usageInfo.mTLSHandshakesAvoided	= mTLSHandshakesAvoided;
+	usageInfo.mConnectionsExpired	= mConnectionsExpired;
+	usageInfo.mPipelinedRequests	= mPipelinedRequests;
+	usageInfo.mIdleConnections		= mIdleCount;
+	usageInfo.mOrigins				= (uint32_t)mOrigins.size();
+
+	usageInfo.mPipeliningOrigins = 0;
+	for(OriginMap::const_iterator it = mOrigins.begin(); it != mOrigins.end(); ++it)
+	{
+		if(it->second.mPipelining == kPipeliningCapable)
+			++usageInfo.mPipeliningOrigins;
+	}
+}
+
+}
+}
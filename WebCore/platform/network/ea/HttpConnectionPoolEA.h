@@ -0,0 +1,123 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+its contributors may be used to endorse or promote products derived
+from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// HttpConnectionPoolEA.h
+//
+// Maintained by EAWebKit Team
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// Keep-alive bookkeeping of TransportHandlerDirtySDK, per origin (scheme, host 
+// and port). The HttpManager owns the sockets and sends a request on an open 
+// connection to the same origin when it has one. The pool decides which requests 
+// may leave their connection open (at most Parameters::mMaxKeepAliveConnectionsPerHost 
+// per origin), how long an idle connection still counts as reusable, and which 
+// origins have answered enough persistent HTTP/1.1 responses to be trusted with 
+// pipelined requests. Used from the main thread only.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef HTTPCONNECTIONPOOLEA_H
+#define HTTPCONNECTIONPOOLEA_H
+
+#include <EABase/eabase.h>
+#include <EAWebKit/EAWebkitAllocator.h>
+#include <eastl/fixed_string.h>
+#include <eastl/fixed_vector.h>
+#include <eastl/map.h>
+
+namespace EA
+{
+namespace WebKit
+{
+struct HttpConnectionUsageInfo;
+
+class HttpConnectionPool
+{
+public:
+	typedef eastl::fixed_string<char8_t, 64, true, EASTLAllocator> OriginString;
+
+	HttpConnectionPool();
+
+	// Extracts "scheme://host:port" from pURI, lower case and with the default port filled in. Returns false if pURI has no host.
+	static bool GetOrigin(const char8_t* pURI, OriginString& origin, bool& bSecure);
+
+	// A request to origin is about to be sent. Returns true if its connection may be kept alive once the response is in.
+	bool Acquire(const OriginString& origin, bool bSecure);
+
+	// The request is done. bPersistent tells if the server left the connection open, and keepAliveSeconds is the timeout 
+	// of its Keep-Alive header (0 if it sent none). A request that did not complete (bSucceeded false) leaves no idle connection.
+	void Release(const OriginString& origin, bool bKeepAliveRequested, bool bSucceeded, bool bHttp11, bool bPersistent, double keepAliveSeconds, bool bPipelined);
+
+	// True once origin is known to handle pipelined requests.
+	bool CanPipeline(const OriginString& origin) const;
+	void CountPipelinedRequest() { ++mPipelinedRequests; }
+
+	void Tick();	// Expires idle connections and forgets origins that have been unused for a while.
+	void Clear();
+	void GetUsage(HttpConnectionUsageInfo& usageInfo) const;
+
+private:
+	enum PipeliningState
+	{
+		kPipeliningUnknown,
+		kPipeliningCapable,
+		kPipeliningIncapable	// Stays so for the session; one broken pipelined response is enough.
+	};
+
+	typedef eastl::fixed_vector<double, 6, true, EASTLAllocator> ExpiryList;
+
+	struct Origin
+	{
+		ExpiryList		mIdleExpiry;			// When each idle connection stops counting as reusable, in the order they went idle.
+		uint32_t		mActiveCount;			// Requests in flight.
+		uint32_t		mPersistentResponses;	// Persistent HTTP/1.1 responses in a row.
+		PipeliningState	mPipelining;
+		double			mLastUseTime;
+
+		Origin();
+	};
+
+	typedef eastl::map<OriginString, Origin, eastl::less<OriginString>, EASTLAllocator> OriginMap;
+
+	uint32_t ExpireIdle(Origin& origin, double currentTime);
+
+	OriginMap	mOrigins;
+	double		mNextTickTime;
+	uint32_t	mIdleCount;
+	uint32_t	mConnectionsOpened;
+	uint32_t	mConnectionsReused;
+	uint32_t	mTLSHandshakesAvoided;
+	uint32_t	mConnectionsExpired;
+	uint32_t	mPipelinedRequests;
+};
+
+}
+}
+
+#endif // HTTPCONNECTIONPOOLEA_H
@@ -128,6 +128,27 @@ EA::WebKit::View* GetViewFromResourceHandle(WebCore::ResourceHandle* pRH)
 	return NULL;
 }
 
+
+// Maps a WebCore priority to one of the pending job queues (0 is the lowest priority).
+// Only cached subresources (style sheets, scripts, images, ...) get a priority from their loader. A request 
+// left unresolved is a main resource, an XHR or similar load that the page is waiting on, so it goes first.
+static uint32_t GetJobPriorityIndex(const WebCore::ResourceHandle* pRH)
+{
+	int priority = pRH->firstRequest().priority();
+	if(priority < WebCore::ResourceLoadPriorityLowest)
+		priority = WebCore::ResourceLoadPriorityHighest;
+	else if(priority > WebCore::ResourceLoadPriorityHighest)
+		priority = WebCore::ResourceLoadPriorityHighest;
+
+	COMPILE_ASSERT(WebCore::ResourceLoadPriorityHighest - WebCore::ResourceLoadPriorityLowest + 1 == EA::WebKit::kTransportJobPriorityCount, PriorityCountMatches);
+	return (uint32_t)(priority - WebCore::ResourceLoadPriorityLowest);
+}
+
+static uint32_t GetHostHash(const WebCore::KURL& kurl)
+{
+	const WTF::String host = kurl.host();  // KURL lowercases the host.
+	return host.isEmpty() ? 0 : host.impl()->hash();
+}
     
 } // namespace Local
 
@@ -135,6 +156,26 @@ EA::WebKit::View* GetViewFromResourceHandle(WebCore::ResourceHandle* pRH)
 namespace WebCore 
 {
 
+void JobInfo::Reset()
+{
+	mId						= 0;
+	mpRH					= NULL;
+	mJobState				= kJSInit;
+	mpTH					= NULL;
+	mTInfo.Reset();
+	mbTHInitialized			= false;
+	mbTHShutdown			= false;
+	mbSuccess				= true;
+	mbAuthorizationRequired	= false;
+	mbPaused				= false;
+	mProcessInfo			= EA::WebKit::ViewProcessInfo(EA::WebKit::kVProcessTypeTransportJob, EA::WebKit::kVProcessStatusStarted);
+	mIgnoreJob				= false;
+	mHostHash				= 0;
+	mStartTime				= 0.0;
+	mFirstByteTime			= 0.0;
+}
+
+
 
 
 
@@ -146,15 +187,19 @@ ResourceHandleManager* ResourceHandleManager::m_pInstance = NULL;
 const double kPollTimeSeconds = 0.016; //60 Frames per Second
 ResourceHandleManager::ResourceHandleManager()
     : m_downloadTimer(this, &ResourceHandleManager::downloadTimerCallback)
-    , m_pendingResourceHandleList()
     , m_runningJobs(0)
     , m_pollTimeSeconds(kPollTimeSeconds)
     , m_maxConcurrentJobs(16)
+    , m_maxJobsPerHost(6)
+    , m_hostJobCounts()
+    , m_jobQueueInfo()
     , m_cookieManager()
     , m_THInfoList()
     , m_JobInfoList()
+    , m_CondemnedJobs()
+    , m_freeJobInfoList()
+    , m_freeJobInfoCount(0)
     , m_JobIdNext(0)
-    , m_CondemnedJobsExist(false)
 #if _DEBUG
 	, m_readVolume(0)
     , m_writeVolume(0)
@@ -176,6 +221,15 @@ ResourceHandleManager::~ResourceHandleManager()
 
 	m_THDiskCache.Shutdown(NULL);
     m_cookieManager.Shutdown();
+
+	// 4. Free the pooled JobInfo instances.
+	while(!m_freeJobInfoList.empty())
+	{
+		JobInfo* pJobInfo = &m_freeJobInfoList.front();
+		m_freeJobInfoList.pop_front();
+		EAWEBKIT_DELETE pJobInfo;
+	}
+	m_freeJobInfoCount = 0;
 }
 
 
@@ -210,7 +264,12 @@ void ResourceHandleManager::add(ResourceHandle* pRH)
 	// We don't add this ResouceHandle to transfer loop right away to avoid Re-Entrancy issues. This ResourceHandle
 	// may be getting added from a Job already in the transfer loop.
 
-	m_pendingResourceHandleList.push_back(pRH);
+	const uint32_t priorityIndex = Local::GetJobPriorityIndex(pRH);
+	PendingJob& pendingJob = m_pendingJobLists[priorityIndex].push_back();
+	pendingJob.mpRH      = pRH;
+	pendingJob.mHostHash = Local::GetHostHash(pRH->firstRequest().url());
+	pendingJob.mQueueTime = EA::WebKit::GetTime();
+	m_jobQueueInfo.mPriority[priorityIndex].mQueuedJobs++;
 
 	if(!m_downloadTimer.isActive())
 		m_downloadTimer.startOneShot(m_pollTimeSeconds);
@@ -359,37 +418,71 @@ void ResourceHandleManager::downloadTimerCallback(Timer<ResourceHandleManager>*
 // Removes a job from our list of jobs that are queued for processing but haven't started yet.
 bool ResourceHandleManager::removePendingJob(ResourceHandle* pRH)
 {
-	for(ResourceHandleList::iterator it = m_pendingResourceHandleList.begin(); it != m_pendingResourceHandleList.end(); ++it)
+	for(uint32_t priorityIndex = 0; priorityIndex < EA::WebKit::kTransportJobPriorityCount; ++priorityIndex)
 	{
-		if(*it == pRH)
+		PendingJobList& pendingJobList = m_pendingJobLists[priorityIndex];
+		for(PendingJobList::iterator it = pendingJobList.begin(); it != pendingJobList.end(); ++it)
 		{
-			m_pendingResourceHandleList.remove(pRH);
-			pRH->deref();
-			return true;
+			if((*it).mpRH == pRH)
+			{
+				pendingJobList.erase(it);
+				m_jobQueueInfo.mPriority[priorityIndex].mQueuedJobs--;
+				pRH->deref();
+				return true;
+			}
 		}
 	}
 	return false;
 }
 
+bool ResourceHandleManager::canStartJobForHost(uint32_t hostHash) const
+{
+	if(!hostHash || (m_maxJobsPerHost <= 0))
+		return true;
+
+	HostJobCountMap::const_iterator it = m_hostJobCounts.find(hostHash);
+	return (it == m_hostJobCounts.end()) || ((*it).second < m_maxJobsPerHost);
+}
 
-// Goes through our list of jobs that are queued and starts them. 
-// Then removes them from the queue (m_pendingResourceHandleList).
+// Goes through our queues of pending jobs and starts them, highest priority first and in FIFO order within a priority.
+// A job whose host is at its job limit is skipped so that it does not hold back jobs to other hosts.
 bool ResourceHandleManager::startPendingJobs()
 {
-    // To consider: Come up with an algorithm to sort the various resources download priority order.
     bool started = false;
-    while (!m_pendingResourceHandleList.empty() && (m_runningJobs < m_maxConcurrentJobs))
+    const double timeNow = EA::WebKit::GetTime();
+
+    for(int priorityIndex = EA::WebKit::kTransportJobPriorityCount - 1; (priorityIndex >= 0) && (m_runningJobs < m_maxConcurrentJobs); --priorityIndex)
     {
-        ResourceHandle* pRH = m_pendingResourceHandleList.front();
-        m_pendingResourceHandleList.pop_front();  
-        startPendingJob(pRH);
-        started = true;
+        PendingJobList& pendingJobList = m_pendingJobLists[priorityIndex];
+        EA::WebKit::TransportJobPriorityInfo& priorityInfo = m_jobQueueInfo.mPriority[priorityIndex];
+
+        for(PendingJobList::iterator it = pendingJobList.begin(); (it != pendingJobList.end()) && (m_runningJobs < m_maxConcurrentJobs); )
+        {
+            const PendingJob pendingJob = *it;
+            if(!canStartJobForHost(pendingJob.mHostHash))
+            {
+                ++it;
+                continue;
+            }
+
+            it = pendingJobList.erase(it);
+
+            const double waitSeconds = timeNow - pendingJob.mQueueTime;
+            priorityInfo.mQueuedJobs--;
+            priorityInfo.mStartedJobs++;
+            priorityInfo.mTotalWaitSeconds += waitSeconds;
+            if(waitSeconds > priorityInfo.mMaxWaitSeconds)
+                priorityInfo.mMaxWaitSeconds = waitSeconds;
+
+            startPendingJob(pendingJob.mpRH, pendingJob.mHostHash);
+            started = true;
+        }
     }
 
     return started;
 }
 
-void ResourceHandleManager::startPendingJob(ResourceHandle* pRH)
+void ResourceHandleManager::startPendingJob(ResourceHandle* pRH, uint32_t hostHash)
 {
     const KURL& kurl = pRH->firstRequest().url();
 
@@ -399,11 +492,15 @@ void ResourceHandleManager::startPendingJob(ResourceHandle* pRH)
 		return;
 	}
 
-	JobInfo& jobInfo = m_JobInfoList.push_back();
+	JobInfo& jobInfo = *AllocateJobInfo();
+	m_JobInfoList.push_back(jobInfo);
 	bool jobInitialized = initializeJob(jobInfo, pRH, false);
 	if(jobInitialized)
 	{
 		m_runningJobs++;
+		jobInfo.mHostHash = hostHash;
+		if(hostHash)
+			m_hostJobCounts[hostHash]++;
 	}
 	else
 	{
@@ -411,7 +508,8 @@ void ResourceHandleManager::startPendingJob(ResourceHandle* pRH)
 		jobInfo.mbSuccess = false;
 		notifyJobFailed(jobInfo);
 		pRH->deref();
-		m_JobInfoList.pop_back();
+		m_JobInfoList.remove(jobInfo);
+		FreeJobInfo(&jobInfo);
 	}
 }
 
@@ -476,6 +574,8 @@ bool ResourceHandleManager::initializeJob(JobInfo& jobInfo, ResourceHandle* pRH,
 
 	jobInfo.mId					= ++m_JobIdNext;
 	jobInfo.mProcessInfo.mJobId = jobInfo.mId;
+	jobInfo.mStartTime			= EA::WebKit::GetTime();
+	jobInfo.mFirstByteTime		= 0.0;
 	jobInfo.mpRH				= pRH;
 	jobInfo.mJobState			= kJSInit;
 	jobInfo.mpTH				= pTH;
@@ -611,13 +711,87 @@ bool ResourceHandleManager::initializeJob(JobInfo& jobInfo, ResourceHandle* pRH,
 void ResourceHandleManager::CondemnJob(JobInfo* pJobInfo)
 {
     // We don't actually remove it here, we put it into a condemned state, to be removed later.
-    pJobInfo->mJobState = kJSRemove;
-    m_CondemnedJobsExist = true;
+	// A job can be condemned more than once (e.g. CondemnAllJobs on an already removed job). We only record it the first time.
+	if(pJobInfo->mJobState != kJSRemove)
+	{
+		pJobInfo->mJobState = kJSRemove;
+		m_CondemnedJobs.push_back(pJobInfo);
+	}
 
 	NOTIFY_PROCESS_STATUS(pJobInfo->mProcessInfo, EA::WebKit::kVProcessStatusEnded);
 }
 
 
+// Removes the jobs recorded by CondemnJob. Only the condemned jobs are visited, and unlinking each one from m_JobInfoList is O(1).
+void ResourceHandleManager::RemoveCondemnedJobs()
+{
+	// Notifications below can end up condemning more jobs, so we work on a local copy and loop until nothing is left.
+	while(!m_CondemnedJobs.empty())
+	{
+		JobInfoPtrList condemnedJobs;
+		condemnedJobs.swap(m_CondemnedJobs);
+
+		for(JobInfoPtrList::iterator it = condemnedJobs.begin(); it != condemnedJobs.end(); ++it)
+		{
+			JobInfo& jobInfo = **it;
+			EAW_ASSERT(jobInfo.mJobState == kJSRemove);
+
+			if(!jobInfo.mbSuccess)
+			{
+				notifyJobFailed(jobInfo);
+			}
+
+			// We promise the TransportHandler that if we Init it then eventually we will Shutdown it. This allows it to clean up.
+			if(jobInfo.mbTHInitialized && !jobInfo.mbTHShutdown)
+			{
+				bool bStateComplete;
+				jobInfo.mpTH->ShutdownJob(&jobInfo.mTInfo, bStateComplete);
+			}
+
+			// This matches the ref() done in ResourceHandleManager::add().
+			jobInfo.mpRH->deref();  
+			jobInfo.mpRH = NULL;
+			onJobRemoved(jobInfo);
+
+			m_JobInfoList.remove(jobInfo);
+			FreeJobInfo(&jobInfo);
+		}
+	}
+}
+
+
+// Returns a JobInfo in its constructed state, reusing a pooled one if available. The caller links it into m_JobInfoList.
+JobInfo* ResourceHandleManager::AllocateJobInfo()
+{
+	if(!m_freeJobInfoList.empty())
+	{
+		JobInfo* pJobInfo = &m_freeJobInfoList.front();
+		m_freeJobInfoList.pop_front();
+		m_freeJobInfoCount--;
+		NOTIFY_PROCESS_STATUS(pJobInfo->mProcessInfo, EA::WebKit::kVProcessStatusStarted);
+		return pJobInfo;
+	}
+
+	return EAWEBKIT_NEW("JobInfo") JobInfo;
+}
+
+
+// Returns an unlinked JobInfo to the pool. The pool is capped at the max number of concurrent jobs so that a burst of jobs does not pin memory.
+void ResourceHandleManager::FreeJobInfo(JobInfo* pJobInfo)
+{
+	if(m_freeJobInfoCount < m_maxConcurrentJobs)
+	{
+		pJobInfo->Reset();
+		m_freeJobInfoList.push_front(*pJobInfo);
+		m_freeJobInfoCount++;
+	}
+	else
+	{
+		EAWEBKIT_DELETE pJobInfo;
+	}
+}
+
+
 void ResourceHandleManager::CondemnAllJobs()
 {
     for(JobInfoList::iterator it = m_JobInfoList.begin(); it != m_JobInfoList.end(); ++it)
@@ -715,43 +889,35 @@ int ResourceHandleManager::ProcessJobs()
 		}
 	}
 
-	if(m_CondemnedJobsExist)
-	{
-		for(JobInfoList::iterator it = m_JobInfoList.begin(); it != m_JobInfoList.end(); )
-		{
-			JobInfo& jobInfo = *it;
-			if(jobInfo.mJobState == kJSRemove)
-			{
-				if(!jobInfo.mbSuccess)
-				{
-					notifyJobFailed(jobInfo);
-				}
+	RemoveCondemnedJobs();
 
-				// We promise the TransportHandler that if we Init it then eventually we will Shutdown it. This allows it to clean up.
-				if(jobInfo.mbTHInitialized && !jobInfo.mbTHShutdown)
-				{
-					bool bStateComplete;
-					jobInfo.mpTH->ShutdownJob(&jobInfo.mTInfo, bStateComplete);
-				}
+	EAW_ASSERT_MSG(m_runningJobs == m_JobInfoList.size(),"IMPOSSIBLE\n");
+	NOTIFY_PROCESS_STATUS(EA::WebKit::kVProcessTypeTHJobs, EA::WebKit::kVProcessStatusEnded);
+	return m_runningJobs; // Same as m_JobInfoList.size(), without walking the intrusive list.
+}
 
-				// This matches the ref() done in ResourceHandleManager::add().
-				jobInfo.mpRH->deref();  
-				jobInfo.mpRH = NULL;
-				m_runningJobs--;
+void ResourceHandleManager::onJobRemoved(const JobInfo& jobInfo)
+{
+	m_runningJobs--;
 
-				it = m_JobInfoList.erase(it);
-			}
-			else
-			{
-				++it; //The job is not in removed state. Just increment the iterator.
-			}
-		}
-		m_CondemnedJobsExist = false; 
+	m_jobQueueInfo.mCompletedJobs++;
+	m_jobQueueInfo.mTotalJobSeconds += EA::WebKit::GetTime() - jobInfo.mStartTime;
+	if(jobInfo.mFirstByteTime > 0.0)
+	{
+		const double firstByteSeconds = jobInfo.mFirstByteTime - jobInfo.mStartTime;
+		m_jobQueueInfo.mRespondedJobs++;
+		m_jobQueueInfo.mTotalFirstByteSeconds += firstByteSeconds;
+		if(firstByteSeconds > m_jobQueueInfo.mMaxFirstByteSeconds)
+			m_jobQueueInfo.mMaxFirstByteSeconds = firstByteSeconds;
 	}
 
-	EAW_ASSERT_MSG(m_runningJobs == m_JobInfoList.size(),"IMPOSSIBLE\n");
-	NOTIFY_PROCESS_STATUS(EA::WebKit::kVProcessTypeTHJobs, EA::WebKit::kVProcessStatusEnded);
-	return (int)m_JobInfoList.size();
+	if(jobInfo.mHostHash)
+	{
+		HostJobCountMap::iterator it = m_hostJobCounts.find(jobInfo.mHostHash);
+		EAW_ASSERT(it != m_hostJobCounts.end());
+		if((it != m_hostJobCounts.end()) && (--(*it).second <= 0))
+			m_hostJobCounts.erase(it);
+	}
 }
 
 
@@ -947,6 +1113,10 @@ bool ResourceHandleManager::HeadersReceived(EA::WebKit::TransportInfo* pTInfo)
 	JobInfo* pJobInfo = (JobInfo*)pTInfo->mpTransportServerJobInfo;       
 	EAW_ASSERT_MSG(!pRHI->m_defersLoading && !pJobInfo->mbPaused, "This should not be called when deferred loading is activated (meaning job is paused)\n");
 
+	// Redirects followed by the transport bring more headers. The first ones are the time to first byte.
+	if(pJobInfo->mFirstByteTime == 0.0)
+		pJobInfo->mFirstByteTime = EA::WebKit::GetTime();
+
 	m_cookieManager.OnHeadersRead(pTInfo); //We want to read cookies sent by the server regardless of the job state as the server might expect those cookies back.
 	
 	if(pRHI->m_cancelled || pJobInfo->mIgnoreJob)
@@ -1012,9 +1182,17 @@ bool ResourceHandleManager::HeadersReceived(EA::WebKit::TransportInfo* pTInfo)
 			GetFixedString(pTInfo->mEffectiveURI)->assign(s.characters(), s.length());
 
 			// Simply add the job again for the new transport handler to handle the redirected url. This will set up new job.
-			if(!redirectedRequest.url().protocolInHTTPFamily())
+			// We do the same if the transport handler doesn't follow redirects itself. The new job picks up any cookies set by this response.
+			if(!redirectedRequest.url().protocolInHTTPFamily() || !pTInfo->mbFollowRedirects)
 			{
 				EAW_ASSERT_MSG(pJobInfo->mTInfo.mbAsync,"Synchronous jobs not supported in this fashion");
+				if(redirectedRequest.httpMethod() != pRHI->m_firstRequest.httpMethod()) // e.g. POST turned into GET above.
+				{
+					pRHI->m_firstRequest.setHTTPMethod(redirectedRequest.httpMethod());
+					pRHI->m_firstRequest.setHTTPBody(0);
+				}
+				if(redirectedRequest.httpReferrer().isEmpty())
+					pRHI->m_firstRequest.clearHTTPReferrer();
 				pJobInfo->mIgnoreJob = true;
 				add(pRH);
 			}
@@ -1042,6 +1220,7 @@ bool ResourceHandleManager::DataReceived(EA::WebKit::TransportInfo* pTInfo, cons
 	EAWEBKIT_THREAD_CHECK();
 	JobInfo* pJobInfo = (JobInfo*)pTInfo->mpTransportServerJobInfo;       
 	pJobInfo->mProcessInfo.mSize +=size;
+	m_jobQueueInfo.mBytesReceived += (uint64_t)size;
 
 	if(pJobInfo->mIgnoreJob)
 		return false;
@@ -1279,6 +1458,9 @@ void ResourceHandleManager::TickTransportHandlers()
 		const THInfo& thInfo = *it;
 		thInfo.mpTH->Tick();
 	}
+
+	// The disk cache is not in m_THInfoList. Its Tick commits files written by its IO thread.
+	m_THDiskCache.Tick();
 }
 
 void ResourceHandleManager::TickDownload()
@@ -1409,11 +1591,32 @@ void ResourceHandleManager::GetDiskCacheUsage(EA::WebKit::DiskCacheUsageInfo& di
 {
 	m_THDiskCache.GetDiskCacheUsage(diskCacheUsageInfo);
 }
+
+void ResourceHandleManager::GetDiskCacheSharingUsage(EA::WebKit::DiskCacheSharingUsageInfo& diskCacheSharingUsageInfo)
+{
+	m_THDiskCache.GetDiskCacheSharingUsage(diskCacheSharingUsageInfo);
+}
+
+void ResourceHandleManager::GetTransportJobQueueInfo(EA::WebKit::TransportJobQueueInfo& transportJobQueueInfo)
+{
+	transportJobQueueInfo = m_jobQueueInfo;
+	transportJobQueueInfo.mRunningJobs = (uint32_t)m_runningJobs;
+}
+
+void ResourceHandleManager::GetHttpConnectionUsageInfo(EA::WebKit::HttpConnectionUsageInfo& httpConnectionUsageInfo)
+{
+#if ENABLE(DIRTYSDK_IN_DLL)
+	m_THDirtySDK.GetConnectionUsage(httpConnectionUsageInfo);
+#else
+	httpConnectionUsageInfo = EA::WebKit::HttpConnectionUsageInfo();
+#endif
+}
 void ResourceHandleManager::SetParams(const EA::WebKit::Parameters& params)
 {
 	const EA::WebKit::Parameters& parameters = EA::WebKit::GetParameters();
 	
 	m_maxConcurrentJobs = parameters.mMaxTransportJobs;
+	m_maxJobsPerHost = parameters.mMaxTransportJobsPerHost;
 
 }
 } // namespace WebCore
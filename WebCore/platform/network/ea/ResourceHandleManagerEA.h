@@ -32,6 +32,7 @@
 #include "Frame.h"
 #include "Timer.h"
 #include "ResourceHandleClient.h"
+#include "ResourceLoadPriority.h"
 #include <wtf/Vector.h>
 
 #include <EAWebKit/EAWebKitConfig.h>
@@ -41,6 +42,8 @@
 #include <internal/include/EAWebKitEASTLHelpers.h>
 #include <EASTL/fixed_list.h>
 #include <EASTL/fixed_vector.h>
+#include <EASTL/hash_map.h>
+#include <EASTL/intrusive_list.h>
 #include "CookieManagerEA.h"
 #include "TransportHandlerDiskCacheEA.h"
 
@@ -69,7 +72,8 @@ namespace WebCore {
 		kJSRemove       // Remove the Job
 	};
 
-	struct JobInfo
+	// JobInfo instances are pooled by ResourceHandleManager, and linked into its job list through the intrusive_list_node.
+	struct JobInfo : public eastl::intrusive_list_node
 	{
 		int								mId;						// This is simply an ever-increasing number.
 		WebCore::ResourceHandle*		mpRH;						// WebKit ResourceHandle. Ref-counted while stored in this struct.
@@ -83,6 +87,9 @@ namespace WebCore {
 		bool							mbPaused;					// True if the job needs to be paused for any reason.For example, if a breakpoint is put on a JavaScript in WebInspector tool.
 		EA::WebKit::ViewProcessInfo		mProcessInfo;				// Used for process user callback notifications 
 		bool							mIgnoreJob;					// If the job is redirected to another transport handler after initial set up, we set the job in the ignore mode. A new job is set up for new transport handler.  
+		uint32_t						mHostHash;					// Hash of the URL host, used for the per host job limit. 0 if the URL has no host.
+		double							mStartTime;					// When the job was initialized. For the load timing of TransportJobQueueInfo.
+		double							mFirstByteTime;				// When its response headers came in. 0 until then.
 		JobInfo()
 			: mId(0)
 			, mpRH(NULL)
@@ -96,9 +103,15 @@ namespace WebCore {
 			, mbPaused(false)
 			, mProcessInfo(EA::WebKit::kVProcessTypeTransportJob, EA::WebKit::kVProcessStatusStarted)
 			, mIgnoreJob(false)
+			, mHostHash(0)
+			, mStartTime(0.0)
+			, mFirstByteTime(0.0)
 		{
+			mpNext = mpPrev = NULL;
 			NOTIFY_PROCESS_STATUS(mProcessInfo,EA::WebKit::kVProcessStatusStarted);
 		}
+
+		void Reset();	// Returns the JobInfo to its constructed state for reuse.
 	};
 
 }
@@ -164,6 +177,9 @@ public:
 	//Disk cache 
 	bool SetDiskCacheParams(const EA::WebKit::DiskCacheInfo& diskCacheInfo);
 	void GetDiskCacheUsage(EA::WebKit::DiskCacheUsageInfo& diskCacheUsageInfo);
+	void GetDiskCacheSharingUsage(EA::WebKit::DiskCacheSharingUsageInfo& diskCacheSharingUsageInfo);
+	void GetTransportJobQueueInfo(EA::WebKit::TransportJobQueueInfo& transportJobQueueInfo);
+	void GetHttpConnectionUsageInfo(EA::WebKit::HttpConnectionUsageInfo& httpConnectionUsageInfo);
 	EA::WebKit::CookieManager*         GetCookieManager();
 	//EA::WebKit::AuthenticationManager* GetAuthenticationManager();
 
@@ -174,8 +190,10 @@ private:
 	void		downloadTimerCallback(Timer<ResourceHandleManager>*);
 
 	bool		startPendingJobs();
-	void		startPendingJob(ResourceHandle* pRH);
+	void		startPendingJob(ResourceHandle* pRH, uint32_t hostHash);
 	bool		removePendingJob(ResourceHandle* pRH);
+	bool		canStartJobForHost(uint32_t hostHash) const;
+	void		onJobRemoved(const JobInfo& jobInfo);
 	
 	bool		initializeJob(JobInfo& jobInfo, ResourceHandle* pRH, bool bSynchronous);
 	int			ProcessJobs(); // To be called repeatedly while there are active jobs.
@@ -183,6 +201,9 @@ private:
 	void		notifyJobFailed(const JobInfo& jobInfo);
 	void		CondemnJob(JobInfo* pJobInfo);
 	void		CondemnAllJobs();
+	void		RemoveCondemnedJobs();
+	JobInfo*	AllocateJobInfo();
+	void		FreeJobInfo(JobInfo* pJobInfo);
 
 	
 	void SetupTHPut(JobInfo* pJobInfo);
@@ -194,9 +215,19 @@ private:
 	void							RemoveDependentJobs(EA::WebKit::TransportHandler* pTH, const char16_t* pScheme);
 
 private:
-	typedef eastl::fixed_list<ResourceHandle*, 16, true, EA::WebKit::EASTLAllocator> ResourceHandleList;   
+	// A job waiting to be started.
+	struct PendingJob
+	{
+		ResourceHandle*		mpRH;
+		uint32_t			mHostHash;		// See JobInfo::mHostHash.
+		double				mQueueTime;		// When add() was called. Used for the queue wait statistics.
+	};
+
+	typedef eastl::fixed_list<PendingJob, 4, true, EA::WebKit::EASTLAllocator> PendingJobList;   
+	typedef eastl::hash_map<uint32_t, int, eastl::hash<uint32_t>, eastl::equal_to<uint32_t>, EA::WebKit::EASTLAllocator> HostJobCountMap; // Running jobs per host hash.
 	typedef eastl::fixed_list<THInfo,  2, true, EA::WebKit::EASTLAllocator> THInfoList;    // List of available TransportHandlers. We reserve 2 (One for the network and one for the application. Of course, the list is capable of auto-expansion).
-	typedef eastl::list<JobInfo, EA::WebKit::EASTLAllocator> JobInfoList;   // Currently running jobs. We don't reserve any since JobInfo instances are a bit heavy. Trading memory usage(Saves about 6K from ResourceHandleManager size) for a small runtime penalty.
+	typedef eastl::intrusive_list<JobInfo> JobInfoList;   // Currently running jobs. JobInfo instances are a bit heavy (strings and header maps) so they come from a small pool (m_freeJobInfoList) instead of being allocated per job.
+	typedef eastl::fixed_vector<JobInfo*, 16, true, EA::WebKit::EASTLAllocator> JobInfoPtrList;
 	
 	static ResourceHandleManager* m_pInstance;
 	EA::WebKit::TransportHandlerFileScheme  m_THFileScheme;               
@@ -208,16 +239,21 @@ private:
 
 	Timer<ResourceHandleManager>        m_downloadTimer;            // 
 	
-	ResourceHandleList					m_pendingResourceHandleList;// This is a list of jobs that haven't been started yet.
+	PendingJobList						m_pendingJobLists[EA::WebKit::kTransportJobPriorityCount]; // Jobs that haven't been started yet, one FIFO per ResourceLoadPriority.
     int                                 m_runningJobs;              // This is a count of jobs that have been started and are running.
     double                              m_pollTimeSeconds;          // Defaults to something small like 0.016 seconds (~60 frames/sec).
     int                                 m_maxConcurrentJobs;        // Max number of jobs occurring at at time.
+    int                                 m_maxJobsPerHost;           // Max number of jobs to the same host at a time. 0 means no limit.
+    HostJobCountMap                     m_hostJobCounts;            // 
+    EA::WebKit::TransportJobQueueInfo   m_jobQueueInfo;             // Queue wait statistics.
     EA::WebKit::CookieManager           m_cookieManager;            // 
 
     THInfoList                              m_THInfoList;
     JobInfoList                             m_JobInfoList;
+    JobInfoPtrList                          m_CondemnedJobs;            // Jobs in the kJSRemove state, in the order they were condemned. Each job is in here once.
+    JobInfoList                             m_freeJobInfoList;          // Recycled JobInfo instances.
+    int                                     m_freeJobInfoCount;
     int                                     m_JobIdNext;
-    bool                                    m_CondemnedJobsExist;
 	
 #if _DEBUG
 	uint64_t m_readVolume;      // Number of bytes ever read.
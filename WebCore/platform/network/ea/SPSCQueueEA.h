@@ -0,0 +1,121 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+its contributors may be used to endorse or promote products derived
+from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// SPSCQueueEA.h
+//
+// Maintained by EAWebKit Team
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// A bounded, lock-free queue for handing items from exactly one producer thread 
+// to exactly one consumer thread. Push is only called by the producer and Pop only 
+// by the consumer. Each side writes only its own index, so no atomic read-modify-write 
+// is needed; the barrier orders the item copy against the index update.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SPSCQUEUEEA_H
+#define SPSCQUEUEEA_H
+
+#include <EABase/eabase.h>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+	#if defined(EA_PROCESSOR_POWERPC)
+		#define EAW_SPSC_MEMORY_BARRIER() __lwsync()
+	#else
+		#define EAW_SPSC_MEMORY_BARRIER() _ReadWriteBarrier() // x86 and x64 don't reorder stores with stores or loads with loads, so a compiler barrier is enough.
+	#endif
+#else
+	#define EAW_SPSC_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+namespace EA
+{
+namespace WebKit
+{
+
+// kCapacity must be a power of 2. T is copied in and out, so it should be small (e.g. a pointer or a small struct).
+template <typename T, uint32_t kCapacity>
+class SPSCQueue
+{
+public:
+	SPSCQueue()
+		: mHead(0)
+		, mTail(0)
+	{
+	}
+
+	// Producer only. Returns false if the queue is full.
+	bool Push(const T& item)
+	{
+		const uint32_t tail = mTail;
+		if((tail - mHead) == kCapacity)
+			return false;
+
+		mItems[tail & (kCapacity - 1)] = item;
+		EAW_SPSC_MEMORY_BARRIER();  // The item must be visible before the consumer can see the new tail.
+		mTail = tail + 1;
+		return true;
+	}
+
+	// Consumer only. Returns false if the queue is empty.
+	bool Pop(T& item)
+	{
+		const uint32_t head = mHead;
+		if(head == mTail)
+			return false;
+
+		EAW_SPSC_MEMORY_BARRIER();  // Don't read the item before seeing the tail that published it.
+		item = mItems[head & (kCapacity - 1)];
+		EAW_SPSC_MEMORY_BARRIER();  // Done reading the item before the producer can reuse its slot.
+		mHead = head + 1;
+		return true;
+	}
+
+	// Either side. The result is only a snapshot when called by the other thread.
+	bool IsEmpty() const
+	{
+		return (mHead == mTail);
+	}
+
+private:
+	typedef char CapacityMustBeAPowerOf2[((kCapacity & (kCapacity - 1)) == 0) ? 1 : -1];
+
+	SPSCQueue(const SPSCQueue&);
+	SPSCQueue& operator=(const SPSCQueue&);
+
+	volatile uint32_t	mHead;	// Written by the consumer only.
+	volatile uint32_t	mTail;	// Written by the producer only.
+	T					mItems[kCapacity];
+};
+
+} // namespace WebKit
+} // namespace EA
+
+#endif // SPSCQUEUEEA_H
@@ -93,6 +93,8 @@ int32_t IStreamDecompressor::Init()
 DeflateStreamDecompressor::DeflateStreamDecompressor(eStreamType streamType)
 	: mZStream(0)
 	, mDecompressedDataCallback(0)
+	, mOutputBufferCallback(0)
+	, mOutputBufferUserData(0)
 	, mDecompressionBuffer(0)
 	, mDecompressionBufferCapacity(0)
 	, mStreamType(streamType)
@@ -191,8 +193,8 @@ int32_t DeflateStreamDecompressor::Decompress(uint8_t* sourceStream, uint32_t so
 			return status;
 	}
 
-	//if the caller did not pass decompress buffer, allocate one. 
-	if(!decompressionBuffer)
+	//if the caller did not pass decompress buffer, allocate one. Not needed in the zero-copy mode.
+	if(!decompressionBuffer && !mOutputBufferCallback)
 	{
 		AllocateDecompressionBuffer(sourceLength);
 
@@ -210,11 +212,24 @@ int32_t DeflateStreamDecompressor::Decompress(uint8_t* sourceStream, uint32_t so
 	while(mZStream->avail_in>0 || callInflateAgain)
 	{
 		callInflateAgain = false;
+		if(mOutputBufferCallback)
+		{
+			decompressionBuffer = mOutputBufferCallback(mOutputBufferUserData, decompressionBufferCapacity);
+			if(!decompressionBuffer)
+			{
+				status = Z_MEM_ERROR;
+				break;
+			}
+		}
 		mZStream->next_out = (Bytef*)(decompressionBuffer);
 		mZStream->avail_out = decompressionBufferCapacity;
 		
 		status = inflate(mZStream, Z_SYNC_FLUSH);
 
+		//In the zero-copy mode, the buffer goes back to the application even if nothing could be decompressed into it.
+		if(mOutputBufferCallback && mDecompressedDataCallback && (status != Z_OK) && (status != Z_STREAM_END))
+			mDecompressedDataCallback(mUserData, decompressionBuffer, 0);
+
 		int32_t bytesDecompressed = 0;
 		switch(status)
 		{
@@ -223,7 +238,7 @@ int32_t DeflateStreamDecompressor::Decompress(uint8_t* sourceStream, uint32_t so
 			bytesDecompressed = (decompressionBufferCapacity - mZStream->avail_out);
 
 			totalBytesDecompressed += bytesDecompressed;
-			if(bytesDecompressed && mDecompressedDataCallback)
+			if((bytesDecompressed || mOutputBufferCallback) && mDecompressedDataCallback)
 				mDecompressedDataCallback(mUserData, decompressionBuffer, bytesDecompressed);
 			
 			if((mZStream->avail_out == 0) && (status == Z_OK))
@@ -328,6 +343,12 @@ void DeflateStreamDecompressor::SetDecompressedDataCallback(DecompressedDataCall
 	mUserData = userData;
 }
 
+void DeflateStreamDecompressor::SetOutputBufferCallback(OutputBufferCallback callback, void* userData)
+{
+	mOutputBufferCallback = callback;
+	mOutputBufferUserData = userData;
+}
+
 int32_t DeflateStreamDecompressor::ProcessGZipHeader(uint8_t*& sourceStream, uint32_t& sourceLength)
 {
 	int status = 0;
@@ -60,6 +60,10 @@ namespace WebKit
 //This is the callback for the application when data is decompressed. 
 typedef void (*DecompressedDataCallback)(void* userData, uint8_t* decompressedData, uint32_t decompressedDataLength);
 
+//This is the callback for the application to provide output buffers in the zero-copy mode. Set bufferCapacity and return the buffer.
+//Returning NULL makes Decompress fail.
+typedef uint8_t* (*OutputBufferCallback)(void* userData, uint32_t& bufferCapacity);
+
 class IStreamDecompressor
 {
 public:
@@ -80,6 +84,10 @@ public:
 	virtual int32_t Decompress(uint8_t* sourceStream, uint32_t sourceLength, uint8_t* decompressionBuffer = 0, uint32_t decompressionBufferCapacity = 0) = 0;
 	//Set a callback to receive the data when decompressed.
 	virtual void	SetDecompressedDataCallback(DecompressedDataCallback callback, void* userData){};
+	//Zero-copy mode. Once an output buffer callback is set, the decompression buffer passed to Decompress is ignored and the data is decompressed
+	//straight into buffers obtained from the callback. Each obtained buffer is handed back exactly once through the DecompressedDataCallback, 
+	//with decompressedData pointing at its start, and is owned by the application from then on. The length may be 0 if nothing was decompressed into it.
+	virtual void	SetOutputBufferCallback(OutputBufferCallback callback, void* userData){};
 private:
 	IStreamDecompressor(const IStreamDecompressor& streamDecompressor);
 	IStreamDecompressor& operator=(const IStreamDecompressor& streamDecompressor);
@@ -114,6 +122,7 @@ public:
 	virtual int32_t Decompress(uint8_t* sourceStream, uint32_t sourceLength, uint8_t* decompressionBuffer = 0, uint32_t decompressionBufferCapacity = 0);
 
 	virtual void	SetDecompressedDataCallback(DecompressedDataCallback callback, void* userData);
+	virtual void	SetOutputBufferCallback(OutputBufferCallback callback, void* userData);
 
 private:
 	void UnInit();
@@ -122,6 +131,8 @@ private:
 	
 	z_stream*										mZStream;
 	DecompressedDataCallback						mDecompressedDataCallback;
+	OutputBufferCallback							mOutputBufferCallback;
+	void*											mOutputBufferUserData;
 	uint8_t*										mDecompressionBuffer;
 	size_t											mDecompressionBufferCapacity;
 	eStreamType										mStreamType;
@@ -41,11 +41,13 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <EAWebKit/EAWebKitView.h>
 #include <EAWebKit/EAWebKitClient.h>
 #include <EAWebKit/EAWebkitSTLWrapper.h>
+#include <EAWebKit/EAWebKitThreadInterface.h>
 
 #include <internal/include/EAWebKit_p.h>
 #include <EAAssert/eaassert.h>
 #include <EAIO/FnEncode.h>          // For Strlcpy and friends.
 #include <stdio.h>
+#include <stddef.h>
 #include "protossl.h"
 
 #if !BUILDING_EAWEBKIT_DLL
@@ -58,6 +60,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #endif
 
 #include "StreamDecompressorEA.h"
+#include "SPSCQueueEA.h"
+#include <eastl/fixed_vector.h>
 
 #if (BUILDING_EAWEBKIT_DLL) // If building dll currently.
 //Note by Arpit Baldeva: Forward declare some functions from the DirtySDK here instead of including the
@@ -82,6 +86,7 @@ int32_t SocketDestroy(uint32_t uFlags);
 #define DIRTY_ESSL						MULTICHAR_CONST('e','s','s','l')
 #define DIRTY_PIPE						MULTICHAR_CONST('p','i','p','e')
 #define DIRTY_PIPE_WITHOUT_KEEP_ALIVE	MULTICHAR_CONST('p','w','k','a')
+#define DIRTY_KEEP_ALIVE				MULTICHAR_CONST('k','e','e','p')
 #define DIRTY_MAX_REDIRECTION			MULTICHAR_CONST('r','m','a','x')
 #define DIRTY_REQUEST_TIMEOUT			MULTICHAR_CONST('t','i','m','e')
 #define DIRTY_LOG_LEVEL					MULTICHAR_CONST('s','p','a','m')
@@ -426,7 +431,25 @@ namespace WebKit
 		mbPostActive(false), 
 		mPostBufferSize(0), 
 		mPostBufferPosition(0), 
-		mStreamDecompressor(0) 
+		mStreamDecompressor(0),
+		mpTInfo(0),
+		mpNetworkThread(0),
+		mpHeaderMapPending(0),
+		mPendingResultCode(0),
+		mbHeadersPending(false),
+		mbHeadersQueued(false),
+		mbRecvDone(false),
+		mbAddedToNetworkThread(false),
+		mbShutdown(false),
+		mbHeadersReady(false),
+		mbTransferDone(false),
+		mTransferResult(0),
+		mpReadyHead(0),
+		mpReadyTail(0),
+		mOrigin(),
+		mbKeepAliveRequested(false),
+		mbPipelined(false),
+		mbHttp11Response(false)
 		{ 
 
 		}
@@ -442,13 +465,437 @@ namespace WebKit
 			mStreamDecompressor = 0;
 		}
 #endif
+		if(mpHeaderMapPending)
+		{
+			mpHeaderMapPending->~EASTLHeaderMapWrapper();
+			GetAllocator()->Free(mpHeaderMapPending, sizeof(EASTLHeaderMapWrapper));
+			mpHeaderMapPending = 0;
+		}
 	}
+
+	/*********Implementation of TransportHandlerDirtySDK::NetworkThread***************/
+
+	const uint32_t kNetworkChunkSize		= 4096;		// Size of the data chunks handed from the network thread to the main thread.
+	const uint32_t kNetworkChunkCount		= 32;		// When all chunks are waiting on the main thread, the network thread stops receiving. Must be a power of 2.
+	const uint32_t kNetworkMessageCount		= 128;		// Must be a power of 2.
+	const uint32_t kNetworkRecvSize			= 16384;	// Max bytes received per job and iteration.
+	const uint32_t kNetworkPollMilliseconds	= 2;
+	const int32_t  kNetworkRecvDecompressionError = -1000; // Not a DirtySDK result. The network thread failed to decompress the content.
+
+	struct TransportHandlerDirtySDK::NetworkChunk
+	{
+		NetworkChunk*	mpNext;
+		uint32_t		mSize;
+		char			mData[kNetworkChunkSize];
+	};
+
+	struct TransportHandlerDirtySDK::NetworkMessage
+	{
+		enum Type
+		{
+			kTypeHeaders,	// mpDirtySDKInfo->mpHeaderMapPending and mPendingResultCode are ready.
+			kTypeData,		// mpChunk holds received (and decompressed) content.
+			kTypeDone,		// mResult is the final receive result. No more data follows.
+			kTypeReleased	// The network thread no longer references mpDirtySDKInfo. This is always its last message.
+		};
+
+		Type			mType;
+		DirtySDKInfo*	mpDirtySDKInfo;
+		NetworkChunk*	mpChunk;
+		int32_t			mResult;
+	};
+
+	// NetworkThread
+	//
+	// Runs the asynchronous HttpManager: HttpManagerUpdate, HttpManagerRecv, the header callbacks and content decompression.
+	// Results go to the main thread through a lock-free single producer/single consumer queue, which TransportHandlerDirtySDK::Tick
+	// drains. Data is carried in chunks from a fixed pool shared by all jobs; the main thread returns them through a second queue.
+	// Compressed content is inflated straight into the chunks (the zero-copy mode of IStreamDecompressor) and the main thread
+	// hands the chunks to DataReceived as they are, so decompressed data is never copied.
+	// The mutex only serializes DirtySDK calls (DirtySDK is not thread safe) and the job list. It is never held while the 
+	// network thread waits on the main thread, so the main thread can take it without risking a deadlock.
+	class TransportHandlerDirtySDK::NetworkThread
+	{
+	public:
+		typedef eastl::fixed_vector<DirtySDKInfo*, 16, true, EA::WebKit::EASTLAllocator> JobList;
+
+		NetworkThread()
+			: mpThreadSystem(NULL)
+			, mpThread(NULL)
+			, mpMutex(NULL)
+			, mpCondition(NULL)
+			, mpHttpManager(NULL)
+			, mpChunks(NULL)
+			, mpFreeChunks(NULL)
+			, mpRecvBuffer(NULL)
+			, mbStop(false)
+		{
+		}
+
+		~NetworkThread()
+		{
+			Stop();
+		}
+
+		bool Start()
+		{
+			mpThreadSystem = GetThreadSystem();
+
+			// A thread system that can't create threads reports kThreadIdInvalid (see DefaultThreadSystem::CurrentThreadId).
+			if(!mpThreadSystem || (mpThreadSystem->CurrentThreadId() == EA::WebKit::kThreadIdInvalid))
+				return false;
+
+			EA::WebKit::Allocator* pAllocator = GetAllocator();
+			mpChunks				= (NetworkChunk*)pAllocator->Malloc(sizeof(NetworkChunk) * kNetworkChunkCount, 0, "EAWebKit/TransportHandlerDirtySDK/NetworkChunks");
+			mpRecvBuffer			= (char*)pAllocator->Malloc(kNetworkRecvSize, 0, "EAWebKit/TransportHandlerDirtySDK/NetworkRecvBuffer");
+			for(uint32_t i = 0; i < kNetworkChunkCount; ++i)
+			{
+				mpChunks[i].mpNext = mpFreeChunks;
+				mpFreeChunks = &mpChunks[i];
+			}
+
+			mpMutex		= mpThreadSystem->CreateAMutex();
+			mpCondition	= mpThreadSystem->CreateAThreadCondition();
+			mpThread	= mpThreadSystem->CreateAThread();
+			if(mpMutex && mpCondition && mpThread)
+			{
+				if(mpThread->Begin(ThreadFunction, this) != EA::WebKit::kThreadIdInvalid)
+				{
+					mpThread->SetName("EAWebKit network");
+					return true;
+				}
+			}
+
+			Destroy();
+			return false;
+		}
+
+		void Stop()
+		{
+			if(mpThread)
+			{
+				mpMutex->Lock();
+				mbStop = true;
+				mpCondition->Signal(true);
+				mpMutex->Unlock();
+
+				intptr_t result = 0;
+				mpThread->WaitForEnd(&result);
+			}
+			Destroy();
+		}
+
+		// Set before the first job is added.
+		void SetHttpManager(HttpManagerRefT* pHttpManager)
+		{
+			mpHttpManager = pHttpManager;
+		}
+
+		void Lock()
+		{
+			mpMutex->Lock();
+		}
+
+		void Unlock()
+		{
+			mpMutex->Unlock();
+		}
+
+		// Main thread, with the lock held. The job's request must have been issued.
+		void AddJob(DirtySDKInfo* pDirtySDKInfo)
+		{
+			pDirtySDKInfo->mbAddedToNetworkThread = true;
+			mJobs.push_back(pDirtySDKInfo);
+			mpCondition->Signal(false);
+		}
+
+		// Main thread, after Stop. Returns the jobs that were not released yet. All of them are shut down by now.
+		void TakeJobs(JobList& jobs)
+		{
+			jobs.swap(mJobs);
+		}
+
+		// Main thread.
+		bool PopMessage(NetworkMessage& message)
+		{
+			return mMessages.Pop(message);
+		}
+
+		// Main thread.
+		void FreeChunk(NetworkChunk* pChunk)
+		{
+			const bool bPushed = mFreedChunks.Push(pChunk); // Can't fail as the queue has room for every chunk.
+			(void)bPushed;
+			EA_ASSERT(bPushed);
+		}
+
+		// Network thread. The OutputBufferCallback of network thread jobs. Hands out a free chunk to decompress into.
+		static uint8_t* OnOutputBuffer(void* userData, uint32_t& bufferCapacity)
+		{
+			DirtySDKInfo* pDirtySDKInfo = static_cast<DirtySDKInfo*>(userData);
+			NetworkChunk* pChunk = pDirtySDKInfo->mpNetworkThread->AllocateChunk();
+			if(!pChunk)
+				return NULL;
+
+			bufferCapacity = kNetworkChunkSize;
+			return (uint8_t*)pChunk->mData;
+		}
+
+		// Network thread. The DecompressedDataCallback of network thread jobs. The data is a chunk from OnOutputBuffer.
+		static void OnDecompressedData(void* userData, uint8_t* decompressedData, uint32_t decompressedDataLength)
+		{
+			DirtySDKInfo*  pDirtySDKInfo  = static_cast<DirtySDKInfo*>(userData);
+			NetworkThread* pNetworkThread = pDirtySDKInfo->mpNetworkThread;
+			NetworkChunk*  pChunk         = (NetworkChunk*)(decompressedData - offsetof(NetworkChunk, mData));
+
+			if(decompressedDataLength)
+			{
+				pChunk->mpNext = NULL;
+				pChunk->mSize  = decompressedDataLength;
+				pNetworkThread->QueueMessage(NetworkMessage::kTypeData, pDirtySDKInfo, pChunk, 0);
+			}
+			else
+			{
+				pChunk->mpNext = pNetworkThread->mpFreeChunks;
+				pNetworkThread->mpFreeChunks = pChunk;
+			}
+		}
+
+	private:
+		static void* ThreadFunction(void* pContext)
+		{
+			static_cast<NetworkThread*>(pContext)->Run();
+			return NULL;
+		}
+
+		void Run()
+		{
+			JobList jobs;
+			JobList releasedJobs;
+
+			while(!mbStop)
+			{
+				mpMutex->Lock();
+				while(mJobs.empty() && !mbStop)
+					mpCondition->Wait(mpMutex);
+
+				// Jobs shut down by the main thread no longer have an HTTP handle, so nothing new can come in for them.
+				jobs.clear();
+				releasedJobs.clear();
+				for(JobList::iterator it = mJobs.begin(); it != mJobs.end(); ++it)
+				{
+					if((*it)->mbShutdown)
+						releasedJobs.push_back(*it);
+					else
+						jobs.push_back(*it);
+				}
+				mJobs = jobs;
+
+				if(!jobs.empty())
+					HttpManagerUpdate(mpHttpManager);
+				mpMutex->Unlock();
+
+				// The job list only shrinks here, so the jobs stay valid until the next iteration.
+				for(JobList::iterator it = jobs.begin(); (it != jobs.end()) && !mbStop; ++it)
+					ReceiveJob(*it);
+
+				for(JobList::iterator it = releasedJobs.begin(); it != releasedJobs.end(); ++it)
+				{
+					if(!QueueMessage(NetworkMessage::kTypeReleased, *it, NULL, 0))
+					{
+						// We are stopping. The main thread frees the rest (see TakeJobs).
+						mpMutex->Lock();
+						mJobs.insert(mJobs.end(), it, releasedJobs.end());
+						mpMutex->Unlock();
+						break;
+					}
+				}
+
+				if(!mbStop)
+					mpThreadSystem->SleepThread(kNetworkPollMilliseconds);
+			}
+		}
+
+		static bool IsFinalRecvResult(int32_t iResult, int32_t resultCode)
+		{
+			(void)resultCode;
+			switch(iResult)
+			{
+			case PROTOHTTP_RECVDONE:
+			case PROTOHTTP_RECVFAIL:
+			case PROTOHTTP_RECVHEAD:
+				return true;
+#if DIRTYVERS <= 0x080D0000 //8.13.0
+			case 0:
+				return (resultCode == 304); // See the matching workaround in TransportHandlerDirtySDK::Transfer.
+#endif
+			default:
+				return false;
+			}
+		}
+
+		void ReceiveJob(DirtySDKInfo* pDirtySDKInfo)
+		{
+			int32_t  iResult	= 0;
+			uint32_t size		= 0;
+			bool     bHeaders	= false;
+			bool     bDone		= false;
+
+			mpMutex->Lock();
+			if(!pDirtySDKInfo->mbShutdown && !pDirtySDKInfo->mbRecvDone)
+			{
+				while((size < kNetworkRecvSize) && ((iResult = HttpManagerRecv(mpHttpManager, pDirtySDKInfo->mHttpHandle, mpRecvBuffer + size, 1, kNetworkRecvSize - size)) > 0))
+					size += iResult;
+
+				// Take the headers after receiving, as the header callback can run from within HttpManagerRecv.
+				bHeaders = pDirtySDKInfo->mbHeadersPending;
+				pDirtySDKInfo->mbHeadersPending = false;
+				pDirtySDKInfo->mbHeadersQueued |= bHeaders;
+
+				bDone = IsFinalRecvResult(iResult, pDirtySDKInfo->mPendingResultCode);
+				pDirtySDKInfo->mbRecvDone = bDone;
+			}
+			mpMutex->Unlock();
+
+			// Headers, then data, then the result; the main thread relies on this order.
+			if(bHeaders && !QueueMessage(NetworkMessage::kTypeHeaders, pDirtySDKInfo, NULL, 0))
+				return;
+
+			if(size)
+			{
+#if ENABLE_PAYLOAD_DECOMPRESSION
+				if(pDirtySDKInfo->mStreamDecompressor)
+				{
+					if(pDirtySDKInfo->mStreamDecompressor->Decompress((uint8_t*)mpRecvBuffer, size) < 0)
+					{
+						mpMutex->Lock();
+						pDirtySDKInfo->mbRecvDone = true;
+						mpMutex->Unlock();
+
+						iResult = kNetworkRecvDecompressionError;
+						bDone   = true;
+					}
+				}
+				else
+#endif
+				{
+					QueueData(pDirtySDKInfo, mpRecvBuffer, size);
+				}
+			}
+
+			if(bDone)
+				QueueMessage(NetworkMessage::kTypeDone, pDirtySDKInfo, NULL, iResult);
+		}
+
+		void QueueData(DirtySDKInfo* pDirtySDKInfo, const char* pData, uint32_t size)
+		{
+			while(size)
+			{
+				NetworkChunk* pChunk = AllocateChunk();
+				if(!pChunk)
+					return;
+
+				pChunk->mpNext = NULL;
+				pChunk->mSize  = (size < kNetworkChunkSize) ? size : kNetworkChunkSize;
+				memcpy(pChunk->mData, pData, pChunk->mSize);
+				if(!QueueMessage(NetworkMessage::kTypeData, pDirtySDKInfo, pChunk, 0))
+					return;
+
+				pData += pChunk->mSize;
+				size  -= pChunk->mSize;
+			}
+		}
+
+		// Waits for the main thread to return a chunk if none is free. Returns NULL if the thread is stopping.
+		NetworkChunk* AllocateChunk()
+		{
+			for(;;)
+			{
+				NetworkChunk* pChunk;
+				while(mFreedChunks.Pop(pChunk))
+				{
+					pChunk->mpNext = mpFreeChunks;
+					mpFreeChunks = pChunk;
+				}
+
+				if(mpFreeChunks)
+				{
+					pChunk = mpFreeChunks;
+					mpFreeChunks = pChunk->mpNext;
+					return pChunk;
+				}
+
+				if(mbStop)
+					return NULL;
+				mpThreadSystem->SleepThread(kNetworkPollMilliseconds);
+			}
+		}
+
+		// Waits for the main thread to make room if the queue is full. Returns false if the thread is stopping.
+		bool QueueMessage(NetworkMessage::Type type, DirtySDKInfo* pDirtySDKInfo, NetworkChunk* pChunk, int32_t iResult)
+		{
+			NetworkMessage message;
+			message.mType			= type;
+			message.mpDirtySDKInfo	= pDirtySDKInfo;
+			message.mpChunk			= pChunk;
+			message.mResult			= iResult;
+
+			while(!mMessages.Push(message))
+			{
+				if(mbStop)
+					return false;
+				mpThreadSystem->SleepThread(kNetworkPollMilliseconds);
+			}
+			return true;
+		}
+
+		void Destroy()
+		{
+			if(mpThreadSystem)
+			{
+				if(mpThread)
+					mpThreadSystem->DestroyAThread(mpThread);
+				if(mpCondition)
+					mpThreadSystem->DestroyAThreadCondition(mpCondition);
+				if(mpMutex)
+					mpThreadSystem->DestroyAMutex(mpMutex);
+			}
+			mpThread	= NULL;
+			mpCondition	= NULL;
+			mpMutex		= NULL;
+
+			EA::WebKit::Allocator* pAllocator = GetAllocator();
+			if(mpChunks)
+				pAllocator->Free(mpChunks, sizeof(NetworkChunk) * kNetworkChunkCount);
+			if(mpRecvBuffer)
+				pAllocator->Free(mpRecvBuffer, kNetworkRecvSize);
+			mpChunks		= NULL;
+			mpFreeChunks	= NULL;
+			mpRecvBuffer	= NULL;
+		}
+
+		EA::WebKit::IThreadSystem*		mpThreadSystem;
+		EA::WebKit::IThread*			mpThread;
+		EA::WebKit::IMutex*				mpMutex;
+		EA::WebKit::IThreadCondition*	mpCondition;
+		HttpManagerRefT*				mpHttpManager;
+		JobList							mJobs;					// Protected by mpMutex.
+		NetworkChunk*					mpChunks;
+		NetworkChunk*					mpFreeChunks;			// Network thread.
+		char*							mpRecvBuffer;			// Network thread.
+		SPSCQueue<NetworkMessage, kNetworkMessageCount>	mMessages;		// Network thread to main thread.
+		SPSCQueue<NetworkChunk*, kNetworkChunkCount>	mFreedChunks;	// Main thread to network thread.
+		volatile bool					mbStop;
+	};
+
 	
 	TransportHandlerDirtySDK::TransportHandlerDirtySDK()
 	: mpHttpManager(NULL)
 	, mpHttpManagerSyncJobs(NULL)
 	, mSharedDecompressionBuffer(NULL)
+	, mpNetworkThread(NULL)
 	, mActiveSchemesCount(0)
+	, mConnectionPool()
 #ifdef _DEBUG
    	, mJobCount(0)
 #endif
@@ -468,6 +915,7 @@ namespace WebKit
 	bool TransportHandlerDirtySDK::SetupHttpManager(HttpManagerRefT*& pHttpManager, bool syncJobs /* = false */)
 	{
 		const EA::WebKit::Parameters& params = EA::WebKit::GetParameters();
+		const bool bNetworkThread = (!syncJobs && mpNetworkThread);
 		if(!syncJobs)
 			pHttpManager = HttpManagerCreate(params.mHttpRequestResponseBufferSize, params.mMaxTransportJobs);
 		else
@@ -485,7 +933,9 @@ namespace WebKit
 		HttpManagerControl(pHttpManager, -1, DIRTY_PIPE, pipelining, 0, NULL); 
 #endif
 		// set the redirection limit to a higher value
-		HttpManagerControl(pHttpManager, -1, DIRTY_MAX_REDIRECTION, 10, 0, NULL); 
+		// The network thread can't reattach cookies when DirtySDK sends a redirected request (see DirtySDKSendHeaderCallback), so 
+		// redirects are disabled there and the TransportServer starts a new job instead (see TransportInfo::mbFollowRedirects).
+		HttpManagerControl(pHttpManager, -1, DIRTY_MAX_REDIRECTION, (bNetworkThread ? 0 : 10), 0, NULL); 
 
 		//Set timeout for DirtySDK based on the page timeout of EAWebKit params
 		HttpManagerControl(pHttpManager, -1, DIRTY_REQUEST_TIMEOUT, (int32_t)(params.mPageTimeoutSeconds * 1000), 0, NULL);
@@ -506,7 +956,8 @@ namespace WebKit
 		// to tick the EAWebKit and DirtySDK on different threads.
 		// Prior to this change/DirtSDK version, we had a limitation that they 
 		// should both be on same thread.
-		if(!params.mTickHttpManagerFromNetConnIdle)
+		// The network thread is the only one to tick its HttpManager.
+		if(!params.mTickHttpManagerFromNetConnIdle || bNetworkThread)
 			HttpManagerControl(pHttpManager, -1, DIRTY_AUTO, FALSE, 0, NULL); 
 #endif
 		return true;
@@ -536,7 +987,22 @@ namespace WebKit
 			//We handle both http and https schemes through the same HttpManager.
 			if (!mpHttpManager)
 			{
+#if (DIRTYVERS > 0x08120000) // The network thread needs DIRTY_AUTO, so that NetConnIdle doesn't tick its HttpManager too.
+				if(GetParameters().mHttpTransportThreadEnabled)
+				{
+					EA::WebKit::Allocator* pAllocator = GetAllocator();
+					mpNetworkThread = new(pAllocator->Malloc(sizeof(NetworkThread), 0, "EAWebKit/TransportHandlerDirtySDK/NetworkThread")) NetworkThread;
+					if(!mpNetworkThread->Start()) // Fall back to ticking on the main thread.
+					{
+						mpNetworkThread->~NetworkThread();
+						pAllocator->Free(mpNetworkThread, sizeof(NetworkThread));
+						mpNetworkThread = NULL;
+					}
+				}
+#endif
 				SetupHttpManager(mpHttpManager);
+				if(mpNetworkThread)
+					mpNetworkThread->SetHttpManager(mpHttpManager);
 				//We don't set up mpHttpManagerSyncJobs here. We adopt lazy initialization for it.
 			}
 
@@ -556,11 +1022,33 @@ namespace WebKit
 		// We don't shutdown unless we are the last scheme.
 		if(mActiveSchemesCount == 0)
 		{
+			mConnectionPool.Clear();
+
 			if(mSharedDecompressionBuffer)
 			{
 				GetAllocator()->Free(mSharedDecompressionBuffer,0);
 				mSharedDecompressionBuffer = NULL;
 			}
+
+			if(mpNetworkThread)
+			{
+				// All jobs are shut down by now. Free the ones the network thread did not get to release.
+				mpNetworkThread->Stop();
+				ProcessNetworkMessages();
+
+				NetworkThread::JobList jobs;
+				mpNetworkThread->TakeJobs(jobs);
+				for(NetworkThread::JobList::iterator it = jobs.begin(); it != jobs.end(); ++it)
+				{
+					EA_ASSERT((*it)->mbShutdown);
+					DestroyDirtySDKInfo(*it);
+				}
+
+				mpNetworkThread->~NetworkThread();
+				GetAllocator()->Free(mpNetworkThread, sizeof(NetworkThread));
+				mpNetworkThread = NULL;
+			}
+
 			if (mpHttpManager)
 			{
 				HttpManagerDestroy(mpHttpManager);
@@ -592,6 +1080,7 @@ namespace WebKit
 		EA::WebKit::Allocator* pAllocator = GetAllocator();
 		DirtySDKInfo* pDirtySDKInfo = new(pAllocator->Malloc(sizeof(DirtySDKInfo), 0, "EAWebKit/TransportHandlerDirtySDK")) DirtySDKInfo; 
 		pTInfo->mTransportHandlerData = (uintptr_t)pDirtySDKInfo;
+		pDirtySDKInfo->mpTInfo = pTInfo;
 
 		HttpManagerRefT* pHttpManager = mpHttpManager;
 		if(!pTInfo->mbAsync)
@@ -601,9 +1090,17 @@ namespace WebKit
 
 			pHttpManager = mpHttpManagerSyncJobs;
 		}
+		else if(mpNetworkThread)
+		{
+			pDirtySDKInfo->mpNetworkThread    = mpNetworkThread;
+			pDirtySDKInfo->mpHeaderMapPending = new(pAllocator->Malloc(sizeof(EASTLHeaderMapWrapper), 0, "EAWebKit/TransportHandlerDirtySDK")) EASTLHeaderMapWrapper;
+			pTInfo->mbFollowRedirects = false; // See SetupHttpManager.
+		}
 
 		// allocate an HTTP transfer handle
+		LockHttpManager(pTInfo);
 		pDirtySDKInfo->mHttpHandle = HttpManagerAlloc(pHttpManager);
+		UnlockHttpManager(pTInfo);
 		
 		if (pDirtySDKInfo->mHttpHandle == 0)
 		{
@@ -662,17 +1159,25 @@ namespace WebKit
 		if(pTInfo->mTransportHandlerData)
 		{
 			DirtySDKInfo*          pDirtySDKInfo  = (DirtySDKInfo*)pTInfo->mTransportHandlerData;
-			EA::WebKit::Allocator* pAllocator     = GetAllocator();
 
 			HttpManagerRefT* pHttpManager = mpHttpManager;
 			if(!pTInfo->mbAsync)
 				pHttpManager = mpHttpManagerSyncJobs;
+
+			// A job removed before its transfer completed (canceled, timed out or failed) leaves no reusable connection behind.
+			if(!pDirtySDKInfo->mOrigin.empty())
+				ReleaseConnection(pTInfo, pDirtySDKInfo, false);
 			
+			LockHttpManager(pTInfo);
 			if(pDirtySDKInfo->mHttpHandle)
 				HttpManagerFree(pHttpManager, pDirtySDKInfo->mHttpHandle);
+			pDirtySDKInfo->mHttpHandle = 0;
+			pDirtySDKInfo->mbShutdown  = true;
+			UnlockHttpManager(pTInfo);
 
-			pDirtySDKInfo->~DirtySDKInfo();
-			pAllocator->Free(pDirtySDKInfo, sizeof(DirtySDKInfo));
+			// Once added, the network thread may still be working with the job. It hands it back when done and we free it then.
+			if(!pDirtySDKInfo->mbAddedToNetworkThread)
+				DestroyDirtySDKInfo(pDirtySDKInfo);
 			pTInfo->mTransportHandlerData = 0;
 
 			#ifdef EA_DEBUG
@@ -699,9 +1204,84 @@ namespace WebKit
 		if(!pTInfo->mbAsync)
 			pHttpManager = mpHttpManagerSyncJobs;
 
+		// Read the POST data first. This calls back into the TransportServer, which we don't do with the HttpManager locked.
+		bool bPostDataRead = false;
+		if((pTInfo->mHttpRequestType == EA::WebKit::kHttpRequestTypePOST) || (pTInfo->mHttpRequestType == EA::WebKit::kHttpRequestTypePUT))
+		{
+
+			// Original code that did a chunked send but which doesn't work with HTTP servers.
+			// pDirtySDKInfo->mbPostActive        = true;
+			// pDirtySDKInfo->mPostBufferSize     = 0;
+			// pDirtySDKInfo->mPostBufferPosition = 0;
+			// iResult = ProtoHttpPost(pDirtySDKInfo->mpProtoHttp, pDirtySDKInfo->mURI.c_str(), NULL, PROTOHTTP_STREAM_BEGIN, PROTOHTTP_POST);
+			// if(iResult == PROTOHTTP_STREAM_BEGIN) // PROTOHTTP_STREAM_BEGIN == -1, so we can have an iResult that is negative yet not really an error.
+			//    iResult = 0;
+
+			// New code whereby we don't use chunked data.
+			pDirtySDKInfo->mPostData.clear();      // Shouldn't be necessary.
+			pDirtySDKInfo->mbPostActive = false;    // Skip right to reading the data from the server (see the Transfer function).
+
+			char    buffer[256];
+			int64_t size;
+
+			do {
+				size = pTInfo->mpTransportServer->ReadData(pTInfo, buffer, sizeof(buffer));
+				if(size > 0)
+					pDirtySDKInfo->mPostData.append(buffer, (EA::TransportHelper::TransportString8::size_type)(size));
+			} while(size > 0);
+
+			EA_ASSERT(size == 0);
+			if(size == 0)
+			{
+				// abaldeva: Don't want to use swprintf. That may be broken on OS X depending upon the 
+				// build flags.
+				const size_t kMaxDigits = 32; 
+				char8_t bufferLen[kMaxDigits];
+				int numChars = sprintf(bufferLen, "%u",(unsigned)pDirtySDKInfo->mPostData.length());
+				EA_ASSERT_FORMATTED(numChars < kMaxDigits-1, ("Impossible length for POST data - %d", numChars));
+
+				char16_t bufferLen16[kMaxDigits];
+				char8_t* pSrc = bufferLen;
+				char16_t* pDest = bufferLen16;
+				while(numChars > 0)
+				{
+					*pDest++ = (char16_t)(*pSrc++);
+					--numChars;
+				}
+				*pDest = 0;
+
+
+				pTInfo->mHeaderMapOut.SetValue(EA_CHAR16("Content-Length"), bufferLen16);
+				bPostDataRead = true;
+			}
+		}
+
+		// Synchronous jobs have an HttpManager of their own and stay out of the connection pool.
+		bool bSecure = false;
+		if(pTInfo->mbAsync && HttpConnectionPool::GetOrigin(pDirtySDKInfo->mURI.c_str(), pDirtySDKInfo->mOrigin, bSecure))
+		{
+			pDirtySDKInfo->mbKeepAliveRequested = mConnectionPool.Acquire(pDirtySDKInfo->mOrigin, bSecure);
+
+			// Only requests that can safely be sent again are pipelined, and only to servers that have kept their connections open before.
+			const bool bIdempotent = (pTInfo->mHttpRequestType == EA::WebKit::kHttpRequestTypeGET) || (pTInfo->mHttpRequestType == EA::WebKit::kHttpRequestTypeHEAD);
+			pDirtySDKInfo->mbPipelined = GetParameters().mHttpPipeliningEnabled && bIdempotent && pDirtySDKInfo->mbKeepAliveRequested && mConnectionPool.CanPipeline(pDirtySDKInfo->mOrigin);
+			if(pDirtySDKInfo->mbPipelined)
+				mConnectionPool.CountPipelinedRequest();
+		}
+
+		LockHttpManager(pTInfo);
+
 		// set callback user info
 		HttpManagerControl(pHttpManager, pDirtySDKInfo->mHttpHandle, DIRTY_CALLBACK_USER_POINTER, 0, 0, (void *)pTInfo);
 
+		if(!pDirtySDKInfo->mOrigin.empty())
+		{
+			HttpManagerControl(pHttpManager, pDirtySDKInfo->mHttpHandle, DIRTY_KEEP_ALIVE, (pDirtySDKInfo->mbKeepAliveRequested ? 1 : 0), 0, NULL);
+#if (		((DIRTYVERS >= 0x07070000) && (DIRTYVERS < 0x08000000))			||				(DIRTYVERS >= 0x08050000))
+			HttpManagerControl(pHttpManager, pDirtySDKInfo->mHttpHandle, DIRTY_PIPE, (pDirtySDKInfo->mbPipelined ? 1 : 0), 0, NULL);
+#endif
+		}
+
 #if 0
 		// Added some debug code so that you can hit the breakpoint quickly in a URL of interest. This assists 
 		// in debugging.
@@ -721,50 +1301,8 @@ namespace WebKit
 		case EA::WebKit::kHttpRequestTypePOST:
 		case EA::WebKit::kHttpRequestTypePUT:
 			{
-
-				// Original code that did a chunked send but which doesn't work with HTTP servers.
-				// pDirtySDKInfo->mbPostActive        = true;
-				// pDirtySDKInfo->mPostBufferSize     = 0;
-				// pDirtySDKInfo->mPostBufferPosition = 0;
-				// iResult = ProtoHttpPost(pDirtySDKInfo->mpProtoHttp, pDirtySDKInfo->mURI.c_str(), NULL, PROTOHTTP_STREAM_BEGIN, PROTOHTTP_POST);
-				// if(iResult == PROTOHTTP_STREAM_BEGIN) // PROTOHTTP_STREAM_BEGIN == -1, so we can have an iResult that is negative yet not really an error.
-				//    iResult = 0;
-
-				// New code whereby we don't use chunked data.
-				pDirtySDKInfo->mPostData.clear();      // Shouldn't be necessary.
-				pDirtySDKInfo->mbPostActive = false;    // Skip right to reading the data from the server (see the Transfer function).
-
-				char    buffer[256];
-				int64_t size;
-
-				do {
-					size = pTInfo->mpTransportServer->ReadData(pTInfo, buffer, sizeof(buffer));
-					if(size > 0)
-						pDirtySDKInfo->mPostData.append(buffer, (EA::TransportHelper::TransportString8::size_type)(size));
-				} while(size > 0);
-
-				EA_ASSERT(size == 0);
-				if(size == 0)
+				if(bPostDataRead)
 				{
-					// abaldeva: Don't want to use swprintf. That may be broken on OS X depending upon the 
-					// build flags.
-					const size_t kMaxDigits = 32; 
-					char8_t bufferLen[kMaxDigits];
-					int numChars = sprintf(bufferLen, "%u",(unsigned)pDirtySDKInfo->mPostData.length());
-					EA_ASSERT_FORMATTED(numChars < kMaxDigits-1, ("Impossible length for POST data - %d", numChars));
-
-					char16_t bufferLen16[kMaxDigits];
-					char8_t* pSrc = bufferLen;
-					char16_t* pDest = bufferLen16;
-					while(numChars > 0)
-					{
-						*pDest++ = (char16_t)(*pSrc++);
-						--numChars;
-					}
-					*pDest = 0;
-
-
-					pTInfo->mHeaderMapOut.SetValue(EA_CHAR16("Content-Length"), bufferLen16);
 					//iResult = HttpManagerPost(pHttpManager, pDirtySDKInfo->mHttpHandle, pDirtySDKInfo->mURI.c_str(), pDirtySDKInfo->mPostData.c_str(), (int32_t) pDirtySDKInfo->mPostData.length(), PROTOHTTP_POST);
 					iResult = HttpManagerRequest(pHttpManager, pDirtySDKInfo->mHttpHandle, pDirtySDKInfo->mURI.c_str(), pDirtySDKInfo->mPostData.c_str(), (int32_t) pDirtySDKInfo->mPostData.length(), ((pTInfo->mHttpRequestType == EA::WebKit::kHttpRequestTypePOST) ? PROTOHTTP_REQUESTTYPE_POST : PROTOHTTP_REQUESTTYPE_PUT));
 
@@ -795,6 +1333,12 @@ namespace WebKit
 		if(!pTInfo->mbVerifySSLCert)
 			HttpManagerControl(pHttpManager, pDirtySDKInfo->mHttpHandle, DIRTY_DISABLE_CERT_VALIDATION,1, 0, NULL); 
 
+		// From here on the network thread updates the request and receives its data.
+		if(pDirtySDKInfo->mpNetworkThread && bReturnValue)
+			mpNetworkThread->AddJob(pDirtySDKInfo);
+
+		UnlockHttpManager(pTInfo);
+
 		bStateComplete = true;
 		return bReturnValue;
 	}
@@ -842,7 +1386,11 @@ namespace WebKit
 			// previous time through (when mSendIndex == 0) and re-add them now, as they may
 			// have changed, especially if the redirect happened to give us a new cookie. 
 			// Some servers (including EA servers) rely on this.
-			ReattachCookies(pTInfo);
+			// Network thread jobs don't get here as DirtySDK doesn't follow their redirects. This may run on the network thread, 
+			// where the cookie manager can't be used.
+			EA_ASSERT(!pDirtySDKInfo->mpNetworkThread);
+			if(!pDirtySDKInfo->mpNetworkThread)
+				ReattachCookies(pTInfo);
 		}
 
 		// if(pDirtySDKInfo->mSendIndex == 1) // If this is the first GET and not a possible subsequent GET after a (e.g. 302) redirect...
@@ -992,11 +1540,31 @@ namespace WebKit
 	{
 		// pHeader includes all the received header text.
 		DirtySDKInfo* pDirtySDKInfo = (DirtySDKInfo*)pTInfo->mTransportHandlerData;
-		HttpManagerRefT* pHttpManager = mpHttpManager;
-		if(!pTInfo->mbAsync)
-			pHttpManager = mpHttpManagerSyncJobs;
 
 		pDirtySDKInfo->mbHeadersReceived = true;
+		pDirtySDKInfo->mbHttp11Response  = (strncmp(pHeader, "HTTP/1.1", 8) == 0);
+
+		if(pDirtySDKInfo->mpNetworkThread)
+		{
+			// We are on the network thread, with the HttpManager locked. We parse the headers here and the main thread 
+			// passes them on to the TransportServer (see DeliverNetworkResults).
+			const int32_t resultCode = ProtoHttpStatus(pState, DIRTY_RESPONSE_CODE, NULL, 0); 
+			EA_ASSERT_MSG(resultCode != -1, "Expecting a valid Http response code\n");
+
+			// A provisional (1xx) response has nothing the TransportServer uses. Once headers are queued, the main thread owns mpHeaderMapPending.
+			EA_ASSERT_MSG(!pDirtySDKInfo->mbHeadersQueued, "Unexpected second response for a job. Redirects should be disabled for network thread jobs.\n");
+			if(((resultCode >= 100) && (resultCode < 200)) || pDirtySDKInfo->mbHeadersQueued)
+				return;
+
+			pDirtySDKInfo->mPendingResultCode = resultCode;
+			bool errorEncountered = SetHeaderMapWrapperFromText(pHeader, uHeaderSize, *pDirtySDKInfo->mpHeaderMapPending, true, true);
+			(void) errorEncountered;
+			EA_ASSERT_MSG(!errorEncountered, "The incoming text header map has some error. The resource response object created using partial header info may not be valid.");
+
+			SetupStreamDecompressor(pTInfo, *pDirtySDKInfo->mpHeaderMapPending);
+			pDirtySDKInfo->mbHeadersPending = true;
+			return;
+		}
 
 		// Check for a 200, 404, etc. code. ProtoHttpStatus returns -1 if headers have not been successfully received.
  		// abaldeva: 05/02/11 - Since we are in a Callback, we should be using ProtoHttp directly instead of the HttpManager(as per DirtySDK team)
@@ -1009,7 +1577,7 @@ namespace WebKit
 		(void) errorEncountered;
 		EA_ASSERT_MSG(!errorEncountered, "The incoming text header map has some error. The resource response object created using partial header info may not be valid.");
 
-		SetupStreamDecompressor(pTInfo);
+		SetupStreamDecompressor(pTInfo, pTInfo->mHeaderMapIn);
 		
 		pTInfo->mpTransportServer->HeadersReceived(pTInfo);
 
@@ -1018,13 +1586,23 @@ namespace WebKit
 
 
 	
-	void TransportHandlerDirtySDK::SetupStreamDecompressor(EA::WebKit::TransportInfo* pTInfo)
+	void TransportHandlerDirtySDK::SetupStreamDecompressor(EA::WebKit::TransportInfo* pTInfo, const EASTLHeaderMapWrapper& headerMapIn)
 	{
 		(void) pTInfo;
+		(void) headerMapIn;
 #if ENABLE_PAYLOAD_DECOMPRESSION
 		DirtySDKInfo* pDirtySDKInfo = (DirtySDKInfo*)pTInfo->mTransportHandlerData;
 		
-		const char16_t* pContentEncodingType(pTInfo->mHeaderMapIn.GetValue(EA_CHAR16("Content-Encoding")));
+		// Network thread jobs decompress into the chunks of the network thread and hand them to the main thread.
+		DecompressedDataCallback pCallback = DecompressedDataCallbackFunc;
+		void* pCallbackUserData = pTInfo;
+		if(pDirtySDKInfo->mpNetworkThread)
+		{
+			pCallback = NetworkThread::OnDecompressedData;
+			pCallbackUserData = pDirtySDKInfo;
+		}
+
+		const char16_t* pContentEncodingType(headerMapIn.GetValue(EA_CHAR16("Content-Encoding")));
 		if(pContentEncodingType)
 		{
 			EA::WebKit::Allocator* pAllocator = GetAllocator();
@@ -1041,19 +1619,23 @@ namespace WebKit
 			{
 
 				pDirtySDKInfo->mStreamDecompressor = new(pAllocator->Malloc(sizeof(DeflateStreamDecompressor),0,0)) DeflateStreamDecompressor(eStreamTypeZLib);
-				pDirtySDKInfo->mStreamDecompressor->SetDecompressedDataCallback(DecompressedDataCallbackFunc, pTInfo);
+				pDirtySDKInfo->mStreamDecompressor->SetDecompressedDataCallback(pCallback, pCallbackUserData);
+				if(pDirtySDKInfo->mpNetworkThread)
+					pDirtySDKInfo->mStreamDecompressor->SetOutputBufferCallback(NetworkThread::OnOutputBuffer, pDirtySDKInfo);
 				streamEncoded = true;
 
 			}
 			else if(EA::TransportHelper::Stricmp(pContentEncodingType, EA_CHAR16("gzip")) == 0)
 			{
 				pDirtySDKInfo->mStreamDecompressor = new(pAllocator->Malloc(sizeof(DeflateStreamDecompressor),0,0)) DeflateStreamDecompressor(eStreamTypeGZip);
-				pDirtySDKInfo->mStreamDecompressor->SetDecompressedDataCallback(DecompressedDataCallbackFunc, pTInfo);
+				pDirtySDKInfo->mStreamDecompressor->SetDecompressedDataCallback(pCallback, pCallbackUserData);
+				if(pDirtySDKInfo->mpNetworkThread)
+					pDirtySDKInfo->mStreamDecompressor->SetOutputBufferCallback(NetworkThread::OnOutputBuffer, pDirtySDKInfo);
 				streamEncoded = true;
 			}
 
 			//Do lazy allocation of the shared decompression buffer
-			if(!mSharedDecompressionBuffer && streamEncoded)
+			if(!mSharedDecompressionBuffer && streamEncoded && !pDirtySDKInfo->mpNetworkThread)
 				mSharedDecompressionBuffer = (uint8_t*)pAllocator->Malloc(EA::TransportHelper::kSharedDecompressionBufferSize,0,"EAWebKitZLibSharedDecompressionBuffer");
 
 		}
@@ -1080,14 +1662,154 @@ namespace WebKit
 
 	bool TransportHandlerDirtySDK::Tick()
 	{
-		if(mpHttpManager)    
+		if(mpNetworkThread) // The network thread updates mpHttpManager. We only pick up its results here.
+			ProcessNetworkMessages();
+		else if(mpHttpManager)    
 			HttpManagerUpdate(mpHttpManager);
 		if(mpHttpManagerSyncJobs)
 			HttpManagerUpdate(mpHttpManagerSyncJobs);
+
+		mConnectionPool.Tick();
 		
 		return true;
 	}
 
+	// Drains the queue of the network thread. Results are kept with their job until Transfer passes them on to the TransportServer,
+	// so that they are delivered from the job state machine as they are without the network thread.
+	void TransportHandlerDirtySDK::ProcessNetworkMessages()
+	{
+		NetworkMessage message;
+		while(mpNetworkThread->PopMessage(message))
+		{
+			DirtySDKInfo* pDirtySDKInfo = message.mpDirtySDKInfo;
+			switch(message.mType)
+			{
+			case NetworkMessage::kTypeHeaders:
+				pDirtySDKInfo->mbHeadersReady = !pDirtySDKInfo->mbShutdown;
+				break;
+
+			case NetworkMessage::kTypeData:
+				if(pDirtySDKInfo->mbShutdown)
+					mpNetworkThread->FreeChunk(message.mpChunk);
+				else
+				{
+					if(pDirtySDKInfo->mpReadyTail)
+						pDirtySDKInfo->mpReadyTail->mpNext = message.mpChunk;
+					else
+						pDirtySDKInfo->mpReadyHead = message.mpChunk;
+					pDirtySDKInfo->mpReadyTail = message.mpChunk;
+				}
+				break;
+
+			case NetworkMessage::kTypeDone:
+				pDirtySDKInfo->mbTransferDone  = true;
+				pDirtySDKInfo->mTransferResult = message.mResult;
+				break;
+
+			case NetworkMessage::kTypeReleased:
+				EA_ASSERT(pDirtySDKInfo->mbShutdown);
+				DestroyDirtySDKInfo(pDirtySDKInfo);
+				break;
+			}
+		}
+	}
+
+	void TransportHandlerDirtySDK::DeliverNetworkResults(EA::WebKit::TransportInfo* pTInfo, DirtySDKInfo* pDirtySDKInfo)
+	{
+		if(pDirtySDKInfo->mbHeadersReady)
+		{
+			pDirtySDKInfo->mbHeadersReady = false;
+			pTInfo->mResultCode = pDirtySDKInfo->mPendingResultCode;
+			GetHeaderMap(pTInfo->mHeaderMapIn)->swap(*GetHeaderMap(*pDirtySDKInfo->mpHeaderMapPending));
+
+			pTInfo->mpTransportServer->HeadersReceived(pTInfo);
+			CookiesReceived(pTInfo);
+		}
+
+		while(pDirtySDKInfo->mpReadyHead && !pDirtySDKInfo->mbShutdown)
+		{
+			NetworkChunk* pChunk = pDirtySDKInfo->mpReadyHead;
+			pDirtySDKInfo->mpReadyHead = pChunk->mpNext;
+			if(!pDirtySDKInfo->mpReadyHead)
+				pDirtySDKInfo->mpReadyTail = NULL;
+
+			pTInfo->mpTransportServer->DataReceived(pTInfo, pChunk->mData, pChunk->mSize);
+			mpNetworkThread->FreeChunk(pChunk);
+		}
+	}
+
+	void TransportHandlerDirtySDK::ReleaseConnection(EA::WebKit::TransportInfo* pTInfo, DirtySDKInfo* pDirtySDKInfo, bool bSucceeded)
+	{
+		// HTTP/1.1 connections stay open unless the server says "close". HTTP/1.0 ones only if it says "keep-alive".
+		bool   bPersistent = pDirtySDKInfo->mbHttp11Response;
+		double keepAliveSeconds = 0.0;
+
+		if(bSucceeded)
+		{
+			const char16_t* pConnection = pTInfo->mHeaderMapIn.GetValue(EA_CHAR16("Connection"));
+			if(pConnection)
+			{
+				EA::TransportHelper::TransportString16 connection(pConnection);
+				connection.make_lower();
+				if(connection.find(EA_CHAR16("close")) != EA::TransportHelper::TransportString16::npos)
+					bPersistent = false;
+				else if(connection.find(EA_CHAR16("keep-alive")) != EA::TransportHelper::TransportString16::npos)
+					bPersistent = true;
+			}
+
+			// For example "Keep-Alive: timeout=5, max=100".
+			const char16_t* pKeepAlive = pTInfo->mHeaderMapIn.GetValue(EA_CHAR16("Keep-Alive"));
+			if(pKeepAlive)
+			{
+				EA::TransportHelper::TransportString16 keepAlive(pKeepAlive);
+				keepAlive.make_lower();
+				eastl_size_t pos = keepAlive.find(EA_CHAR16("timeout="));
+				if(pos != EA::TransportHelper::TransportString16::npos)
+				{
+					for(pos += 8; (pos < keepAlive.length()) && (keepAlive[pos] >= '0') && (keepAlive[pos] <= '9'); ++pos)
+						keepAliveSeconds = (keepAliveSeconds * 10.0) + (keepAlive[pos] - '0');
+				}
+			}
+		}
+
+		mConnectionPool.Release(pDirtySDKInfo->mOrigin, pDirtySDKInfo->mbKeepAliveRequested, bSucceeded, pDirtySDKInfo->mbHttp11Response, bPersistent, keepAliveSeconds, pDirtySDKInfo->mbPipelined);
+		pDirtySDKInfo->mOrigin.clear();
+	}
+
+	void TransportHandlerDirtySDK::DestroyDirtySDKInfo(DirtySDKInfo* pDirtySDKInfo)
+	{
+		while(pDirtySDKInfo->mpReadyHead)
+		{
+			NetworkChunk* pChunk = pDirtySDKInfo->mpReadyHead;
+			pDirtySDKInfo->mpReadyHead = pChunk->mpNext;
+			mpNetworkThread->FreeChunk(pChunk);
+		}
+
+		pDirtySDKInfo->~DirtySDKInfo();
+		GetAllocator()->Free(pDirtySDKInfo, sizeof(DirtySDKInfo));
+	}
+
+	// The HttpManager of network thread jobs is only used with the lock held. Synchronous jobs have their own HttpManager.
+	void TransportHandlerDirtySDK::LockHttpManager(const EA::WebKit::TransportInfo* pTInfo)
+	{
+		if(mpNetworkThread && pTInfo->mbAsync)
+			mpNetworkThread->Lock();
+	}
+
+	void TransportHandlerDirtySDK::UnlockHttpManager(const EA::WebKit::TransportInfo* pTInfo)
+	{
+		if(mpNetworkThread && pTInfo->mbAsync)
+			mpNetworkThread->Unlock();
+	}
+
+	int32_t TransportHandlerDirtySDK::GetHttpManagerStatus(const EA::WebKit::TransportInfo* pTInfo, HttpManagerRefT* pHttpManager, int32_t iSelect, void* pBuffer, int32_t iBufSize)
+	{
+		LockHttpManager(pTInfo);
+		const int32_t iResult = HttpManagerStatus(pHttpManager, ((DirtySDKInfo*)pTInfo->mTransportHandlerData)->mHttpHandle, iSelect, pBuffer, iBufSize);
+		UnlockHttpManager(pTInfo);
+		return iResult;
+	}
+
 	bool TransportHandlerDirtySDK::Transfer(EA::WebKit::TransportInfo* pTInfo, bool& bStateComplete)
 	{
 		bool          bReturnValue = true;
@@ -1103,43 +1825,62 @@ namespace WebKit
 		if(dCurrentTime > pTInfo->mTimeout)
 			bReturnValue = false;
 
-		switch(pTInfo->mHttpRequestType)
+		if(pDirtySDKInfo->mpNetworkThread)
 		{
-		//Note by Arpit Baldeva: GET and POST method response usually would have some data to go with.
-		case EA::WebKit::kHttpRequestTypeGET:
-		case EA::WebKit::kHttpRequestTypePOST:
-		
-		case EA::WebKit::kHttpRequestTypePUT:
-		case EA::WebKit::kHttpRequestTypeHEAD:
-		case EA::WebKit::kHttpRequestTypeDELETE:
-		case EA::WebKit::kHttpRequestTypeOPTIONS:
+			// The network thread did the receiving. Pass on what it has for us and carry on with its final result, if any.
+			DeliverNetworkResults(pTInfo, pDirtySDKInfo);
+			if(!pDirtySDKInfo->mbTransferDone)
+				return bReturnValue;
+
+			iResult = pDirtySDKInfo->mTransferResult;
+			if(iResult == kNetworkRecvDecompressionError)
+			{
+				pTInfo->mpTransportServer->DataDone(pTInfo, false);
+				bReturnValue   = false;
+				bStateComplete = true;
+				return bReturnValue;
+			}
+		}
+		else
+		{
+			switch(pTInfo->mHttpRequestType)
 			{
-				while((iResult = HttpManagerRecv(pHttpManager, pDirtySDKInfo->mHttpHandle, buffer, 1, sizeof(buffer))) > 0)  // While there is received data...
+			//Note by Arpit Baldeva: GET and POST method response usually would have some data to go with.
+			case EA::WebKit::kHttpRequestTypeGET:
+			case EA::WebKit::kHttpRequestTypePOST:
+		
+			case EA::WebKit::kHttpRequestTypePUT:
+			case EA::WebKit::kHttpRequestTypeHEAD:
+			case EA::WebKit::kHttpRequestTypeDELETE:
+			case EA::WebKit::kHttpRequestTypeOPTIONS:
 				{
-					EA_ASSERT_MSG(pDirtySDKInfo->mbHeadersReceived,"The headers should have been received and processed by this time through the DirtySDK callback\n");
-	#if ENABLE_PAYLOAD_DECOMPRESSION
-					if(pDirtySDKInfo->mStreamDecompressor)
+					while((iResult = HttpManagerRecv(pHttpManager, pDirtySDKInfo->mHttpHandle, buffer, 1, sizeof(buffer))) > 0)  // While there is received data...
 					{
-						if(pDirtySDKInfo->mStreamDecompressor->Decompress((uint8_t*)buffer,iResult,mSharedDecompressionBuffer,EA::TransportHelper::kSharedDecompressionBufferSize)<0)//if there is any error in the processing of stream, error out.
+						EA_ASSERT_MSG(pDirtySDKInfo->mbHeadersReceived,"The headers should have been received and processed by this time through the DirtySDK callback\n");
+		#if ENABLE_PAYLOAD_DECOMPRESSION
+						if(pDirtySDKInfo->mStreamDecompressor)
 						{
-							pTInfo->mpTransportServer->DataDone(pTInfo, false);
-							bReturnValue   = false;
-							bStateComplete = true;
-							return bReturnValue;
+							if(pDirtySDKInfo->mStreamDecompressor->Decompress((uint8_t*)buffer,iResult,mSharedDecompressionBuffer,EA::TransportHelper::kSharedDecompressionBufferSize)<0)//if there is any error in the processing of stream, error out.
+							{
+								pTInfo->mpTransportServer->DataDone(pTInfo, false);
+								bReturnValue   = false;
+								bStateComplete = true;
+								return bReturnValue;
+							}
+						}
+						else
+		#endif
+						{
+							pTInfo->mpTransportServer->DataReceived(pTInfo, buffer,iResult);
 						}
 					}
-					else
-	#endif
-					{
-						pTInfo->mpTransportServer->DataReceived(pTInfo, buffer,iResult);
-					}
+					break;
 				}
+
+			// handle a default case as otherwise it fails to compile
+			default:
 				break;
 			}
-
-		// handle a default case as otherwise it fails to compile
-		default:
-			break;
 		}
 		
 		// iResult is one of:
@@ -1190,7 +1931,7 @@ namespace WebKit
 				{
 					EA::WebKit::NetworkErrorInfo info;
 					eastl::string8 errorMessage;
-					int32_t timeout = HttpManagerStatus(pHttpManager, pDirtySDKInfo->mHttpHandle, DIRTY_REQUEST_TIMEOUT, NULL, 0);
+					int32_t timeout = GetHttpManagerStatus(pTInfo, pHttpManager, DIRTY_REQUEST_TIMEOUT, NULL, 0);
 					if(timeout)
 					{
 						info.mNetworkErrorType = EA::WebKit::kNetworkErrorTimeOut;
@@ -1203,7 +1944,7 @@ namespace WebKit
 					}
 
 #if DIRTYVERS >= 0x07060A00
-					int32_t essl = HttpManagerStatus(pHttpManager, pDirtySDKInfo->mHttpHandle, DIRTY_ESSL, NULL, 0);
+					int32_t essl = GetHttpManagerStatus(pTInfo, pHttpManager, DIRTY_ESSL, NULL, 0);
 					if(essl < 0 && (pDirtySDKInfo->mURI.find("https") != EA::TransportHelper::TransportString8::npos))//DirtySDK triggers the error for even non SSL links. Don't report those errors.
 					{
                        	info.mNetworkErrorType = EA::WebKit::kNetworkErrorSSLCert;
@@ -1219,7 +1960,7 @@ namespace WebKit
                         {
                             ProtoSSLCertInfoT certInfo;
                             int32_t certInfoSize = sizeof(ProtoSSLCertInfoT);
-                            int32_t status = HttpManagerStatus(pHttpManager, pDirtySDKInfo->mHttpHandle, DIRTY_CERT, &certInfo, certInfoSize);
+                            int32_t status = GetHttpManagerStatus(pTInfo, pHttpManager, DIRTY_CERT, &certInfo, certInfoSize);
                             if(status == PROTOSSL_ERROR_NONE)
                             {
                                 // The needed authority is not always set in common so we print out all fields to give the user feedback.
@@ -1312,6 +2053,9 @@ namespace WebKit
 		}
 #endif //if 0
 
+		if(bStateComplete && !pDirtySDKInfo->mOrigin.empty())
+			ReleaseConnection(pTInfo, pDirtySDKInfo, bReturnValue);
+
 		return bReturnValue;
 	}
 
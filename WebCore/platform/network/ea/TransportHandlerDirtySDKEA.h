@@ -76,6 +76,7 @@ namespace TransportHelper
 
 #include "protohttpmanager.h"
 #include "dirtyvers.h" // Defines (e.g.) #define DIRTYVERS (0x07000000)
+#include "HttpConnectionPoolEA.h"
 
 
 namespace EA
@@ -101,6 +102,8 @@ public:
 	bool CanCacheToDisk ();  
 	bool Tick			();
 
+	void GetConnectionUsage(EA::WebKit::HttpConnectionUsageInfo& usageInfo) const { mConnectionPool.GetUsage(usageInfo); }
+
 #if DIRTYVERS > 0x07050300 
 	static int32_t DirtySDKSendHeaderCallbackStatic(ProtoHttpRefT* pState, char* pHeader, uint32_t uHeaderSize, const char* pData, uint32_t uDataLen, void* pUserRef);
 #else
@@ -116,6 +119,9 @@ public:
 	void        DirtySDKRecvHeaderCallback(ProtoHttpRefT* pState, const char* pHeader, uint32_t uHeaderSize, EA::WebKit::TransportInfo* pTInfo);
 
 private:
+	class  NetworkThread;
+	struct NetworkChunk;
+	struct NetworkMessage;
     
 	struct DirtySDKInfo  // Our info for a given job.
 	{
@@ -130,18 +136,50 @@ private:
 		int64_t									mPostBufferSize;       // Deprecated unless/until we go back to using chunked data. 
 		int64_t									mPostBufferPosition;   // Deprecated unless/until we go back to using chunked data.
 		IStreamDecompressor*					mStreamDecompressor;
+
+		// Used when the job is run by the network thread (mpNetworkThread != NULL). See NetworkThread.
+		EA::WebKit::TransportInfo*				mpTInfo;
+		NetworkThread*							mpNetworkThread;
+		EASTLHeaderMapWrapper*					mpHeaderMapPending;    // Headers parsed on the network thread. Swapped into mHeaderMapIn on the main thread.
+		int32_t									mPendingResultCode;
+		bool									mbHeadersPending;      // Network thread. Headers were parsed and are not queued to the main thread yet.
+		bool									mbHeadersQueued;       // Network thread. Headers were queued; later header callbacks are ignored.
+		bool									mbRecvDone;            // Network thread. The final receive result was queued.
+		bool									mbAddedToNetworkThread;
+		bool									mbShutdown;            // Set by ShutdownJob. The network thread then releases the job back to the main thread, which frees it.
+		bool									mbHeadersReady;        // Main thread. Headers are waiting to be passed to the TransportServer.
+		bool									mbTransferDone;        // Main thread. mTransferResult is the final receive result.
+		int32_t									mTransferResult;
+		NetworkChunk*							mpReadyHead;           // Main thread. Data waiting to be passed to the TransportServer.
+		NetworkChunk*							mpReadyTail;
+
+		// Main thread. See HttpConnectionPool. mOrigin is empty unless the request holds a connection of mConnectionPool.
+		HttpConnectionPool::OriginString		mOrigin;
+		bool									mbKeepAliveRequested;
+		bool									mbPipelined;
+		bool									mbHttp11Response;      // Set with the response headers, on the network thread for its jobs.
+
 		DirtySDKInfo();
 		~DirtySDKInfo();
 
 	};
 	
 	bool SetupHttpManager(HttpManagerRefT*& pHttpManager, bool syncJobs = false);
-	void SetupStreamDecompressor(EA::WebKit::TransportInfo* pTInfo);
+	void SetupStreamDecompressor(EA::WebKit::TransportInfo* pTInfo, const EASTLHeaderMapWrapper& headerMapIn);
+	void LockHttpManager(const EA::WebKit::TransportInfo* pTInfo);
+	void UnlockHttpManager(const EA::WebKit::TransportInfo* pTInfo);
+	int32_t GetHttpManagerStatus(const EA::WebKit::TransportInfo* pTInfo, HttpManagerRefT* pHttpManager, int32_t iSelect, void* pBuffer, int32_t iBufSize);
+	void ProcessNetworkMessages();
+	void DeliverNetworkResults(EA::WebKit::TransportInfo* pTInfo, DirtySDKInfo* pDirtySDKInfo);
+	void DestroyDirtySDKInfo(DirtySDKInfo* pDirtySDKInfo);
+	void ReleaseConnection(EA::WebKit::TransportInfo* pTInfo, DirtySDKInfo* pDirtySDKInfo, bool bSucceeded);
 
     HttpManagerRefT* mpHttpManager;
 	HttpManagerRefT* mpHttpManagerSyncJobs; //We create a Http Manager instead of a new ref each time. This keeps code clean and probably also more efficient if lot of requests are made over the time.
 	uint8_t* mSharedDecompressionBuffer;
+	NetworkThread* mpNetworkThread;   // Runs mpHttpManager if Parameters::mHttpTransportThreadEnabled is set. NULL otherwise.
 	int mActiveSchemesCount;
+	HttpConnectionPool mConnectionPool;   // Keep-alive and pipelining decisions for the jobs of mpHttpManager.
 
     
 #ifdef _DEBUG
@@ -46,6 +46,13 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // Made system use max-age or expires values versus a 5 hour default.
 // Added a shared buffer for blocking reads.
 
+// Update:
+// Replaced the ini file index with a binary index made of an append-only journal that is
+// compacted only when it grows well past the live entry count. Old ini files are migrated on Init.
+// Moved cache file reads, writes and checksums to a background IO thread when the application
+// provides a thread system.
+// Identical resources cached under different URLs now share one file named after a hash of its contents.
+
 #include "config.h"
 #include "TransportHandlerDiskCacheEA.h"
 #include "SharedBuffer.h"
@@ -56,6 +63,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <EAIO/EAFileBase.h>
 #include <EAIO/EAFileUtil.h>
 #include <EAIO/EAFileDirectory.h>
+#include <EASTL/sort.h>
 #include <internal/include/EAWebKitString.h>
 #include <internal/include/EAWebKitAssert.h>
 #include <internal/include/EAWebKitEASTLHelpers.h>
@@ -67,6 +75,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <EAIO/FnEncode.h>
 #include "SystemTime.h"
 #include <EAWebKit/EAWebKitFileSystem.h>
+#include <EAWebKit/EAWebKitThreadInterface.h>
 #include <internal/include/EAWebkit_p.h>
 
 
@@ -91,7 +100,12 @@ const uint32_t   kDefaultFileCacheSize                 = 1000000 * 3;        //
 const uint32_t   kDefaultExpirationTimeSeconds         = 60 * 60 * 5;        // 5 hours
 const bool       kDefaultKeepExpired                   = false;
 const char16_t*  kDefaultCacheDirectoryName            = EA_CHAR16("cache\\"); 
-const char16_t*  kDefaultIniFileName                   = EA_CHAR16("FileCache.ini");
+const char16_t*  kDefaultIniFileName                   = EA_CHAR16("FileCache.ini");  // Legacy text index. Only read to migrate to the binary index.
+const char16_t*  kDefaultIndexFileName                 = EA_CHAR16("FileCache.idx");
+const uint32_t   kCacheIndexMagic                      = 0x49435745;          // 'EWCI'
+const uint32_t   kCacheIndexVersion                    = 1;                   // Change version # if format changes.
+const uint32_t   kCacheIndexHeaderSize                 = 8;                   // Magic + version
+const uint32_t   kCacheIndexMinRecordsToCompact        = 256;                 // Don't bother compacting small journals.
 const char8_t*   kDefaultIniFileSection                = "Cache Entries: V 1.01.00"; // Change version # if format changes. 
 const char8_t*   kCacheLineEntry                       = "Cache Entry:";      // Each line
 const char8_t*   kCacheChecksum                        = "Cache Checksum:";   // Each line
@@ -105,6 +119,8 @@ const int32_t    kMaxOpenFiles                         = 24;                   /
 const uint32_t   kMaxFileCount                         = 2048;                // Limit the amount of files that can be cached in the cache dir  + 1 for the ini file
 const uint32_t   kCacheDownloadBufferSize              = 1024 * 64;           // Shared download buffer size  
 const uint32_t   kCacheDownloadBufferAlign             = 16;                  // Shared download buffer alignment  
+const uint32_t   kMaxReadyChunksPerJob                 = 4;                   // Read-ahead limit of the IO thread per job (in kCacheDownloadBufferSize chunks)
+const uint32_t   kMaxFreeReadChunks                    = 8;                   // Number of chunk buffers the IO thread keeps around for reuse
 
 // THREAD_SAFE_CALL / THREAD_SAFE_INNER_CALL
 // 
@@ -187,6 +203,19 @@ static uint32_t GetByteChecksum(const char* buffer, const int32_t size, const ui
     return sum;
 }
 
+// 64 bit FNV-1a hash of a whole resource. Unlike GetByteChecksum, this is meant to tell 
+// resources apart, so it is used to name content addressed cache files.
+static uint64_t GetContentHash(const char* buffer, const uint32_t size)
+{
+    uint64_t hash = UINT64_C(14695981039346656037);
+    for(uint32_t i = 0; i < size; i++)
+    {
+        hash ^= (uint8_t)buffer[i];
+        hash *= UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
 // Converts a value to a string 
 static char16_t* EAIOItoa16(uint32_t value, char16_t* buffer)
 {
@@ -201,6 +230,88 @@ static char16_t* EAIOItoa16(uint32_t value, char16_t* buffer)
 }
 
 
+// Binary cache index records.
+//
+// Every record is: uint8 type, uint32 payload size, payload, uint32 checksum of the payload.
+// Integers are little endian. Strings are a uint32 length followed by UTF8 bytes with no terminator.
+// A record with a bad size or checksum ends the journal; everything before it is kept.
+enum CacheIndexRecordType
+{
+    kCacheIndexRecordAdd    = 1,    // Key, file name, MIME type and all Info fields.
+    kCacheIndexRecordRemove = 2,    // Key.
+    kCacheIndexRecordTouch  = 3     // Key and time last used.
+};
+
+static void IndexWriteU32(eastl::vector<char, EASTLAllocator>& buffer, uint32_t value)
+{
+    buffer.push_back((char)(value));
+    buffer.push_back((char)(value >> 8));
+    buffer.push_back((char)(value >> 16));
+    buffer.push_back((char)(value >> 24));
+}
+
+static void IndexWriteString(eastl::vector<char, EASTLAllocator>& buffer, const char8_t* pString, uint32_t length)
+{
+    IndexWriteU32(buffer, length);
+    buffer.insert(buffer.end(), pString, pString + length);
+}
+
+class CacheIndexReader
+{
+public:
+    CacheIndexReader(const char* pData, int64_t size)
+        : mpCurrent((const uint8_t*)pData)
+        , mpEnd((const uint8_t*)pData + size)
+    {
+    }
+
+    bool        AtEnd() const           { return mpCurrent >= mpEnd; }
+    uint32_t    Remaining() const       { return (uint32_t)(mpEnd - mpCurrent); }
+    const char* Current() const         { return (const char*)mpCurrent; }
+    void        Skip(uint32_t size)     { mpCurrent += size; }
+
+    bool ReadU8(uint8_t& value)
+    {
+        if(Remaining() < 1)
+            return false;
+        value = *mpCurrent++;
+        return true;
+    }
+
+    bool ReadU32(uint32_t& value)
+    {
+        if(Remaining() < 4)
+            return false;
+        value = (uint32_t)mpCurrent[0] | ((uint32_t)mpCurrent[1] << 8) | ((uint32_t)mpCurrent[2] << 16) | ((uint32_t)mpCurrent[3] << 24);
+        mpCurrent += 4;
+        return true;
+    }
+
+    bool ReadString(EA::WebKit::FixedString8_128& value)
+    {
+        uint32_t length = 0;
+        if(!ReadU32(length) || (Remaining() < length))
+            return false;
+        value.assign((const char8_t*)mpCurrent, (const char8_t*)mpCurrent + length);
+        mpCurrent += length;
+        return true;
+    }
+
+private:
+    const uint8_t* mpCurrent;
+    const uint8_t* mpEnd;
+};
+
+// Orders DataMap iterators by the time their entry was last used.
+struct CacheEntryTimeLastUsedLess
+{
+    template <typename Iterator>
+    bool operator()(const Iterator& a, const Iterator& b) const
+    {
+        return (*a).second.mnTimeLastUsed < (*b).second.mnTimeLastUsed;
+    }
+};
+
 // Grabbed this from EAIO but changed so does not create files but just checks if they exist
 bool MakeTempPathName(char16_t* pPath, const char16_t* pDirectory, const char16_t* pFileName, const char16_t* pExtension)
 {
@@ -519,6 +630,460 @@ bool CacheResponseHeaderInfo::SetDirectivesFromHeader(const EA::WebKit::Transpor
     return m_ShouldCacheToDisk;
 }
 
+/*********Implementation of TransportHandlerDiskCache::IOThread***************/
+
+// A cache file write handed to the IO thread. The main thread keeps the cache entry pending
+// until the write comes back through TakeCompletedWrites.
+struct TransportHandlerDiskCache::WriteRequest
+{
+    EA::WebKit::FixedString8_128    msKey;
+    EA::WebKit::FixedString16_128   msCachedFileName;
+    EA::WebKit::FixedString8_256    msPath;
+    char*                           mpData;
+    uint32_t                        mnDataSize;
+    uint32_t                        mnChecksum;     // Computed by the IO thread.
+    bool                            mbSuccess;
+    WriteRequest*                   mpNext;
+
+    WriteRequest()
+        : mpData(0)
+        , mnDataSize(0)
+        , mnChecksum(0)
+        , mbSuccess(false)
+        , mpNext(0)
+    {
+    }
+};
+
+// IOThread
+//
+// A single background thread that does the file reads, writes and checksums of the disk cache.
+// Writes are done first since a pending write holds a copy of the resource in memory. Reads are 
+// done one chunk at a time, round-robin across jobs, with a small read-ahead limit per job.
+// All queues are protected by one mutex. The one condition is broadcast whenever anything changes;
+// the IO thread waits on it for work and the main thread waits on it in CancelRead and WaitForIdle.
+class TransportHandlerDiskCache::IOThread
+{
+public:
+    IOThread()
+        : mpThreadSystem(NULL)
+        , mpThread(NULL)
+        , mpMutex(NULL)
+        , mpCondition(NULL)
+        , mpReadHead(NULL)
+        , mpReadTail(NULL)
+        , mpCurrentRead(NULL)
+        , mpWriteHead(NULL)
+        , mpWriteTail(NULL)
+        , mpCompletedWrites(NULL)
+        , mpFreeChunks(NULL)
+        , mnFreeChunkCount(0)
+        , mbWriting(false)
+        , mbStop(false)
+    {
+    }
+
+    ~IOThread()
+    {
+        Stop();
+    }
+
+    bool Start()
+    {
+        mpThreadSystem = GetThreadSystem();
+
+        // A thread system that can't create threads reports kThreadIdInvalid (see DefaultThreadSystem::CurrentThreadId).
+        if(!mpThreadSystem || (mpThreadSystem->CurrentThreadId() == EA::WebKit::kThreadIdInvalid))
+            return false;
+
+        mpMutex     = mpThreadSystem->CreateAMutex();
+        mpCondition = mpThreadSystem->CreateAThreadCondition();
+        mpThread    = mpThreadSystem->CreateAThread();
+        if(mpMutex && mpCondition && mpThread)
+        {
+            if(mpThread->Begin(ThreadFunction, this) != EA::WebKit::kThreadIdInvalid)
+            {
+                mpThread->SetName("EAWebKit disk cache IO");
+                return true;
+            }
+        }
+
+        Destroy();
+        return false;
+    }
+
+    void Stop()
+    {
+        if(mpThread)
+        {
+            mpMutex->Lock();
+            mbStop = true;
+            mpCondition->Signal(true);
+            mpMutex->Unlock();
+
+            intptr_t result = 0;
+            mpThread->WaitForEnd(&result);
+        }
+        Destroy();
+    }
+
+    // Reads
+
+    void QueueRead(FileInfo* pFileInfo)
+    {
+        mpMutex->Lock();
+        EAW_ASSERT(!pFileInfo->mbReadQueued);
+        pFileInfo->mbReadQueued = true;
+        PushRead(pFileInfo);
+        mpCondition->Signal(true);
+        mpMutex->Unlock();
+    }
+
+    // Detaches the chunks read so far. The job is requeued if the IO thread stopped because of the read-ahead limit.
+    ReadChunk* TakeReadChunks(FileInfo* pFileInfo, bool& bDone, bool& bError)
+    {
+        mpMutex->Lock();
+        ReadChunk* pChunks = pFileInfo->mpReadyHead;
+        pFileInfo->mpReadyHead  = NULL;
+        pFileInfo->mpReadyTail  = NULL;
+        pFileInfo->mnReadyCount = 0;
+        bDone  = pFileInfo->mbReadDone;
+        bError = pFileInfo->mbReadError;
+
+        if(!pFileInfo->mbReadQueued && !bDone && !bError && !pFileInfo->mbReadCancel)
+        {
+            pFileInfo->mbReadQueued = true;
+            PushRead(pFileInfo);
+            mpCondition->Signal(true);
+        }
+        mpMutex->Unlock();
+        return pChunks;
+    }
+
+    // Makes sure the IO thread no longer references the job. Blocks for at most one chunk read.
+    void CancelRead(FileInfo* pFileInfo)
+    {
+        mpMutex->Lock();
+        pFileInfo->mbReadCancel = true;
+
+        if(pFileInfo->mbReadQueued && (mpCurrentRead != pFileInfo))
+        {
+            RemoveRead(pFileInfo);
+            pFileInfo->mbReadQueued = false;
+        }
+
+        while(pFileInfo->mbReadQueued)
+            mpCondition->Wait(mpMutex);
+
+        ReadChunk* pChunks = pFileInfo->mpReadyHead;
+        pFileInfo->mpReadyHead  = NULL;
+        pFileInfo->mpReadyTail  = NULL;
+        pFileInfo->mnReadyCount = 0;
+        FreeChunksLocked(pChunks);
+        mpMutex->Unlock();
+    }
+
+    void FreeReadChunks(ReadChunk* pChunks)
+    {
+        if(pChunks)
+        {
+            mpMutex->Lock();
+            FreeChunksLocked(pChunks);
+            mpMutex->Unlock();
+        }
+    }
+
+    // Writes
+
+    void QueueWrite(WriteRequest* pRequest)
+    {
+        mpMutex->Lock();
+        pRequest->mpNext = NULL;
+        if(mpWriteTail)
+            mpWriteTail->mpNext = pRequest;
+        else
+            mpWriteHead = pRequest;
+        mpWriteTail = pRequest;
+        mpCondition->Signal(true);
+        mpMutex->Unlock();
+    }
+
+    // Returns the completed writes in completion order.
+    WriteRequest* TakeCompletedWrites()
+    {
+        mpMutex->Lock();
+        WriteRequest* pReversed = mpCompletedWrites;
+        mpCompletedWrites = NULL;
+        mpMutex->Unlock();
+
+        WriteRequest* pCompleted = NULL;
+        while(pReversed)
+        {
+            WriteRequest* pNext = pReversed->mpNext;
+            pReversed->mpNext = pCompleted;
+            pCompleted = pReversed;
+            pReversed = pNext;
+        }
+        return pCompleted;
+    }
+
+    // Blocks until every queued write is done.
+    void WaitForIdle()
+    {
+        mpMutex->Lock();
+        while(mpWriteHead || mbWriting)
+            mpCondition->Wait(mpMutex);
+        mpMutex->Unlock();
+    }
+
+    static void FreeWriteRequest(WriteRequest* pRequest)
+    {
+        EAWEBKIT_DELETE[] pRequest->mpData;
+        EAWEBKIT_DELETE pRequest;
+    }
+
+private:
+    static void* ThreadFunction(void* pContext)
+    {
+        static_cast<IOThread*>(pContext)->Run();
+        return NULL;
+    }
+
+    void Run()
+    {
+        mpMutex->Lock();
+        while(!mbStop)
+        {
+            if(mpWriteHead)
+            {
+                WriteRequest* pRequest = mpWriteHead;
+                mpWriteHead = pRequest->mpNext;
+                if(!mpWriteHead)
+                    mpWriteTail = NULL;
+                mbWriting = true;
+
+                mpMutex->Unlock();
+                DoWrite(pRequest);
+                mpMutex->Lock();
+
+                pRequest->mpNext = mpCompletedWrites;
+                mpCompletedWrites = pRequest;
+                mbWriting = false;
+                mpCondition->Signal(true);
+            }
+            else if(mpReadHead)
+            {
+                FileInfo* pFileInfo = mpReadHead;
+                mpReadHead = pFileInfo->mpNextQueued;
+                if(!mpReadHead)
+                    mpReadTail = NULL;
+                pFileInfo->mpNextQueued = NULL;
+
+                ReadChunk* pChunk = AllocateChunkLocked();
+                mpCurrentRead = pFileInfo;
+
+                mpMutex->Unlock();
+                int64_t size = FileSystem::kSizeTypeError;
+                FileSystem* pFS = GetFileSystem();
+                if(pChunk && pFS)
+                {
+                    size = pFS->ReadFile(pFileInfo->mFileObject, pChunk->mpData, kCacheDownloadBufferSize);
+                    if(size > 0)
+                        pFileInfo->mCurChecksum = GetByteChecksum(pChunk->mpData, (int32_t)size, pFileInfo->mCurChecksum);
+                }
+                mpMutex->Lock();
+
+                mpCurrentRead = NULL;
+                if(size > 0)
+                {
+                    pChunk->mnSize = size;
+                    pChunk->mpNext = NULL;
+                    if(pFileInfo->mpReadyTail)
+                        pFileInfo->mpReadyTail->mpNext = pChunk;
+                    else
+                        pFileInfo->mpReadyHead = pChunk;
+                    pFileInfo->mpReadyTail = pChunk;
+                    pFileInfo->mnReadyCount++;
+                }
+                else
+                {
+                    FreeChunksLocked(pChunk);
+                    if(size == 0)
+                        pFileInfo->mbReadDone = true;
+                    else
+                        pFileInfo->mbReadError = true;
+                }
+
+                // Keep going round-robin unless finished, cancelled or far enough ahead of the main thread.
+                if(!pFileInfo->mbReadDone && !pFileInfo->mbReadError && !pFileInfo->mbReadCancel && (pFileInfo->mnReadyCount < kMaxReadyChunksPerJob))
+                    PushRead(pFileInfo);
+                else
+                    pFileInfo->mbReadQueued = false;
+
+                mpCondition->Signal(true);
+            }
+            else
+            {
+                mpCondition->Wait(mpMutex);
+            }
+        }
+        mpMutex->Unlock();
+    }
+
+    void DoWrite(WriteRequest* pRequest)
+    {
+        pRequest->mnChecksum = GetByteChecksum(pRequest->mpData, (int32_t)pRequest->mnDataSize, 0);
+
+        FileSystem* pFS = GetFileSystem();
+        if(pFS)
+        {
+            FileSystem::FileObject fileObject = pFS->CreateFileObject();
+            if(fileObject != FileSystem::kFileObjectInvalid)
+            {
+                if(pFS->OpenFile(fileObject, pRequest->msPath.c_str(), FileSystem::kWrite, FileSystem::kCDOCreateAlways))
+                {
+                    pRequest->mbSuccess = pFS->WriteFile(fileObject, pRequest->mpData, pRequest->mnDataSize);
+                    pFS->CloseFile(fileObject);
+                }
+                pFS->DestroyFileObject(fileObject);
+            }
+        }
+    }
+
+    void PushRead(FileInfo* pFileInfo)
+    {
+        pFileInfo->mpNextQueued = NULL;
+        if(mpReadTail)
+            mpReadTail->mpNextQueued = pFileInfo;
+        else
+            mpReadHead = pFileInfo;
+        mpReadTail = pFileInfo;
+    }
+
+    void RemoveRead(FileInfo* pFileInfo)
+    {
+        FileInfo* pPrev = NULL;
+        for(FileInfo* pCur = mpReadHead; pCur; pPrev = pCur, pCur = pCur->mpNextQueued)
+        {
+            if(pCur == pFileInfo)
+            {
+                if(pPrev)
+                    pPrev->mpNextQueued = pCur->mpNextQueued;
+                else
+                    mpReadHead = pCur->mpNextQueued;
+                if(mpReadTail == pCur)
+                    mpReadTail = pPrev;
+                pCur->mpNextQueued = NULL;
+                break;
+            }
+        }
+    }
+
+    ReadChunk* AllocateChunkLocked()
+    {
+        if(mpFreeChunks)
+        {
+            ReadChunk* pChunk = mpFreeChunks;
+            mpFreeChunks = pChunk->mpNext;
+            mnFreeChunkCount--;
+            return pChunk;
+        }
+
+        Allocator* pAllocator = GetAllocator();
+        ReadChunk* pChunk = (ReadChunk*)pAllocator->Malloc(sizeof(ReadChunk), 0, "EAWebKit/TransportHandlerDiskCache");
+        if(pChunk)
+        {
+            pChunk->mpNext = NULL;
+            pChunk->mnSize = 0;
+            pChunk->mpData = (char*)pAllocator->MallocAligned(kCacheDownloadBufferSize, kCacheDownloadBufferAlign, 0, 0, "Cache file read chunk");
+            if(!pChunk->mpData)
+            {
+                pAllocator->Free(pChunk, sizeof(ReadChunk));
+                pChunk = NULL;
+            }
+        }
+        return pChunk;
+    }
+
+    void FreeChunksLocked(ReadChunk* pChunks)
+    {
+        Allocator* pAllocator = GetAllocator();
+        while(pChunks)
+        {
+            ReadChunk* pNext = pChunks->mpNext;
+            if(mnFreeChunkCount < kMaxFreeReadChunks)
+            {
+                pChunks->mpNext = mpFreeChunks;
+                mpFreeChunks = pChunks;
+                mnFreeChunkCount++;
+            }
+            else
+            {
+                pAllocator->Free(pChunks->mpData, 0);
+                pAllocator->Free(pChunks, sizeof(ReadChunk));
+            }
+            pChunks = pNext;
+        }
+    }
+
+    void Destroy()
+    {
+        // Only called when the thread is not running, so no locking.
+        while(mpWriteHead)
+        {
+            WriteRequest* pNext = mpWriteHead->mpNext;
+            FreeWriteRequest(mpWriteHead);
+            mpWriteHead = pNext;
+        }
+        mpWriteTail = NULL;
+
+        while(mpCompletedWrites)
+        {
+            WriteRequest* pNext = mpCompletedWrites->mpNext;
+            FreeWriteRequest(mpCompletedWrites);
+            mpCompletedWrites = pNext;
+        }
+
+        Allocator* pAllocator = GetAllocator();
+        while(mpFreeChunks)
+        {
+            ReadChunk* pNext = mpFreeChunks->mpNext;
+            pAllocator->Free(mpFreeChunks->mpData, 0);
+            pAllocator->Free(mpFreeChunks, sizeof(ReadChunk));
+            mpFreeChunks = pNext;
+        }
+        mnFreeChunkCount = 0;
+
+        if(mpThreadSystem)
+        {
+            if(mpThread)
+                mpThreadSystem->DestroyAThread(mpThread);
+            if(mpCondition)
+                mpThreadSystem->DestroyAThreadCondition(mpCondition);
+            if(mpMutex)
+                mpThreadSystem->DestroyAMutex(mpMutex);
+        }
+        mpThread    = NULL;
+        mpCondition = NULL;
+        mpMutex     = NULL;
+    }
+
+    IThreadSystem*      mpThreadSystem;
+    IThread*            mpThread;
+    IMutex*             mpMutex;
+    IThreadCondition*   mpCondition;
+    FileInfo*           mpReadHead;         // Jobs waiting for their next chunk to be read.
+    FileInfo*           mpReadTail;
+    FileInfo*           mpCurrentRead;      // Job being read with the mutex unlocked.
+    WriteRequest*       mpWriteHead;        // Writes waiting to be done.
+    WriteRequest*       mpWriteTail;
+    WriteRequest*       mpCompletedWrites;  // Writes done, most recent first.
+    ReadChunk*          mpFreeChunks;
+    uint32_t            mnFreeChunkCount;
+    bool                mbWriting;          // A write is being done with the mutex unlocked.
+    bool                mbStop;
+};
+
 /*****************Implementation of TransportHandlerDiskCache*****************/
 
 uint32_t TransportHandlerDiskCache::sMaxJobCount = kMaxOpenFiles;
@@ -533,7 +1098,25 @@ TransportHandlerDiskCache::TransportHandlerDiskCache()
   , mbEnabled(false)
   , msCacheDirectory ()
   , msIniFileName(kDefaultIniFileName)
+  , msIndexFileName(kDefaultIndexFileName)
+  , mIndexFileObject(FileSystem::kFileObjectInvalid)
+  , mnIndexFileSize(0)
+  , mnIndexRecordCount(0)
+  , mnIndexFlushTime(0)
+  , mIndexBuffer()
+  , mpIOThread(0)
+  , mbAsyncIO(false)
+  , mnAsyncReadCount(0)
+  , mnFileNameSequence(0)
   , mDataMap()
+  , mpLRUHead(0)
+  , mpLRUTail(0)
+  , mExpiryHeap()
+  , mFileRefMap()
+  , mbShareIdenticalFiles(true)
+  , mnLinkedFileCount(0)
+  , mnLinkedDataSize(0)
+  , mnLinkedResourceSize(0)
   , mbKeepExpired ( kDefaultKeepExpired )
   , mnMaxFileCacheSize ( kDefaultFileCacheSize )
   , mnDefaultExpirationTimeSeconds ( kDefaultExpirationTimeSeconds )
@@ -546,6 +1129,11 @@ TransportHandlerDiskCache::TransportHandlerDiskCache()
 TransportHandlerDiskCache::~TransportHandlerDiskCache()
 {
     Shutdown(NULL);
+    if(mpIOThread)
+    {
+        EAWEBKIT_DELETE mpIOThread;
+        mpIOThread = 0;
+    }
 //    EAW_ASSERT(TransportHandlerDiskCache::sOpenFileCount == 0);
 //    EAW_ASSERT(TransportHandlerDiskCache::sOpenJobCount == 0);
 
@@ -591,23 +1179,71 @@ bool TransportHandlerDiskCache::Init(const char16_t* pScheme)
                 EAW_ASSERT_MSG(bReturnValue, "TransportHandlerDiskCache::Init(): Unable to create cache directory.");
             }
 
-            ReadCacheIniFile();
+            const bool bIndexRead = ReadCacheIndexFile();
+            if(!bIndexRead)
+                ReadCacheIniFile();     // Migrate the index of an older version, if any.
+
             RemoveUnusedCachedFiles();
+            RebuildCacheIndex();
             mbInitialized = true;     
+
+            // Keep appending to the existing journal unless it needs to be rewritten.
+            if(!bIndexRead || CacheIndexNeedsCompaction() || !OpenCacheIndexFile())
+                CompactCacheIndexFile();
+
+            if(!bIndexRead)
+                RemoveCacheIniFile();
+
+            StartIOThread();
         }
     }
 
     return bReturnValue;
 }
 
+void TransportHandlerDiskCache::StartIOThread()
+{
+    if(mbAsyncIO && !mpIOThread)
+    {
+        mpIOThread = EAWEBKIT_NEW("DiskCacheIOThread") IOThread();
+        if(!mpIOThread->Start())
+        {
+            EAWEBKIT_DELETE mpIOThread;     // No thread support. Fall back to synchronous file IO.
+            mpIOThread = 0;
+        }
+    }
+}
+
+void TransportHandlerDiskCache::StopIOThread()
+{
+    EAW_ASSERT(mnAsyncReadCount == 0);
+
+    if(mpIOThread)
+    {
+        mpIOThread->WaitForIdle();
+        ProcessCompletedWrites();
+        EAWEBKIT_DELETE mpIOThread;         // Joins the thread.
+        mpIOThread = 0;
+    }
+}
+
 bool TransportHandlerDiskCache::Shutdown(const char16_t* /*pScheme*/)
 {
     THREAD_SAFE_CALL;
 
     if(mbInitialized)
     {
+        if(mpIOThread)
+        {
+            // Commit whatever is still being written so it survives the restart.
+            mpIOThread->WaitForIdle();
+            ProcessCompletedWrites();
+        }
         DoPeriodicCacheMaintenance();
-        UpdateCacheIniFile();
+        FlushCacheIndexFile();
+        if(CacheIndexNeedsCompaction())
+            CompactCacheIndexFile();
+        CloseCacheIndexFile();
         ClearCacheMap();
         mbInitialized = false;
     }
@@ -656,7 +1292,8 @@ bool TransportHandlerDiskCache::InitJob(TransportInfo* pTInfo, bool& bStateCompl
         DataMap::iterator iter = mDataMap.find( uri8 );
         if (iter != mDataMap.end() )
         {
-            const Info& cacheFileInfo = iter->second;
+            Info& cacheFileInfo = iter->second;
+            TouchCacheEntry(cacheFileInfo);
 
             EA::IO::Path::PathString16 sFilePath(msCacheDirectory.c_str());
             EA::IO::Path::Join(sFilePath, cacheFileInfo.msCachedFileName.c_str() );
@@ -727,6 +1364,9 @@ bool TransportHandlerDiskCache::Connect(TransportInfo* pTInfo, bool& bStateCompl
             if(pFS->OpenFile(pFileInfo->mFileObject, GetFixedString(pTInfo->mPath)->c_str(), FileSystem::kRead, FileSystem::kCDOOpenExisting))
             {
                 TransportHandlerDiskCache::sOpenFileCount++;    // Keep track of number of open files            
+                pFileInfo->mbAsync = (mpIOThread != 0) && mbAsyncIO;
+                if(pFileInfo->mbAsync)
+                    mnAsyncReadCount++;
                 bReturnValue = true;
             }
             else
@@ -753,6 +1393,16 @@ bool TransportHandlerDiskCache::Disconnect(TransportInfo* pTInfo, bool& bStateCo
         FileSystem* pFS = GetFileSystem();
         EAW_ASSERT(pFS != NULL);
 
+        // The IO thread must be done with the file before it is closed.
+        if(pFileInfo->mbAsync)
+        {
+            if(mpIOThread)
+                mpIOThread->CancelRead(pFileInfo);
+            pFileInfo->mbAsync = false;
+            EAW_ASSERT(mnAsyncReadCount > 0);
+            mnAsyncReadCount--;
+        }
+
         if(pFS)
         {
             pFS->CloseFile(pFileInfo->mFileObject);
@@ -777,6 +1427,9 @@ bool TransportHandlerDiskCache::Transfer(TransportInfo* pTInfo, bool& bStateComp
 
     FileInfo* pFileInfo = (FileInfo*)pTInfo->mTransportHandlerData;
     EAW_ASSERT(pFileInfo != NULL);
+
+    if(pFileInfo->mbAsync && mpIOThread)
+        return TransferAsync(pTInfo, pFileInfo, bStateComplete);
     
     char* pBuffer = GetCacheDownloadBuffer();
     if((pFileInfo->mFileObject != FileSystem::kFileObjectInvalid) && (pBuffer))
@@ -828,33 +1481,7 @@ bool TransportHandlerDiskCache::Transfer(TransportInfo* pTInfo, bool& bStateComp
             {
                 // Completed read
                 bStateComplete = true;
-                
-                // Verify that the checksum is ok
-                EA::WebKit::FixedString8_128 uri8;
-                EA::WebKit::ConvertToString8(*GetFixedString(pTInfo->mURI), uri8);
-                DataMap::iterator iter = mDataMap.find( uri8 );
-                if (iter != mDataMap.end() )
-                {
-                    const Info& cacheFileInfo = iter->second;
-                    if(pFileInfo->mCurChecksum == cacheFileInfo.mnChecksum)
-                    {
-                         bResult = true;    // No errors
-                    }
-                    else
-                    {
-                         bResult = false;    // Errors - Might need a way to tell it to retry using http
-                        
-                         // Remove this file from cache since checksum was suspect
-                        InvalidateCachedDataIfRequired(pTInfo);
-                    }
-                }
-                else
-                {
-                    // We would not expect this as if we are caching a file, we should have the 
-                    // cache info available.
-                    EAW_ASSERT(0);
-                     bResult = false;    // Errors                    
-                }
+                bResult = VerifyTransferChecksum(pTInfo, pFileInfo->mCurChecksum);
             }
             else
             {
@@ -883,29 +1510,162 @@ bool TransportHandlerDiskCache::Transfer(TransportInfo* pTInfo, bool& bStateComp
     return true;
 }
 
-void TransportHandlerDiskCache::InvalidateCachedDataIfRequired(const EA::WebKit::TransportInfo* pTInfo)
+// Delivers whatever the IO thread has read so far. Never blocks on file IO.
+bool TransportHandlerDiskCache::TransferAsync(TransportInfo* pTInfo, FileInfo* pFileInfo, bool& bStateComplete)
 {
-    if(!mbEnabled)
-        return;
+    using namespace EA::WebKit;
 
-    //Some HTTP methods MUST cause a cache to invalidate an entity. This is either 
-    //the entity referred to by the Request-URI, or by the Location or 
-    //Content-Location headers (if present). These methods are: POST, PUT, DELETE.
+    bool bResult = true;
 
-	bool invalidate = (	pTInfo->mHttpRequestType == EA::WebKit::kHttpRequestTypePOST ||
-						pTInfo->mHttpRequestType == EA::WebKit::kHttpRequestTypePUT ||
-						pTInfo->mHttpRequestType == EA::WebKit::kHttpRequestTypeDELETE );
-    if(invalidate)
+    if(pFileInfo->mFileObject != FileSystem::kFileObjectInvalid)
     {
-        EA::WebKit::FixedString8_128 uri8;
-		EA::WebKit::ConvertToString8(*GetFixedString(pTInfo->mURI), uri8);
-        DataMap::iterator iter = mDataMap.find( uri8 );
-        if (iter != mDataMap.end() )
+        if(pFileInfo->mFileSize < 0) // If this is the first time through...
         {
-            const Info& cacheFileInfo = iter->second;
-            RemoveCachedFile(cacheFileInfo.msCachedFileName.c_str());
-            mDataMap.erase(iter);
+            FileSystem* pFS = GetFileSystem();
+            EAW_ASSERT(pFS != NULL);
+
+            pFileInfo->mFileSize = pFS->GetFileSize(pFileInfo->mFileObject);
+            pTInfo->mpTransportServer->SetExpectedLength(pTInfo, pFileInfo->mFileSize);
+            mpIOThread->QueueRead(pFileInfo);
+            return true;
+        }
+
+        bool bDone  = false;
+        bool bError = false;
+        ReadChunk* pChunks = mpIOThread->TakeReadChunks(pFileInfo, bDone, bError);
+        for(ReadChunk* pChunk = pChunks; pChunk; pChunk = pChunk->mpNext)
+            pTInfo->mpTransportServer->DataReceived(pTInfo, pChunk->mpData, pChunk->mnSize);
+        mpIOThread->FreeReadChunks(pChunks);
+
+        if(bError)
+        {
+            bStateComplete = true;
+            bResult        = false;
         }
+        else if(bDone)
+        {
+            // The IO thread no longer touches mCurChecksum once it has flagged the read as done.
+            bStateComplete = true;
+            bResult = VerifyTransferChecksum(pTInfo, pFileInfo->mCurChecksum);
+        }
+    }
+    else
+    {
+        bStateComplete = true;
+        bResult        = false;
+    }
+
+    // For now, set it to either 200 (OK) or 404 (not found).
+    if(bResult)
+        pTInfo->mResultCode = 200;
+    else
+        pTInfo->mResultCode = 404;
+
+    if(bStateComplete)
+        pTInfo->mpTransportServer->DataDone(pTInfo, bResult);
+
+    return true;
+}
+
+bool TransportHandlerDiskCache::VerifyTransferChecksum(TransportInfo* pTInfo, uint32_t checksum)
+{
+    // Verify that the checksum is ok
+    EA::WebKit::FixedString8_128 uri8;
+    EA::WebKit::ConvertToString8(*GetFixedString(pTInfo->mURI), uri8);
+    DataMap::iterator iter = mDataMap.find( uri8 );
+    if (iter != mDataMap.end() )
+    {
+        const Info& cacheFileInfo = iter->second;
+        if(checksum == cacheFileInfo.mnChecksum)
+            return true;    // No errors
+
+        // Errors - Might need a way to tell it to retry using http
+        // Remove this file from cache since checksum was suspect
+        InvalidateCachedDataIfRequired(pTInfo);
+        return false;
+    }
+
+    // We would not expect this as if we are caching a file, we should have the 
+    // cache info available.
+    EAW_ASSERT(0);
+    return false;
+}
+
+bool TransportHandlerDiskCache::Tick()
+{
+    if(mpIOThread)
+    {
+        ProcessCompletedWrites();
+
+        // Async IO was turned off while files were still being read. Stop the thread once they are closed.
+        if(!mbAsyncIO && (mnAsyncReadCount == 0))
+            StopIOThread();
+    }
+    return true;
+}
+
+void TransportHandlerDiskCache::ProcessCompletedWrites()
+{
+    THREAD_SAFE_CALL;
+
+    WriteRequest* pRequest = mpIOThread->TakeCompletedWrites();
+    while(pRequest)
+    {
+        WriteRequest* pNext = pRequest->mpNext;
+
+        FileRefMap::iterator itRef = mFileRefMap.find(pRequest->msCachedFileName);
+        if(itRef != mFileRefMap.end())
+        {
+            (*itRef).second.mbWritePending = false;
+            (*itRef).second.mpWriteData = 0;
+        }
+
+        // The entry may have been removed or replaced while its file was being written.
+        DataMap::iterator it = mDataMap.find(pRequest->msKey);
+        const bool bOwnerFound = (it != mDataMap.end()) && ((*it).second.mnLocation & kCacheLocationPending) && ((*it).second.msCachedFileName == pRequest->msCachedFileName);
+        if(bOwnerFound)
+        {
+            if(pRequest->mbSuccess)
+            {
+                (*it).second.mnChecksum = pRequest->mnChecksum;
+                CommitCacheEntry(it);
+            }
+            else
+            {
+                EraseCachedData(it);    // Also removes a partially written file.
+            }
+        }
+
+        // Entries for identical resources that arrived during the write were waiting for this file.
+        if(mFileRefMap.find(pRequest->msCachedFileName) != mFileRefMap.end())
+            CommitSharedEntries(pRequest->msCachedFileName, pRequest->mbSuccess);
+        else if(!bOwnerFound)
+            RemoveCachedFile(pRequest->msCachedFileName.c_str());   // Nothing references the file any more.
+
+        IOThread::FreeWriteRequest(pRequest);
+        pRequest = pNext;
+    }
+}
+
+void TransportHandlerDiskCache::InvalidateCachedDataIfRequired(const EA::WebKit::TransportInfo* pTInfo)
+{
+    if(!mbEnabled)
+        return;
+
+    //Some HTTP methods MUST cause a cache to invalidate an entity. This is either 
+    //the entity referred to by the Request-URI, or by the Location or 
+    //Content-Location headers (if present). These methods are: POST, PUT, DELETE.
+
+	bool invalidate = (	pTInfo->mHttpRequestType == EA::WebKit::kHttpRequestTypePOST ||
+						pTInfo->mHttpRequestType == EA::WebKit::kHttpRequestTypePUT ||
+						pTInfo->mHttpRequestType == EA::WebKit::kHttpRequestTypeDELETE );
+    if(invalidate)
+    {
+        EA::WebKit::FixedString8_128 uri8;
+		EA::WebKit::ConvertToString8(*GetFixedString(pTInfo->mURI), uri8);
+        DataMap::iterator iter = mDataMap.find( uri8 );
+        if (iter != mDataMap.end() )
+            EraseCachedData(iter);
     }
 }
 
@@ -933,16 +1693,26 @@ void TransportHandlerDiskCache::CacheToDisk(const EA::WebKit::FixedString16_128&
     
     RemoveCachedData ( pKey ); // if we have something for this key already, purge it
 
-    Info& newInfo ( (*mDataMap.insert ( eastl::make_pair (  pKey, Info() ) ).first).second );
-    newInfo.mnDataSize     = 0;
+    DataMap::iterator itNew ( mDataMap.insert ( eastl::make_pair (  pKey, Info() ) ).first );
+    Info& newInfo ( (*itNew).second );
+    newInfo.mnDataSize     = fileSize;
     newInfo.mnLocation     = 0;
     newInfo.mnTimeoutSeconds = 0;
     newInfo.mnTimeCreated  = GetHTTPTime ();
     newInfo.mnTimeLastUsed = UINT32_MAX;    // trick so FindLRU will never find un-committed items
-    newInfo.mnTimeTimeout  = newInfo.mnTimeCreated;
     newInfo.msCachedFileName = uriFNameStr.c_str();
     newInfo.msMIMEContentType = mimeStr;
-    newInfo.mnChecksum = GetByteChecksum(requestData.data(), requestData.size(), 0);
+    if((cacheHeaderInfo.m_ExpiresFound) || (cacheHeaderInfo.m_MaxAgeFound))
+    {
+        newInfo.mnTimeoutSeconds = cacheHeaderInfo.m_MaxAge;
+    }
+    else
+    {
+        EAW_ASSERT(0);  // Should normally not get here
+        newInfo.mnTimeoutSeconds = kDefaultExpirationTimeSeconds;
+    }
+    newInfo.mnTimeTimeout  = newInfo.mnTimeCreated + newInfo.mnTimeoutSeconds;
+    newInfo.mnRevalidate = cacheHeaderInfo.m_RevalidateFound;
 
     bool validName = false;
     
@@ -952,7 +1722,17 @@ void TransportHandlerDiskCache::CacheToDisk(const EA::WebKit::FixedString16_128&
     if ( MIMEStringToMIMETypes( mimeStr.c_str(), mimeType, mimeSubtype, (uint32_t) mimeStr.size()) )
     {
         newInfo.msCachedFileName = uriFNameStr.c_str();
-        validName = GetNewCacheFileName ( mimeType, mimeSubtype, newInfo.msCachedFileName);
+        if(mbShareIdenticalFiles)
+        {
+            // If a different resource already has this content name, this one gets a file of its own.
+            GetContentCacheFileName ( mimeType, mimeSubtype, requestData.data(), fileSize, newInfo.msCachedFileName);
+            validName = CanShareContentFile(newInfo.msCachedFileName, requestData.data(), fileSize) ||
+                        GetNewCacheFileName ( mimeType, mimeSubtype, newInfo.msCachedFileName);
+        }
+        else
+        {
+            validName = GetNewCacheFileName ( mimeType, mimeSubtype, newInfo.msCachedFileName);
+        }
 	    tmp +=newInfo.msCachedFileName;
     }
     // Questions: Should we refuse if file name and path is too long?
@@ -964,42 +1744,70 @@ void TransportHandlerDiskCache::CacheToDisk(const EA::WebKit::FixedString16_128&
     FileSystem* pFS = GetFileSystem();
     if(pFS != NULL && validName)
     {
-        FileInfo fileInfo;
+        AddFileReference(newInfo);
+        FileRef& fileRef = mFileRefMap[newInfo.msCachedFileName];
 
-        fileInfo.mFileObject = pFS->CreateFileObject();
-        if(fileInfo.mFileObject != FileSystem::kFileObjectInvalid)
+        if(fileRef.mnLinkedCount)
         {
-            if(pFS->OpenFile(fileInfo.mFileObject, pathStr.c_str(), FileSystem::kWrite, FileSystem::kCDOCreateAlways))
-            {
-                bSuccess = pFS->WriteFile(fileInfo.mFileObject, requestData.data(), requestData.size());
-                pFS->CloseFile(fileInfo.mFileObject);
+            // An identical resource is already on disk. Just point this entry at its file.
+            newInfo.mnChecksum = GetByteChecksum(requestData.data(), fileSize, 0);
+            CommitCacheEntry(itNew);
+            bSuccess = true;
+        }
+        else if(fileRef.mbWritePending)
+        {
+            // An identical resource is being written. Wait for it; see CommitSharedEntries.
+            newInfo.mnChecksum = GetByteChecksum(requestData.data(), fileSize, 0);
+            newInfo.mnLocation = kCacheLocationPending;
+            bSuccess = true;
+        }
+        else if(mpIOThread && mbAsyncIO)
+        {
+            // Hand a copy of the data to the IO thread. The entry stays pending (so it can't be used
+            // or evicted) until ProcessCompletedWrites commits it.
+            WriteRequest* pRequest = EAWEBKIT_NEW("DiskCacheWriteRequest") WriteRequest();
+            pRequest->msKey            = pKey;
+            pRequest->msCachedFileName = newInfo.msCachedFileName;
+            pRequest->msPath           = pathStr.c_str();
+            pRequest->mnDataSize       = fileSize;
+            pRequest->mpData           = EAWEBKIT_NEW("DiskCacheWriteData") char[fileSize ? fileSize : 1];
+            memcpy(pRequest->mpData, requestData.data(), fileSize);
+
+            newInfo.mnLocation     = kCacheLocationPending;
+            fileRef.mbWritePending = true;
+            fileRef.mpWriteData    = pRequest->mpData;
+            mpIOThread->QueueWrite(pRequest);
+            bSuccess = true;
+        }
+        else
+        {
+            FileInfo fileInfo;
 
-                if(bSuccess)
+            fileInfo.mFileObject = pFS->CreateFileObject();
+            if(fileInfo.mFileObject != FileSystem::kFileObjectInvalid)
+            {
+                if(pFS->OpenFile(fileInfo.mFileObject, pathStr.c_str(), FileSystem::kWrite, FileSystem::kCDOCreateAlways))
                 {
-                    ++sCurFileCount;
-                    newInfo.mnLocation = kCacheLocationDisk;
-                    newInfo.mnDataSize = requestData.size();
-                    if((cacheHeaderInfo.m_ExpiresFound) || (cacheHeaderInfo.m_MaxAgeFound))
-                    {
+                    bSuccess = pFS->WriteFile(fileInfo.mFileObject, requestData.data(), requestData.size());
+                    pFS->CloseFile(fileInfo.mFileObject);
 
-                        newInfo.mnTimeoutSeconds = cacheHeaderInfo.m_MaxAge;
-                    }
-                    else
+                    if(bSuccess)
                     {
-                        EAW_ASSERT(0);  // Should normally not get here
-                        newInfo.mnTimeoutSeconds = kDefaultExpirationTimeSeconds;
+                        newInfo.mnChecksum = GetByteChecksum(requestData.data(), requestData.size(), 0);
+                        CommitCacheEntry(itNew);
                     }
-                    newInfo.mnTimeTimeout = newInfo.mnTimeCreated + newInfo.mnTimeoutSeconds;
-                    newInfo.mnTimeLastUsed  = GetHTTPTime ();
-                    newInfo.mnRevalidate = cacheHeaderInfo.m_RevalidateFound;
                 }
+                pFS->DestroyFileObject(fileInfo.mFileObject);
             }
-            pFS->DestroyFileObject(fileInfo.mFileObject);
         }
-    }
 
-    if ( !bSuccess )  // failed to write cache file, so erase the cache entry
-        mDataMap.erase( pKey );
+        if ( !bSuccess )  // failed to write cache file, so erase the cache entry (it was never linked)
+            EraseCachedData( itNew );
+    }
+    else
+    {
+        mDataMap.erase( itNew );
+    }
 
     if ( ++mnCacheAccessCountSinceLastMaintenance > kDefaultAccessCountBeforeMaintenance )
         DoPeriodicCacheMaintenance();
@@ -1076,8 +1884,7 @@ bool TransportHandlerDiskCache::IniFileCallbackFunction(const char16_t* /*pKey*/
                     {
                         EA::WebKit::FixedString8_128 sField8;
                         EA::WebKit::ConvertToString8(sFields[0], sField8);
-                        pFileCacheHandler->mDataMap.insert(DataMap::value_type(sField8, cacheInfo));
-                        ++sCurFileCount;                                            
+                        pFileCacheHandler->mDataMap.insert(DataMap::value_type(sField8, cacheInfo));   // Linked by RebuildCacheIndex.
                     }
                 }
                 else
@@ -1109,8 +1916,20 @@ bool TransportHandlerDiskCache::SetDiskCacheParams(const EA::WebKit::DiskCacheIn
 		SetMaxFileCount(diskCacheInfo.mMaxNumberOfCachedFiles);
 		SetMaxJobCount(diskCacheInfo.mMaxNumberOfOpenFiles);
 		SetMinFileSize(diskCacheInfo.mMinFileSizeToCache);
+		mbAsyncIO = GetParameters().mDiskCacheAsyncFileIO;
+		mbShareIdenticalFiles = GetParameters().mDiskCacheShareIdenticalFiles;
 	
 		UseFileCache(true);
+
+		// Init only starts the IO thread the first time, so apply a change of mDiskCacheAsyncFileIO here. New files are
+		// read and written synchronously right away; files the IO thread is reading keep it until they are closed (see Tick).
+		if(mbInitialized)
+		{
+			if(mbAsyncIO)
+				StartIOThread();
+			else if(mpIOThread && (mnAsyncReadCount == 0))
+				StopIOThread();
+		}
 	}
 
 	return createdDir && mbEnabled;
@@ -1123,6 +1942,12 @@ void TransportHandlerDiskCache::GetDiskCacheUsage(EA::WebKit::DiskCacheUsageInfo
 	diskCacheUsageInfo.mCurrentNumberOfOpenFiles = TransportHandlerDiskCache::sOpenFileCount;
 }
 
+void TransportHandlerDiskCache::GetDiskCacheSharingUsage(EA::WebKit::DiskCacheSharingUsageInfo& diskCacheSharingUsageInfo)
+{
+	diskCacheSharingUsageInfo.mCurrentNumberOfCachedResources = (uint32_t) mExpiryHeap.size();
+	diskCacheSharingUsageInfo.mSharedFileBytesSaved = (uint32_t) (mnLinkedResourceSize - mnLinkedDataSize);
+}
+
 void TransportHandlerDiskCache::SetDefaultExpirationTime(uint32_t nDefaultExpirationTimeSeconds)
 {
     // We don't worry about thread safety here, as this function is only to be 
@@ -1157,6 +1982,15 @@ bool TransportHandlerDiskCache::SetCacheDirectory(const char16_t* pCacheDirector
 
     if(pCacheDirectory[0])
     {
+        // Moving to another directory: save the index of the current one and let SetDiskCacheParams
+        // start again from the index of the new one, as the entries in memory point to files in the old one.
+        EA::WebKit::FixedString16_128 cacheDirectory(pCacheDirectory);
+        cacheDirectory.push_back(0);
+        if(!EA::IO::Path::EnsureTrailingSeparator(&cacheDirectory[0], EA::IO::kLengthNull))
+            cacheDirectory.pop_back();
+        if(mbInitialized && msCacheDirectory.comparei(cacheDirectory.c_str()) != 0)
+            Shutdown(NULL);
+
         // If we are going to change the cache directory, we may as well not leave
         // any cache files behind in the old cache directory.
         if(!msCacheDirectory.empty() && msCacheDirectory.comparei(pCacheDirectory) == 0)
@@ -1360,14 +2194,17 @@ void TransportHandlerDiskCache::ClearCache()
 
     mnCacheAccessCount++;
 
-    DataMap::iterator iter;
-    for(iter = mDataMap.begin(); iter != mDataMap.end(); ++iter)
+    // Files still being written are removed by ProcessCompletedWrites once their writes complete.
+    FileRefMap::iterator iter;
+    for(iter = mFileRefMap.begin(); iter != mFileRefMap.end(); ++iter)
     {
-        Info& cacheInfo = (*iter).second;
-        RemoveCachedFile(cacheInfo.msCachedFileName.c_str());
+        if(!(*iter).second.mbWritePending)
+            RemoveCachedFile((*iter).first.c_str());
     }
+    ClearCacheIndex();
     mDataMap.clear();
-    UpdateCacheIniFile();
+    mFileRefMap.clear();
+    CompactCacheIndexFile();
 }
 
 
@@ -1387,9 +2224,7 @@ bool TransportHandlerDiskCache::RemoveCachedData(const EA::WebKit::FixedString8_
 
     if(it != mDataMap.end()) // If the key is already in our data map...
     {
-        Info& cacheInfo = (*it).second;
-        RemoveCachedFile(cacheInfo.msCachedFileName.c_str());   // Remove the file if it is present.
-        mDataMap.erase(it);                                     // Just erase it and move on.
+        EraseCachedData(it);    // Remove the file if it is present and just erase it and move on.
         return true;
     }
 
@@ -1418,7 +2253,16 @@ bool TransportHandlerDiskCache::GetNewCacheFileName( int nMIMEType, int nMIMESub
 
     char16_t pFilePath[EA::IO::kMaxPathLength];
 
-    const bool bResult = MakeTempPathName(pFilePath, msCacheDirectory.c_str(), NULL, pExtension);
+    // Files being written by the IO thread don't exist yet, so FileExists alone can't keep their names unique.
+    char16_t pFileName[24] = { 't', 'e', 'm', 'p', 0 };
+    if(mpIOThread)
+    {
+        char16_t buffer[20];
+        EA::Internal::Strcat ( pFileName, EAIOItoa16(mnFileNameSequence++, buffer) );
+        EA::Internal::Strcat ( pFileName, EA_CHAR16("_") );
+    }
+
+    const bool bResult = MakeTempPathName(pFilePath, msCacheDirectory.c_str(), pFileName, pExtension);
 
     if ( bResult ) {
         // we know that the full path begins with the directory, so just copy the string after that
@@ -1428,101 +2272,552 @@ bool TransportHandlerDiskCache::GetNewCacheFileName( int nMIMEType, int nMIMESub
     return bResult;
 }
 
+// Names a cache file after its contents so that identical resources map to the same file.
+// The name holds a 64 bit hash and the size, which makes an accidental match vanishingly unlikely.
+// A match can still be crafted, so CanShareContentFile compares the contents before a file is shared.
+void TransportHandlerDiskCache::GetContentCacheFileName(int nMIMEType, int nMIMESubtype, const char* pData, uint32_t size, EA::WebKit::FixedString16_128& sFileName)
+{
+    static const char kHexDigits[] = "0123456789abcdef";
+
+    const uint64_t hash = GetContentHash(pData, size);
+
+    char16_t pName[32];
+    char16_t* pCur = pName;
+    *pCur++ = 'h';
+    for(int shift = 60; shift >= 0; shift -= 4)
+        *pCur++ = (char16_t)kHexDigits[(hash >> shift) & 0xf];
+    for(int shift = 28; shift >= 0; shift -= 4)
+        *pCur++ = (char16_t)kHexDigits[(size >> shift) & 0xf];
+    *pCur = 0;
+
+    char16_t pExtension[EA::IO::kMaxPathLength] = { '\0' };
+    MIMETypesToFileExtension ( MIMEType(nMIMEType), MIMEType(nMIMESubtype), pExtension, EA::IO::kMaxPathLength );
+
+    sFileName.assign(pName);
+    sFileName.append(pExtension);
+    sFileName.append(kCachedFileExtension);
+}
+
+// Returns true if a resource named sFileName by GetContentCacheFileName can use that file: either there is no
+// such file yet or it holds the same bytes. Otherwise a resource crafted to hash like another one would be served
+// in its place from the cache. The file is read back on this thread, which costs about what the write it saves does.
+bool TransportHandlerDiskCache::CanShareContentFile(const EA::WebKit::FixedString16_128& sFileName, const char* pData, uint32_t size)
+{
+    FileRefMap::const_iterator itRef = mFileRefMap.find(sFileName);
+    if(itRef == mFileRefMap.end())
+        return true;
+
+    // The name holds the size, so the data being written is as large as pData.
+    const FileRef& fileRef = (*itRef).second;
+    if(fileRef.mbWritePending)
+        return fileRef.mpWriteData && (memcmp(fileRef.mpWriteData, pData, size) == 0);
+    if(!fileRef.mnLinkedCount)
+        return true;    // Nothing complete on disk; the file gets written again.
+
+    FileSystem* pFS = GetFileSystem();
+    char* pBuffer = GetCacheDownloadBuffer();
+    if(!pFS || !pBuffer)
+        return false;
+
+    EA::WebKit::FixedString16_128 path16(msCacheDirectory);
+    path16 += sFileName;
+    EA::WebKit::FixedString8_128 path8;
+    EA::WebKit::ConvertToString8(path16, path8);
+
+    bool bSame = false;
+    EA::WebKit::FileSystem::FileObject fileObject = pFS->CreateFileObject();
+    if(fileObject != FileSystem::kFileObjectInvalid)
+    {
+        if(pFS->OpenFile(fileObject, path8.c_str(), FileSystem::kRead, FileSystem::kCDOOpenExisting))
+        {
+            bSame = (pFS->GetFileSize(fileObject) == (int64_t)size);
+            for(uint32_t offset = 0; bSame && (offset < size); )
+            {
+                const uint32_t readSize = ((size - offset) < kCacheDownloadBufferSize) ? (size - offset) : kCacheDownloadBufferSize;
+                bSame = (pFS->ReadFile(fileObject, pBuffer, readSize) == (int64_t)readSize) && (memcmp(pBuffer, pData + offset, readSize) == 0);
+                offset += readSize;
+            }
+            pFS->CloseFile(fileObject);
+        }
+        pFS->DestroyFileObject(fileObject);
+    }
+    return bSame;
+}
+
+void TransportHandlerDiskCache::AddFileReference(const Info& cacheInfo)
+{
+    ++mFileRefMap[cacheInfo.msCachedFileName].mnRefCount;
+}
+
+void TransportHandlerDiskCache::ReleaseFileReference(const Info& cacheInfo)
+{
+    FileRefMap::iterator it = mFileRefMap.find(cacheInfo.msCachedFileName);
+    if(it == mFileRefMap.end())
+        return;
+
+    FileRef& fileRef = (*it).second;
+    EAW_ASSERT(fileRef.mnRefCount > 0);
+    if(--fileRef.mnRefCount == 0)
+    {
+        // A pending write is left alone; ProcessCompletedWrites removes the file when it completes.
+        if(!fileRef.mbWritePending)
+            RemoveCachedFile(cacheInfo.msCachedFileName.c_str());
+        mFileRefMap.erase(it);
+    }
+}
+
+// Commits a pending entry whose file is complete on disk. mnDataSize and mnChecksum must be set.
+void TransportHandlerDiskCache::CommitCacheEntry(DataMap::iterator it)
+{
+    Info& cacheInfo = (*it).second;
+    cacheInfo.mnLocation     = kCacheLocationDisk;
+    cacheInfo.mnTimeLastUsed = GetHTTPTime ();
+
+    const uint32_t nLinkedFileCount = mnLinkedFileCount;
+    LinkCacheEntry(it);
+    if(mnLinkedFileCount != nLinkedFileCount)  // Not sharing an existing file.
+        ++sCurFileCount;
+
+    AppendCacheIndexRecord(kCacheIndexRecordAdd, (*it).first, &cacheInfo);
+}
+
+// Commits (or drops, if the write failed) the pending entries that were waiting for another entry's
+// write of the same file. This scans the map, but only runs when identical resources were cached
+// while the file was being written.
+void TransportHandlerDiskCache::CommitSharedEntries(const EA::WebKit::FixedString16_128& sFileName, bool bSuccess)
+{
+    FileRefMap::iterator itRef = mFileRefMap.find(sFileName);
+    if((itRef == mFileRefMap.end()) || ((*itRef).second.mnRefCount == (*itRef).second.mnLinkedCount))
+        return;
+
+    for(DataMap::iterator it = mDataMap.begin(); it != mDataMap.end(); )
+    {
+        DataMap::iterator itNext = it;
+        ++itNext;
+
+        Info& cacheInfo = (*it).second;
+        if((cacheInfo.mnLocation & kCacheLocationPending) && (cacheInfo.msCachedFileName == sFileName))
+        {
+            if(bSuccess)
+                CommitCacheEntry(it);
+            else
+                EraseCachedData(it);
+        }
+        it = itNext;
+    }
+}
+
 void TransportHandlerDiskCache::ClearCacheMap()
 {
+    ClearCacheIndex();
     mDataMap.clear();
+    mFileRefMap.clear();
 }
 
 
 
-// UpdateCacheIniFile
-//
-// This function is normally called upon shutting down an instance of this class.
-//   CA: started calling this from DoPeriodicCacheMaintenance to avoid ini file being out of
-//   date on non-clean exit
-//
-bool TransportHandlerDiskCache::UpdateCacheIniFile()
+void TransportHandlerDiskCache::GetCacheIndexFilePath(EA::WebKit::FixedString8_256& path8) const
 {
-    // Writes our cache information to the ini file used to store it.
-    THREAD_SAFE_INNER_CALL;
-
-    bool returnFlag = false;
+    EA::WebKit::FixedString16_256 path16(msCacheDirectory.c_str()); 
+    path16.append(msIndexFileName.c_str(), msIndexFileName.size());
+    EA::WebKit::ConvertToString8(path16, path8);
+}
 
+bool TransportHandlerDiskCache::ReadCacheIndexFile()
+{
+    // Reads the binary index with a single mapping (or a single read if the file system can't map)
+    // and replays its journal into mDataMap. Returns false if there is no usable index.
     if(!mbEnabled)
-        return returnFlag;
+        return false;
 
-    // Access file
     FileSystem* pFS = GetFileSystem();
     if(!pFS)
-        return returnFlag;
+        return false;
 
-  
-    // Build Path with file name    
-    EA::WebKit::FixedString16_256 path16(msCacheDirectory.c_str()); 
-    EA::WebKit::FixedString16_256 name16(msIniFileName.c_str()); 
-    path16.append(name16);
-    EA::WebKit::FixedString8_256 path8;    
-    EA::WebKit::ConvertToString8(path16, path8);
-        
-    // Remove old ini file    
-    pFS->RemoveFile(path8.c_str());
-    
-    // Create new one
-    EA::WebKit::FileSystem::FileObject fileObject = pFS->CreateFileObject();
-    if(fileObject != FileSystem::kFileObjectInvalid)
+    EA::WebKit::FixedString8_256 path8;
+    GetCacheIndexFilePath(path8);
+
+    bool bResult = false;
+    int64_t numBytes = 0;
+    const void* pMappedData = pFS->MapFile(path8.c_str(), numBytes);
+    if(pMappedData)
     {
-        if(pFS->OpenFile(fileObject, path8.c_str(), FileSystem::kWrite, FileSystem::kCDOCreateAlways))
-        {    
-            
-            // Add in title header
-            EA::WebKit::FixedString8_64 title;
-            title.sprintf("%s\n",kDefaultIniFileSection);
-            uint32_t checksum = 0;
-            checksum = GetByteChecksum(title.c_str(), title.length(), checksum);
-            pFS->WriteFile(fileObject,title.c_str(),title.length());                
+        bResult = ParseCacheIndex((const char*)pMappedData, numBytes);
+        pFS->UnmapFile(pMappedData, numBytes);
+    }
+    else if(pFS->GetFileSize(path8.c_str(), numBytes) && (numBytes > 0))
+    {
+        EA::WebKit::FileSystem::FileObject fileObject = pFS->CreateFileObject();
+        if(fileObject != FileSystem::kFileObjectInvalid)
+        {
+            if(pFS->OpenFile(fileObject, path8.c_str(), FileSystem::kRead, FileSystem::kCDOOpenExisting))
+            {
+                char* pFileBuffer = EAWEBKIT_NEW("CacheIndexBuffer") char[(size_t)numBytes];
+                const int64_t readSize = pFS->ReadFile(fileObject, pFileBuffer, numBytes);
+                pFS->CloseFile(fileObject);
+
+                if(readSize == numBytes)
+                    bResult = ParseCacheIndex(pFileBuffer, numBytes);
+
+                EAWEBKIT_DELETE[] pFileBuffer;
+            }
+            pFS->DestroyFileObject(fileObject);
+        }
+    }
+
+    return bResult;
+}
+
+bool TransportHandlerDiskCache::ParseCacheIndex(const char* pData, int64_t size)
+{
+    // Entries are only inserted here. Validation and linking is done by RebuildCacheIndex once all records are applied.
+    CacheIndexReader reader(pData, size);
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    if(!reader.ReadU32(magic) || (magic != kCacheIndexMagic) || !reader.ReadU32(version) || (version != kCacheIndexVersion))
+        return false;
+
+    mnIndexRecordCount = 0;
+    mnIndexFileSize    = kCacheIndexHeaderSize;
+
+    EA::WebKit::FixedString8_128 key;
+    EA::WebKit::FixedString8_128 fileName8;
+    EA::WebKit::FixedString16_128 fileName16;
+
+    while(!reader.AtEnd())
+    {
+        uint8_t  recordType  = 0;
+        uint32_t payloadSize = 0;
+        uint32_t checksum    = 0;
+
+        if(!reader.ReadU8(recordType) || !reader.ReadU32(payloadSize) || (payloadSize > reader.Remaining()) || ((reader.Remaining() - payloadSize) < 4))
+            break;  // Torn write at the end of the journal.
 
+        const char* pPayload = reader.Current();
+        reader.Skip(payloadSize);
+        reader.ReadU32(checksum);
+        if(checksum != GetByteChecksum(pPayload, (int32_t)payloadSize, 0))
+            break;
 
-            // Add in each cache entry.
-            // (Note: wondering if we should a hash key of the string instead of the full query string to save space)
-            for(DataMap::iterator it = mDataMap.begin(); it != mDataMap.end(); ++it) // For each hash map entry, add an ini file section for it.
+        CacheIndexReader payload(pPayload, payloadSize);
+        if(!payload.ReadString(key))
+            break;
+
+        bool bValid = true;
+        switch(recordType)
+        {
+            case kCacheIndexRecordAdd:
             {
-                const EA::WebKit::FixedString8_128& sKey = (*it).first;
-                Info& cacheInfo = (*it).second;
+                Info cacheInfo;
+                uint32_t revalidate = 0;
+                uint8_t  revalidate8 = 0;
+                uint32_t dataSize = 0;
+                bValid = payload.ReadString(fileName8) &&
+                         payload.ReadString(cacheInfo.msMIMEContentType) &&
+                         payload.ReadU32(dataSize) &&
+                         payload.ReadU32(cacheInfo.mnTimeoutSeconds) &&
+                         payload.ReadU32(cacheInfo.mnTimeCreated) &&
+                         payload.ReadU32(cacheInfo.mnTimeLastUsed) &&
+                         payload.ReadU32(cacheInfo.mnTimeTimeout) &&
+                         payload.ReadU32(cacheInfo.mnChecksum) &&
+                         payload.ReadU8(revalidate8);
+                if(bValid)
+                {
+                    revalidate = revalidate8;
+                    EA::WebKit::ConvertToString16(fileName8, fileName16);
+                    cacheInfo.msCachedFileName = fileName16;
+                    cacheInfo.mnDataSize       = dataSize;
+                    cacheInfo.mnLocation       = kCacheLocationDisk;
+                    cacheInfo.mnRevalidate     = (revalidate != 0);
+                    mDataMap[key] = cacheInfo;
+                }
+                break;
+            }
+
+            case kCacheIndexRecordRemove:
+                mDataMap.erase(key);
+                break;
 
-                if( ( cacheInfo.mnLocation & kCacheLocationDisk ) != 0 ) // only write about things on disk
+            case kCacheIndexRecordTouch:
+            {
+                uint32_t timeLastUsed = 0;
+                bValid = payload.ReadU32(timeLastUsed);
+                if(bValid)
                 {
-                           
-                    EA::WebKit::FixedString8_256 line;
-                    EA::WebKit::FixedString16_256 conv16(cacheInfo.msCachedFileName.c_str());
-                    EA::WebKit::FixedString8_256 conv8;
-                    EA::WebKit::ConvertToString8(conv16, conv8);
-                    line.sprintf("%s%s,%s,%s,%u,%u,%u,%u,%u,%u,%u\n",
-                        kCacheLineEntry,sKey.c_str(),
-                        conv8.c_str(),
-                        cacheInfo.msMIMEContentType.c_str(),    
-                        cacheInfo.mnDataSize,
-                        cacheInfo.mnTimeoutSeconds,
-                        cacheInfo.mnTimeCreated,
-                        cacheInfo.mnTimeLastUsed,
-                        cacheInfo.mnTimeTimeout,
-                        cacheInfo.mnChecksum,
-                        cacheInfo.mnRevalidate);
-                
-                    checksum = GetByteChecksum(line.c_str(), line.length(), checksum);
-                    pFS->WriteFile(fileObject,line.c_str(),line.length());                   
+                    DataMap::iterator it = mDataMap.find(key);
+                    if(it != mDataMap.end())
+                        (*it).second.mnTimeLastUsed = timeLastUsed;
                 }
+                break;
             }
 
-            // File Checksum
-            EA::WebKit::FixedString8_64 fileChecksum;
-            fileChecksum.sprintf("%s%u",kCacheChecksum,checksum);
-            pFS->WriteFile(fileObject,fileChecksum.c_str(),fileChecksum.length());                   
-            pFS->CloseFile(fileObject);
-            returnFlag = true;      // Consider as success 
+            default:
+                bValid = false;
+                break;
+        }
+
+        if(!bValid)
+            break;
+
+        ++mnIndexRecordCount;
+        mnIndexFileSize = size - reader.Remaining();
+    }
+
+    // If we stopped early, mnIndexFileSize won't match the file size and OpenCacheIndexFile will force a compaction.
+    return true;
+}
+
+void TransportHandlerDiskCache::RebuildCacheIndex()
+{
+    // Validates every entry in mDataMap and links the survivors into the LRU list and expiry heap,
+    // oldest first so that the LRU order survives a restart.
+    typedef eastl::vector<DataMap::iterator, EASTLAllocator> IteratorVector;
+    typedef eastl::vector<FixedString16_128, EASTLAllocator> FileNameVector;
+
+    ClearCacheIndex();
+    mFileRefMap.clear();
+
+    const uint32_t nTimeNow = (uint32_t)GetHTTPTime();
+    IteratorVector entries;
+    FileNameVector removedFiles;    // Files of dropped entries. A shared file may still be used by a valid entry.
+    entries.reserve(mDataMap.size());
+
+    for(DataMap::iterator it = mDataMap.begin(); it != mDataMap.end(); )
+    {
+        Info& cacheInfo = (*it).second;
+
+        if(cacheInfo.mnTimeCreated > nTimeNow)  // Just fix the error.
+            cacheInfo.mnTimeCreated = nTimeNow;
+
+        if(cacheInfo.mnTimeLastUsed > nTimeNow) // Just fix the error
+            cacheInfo.mnTimeLastUsed = nTimeNow;
+
+        if((cacheInfo.mnDataSize > kMaxPracticalFileSize) || (cacheInfo.mnTimeTimeout <= nTimeNow))
+        {
+            removedFiles.push_back(cacheInfo.msCachedFileName);
+            it = mDataMap.erase(it);
         }
-        pFS->DestroyFileObject(fileObject);        
+        else
+        {
+            AddFileReference(cacheInfo);
+            entries.push_back(it);
+            ++it;
+        }
+    }
+
+    eastl::sort(removedFiles.begin(), removedFiles.end());
+    for(eastl_size_t i = 0; i < removedFiles.size(); i++)
+    {
+        const bool bDuplicate = (i > 0) && (removedFiles[i] == removedFiles[i - 1]);
+        if(!bDuplicate && (mFileRefMap.find(removedFiles[i]) == mFileRefMap.end()))
+            RemoveCachedFile(removedFiles[i].c_str());
     }
-    return returnFlag;
+
+    eastl::sort(entries.begin(), entries.end(), CacheEntryTimeLastUsedLess());
+
+    for(IteratorVector::iterator it = entries.begin(); it != entries.end(); ++it)
+        LinkCacheEntry(*it);
+
+    sCurFileCount = mnLinkedFileCount;
+}
+
+bool TransportHandlerDiskCache::OpenCacheIndexFile()
+{
+    // Opens the existing index for appending. Fails if the file on disk does not match what we read
+    // (torn tail, or a file system that does not keep contents), in which case the caller compacts.
+    THREAD_SAFE_INNER_CALL;
+
+    CloseCacheIndexFile();
+
+    FileSystem* pFS = GetFileSystem();
+    if(!pFS || !mbEnabled)
+        return false;
+
+    EA::WebKit::FixedString8_256 path8;
+    GetCacheIndexFilePath(path8);
+
+    mIndexFileObject = pFS->CreateFileObject();
+    if(mIndexFileObject != FileSystem::kFileObjectInvalid)
+    {
+        if(pFS->OpenFile(mIndexFileObject, path8.c_str(), FileSystem::kWrite, FileSystem::kCDOOpenAlways))
+        {
+            if((pFS->GetFileSize(mIndexFileObject) == mnIndexFileSize) && pFS->SetFilePosition(mIndexFileObject, mnIndexFileSize))
+            {
+                mnIndexFlushTime = (uint32_t)GetHTTPTime();
+                return true;
+            }
+            pFS->CloseFile(mIndexFileObject);
+        }
+        pFS->DestroyFileObject(mIndexFileObject);
+        mIndexFileObject = FileSystem::kFileObjectInvalid;
+    }
+    return false;
+}
+
+void TransportHandlerDiskCache::CloseCacheIndexFile()
+{
+    if(mIndexFileObject != FileSystem::kFileObjectInvalid)
+    {
+        FileSystem* pFS = GetFileSystem();
+        if(pFS)
+        {
+            pFS->CloseFile(mIndexFileObject);
+            pFS->DestroyFileObject(mIndexFileObject);
+        }
+        mIndexFileObject = FileSystem::kFileObjectInvalid;
+    }
+}
+
+bool TransportHandlerDiskCache::CacheIndexNeedsCompaction() const
+{
+    return (mnIndexRecordCount > kCacheIndexMinRecordsToCompact) && (mnIndexRecordCount > ((uint32_t)mExpiryHeap.size() * 2));
+}
+
+bool TransportHandlerDiskCache::CompactCacheIndexFile()
+{
+    // Rewrites the index with a single add record per committed entry, in LRU order, 
+    // and leaves it open for appending.
+    THREAD_SAFE_INNER_CALL;
+
+    CloseCacheIndexFile();
+
+    if(!mbEnabled)
+        return false;
+
+    FileSystem* pFS = GetFileSystem();
+    if(!pFS)
+        return false;
+
+    EA::WebKit::FixedString8_256 path8;
+    GetCacheIndexFilePath(path8);
+
+    mIndexFileObject = pFS->CreateFileObject();
+    if(mIndexFileObject == FileSystem::kFileObjectInvalid)
+        return false;
+
+    if(!pFS->OpenFile(mIndexFileObject, path8.c_str(), FileSystem::kWrite, FileSystem::kCDOCreateAlways))
+    {
+        pFS->DestroyFileObject(mIndexFileObject);
+        mIndexFileObject = FileSystem::kFileObjectInvalid;
+        return false;
+    }
+
+    mIndexBuffer.clear();
+    IndexWriteU32(mIndexBuffer, kCacheIndexMagic);
+    IndexWriteU32(mIndexBuffer, kCacheIndexVersion);
+    bool bResult = pFS->WriteFile(mIndexFileObject, mIndexBuffer.data(), (int64_t)mIndexBuffer.size());
+    mnIndexFileSize    = (int64_t)mIndexBuffer.size();
+    mnIndexRecordCount = 0;
+    mnIndexFlushTime   = (uint32_t)GetHTTPTime();
+
+    for(Info* pInfo = mpLRUHead; pInfo && bResult; pInfo = pInfo->mpLRUNext)
+        bResult = AppendCacheIndexRecord(kCacheIndexRecordAdd, *pInfo->mpKey, pInfo);
+
+    pFS->FlushFile(mIndexFileObject);
+
+    if(!bResult)
+        CloseCacheIndexFile();
+
+    return bResult;
+}
+
+bool TransportHandlerDiskCache::AppendCacheIndexRecord(uint8_t recordType, const EA::WebKit::FixedString8_128& key, const Info* pInfo)
+{
+    if(mIndexFileObject == FileSystem::kFileObjectInvalid)
+        return false;
+
+    FileSystem* pFS = GetFileSystem();
+    if(!pFS)
+        return false;
+
+    // Reserve the record header, write the payload and then patch the payload size in.
+    const uint32_t kRecordHeaderSize = 5;
+    mIndexBuffer.resize(kRecordHeaderSize);
+    IndexWriteString(mIndexBuffer, key.c_str(), (uint32_t)key.size());
+
+    switch(recordType)
+    {
+        case kCacheIndexRecordAdd:
+        {
+            EAW_ASSERT(pInfo);
+            EA::WebKit::FixedString16_128 fileName16(pInfo->msCachedFileName.c_str());
+            EA::WebKit::FixedString8_128 fileName8;
+            EA::WebKit::ConvertToString8(fileName16, fileName8);
+
+            IndexWriteString(mIndexBuffer, fileName8.c_str(), (uint32_t)fileName8.size());
+            IndexWriteString(mIndexBuffer, pInfo->msMIMEContentType.c_str(), (uint32_t)pInfo->msMIMEContentType.size());
+            IndexWriteU32(mIndexBuffer, (uint32_t)pInfo->mnDataSize);
+            IndexWriteU32(mIndexBuffer, pInfo->mnTimeoutSeconds);
+            IndexWriteU32(mIndexBuffer, pInfo->mnTimeCreated);
+            IndexWriteU32(mIndexBuffer, pInfo->mnTimeLastUsed);
+            IndexWriteU32(mIndexBuffer, pInfo->mnTimeTimeout);
+            IndexWriteU32(mIndexBuffer, pInfo->mnChecksum);
+            mIndexBuffer.push_back(pInfo->mnRevalidate ? 1 : 0);
+            break;
+        }
+
+        case kCacheIndexRecordTouch:
+            EAW_ASSERT(pInfo);
+            IndexWriteU32(mIndexBuffer, pInfo->mnTimeLastUsed);
+            break;
+
+        default:
+            break;
+    }
+
+    const uint32_t payloadSize = (uint32_t)mIndexBuffer.size() - kRecordHeaderSize;
+    const uint32_t checksum    = GetByteChecksum(mIndexBuffer.data() + kRecordHeaderSize, (int32_t)payloadSize, 0);
+    IndexWriteU32(mIndexBuffer, checksum);
+
+    mIndexBuffer[0] = (char)recordType;
+    mIndexBuffer[1] = (char)(payloadSize);
+    mIndexBuffer[2] = (char)(payloadSize >> 8);
+    mIndexBuffer[3] = (char)(payloadSize >> 16);
+    mIndexBuffer[4] = (char)(payloadSize >> 24);
+
+    if(!pFS->WriteFile(mIndexFileObject, mIndexBuffer.data(), (int64_t)mIndexBuffer.size()))
+    {
+        // The journal is now suspect. Stop appending; the index is rewritten on shutdown.
+        CloseCacheIndexFile();
+        mnIndexRecordCount = kCacheIndexMinRecordsToCompact + ((uint32_t)mExpiryHeap.size() * 2) + 1;
+        return false;
+    }
+
+    mnIndexFileSize += (int64_t)mIndexBuffer.size();
+    ++mnIndexRecordCount;
+    return true;
+}
+
+void TransportHandlerDiskCache::FlushCacheIndexFile()
+{
+    // Writes touch records for entries used since the last flush so that LRU order survives a restart.
+    // Those entries are at the tail of the LRU list, so we stop at the first older entry.
+    if(mIndexFileObject == FileSystem::kFileObjectInvalid)
+        return;
+
+    for(Info* pInfo = mpLRUTail; pInfo && (pInfo->mnTimeLastUsed >= mnIndexFlushTime); pInfo = pInfo->mpLRUPrev)
+    {
+        if(!AppendCacheIndexRecord(kCacheIndexRecordTouch, *pInfo->mpKey, pInfo))
+            return;
+    }
+    mnIndexFlushTime = (uint32_t)GetHTTPTime();
+
+    FileSystem* pFS = GetFileSystem();
+    if(pFS)
+        pFS->FlushFile(mIndexFileObject);
+}
+
+void TransportHandlerDiskCache::RemoveCacheIniFile()
+{
+    EA::WebKit::FixedString16_256 path16(msCacheDirectory.c_str()); 
+    path16.append(msIniFileName.c_str(), msIniFileName.size()); 
+    EA::WebKit::FixedString8_256 path8;    
+    EA::WebKit::ConvertToString8(path16, path8);
+
+    FileSystem* pFS = GetFileSystem();
+    if(pFS && pFS->FileExists(path8.c_str()))
+        pFS->RemoveFile(path8.c_str());
 }
 
 bool TransportHandlerDiskCache::ReadCacheIniFile()
@@ -1655,27 +2950,47 @@ bool TransportHandlerDiskCache::RemoveCachedFile(const char16_t* pFileName)
 bool TransportHandlerDiskCache::RemoveUnusedCachedFiles()
 {
     // Thread-safety not implemented here, as this is only called from init.
+    // Deletes cache files that are not in our map and drops map entries whose file is missing.
+    // Names are compared case insensitively through a lowercase hash so this is linear in the number of files.
+    typedef eastl::hash_map<FixedString16_128, bool, eastl::string_hash<FixedString16_128>, eastl::equal_to<FixedString16_128>, EASTLAllocator> FileNameMap;
+
     EA::IO::DirectoryIterator            directoryIterator;
     EA::IO::DirectoryIterator::EntryList entryList;
+    FileNameMap                          diskFiles;     // Lowercase name -> referenced by the map
 
-    if(directoryIterator.Read((msCacheDirectory.c_str()), entryList, (kSearchCachedFileExtension), EA::IO::kDirectoryEntryFile))
+    directoryIterator.Read((msCacheDirectory.c_str()), entryList, (kSearchCachedFileExtension), EA::IO::kDirectoryEntryFile);
+    for(EA::IO::DirectoryIterator::EntryList::iterator it = entryList.begin(); it != entryList.end(); ++it)
     {
-        for(EA::IO::DirectoryIterator::EntryList::iterator it = entryList.begin(); it != entryList.end(); ++it)
-        {
-            const EA::IO::DirectoryIterator::Entry& entry = *it;
-            DataMap::iterator itMap = mDataMap.begin();
-
-            for(; itMap != mDataMap.end(); ++itMap) // For each hash map entry, add an ini file section for it.
-            {
-                const Info& cacheInfo = (*itMap).second;
+        FixedString16_128 name((*it).msName.c_str());
+        name.make_lower();
+        diskFiles.insert(FileNameMap::value_type(name, false));
+    }
 
-                if(EA::Internal::Stricmp(cacheInfo.msCachedFileName.c_str(), (entry.msName.c_str())) == 0) // If the disk file is also in our cache map...
-                    break;
-            }
+    for(DataMap::iterator itMap = mDataMap.begin(); itMap != mDataMap.end(); )
+    {
+        FixedString16_128 name((*itMap).second.msCachedFileName);
+        name.make_lower();
 
-            if(itMap == mDataMap.end()) // If the file was not in our list...
-                RemoveCachedFile((entry.msName.c_str()));
+        FileNameMap::iterator itFile = diskFiles.find(name);
+        if(itFile != diskFiles.end())
+        {
+            (*itFile).second = true;
+            ++itMap;
         }
+        else
+        {
+            UnlinkCacheEntry((*itMap).second);
+            itMap = mDataMap.erase(itMap);   // The file is gone so the entry is useless.
+        }
+    }
+
+    for(EA::IO::DirectoryIterator::EntryList::iterator it = entryList.begin(); it != entryList.end(); ++it)
+    {
+        FixedString16_128 name((*it).msName.c_str());
+        name.make_lower();
+
+        if(!diskFiles[name]) // If the file was not in our list...
+            RemoveCachedFile((*it).msName.c_str());
     }
     return true;
 }
@@ -1685,20 +3000,179 @@ TransportHandlerDiskCache::DataMap::iterator TransportHandlerDiskCache::FindLRUI
 //   find oldest item in location
     THREAD_SAFE_INNER_CALL;
 
-    DataMap::iterator itCur(mDataMap.begin()), itEnd(mDataMap.end());
-    DataMap::iterator itSought ( itEnd );
-    uint32_t nOldestTime ( UINT32_MAX ); // Note: pending resources have last access == UINT32_MAX so they should never be chosen
-    for(; itCur!=itEnd; ++itCur) 
+    // The head of the LRU list is the oldest committed entry. Pending resources are never linked so they can't be chosen.
+    if(mpLRUHead)
     {
-    	Info& cacheInfo ( (*itCur).second );
-        if ( cacheInfo.mnTimeLastUsed < nOldestTime ) 
-        {
-            itSought = itCur;
-            nOldestTime = cacheInfo.mnTimeLastUsed;
-        }
+        EAW_ASSERT(mpLRUHead->mpKey);
+        return mDataMap.find(*mpLRUHead->mpKey);
+    }
+
+    return mDataMap.end();
+}
+
+void TransportHandlerDiskCache::EraseCachedData(DataMap::iterator it)
+{
+    Info& cacheInfo = (*it).second;
+    if(cacheInfo.mnExpiryHeapIndex != kExpiryHeapIndexInvalid)     // Only committed entries are in the index file.
+        AppendCacheIndexRecord(kCacheIndexRecordRemove, (*it).first, NULL);
+    UnlinkCacheEntry(cacheInfo);
+    ReleaseFileReference(cacheInfo);
+    mDataMap.erase(it);
+}
+
+// Adds a committed entry to the tail (most recently used end) of the LRU list and to the expiry heap.
+void TransportHandlerDiskCache::LinkCacheEntry(DataMap::iterator it)
+{
+    Info& cacheInfo = (*it).second;
+    EAW_ASSERT(cacheInfo.mnExpiryHeapIndex == kExpiryHeapIndexInvalid);
+    
+    cacheInfo.mpKey     = &(*it).first;
+    cacheInfo.mpLRUPrev = mpLRUTail;
+    cacheInfo.mpLRUNext = 0;
+    if(mpLRUTail)
+        mpLRUTail->mpLRUNext = &cacheInfo;
+    else
+        mpLRUHead = &cacheInfo;
+    mpLRUTail = &cacheInfo;
+
+    cacheInfo.mnExpiryHeapIndex = (uint32_t) mExpiryHeap.size();
+    mExpiryHeap.push_back(&cacheInfo);
+    ExpiryHeapSiftUp(cacheInfo.mnExpiryHeapIndex);
+
+    // Shared files count once against the size and file count limits.
+    if(mFileRefMap[cacheInfo.msCachedFileName].mnLinkedCount++ == 0)
+    {
+        ++mnLinkedFileCount;
+        mnLinkedDataSize += cacheInfo.mnDataSize;
+    }
+    mnLinkedResourceSize += cacheInfo.mnDataSize;
+}
+
+void TransportHandlerDiskCache::UnlinkCacheEntry(Info& cacheInfo)
+{
+    // Pending entries were never linked.
+    if(cacheInfo.mnExpiryHeapIndex == kExpiryHeapIndexInvalid)
+        return;
+
+    if(cacheInfo.mpLRUPrev)
+        cacheInfo.mpLRUPrev->mpLRUNext = cacheInfo.mpLRUNext;
+    else
+        mpLRUHead = cacheInfo.mpLRUNext;
+    if(cacheInfo.mpLRUNext)
+        cacheInfo.mpLRUNext->mpLRUPrev = cacheInfo.mpLRUPrev;
+    else
+        mpLRUTail = cacheInfo.mpLRUPrev;
+    cacheInfo.mpLRUPrev = 0;
+    cacheInfo.mpLRUNext = 0;
+
+    // Move the last heap element into the freed slot and restore the heap property from there.
+    const uint32_t index = cacheInfo.mnExpiryHeapIndex;
+    const uint32_t last  = (uint32_t) mExpiryHeap.size() - 1;
+    if(index != last)
+    {
+        ExpiryHeapSwap(index, last);
+        mExpiryHeap.pop_back();
+        ExpiryHeapSiftDown(index);
+        ExpiryHeapSiftUp(index);
+    }
+    else
+    {
+        mExpiryHeap.pop_back();
     }
+    cacheInfo.mnExpiryHeapIndex = kExpiryHeapIndexInvalid;
+    cacheInfo.mpKey = 0;
 
-    return itSought;
+    FileRefMap::iterator itRef = mFileRefMap.find(cacheInfo.msCachedFileName);
+    EAW_ASSERT((itRef != mFileRefMap.end()) && ((*itRef).second.mnLinkedCount > 0));
+    if((itRef != mFileRefMap.end()) && (--(*itRef).second.mnLinkedCount == 0))
+    {
+        EAW_ASSERT(mnLinkedFileCount > 0);
+        --mnLinkedFileCount;
+        mnLinkedDataSize -= cacheInfo.mnDataSize;
+    }
+    mnLinkedResourceSize -= cacheInfo.mnDataSize;
+}
+
+void TransportHandlerDiskCache::TouchCacheEntry(Info& cacheInfo)
+{
+    cacheInfo.mnTimeLastUsed = (uint32_t) GetHTTPTime();
+
+    if((cacheInfo.mnExpiryHeapIndex == kExpiryHeapIndexInvalid) || (&cacheInfo == mpLRUTail))
+        return;
+
+    // Move to the tail of the LRU list. The expiry heap does not depend on usage so it is left alone.
+    if(cacheInfo.mpLRUPrev)
+        cacheInfo.mpLRUPrev->mpLRUNext = cacheInfo.mpLRUNext;
+    else
+        mpLRUHead = cacheInfo.mpLRUNext;
+    cacheInfo.mpLRUNext->mpLRUPrev = cacheInfo.mpLRUPrev;   // Not the tail so mpLRUNext is non-null.
+
+    cacheInfo.mpLRUPrev = mpLRUTail;
+    cacheInfo.mpLRUNext = 0;
+    mpLRUTail->mpLRUNext = &cacheInfo;
+    mpLRUTail = &cacheInfo;
+}
+
+void TransportHandlerDiskCache::ClearCacheIndex()
+{
+    for(ExpiryHeap::iterator it = mExpiryHeap.begin(); it != mExpiryHeap.end(); ++it)
+    {
+        Info* pInfo = *it;
+        pInfo->mnExpiryHeapIndex = kExpiryHeapIndexInvalid;
+        pInfo->mpLRUPrev = 0;
+        pInfo->mpLRUNext = 0;
+        pInfo->mpKey = 0;
+    }
+    mExpiryHeap.clear();
+    mpLRUHead = 0;
+    mpLRUTail = 0;
+    mnLinkedFileCount = 0;
+    mnLinkedDataSize = 0;
+    mnLinkedResourceSize = 0;
+
+    for(FileRefMap::iterator it = mFileRefMap.begin(); it != mFileRefMap.end(); ++it)
+        (*it).second.mnLinkedCount = 0;
+}
+
+void TransportHandlerDiskCache::ExpiryHeapSwap(uint32_t a, uint32_t b)
+{
+    Info* pTemp = mExpiryHeap[a];
+    mExpiryHeap[a] = mExpiryHeap[b];
+    mExpiryHeap[b] = pTemp;
+    mExpiryHeap[a]->mnExpiryHeapIndex = a;
+    mExpiryHeap[b]->mnExpiryHeapIndex = b;
+}
+
+void TransportHandlerDiskCache::ExpiryHeapSiftUp(uint32_t index)
+{
+    while(index > 0)
+    {
+        const uint32_t parent = (index - 1) >> 1;
+        if(mExpiryHeap[parent]->mnTimeTimeout <= mExpiryHeap[index]->mnTimeTimeout)
+            break;
+        ExpiryHeapSwap(parent, index);
+        index = parent;
+    }
+}
+
+void TransportHandlerDiskCache::ExpiryHeapSiftDown(uint32_t index)
+{
+    const uint32_t size = (uint32_t) mExpiryHeap.size();
+    for(;;)
+    {
+        const uint32_t left  = (index << 1) + 1;
+        const uint32_t right = left + 1;
+        uint32_t smallest = index;
+
+        if((left < size) && (mExpiryHeap[left]->mnTimeTimeout < mExpiryHeap[smallest]->mnTimeTimeout))
+            smallest = left;
+        if((right < size) && (mExpiryHeap[right]->mnTimeTimeout < mExpiryHeap[smallest]->mnTimeTimeout))
+            smallest = right;
+        if(smallest == index)
+            break;
+        ExpiryHeapSwap(index, smallest);
+        index = smallest;
+    }
 }
 
 void TransportHandlerDiskCache::DoPeriodicCacheMaintenance()
@@ -1708,59 +3182,38 @@ void TransportHandlerDiskCache::DoPeriodicCacheMaintenance()
     if(!mbEnabled)
         return;
 
-    uint32_t fileCount =0;
-    EA::IO::size_type nFileCacheMemoryUsage = 0;
-      
     bool    bDiskFilesChanged = false; // should we update the ini file?
 
     mnCacheAccessCountSinceLastMaintenance = 0;
 
     if ( !mbKeepExpired ) {
-        // Need to check expiration dates of data map entries.
+        // Pop expired entries off the top of the expiry heap. Only committed entries are in the heap 
+        // so files that are still pending are never deleted here.
         const uint32_t nTimeNow = (uint32_t)GetHTTPTime();
 
-        for(DataMap::iterator it = mDataMap.begin(); it != mDataMap.end(); ) // For each hash map entry, add an ini file section for it.
+        while(!mExpiryHeap.empty() && (nTimeNow >= mExpiryHeap.front()->mnTimeTimeout))
         {
-            const Info& cacheInfo = (*it).second;
-
-            if ( (nTimeNow >= cacheInfo.mnTimeTimeout) 
-                && ( ( cacheInfo.mnLocation & kCacheLocationPending ) == 0 ) ) 
-                // If the cached item has expired...
-                // && don't delete files that have not been committed
-            {
-                if ( cacheInfo.mnLocation & kCacheLocationDisk ) {
-                    RemoveCachedFile(cacheInfo.msCachedFileName.c_str());   // Delete File cached data if present.
-                    bDiskFilesChanged = true;
-                }
-                it = mDataMap.erase(it);
-            }
-            else
-            {
-                if ( cacheInfo.mnLocation & kCacheLocationDisk )
-                {
-                    ++fileCount;
-                    nFileCacheMemoryUsage += cacheInfo.mnDataSize;
-                }
-                ++it;
-            }
+            DataMap::iterator it = mDataMap.find(*mExpiryHeap.front()->mpKey);
+            EAW_ASSERT(it != mDataMap.end());
+            if(it == mDataMap.end())
+                break; // shouldn't happen
+            
+            EraseCachedData(it);
+            bDiskFilesChanged = true;
         }
     }
 
     // OK, now we've purged any old files and know how much File 
     // space is being taken up by the cached data. We should do some purges
-    // of the first-expiring data if we are using up too much memory.
+    // of the least recently used data if we are using up too much memory.
 
-    while((nFileCacheMemoryUsage > mnMaxFileCacheSize) && (fileCount > mnMaxFileCount))
+    while((mnLinkedDataSize > mnMaxFileCacheSize) && (mnLinkedFileCount > mnMaxFileCount))
     {
         DataMap::iterator itLRU ( FindLRUItem() );
         if ( itLRU != mDataMap.end () ) 
         {
-            Info& cacheInfo ( (*itLRU).second );
-            RemoveCachedFile ( cacheInfo.msCachedFileName.c_str() );
+            EraseCachedData(itLRU);
             bDiskFilesChanged = true;
-            nFileCacheMemoryUsage -= cacheInfo.mnDataSize;
-            fileCount--;
-            mDataMap.erase ( itLRU );
         }
         else 
         {
@@ -1768,10 +3221,13 @@ void TransportHandlerDiskCache::DoPeriodicCacheMaintenance()
         }
     }
 
-    sCurFileCount = fileCount;
+    sCurFileCount = mnLinkedFileCount;
 
-    if ( bDiskFilesChanged )
-    	UpdateCacheIniFile();
+    // Removals were already journaled. Only rewrite the index when the journal has grown too large.
+    if ( bDiskFilesChanged && CacheIndexNeedsCompaction() )
+    	CompactCacheIndexFile();
+    else
+        FlushCacheIndexFile();
 }
 
 } //namespace WebKit
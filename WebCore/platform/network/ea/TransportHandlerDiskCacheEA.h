@@ -48,6 +48,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <EASTL/core_allocator_adapter.h>
 #include <EASTL/string.h>
 #include <EASTL/hash_map.h>
+#include <EASTL/vector.h>
 #include <EAIO/EAStream.h>
 #include <EAIO/EAStreamMemory.h>
 
@@ -116,6 +117,14 @@ namespace EA
         /// it implements a mutex to protect access via multiple threads. Otherwise thread
         /// safety is left up to the user.
         ///
+        /// If Parameters::mDiskCacheAsyncFileIO is set, cache file reads, writes and checksums are done
+        /// on a background IO thread. The class itself
+        /// is still only used from the main thread; results are picked up in Transfer and Tick.
+        ///
+        /// Cache files can be shared by several URLs (see Parameters::mDiskCacheShareIdenticalFiles). A shared
+        /// file is named after a hash of its contents, so URL keys map to a content file which is only
+        /// deleted once the last key referencing it is removed.
+        ///
 
         class TransportHandlerDiskCache : public TransportHandler
         {
@@ -130,9 +139,11 @@ namespace EA
             bool Connect    (TransportInfo* pTInfo, bool& bStateComplete);
             bool Disconnect (TransportInfo* pTInfo, bool& bStateComplete);
             bool Transfer   (TransportInfo* pTInfo, bool& bStateComplete);
+            bool Tick       ();
 
 			bool SetDiskCacheParams(const EA::WebKit::DiskCacheInfo& diskCacheInfo);
 			void GetDiskCacheUsage(EA::WebKit::DiskCacheUsageInfo& diskCacheInfo);
+			void GetDiskCacheSharingUsage(EA::WebKit::DiskCacheSharingUsageInfo& diskCacheSharingUsageInfo);
             // Some caching schemes involve keeping resources past their expiration dates, then asking the
             // server if they can still be used. If this is enabled, resources are only deleted when the
             // total size exceeds the limits set.
@@ -186,6 +197,19 @@ namespace EA
                 kCacheLocationPending = 0x4  // an entry for this key has been created, but not committed to the cache
             };
 
+            static const uint32_t kExpiryHeapIndexInvalid = 0xffffffff;
+
+            class IOThread;
+            struct WriteRequest;
+
+            /// A slice of a cache file read by the IO thread, waiting to be handed to the TransportServer.
+            struct ReadChunk
+            {
+                ReadChunk*          mpNext;
+                char*               mpData;
+                int64_t             mnSize;
+            };
+
             struct Info
             {
                 FixedString8_128        msMIMEContentType;      /// MIME type (if known) of cached resource
@@ -198,6 +222,29 @@ namespace EA
                 uint32_t            mnTimeTimeout;          /// The time of the timeout.
                 uint32_t            mnChecksum;             /// File checksum to detect corruption.
                 bool                mnRevalidate;           /// File must revalidate time before using.
+
+                // Index links. These are only valid while the entry is committed to disk (see LinkCacheEntry).
+                // They let eviction and expiration avoid scanning the whole DataMap.
+                const FixedString8_128* mpKey;              /// Key of this entry in mDataMap. Hash map nodes are stable so this stays valid while linked.
+                Info*               mpLRUPrev;              /// Previous (less recently used) entry in the LRU list.
+                Info*               mpLRUNext;              /// Next (more recently used) entry in the LRU list.
+                uint32_t            mnExpiryHeapIndex;      /// Position in mExpiryHeap or kExpiryHeapIndexInvalid if not linked.
+
+                Info()
+                    : mnDataSize(0)
+                    , mnLocation(kCacheLocationNone)
+                    , mnTimeoutSeconds(0)
+                    , mnTimeCreated(0)
+                    , mnTimeLastUsed(0)
+                    , mnTimeTimeout(0)
+                    , mnChecksum(0)
+                    , mnRevalidate(false)
+                    , mpKey(0)
+                    , mpLRUPrev(0)
+                    , mpLRUNext(0)
+                    , mnExpiryHeapIndex(kExpiryHeapIndexInvalid)
+                {
+                }
             };
 
             struct FileInfo/*: public WTF::FastAllocBase*/
@@ -208,10 +255,30 @@ namespace EA
                 // Removed buffer for now as we are using a shared aligned buffer is doing blocking reads
                 //char                   mBuffer[4096]; 
 
+                // Async read state. Except for mbAsync, these are owned by the IO thread mutex.
+                bool                   mbAsync;                 /// Reads are done by the IO thread.
+                bool                   mbReadQueued;            /// The IO thread holds a reference to this job (queued or reading).
+                bool                   mbReadDone;              /// The IO thread reached the end of the file.
+                bool                   mbReadError;             /// The IO thread failed to read the file.
+                bool                   mbReadCancel;            /// The job is going away; the IO thread must drop it.
+                ReadChunk*             mpReadyHead;             /// Chunks read but not yet delivered.
+                ReadChunk*             mpReadyTail;
+                uint32_t               mnReadyCount;
+                FileInfo*              mpNextQueued;            /// Link in the IO thread read queue.
+
                 FileInfo() 
                     : mFileObject(FileSystem::kFileObjectInvalid)
                     , mFileSize(-1)
                     , mCurChecksum(0)
+                    , mbAsync(false)
+                    , mbReadQueued(false)
+                    , mbReadDone(false)
+                    , mbReadError(false)
+                    , mbReadCancel(false)
+                    , mpReadyHead(0)
+                    , mpReadyTail(0)
+                    , mnReadyCount(0)
+                    , mpNextQueued(0)
                 {
                 }
 
@@ -220,7 +287,28 @@ namespace EA
             /// cache map data type
             typedef eastl::hash_map<FixedString8_128, Info, eastl::string_hash<FixedString8_128>, eastl::equal_to<FixedString8_128>, EASTLAllocator> DataMap;
 
+            /// Min-heap of committed entries ordered by mnTimeTimeout. Each Info tracks its own slot so it can be removed in O(log n).
+            typedef eastl::vector<Info*, EASTLAllocator> ExpiryHeap;
+
+            /// Scratch storage used to build binary cache index records before they are written.
+            typedef eastl::vector<char, EASTLAllocator> IndexBuffer;
+
+            /// Reference counts of a cache file, which can be shared by several entries.
+            struct FileRef
+            {
+                uint32_t                mnRefCount;             /// Entries (pending or committed) naming this file.
+                uint32_t                mnLinkedCount;          /// Committed entries naming this file. The file is complete on disk if non-zero.
+                bool                    mbWritePending;         /// The IO thread is writing this file.
+                const char*             mpWriteData;            /// The data the IO thread is writing, while mbWritePending.
+
+                FileRef() : mnRefCount(0), mnLinkedCount(0), mbWritePending(false), mpWriteData(0) { }
+            };
+
+            /// Map of cache file name to its reference counts.
+            typedef eastl::hash_map<FixedString16_128, FileRef, eastl::string_hash<FixedString16_128>, eastl::equal_to<FixedString16_128>, EASTLAllocator> FileRefMap;
+
             /// This is a callback function which is called by the ini file reader in ReadCacheIniFile.
+            /// The ini file is only read to migrate caches written by older versions to the binary index.
             static bool IniFileCallbackFunction(const char16_t* pKey, const char16_t* pValue, void* pContext);
 
             bool IsCachedDataValid( const Info& cacheInfo );
@@ -228,20 +316,54 @@ namespace EA
 
             bool RemoveCachedData(const FixedString8_128& pKey);
             void ClearCacheMap();
-            bool UpdateCacheIniFile();
             bool ReadCacheIniFile();
+            void RemoveCacheIniFile();
+
+            // Binary cache index. The index file is a small header followed by an append-only journal of add, remove
+            // and touch records. It is only rewritten (compacted) once the journal has grown well past the live entry count.
+            bool ReadCacheIndexFile();
+            bool ParseCacheIndex(const char* pData, int64_t size);
+            bool OpenCacheIndexFile();
+            void CloseCacheIndexFile();
+            bool CompactCacheIndexFile();
+            bool AppendCacheIndexRecord(uint8_t recordType, const FixedString8_128& key, const Info* pInfo);
+            void FlushCacheIndexFile();
+            bool CacheIndexNeedsCompaction() const;
+            void RebuildCacheIndex();
+            void GetCacheIndexFilePath(FixedString8_256& path8) const;
 
             bool GetNewCacheFileName( int nMIMEType, int nMIMESubtype, FixedString16_128& sFileName);
+            void GetContentCacheFileName(int nMIMEType, int nMIMESubtype, const char* pData, uint32_t size, FixedString16_128& sFileName);
+            bool CanShareContentFile(const FixedString16_128& sFileName, const char* pData, uint32_t size);
+            void AddFileReference(const Info& cacheInfo);
+            void ReleaseFileReference(const Info& cacheInfo);                   /// Deletes the file once no entry references it.
+            void CommitCacheEntry(DataMap::iterator it);
+            void CommitSharedEntries(const FixedString16_128& sFileName, bool bSuccess);
             bool RemoveCachedFile(const char16_t* pFileName);
             bool RemoveUnusedCachedFiles();
             void DoPeriodicCacheMaintenance();
             DataMap::iterator FindLRUItem (); // oldest item in location
+            void EraseCachedData(DataMap::iterator it);                         /// Unlinks the entry, releases its file and erases it from the map.
+
+            // LRU list and expiry heap maintenance. Only entries committed to disk are linked.
+            void LinkCacheEntry(DataMap::iterator it);
+            void UnlinkCacheEntry(Info& cacheInfo);
+            void TouchCacheEntry(Info& cacheInfo);                              /// Marks the entry as most recently used.
+            void ClearCacheIndex();
+            void ExpiryHeapSiftUp(uint32_t index);
+            void ExpiryHeapSiftDown(uint32_t index);
+            void ExpiryHeapSwap(uint32_t a, uint32_t b);
 
             // To prevent assignment outside of proper refcounting code, 
             // we declare these functions, but we don't define their implementations.
             TransportHandlerDiskCache(const TransportHandlerDiskCache&);
             const TransportHandlerDiskCache& operator=(const TransportHandlerDiskCache&);
             char* GetCacheDownloadBuffer();                                     /// Get and allocate a shared download buffer if needed.
+            bool TransferAsync(TransportInfo* pTInfo, FileInfo* pFileInfo, bool& bStateComplete);
+            bool VerifyTransferChecksum(TransportInfo* pTInfo, uint32_t checksum);
+            void ProcessCompletedWrites();                                      /// Commits cache files written by the IO thread.
+            void StartIOThread();                                               /// Starts the IO thread if mbAsyncIO is set and the thread system allows it.
+            void StopIOThread();                                                /// Commits pending writes and joins the IO thread. No file may be read by it any more.
             void RemoveCacheDownloadBuffer();                                   /// Remove the allocated download buffer
 
         protected:
@@ -254,8 +376,26 @@ namespace EA
             int                         mRefCount;                              /// standard refcount
         #endif 
             FixedString16_128           msCacheDirectory;                       /// Path to cache directory on disk.
-            FixedString16_128           msIniFileName;                          /// File name alone of cache ini file, which stores info about cached data on disk.
+            FixedString16_128           msIniFileName;                          /// File name alone of the legacy cache ini file. Only read for migration.
+            FixedString16_128           msIndexFileName;                        /// File name alone of the binary cache index, which stores info about cached data on disk.
+            FileSystem::FileObject      mIndexFileObject;                       /// Index file, kept open while initialized so journal records can be appended.
+            int64_t                     mnIndexFileSize;                        /// Bytes in the index file. Used to detect a torn or truncated journal.
+            uint32_t                    mnIndexRecordCount;                     /// Number of records in the index file, including superseded ones.
+            uint32_t                    mnIndexFlushTime;                       /// Time touch records were last written. Entries used since then get a touch record.
+            IndexBuffer                 mIndexBuffer;                           /// Reused buffer for building index records.
+            IOThread*                   mpIOThread;                             /// Background file IO. NULL if file IO is done synchronously.
+            bool                        mbAsyncIO;                              /// Use an IO thread if the thread system supports it.
+            uint32_t                    mnAsyncReadCount;                       /// Open cache files read by the IO thread. Once mbAsyncIO is turned off, the thread is stopped when this drops to 0.
+            uint32_t                    mnFileNameSequence;                     /// Makes new cache file names unique while their files are still being written.
             DataMap                     mDataMap;                               /// Map of cached data key (string) to cached data.
+            Info*                       mpLRUHead;                              /// Least recently used committed entry.
+            Info*                       mpLRUTail;                              /// Most recently used committed entry.
+            ExpiryHeap                  mExpiryHeap;                            /// Committed entries ordered by time of timeout.
+            FileRefMap                  mFileRefMap;                            /// Reference counts of the files named by mDataMap entries.
+            bool                        mbShareIdenticalFiles;                  /// Store identical resources in one content-named file.
+            uint32_t                    mnLinkedFileCount;                      /// Number of distinct files of committed entries.
+            EA::IO::size_type           mnLinkedDataSize;                       /// Size of the distinct files of committed entries.
+            EA::IO::size_type           mnLinkedResourceSize;                   /// Sum of mnDataSize of committed entries. Exceeds mnLinkedDataSize by the bytes saved by sharing.
             bool                        mbKeepExpired;                          /// Should cached entries be kept after they are expired?
             uint32_t                    mnMaxFileCacheSize;                     /// Max size of file cache.
             uint32_t                    mnDefaultExpirationTimeSeconds;         /// Default time for cache entries to expire.
@@ -39,6 +39,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <EAWebKit/EAWebKitConfig.h>
 #include <EAWebKit/EAWebKitSystem.h>
 #include <EAWebKit/EAWebKitDll.h>
+#include <EAWebKit/EAWebKitThreadInterface.h>
 namespace EA
 {
 namespace WebKit
@@ -100,7 +101,7 @@ struct DiskCacheInfo
 	uint32_t		mMaxNumberOfCachedFiles;    // Max number of files that can be cached in the cache directory (+1 for the cache ini ctrl file). So a limit of 2 files will cache 2 files + 1 shared ctrl init file.   
 	uint32_t		mMaxNumberOfOpenFiles;      // Max number of files that can keep stay open 
 	uint32_t		mMinFileSizeToCache;        // Min file size in bytes to be cached.  This can prevent small 32 byte files from being cached for example.
-	const utf8_t*	mDiskCacheDirectory;		// Full/Relative file path to writable directory. If relative, a valid full path should be returned when calling FileSystem::GetBaseDirectory(). SetDiskCacheUsage copies this string.
+	const utf8_t*	mDiskCacheDirectory;		// Full/Relative file path to writable directory. If relative, a valid full path should be returned when calling FileSystem::GetBaseDirectory(). SetDiskCacheUsage copies this string. Changing it saves the cache index of the old directory and continues with the cache found in the new one.
 
 	DiskCacheInfo()
 		: mDiskCacheSize(256 * 1024 * 1024) // Max size that the file cache can use
@@ -134,6 +135,158 @@ struct DiskCacheUsageInfo
 
 	}
 };
+// Transport job queue statistics, per WebCore resource load priority. Index 0 is the lowest priority (e.g. prefetches) and 
+// kTransportJobPriorityCount-1 the highest (e.g. the main document).
+const uint32_t kTransportJobPriorityCount = 4;
+
+struct TransportJobPriorityInfo
+{
+	uint32_t		mQueuedJobs;			// Current number of jobs waiting to start
+	uint32_t		mStartedJobs;			// Number of jobs started since EAWebKit was initialized
+	double			mTotalWaitSeconds;		// Total time that started jobs waited in the queue. Divide by mStartedJobs for the average.
+	double			mMaxWaitSeconds;		// Longest time a started job waited in the queue
+
+	TransportJobPriorityInfo()
+		: mQueuedJobs(0)
+		, mStartedJobs(0)
+		, mTotalWaitSeconds(0.0)
+		, mMaxWaitSeconds(0.0)
+	{
+
+	}
+};
+
+struct TransportJobQueueInfo
+{
+	TransportJobPriorityInfo	mPriority[kTransportJobPriorityCount];
+	uint32_t					mRunningJobs;	// Current number of jobs started and not yet removed
+
+	// Load timing of started jobs, whatever their transport. Meant for measuring page loads: read before and after and take the difference.
+	uint32_t					mCompletedJobs;			// Jobs removed, successful or not
+	uint32_t					mRespondedJobs;			// Completed jobs that got response headers. Divide mTotalFirstByteSeconds by this for the average time to first byte.
+	double						mTotalFirstByteSeconds;	// Time from job start to its response headers, summed over mRespondedJobs
+	double						mMaxFirstByteSeconds;	// Longest time from job start to response headers
+	double						mTotalJobSeconds;		// Time from job start to removal, summed over mCompletedJobs
+	uint64_t					mBytesReceived;			// Content bytes passed to WebCore (after content decoding)
+
+	TransportJobQueueInfo()
+		: mRunningJobs(0)
+		, mCompletedJobs(0)
+		, mRespondedJobs(0)
+		, mTotalFirstByteSeconds(0.0)
+		, mMaxFirstByteSeconds(0.0)
+		, mTotalJobSeconds(0.0)
+		, mBytesReceived(0)
+	{
+
+	}
+};
+
+// HTTP connection reuse, as tracked by the DirtySDK transport handler for asynchronous jobs (see Parameters::mMaxKeepAliveConnectionsPerHost).
+// An origin is a scheme, host and port. Counts are since EAWebKit was initialized unless noted.
+struct HttpConnectionUsageInfo
+{
+	uint32_t		mConnectionsOpened;		// Requests that found no idle kept-alive connection to their origin
+	uint32_t		mConnectionsReused;		// Requests sent on an idle kept-alive connection to their origin
+	uint32_t		mTLSHandshakesAvoided;	// The https requests among mConnectionsReused
+	uint32_t		mConnectionsExpired;	// Idle connections that went past their keep-alive timeout unused
+	uint32_t		mPipelinedRequests;		// Requests allowed to be pipelined (see Parameters::mHttpPipeliningEnabled)
+	uint32_t		mIdleConnections;		// Current idle kept-alive connections, over all origins
+	uint32_t		mOrigins;				// Current number of origins tracked
+	uint32_t		mPipeliningOrigins;		// Current number of origins trusted with pipelined requests
+
+	HttpConnectionUsageInfo()
+		: mConnectionsOpened(0)
+		, mConnectionsReused(0)
+		, mTLSHandshakesAvoided(0)
+		, mConnectionsExpired(0)
+		, mPipelinedRequests(0)
+		, mIdleConnections(0)
+		, mOrigins(0)
+		, mPipeliningOrigins(0)
+	{
+
+	}
+};
+
+// Glyph cache statistics of the built-in text system. These stay 0 if the application provides its own ITextSystem.
+struct GlyphCacheUsageInfo
+{
+	uint32_t		mPageCount;				// Current number of glyph cache texture pages holding glyphs
+	uint32_t		mHits;					// Glyph look ups found in the cache since EAWebKit was initialized
+	uint32_t		mMisses;				// Glyph look ups that had to rasterize the glyph
+	uint32_t		mEvictedPages;			// Pages cleared to make room for new glyphs, least recently used first
+	uint32_t		mFlushes;				// Times the whole cache was cleared because a single text run needed every page
+	uint32_t		mPrefetchedGlyphs;		// Glyphs rasterized on worker threads ahead of paint and added to the cache
+
+	GlyphCacheUsageInfo()
+		: mPageCount(0)
+		, mHits(0)
+		, mMisses(0)
+		, mEvictedPages(0)
+		, mFlushes(0)
+		, mPrefetchedGlyphs(0)
+	{
+
+	}
+};
+
+// Image compression statistics (see Parameters::mEnableImageCompression).
+struct ImageCompressionUsageInfo
+{
+	uint32_t		mCompressedImageCount;		// Decoded frames currently kept compressed
+	uint32_t		mCompressedBytes;			// Memory used by these frames
+	uint32_t		mSavedBytes;				// Memory these frames would take on top of mCompressedBytes if they were not compressed
+	uint32_t		mCompressions;				// Frames compressed since EAWebKit was initialized
+	uint32_t		mDecompressions;			// Frames decompressed for drawing
+	uint32_t		mDecompressedCacheHits;		// Draws of compressed frames served by the decompressed frame cache
+	uint32_t		mDecompressedCacheBytes;	// Memory used by the decompressed frame cache, pooled buffers included
+	uint32_t		mPooledBufferReuses;		// Decompressions that reused the buffer of a destroyed frame of the same size
+
+	ImageCompressionUsageInfo()
+		: mCompressedImageCount(0)
+		, mCompressedBytes(0)
+		, mSavedBytes(0)
+		, mCompressions(0)
+		, mDecompressions(0)
+		, mDecompressedCacheHits(0)
+		, mDecompressedCacheBytes(0)
+		, mPooledBufferReuses(0)
+	{
+
+	}
+};
+
+// Disk cache file sharing statistics (see Parameters::mDiskCacheShareIdenticalFiles).
+struct DiskCacheSharingUsageInfo
+{
+	uint32_t		mCurrentNumberOfCachedResources;	// Current number of cached resources. Can exceed DiskCacheUsageInfo::mCurrentNumberOfCachedFiles if identical resources share a file.
+	uint32_t		mSharedFileBytesSaved;				// Bytes not written to disk because identical resources share a file
+
+	DiskCacheSharingUsageInfo()
+		: mCurrentNumberOfCachedResources(0)
+		, mSharedFileBytesSaved(0)
+	{
+
+	}
+};
+
+// Decode to display size statistics (see Parameters::mEnableDecodeToDisplaySize).
+struct ImageDecodeUsageInfo
+{
+	uint32_t		mDecodeSavedBytes;		// Decoded image memory currently saved, compared to decoding those images at full size. Not included in RAMCacheUsageInfo::mImagesBytes.
+	uint32_t		mReducedImageCount;		// Number of images currently decoded smaller than their full size
+	uint32_t		mRedecodeCount;			// Number of times an image was decoded again because it got displayed larger than its decoded size. Counted since EAWebKit was initialized.
+
+	ImageDecodeUsageInfo()
+		: mDecodeSavedBytes(0)
+		, mReducedImageCount(0)
+		, mRedecodeCount(0)
+	{
+
+	}
+};
+
 struct CookieInfo
 {
 	uint32_t		mMaxIndividualCookieSize;	// Should usually be at least 4096. The usable space is mMaxIndividualCookieSize-1.
@@ -172,7 +325,7 @@ struct Parameters
 	uint32_t            mMaxTransportJobs;              // Defaults to 16. Specifies maximum number of concurrent transport jobs (e.g. HTTP requests).
 	uint32_t			mHttpRequestResponseBufferSize; // Defaults to 4096. Number of bytes that a HTTP request/response handle has for transaction with server. This is only for request/response headers and does not put any limit on the actual resource size(say a css file).
 	uint32_t            mPageTimeoutSeconds;            // Defaults to 30 seconds. Page load timeout, in seconds. This timeout is applied to each individual resource. Your page does not have to finish loading within 30 seconds but this timeout is maximum time allowed between consecutive bytes received from the server (until the resource is fully loaded). 
-	bool				mHttpPipeliningEnabled;		    // Defaults to false. If enabled, the current implementation increases load times with slightly lower memory usage.
+	bool				mHttpPipeliningEnabled;		    // Defaults to false. If enabled, GET and HEAD requests are pipelined, but only to origins that have answered several HTTP/1.1 requests in a row without closing the connection. An origin that fails a pipelined request is not sent any more for the session.
 	bool                mVerifySSLCert;                 // Defaults to true. If true then we do SSL/TLS peer verification via security certificates. You should set this to false only if debugging non-shipping builds. Was called mVerifyPeersEnabled in 1.x.
 	bool				mTickHttpManagerFromNetConnIdle;// Defaults to true (existing behavior). If true, NetConnIdle call in DirtySDK updates HttpManager used by this library. This results in slightly improved performance. The reason to turn it false would be if you are ticking EAWebKit and DirtySDK on different threads.
 	int32_t				mHttpManagerLogLevel;			// Defaults to 1.
@@ -216,6 +369,22 @@ struct Parameters
 	bool mEnableLowQualitySamplingDuringScaling;// Default to true. If enabled, the image is sampled at low quality before it comes to rest. The image remains at low quality for at least 50 ms after scaling is done. Useful for good performance if your page has heavy zoom/pan usage(for example, maps.google.com) 
     bool mEnableRoundedCornerClip;              // Enables detailed rounded corner clipping. This can however impact performance so off by default. 
 	bool mEnableWebWorkers;						// Defaults to true. Web workers create an OS level thread which might not be desired in some scenarios. This option allows disabling web workers at library initialization. Note that the JavaScript based checks for web worker support will still succeed however the failure will be apparent. 
+
+	// Newer settings go below, at the end of the struct, so that the offsets of the ones above stay the same for applications built against an older header.
+	uint32_t mMaxTransportJobsPerHost;			// Defaults to 6. Specifies maximum number of concurrent transport jobs to a single host. 0 means no per host limit. Queued jobs are started highest priority first (main documents and XHRs, then style sheets and scripts, ahead of images and prefetches).
+	bool mHttpTransportThreadEnabled;			// Defaults to false. If true, asynchronous HTTP jobs are run on a dedicated network thread (socket reads, header parsing and content decompression) and the main thread only picks up the results. Requires a thread system that can create threads and DirtySDK newer than 8.18; otherwise this is ignored. mTickHttpManagerFromNetConnIdle is ignored for those jobs, and redirects are followed by starting a new job. Read when the http scheme is initialized.
+	uint32_t mGlyphRunCacheSize;				// Default is 1 MB.  Byte budget for keeping composited text runs so that unchanged text is redrawn with a single blit.  0 disables the cache.
+	bool mEnableParallelImageCompression;		// Defaults to true.  If enabled along with mEnableImageCompression, large images are compressed and decompressed in bands of rows on the EAWebKit thread pool.
+	uint32_t mDecompressedImageCacheSize;		// Default is 4 MB.  Byte budget for keeping compressed images decompressed after they are drawn, so that images drawn every frame are not decompressed each time.  0 disables the cache.
+	bool mEnableParallelTilePainting;			// Defaults to false.  With the tiled backing store, the paint of each dirty tile is recorded on the main thread and rasterized on the EAWebKit thread pool. The tile surfaces stay locked until all the dirty tiles are rasterized.
+	bool mEnableAsyncImageDecoding;				// Defaults to false. Complete still images are decoded on the EAWebKit thread pool when first drawn. Nothing is drawn for the image until its decode is picked up on a later tick, and the image is then repainted. Small images and animations are still decoded when drawn.
+	bool mEnableDecodeToDisplaySize;			// Defaults to false. Complete still JPEG and PNG images are decoded no larger than they are displayed (JPEG by 1/2, 1/4 or 1/8 DCT scaling, PNG by box filtering), and decoded again if later displayed larger. Images used as patterns, on canvases or as textures are decoded at full size. See EAWebKitLib::GetImageDecodeUsage for the memory saved.
+	uint32_t mMaxKeepAliveConnectionsPerHost;	// Defaults to 6. Max number of connections kept open to a single origin (scheme, host and port). Requests beyond it ask the server to close the connection when done. 0 disables keep-alive. See EAWebKitLib::GetHttpConnectionUsageInfo.
+	uint32_t mHttpKeepAliveTimeoutSeconds;		// Defaults to 15. How long an idle kept-alive connection is counted on for reuse, unless the server's Keep-Alive header gives a shorter timeout. 0 disables keep-alive.
+	bool mDiskCacheAsyncFileIO;					// Defaults to false. If enabled, disk cache files are read and written on a background thread. The FileSystem is then called from that thread and must be usable from any thread. Read when SetDiskCacheUsage is called. Ignored if the thread system can't create threads.
+	bool mDiskCacheShareIdenticalFiles;			// Defaults to true. If enabled, disk cached resources with identical contents (e.g. the same script from different URLs) are stored in a single file. See EAWebKitLib::GetDiskCacheSharingUsage.
+	bool mCookieAsyncFileIO;					// Defaults to false. If enabled, cookie changes are written to the cookie file on a background thread. The FileSystem is then called from that thread and must be usable from any thread. Read when SetCookieUsage is called. Ignored if the thread system can't create threads.
+	bool mEnableGlyphPrefetch;					// Defaults to false. If enabled, glyphs found by layout that are not in the glyph cache yet are rasterized on the EAWebKit thread pool, and each paint adds the ones that are done to the glyph cache. Only used with the built-in text system and an EAText built with EATEXT_THREAD_SAFETY_ENABLED. Starts the thread pool.
     Parameters();
 private:
 	// Disallow compiler generated copy ctor. The embedder should take a reference using GetParameters().
@@ -380,6 +549,36 @@ public:
 	// APIs related to mostly debugging
 	virtual const char8_t*	GetVersion();
 
+	// Transport job scheduler statistics (see Parameters::mMaxTransportJobsPerHost).
+	virtual void			GetTransportJobQueueInfo(TransportJobQueueInfo& transportJobQueueInfo);
+
+	// HTTP keep-alive connection reuse and pipelining statistics.
+	virtual void			GetHttpConnectionUsageInfo(HttpConnectionUsageInfo& httpConnectionUsageInfo);
+
+	// Glyph cache statistics of the built-in text system.
+	virtual void			GetGlyphCacheUsage(GlyphCacheUsageInfo& glyphCacheUsageInfo);
+
+	// Image compression and decompressed frame cache statistics.
+	virtual void			GetImageCompressionUsage(ImageCompressionUsageInfo& imageCompressionUsageInfo);
+
+	// Disk cache file sharing statistics.
+	virtual void			GetDiskCacheSharingUsage(DiskCacheSharingUsageInfo& diskCacheSharingUsageInfo);
+
+	// Decode to display size statistics.
+	virtual void			GetImageDecodeUsage(ImageDecodeUsageInfo& imageDecodeUsageInfo);
+
+	// The thread system that comes with EAWebKit, with native threads. NULL if the library was built without it (see EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED).
+	// Pass it as AppSystems::mThreadSystem to let EAWebKit create threads when the application has no thread system of its own. Local storage and
+	// databases then run on threads of their own, so the FileSystem must be usable from any thread. Without a thread system, EAWebKit runs on a single 
+	// thread and the thread pool work (e.g. Parameters::mEnableParallelTilePainting) and background file IO are done on the calling thread.
+	// Can be called before Init.
+	virtual IThreadSystem*	GetNativeThreadSystem();
+
+	// Runs doWork once for each of the workCount contexts on the EAWebKit thread pool, the one used for parallel painting, decoding and glyph 
+	// rasterization, and returns once every call returned. The calling thread runs queued work while it waits. doWork must not call EAWebKit.
+	virtual void			RunThreadPoolWork(DoWorkEntryPoint doWork, void* const* pWorkContexts, uint32_t workCount);
+	virtual uint32_t		GetThreadPoolWorkerCount(); // 0 if the thread system can't create threads, in which case the work runs on the calling thread.
+
 	//
 	// Add newer APIs above this.
 	//
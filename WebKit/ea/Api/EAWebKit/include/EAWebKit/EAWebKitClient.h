@@ -456,11 +456,11 @@ enum VProcessType
 	kVProcessTypeFileCacheJob,              // Single job loop tracking using the file cache system
 	kVProcessTypeDrawImage,                 // Single image draw (includes most decoding, resize, compression render)
 	kVProcessTypeDrawImagePattern,          // Tiling image draw (includes most decoding, resize, compression render)
-	kVProcessTypeDrawGlyph,                 // Font draw (includes render)
+	kVProcessTypeDrawGlyph,                 // Font draw (includes render). mSize is the number of glyphs in the run
 	kVProcessTypeDrawRaster,                // Low level raster draw for font and images
-	kVProcessTypeImageDecoder,              // Image decoder (JPEG, GIF, PNG)
-	kVProcessTypeImageCompressionPack,      // Image compression packing
-	kVProcessTypeImageCompressionUnPack,    // Image compression unpacking
+	kVProcessTypeImageDecoder,              // Image decoder (JPEG, GIF, PNG). With Parameters::mEnableAsyncImageDecoding, only the end of each worker decode is notified, from the main thread, with mSize set to the worker time in microseconds
+	kVProcessTypeImageCompressionPack,      // Image compression packing. mSize is the pixel count of the image
+	kVProcessTypeImageCompressionUnPack,    // Image compression unpacking. mSize is the pixel count of the image. Draws served by the decompressed frame cache are not notified
 	kVProcessTypeJavaScriptParser,          // JavaScript parser
 	kVProcessTypeJavaScriptExecute,         // JavaScript execute
 	kVProcessTypeCSSParseSheet,             // CSS Sheet parse
@@ -477,6 +477,8 @@ enum VProcessType
     kVProcessTypeBeginViewUpdate,
 	kVProcessTypeEndViewUpdate,
     kVProcessTypeAnimation,
+    kVProcessTypePaintTileRecord,           // Record the paint of a single tile, when Parameters::mEnableParallelTilePainting is set
+    kVProcessTypePaintTileRaster,           // Rasterize a single tile recording on a worker thread. Only the end is notified, from the main thread, with mSize set to the worker time in microseconds
 
 
 	//****************************************************************//
@@ -145,4 +145,22 @@ They are kept here just for convenience.														*
     #define EAWEBKIT_DEFAULT_FILE_SYSTEM_ENABLED 1
 #endif
 
+
+///////////////////////////////////////////////////////////////////////////////
+// EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED
+//
+// Defined as 0 or 1; 1 is default on platforms with native thread support.
+// Controls if the library includes a thread system with native threads, which an
+// application can pass to Init (see EAWebKitLib::GetNativeThreadSystem). If 0, or
+// if the application passes no thread system, the default thread system can't
+// create threads and runs everything on the calling thread.
+//
+#ifndef EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED
+    #if defined(EA_PLATFORM_MICROSOFT) || defined(EA_PLATFORM_UNIX)
+        #define EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED 1
+    #else
+        #define EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED 0
+    #endif
+#endif
+
 #endif // EAWEBKIT_EAWEBKITCONFIG_H
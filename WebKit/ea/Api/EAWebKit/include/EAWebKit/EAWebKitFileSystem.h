@@ -139,6 +139,17 @@ public:
 		path[0] = 0; 
 		return false;
 	}
+
+	// MapFile provides read-only access to the entire contents of a file, usually through a memory mapping. It returns NULL if
+	// mapping is not supported or failed, in which case the caller falls back to regular reads. The pointer stays valid until
+	// UnmapFile is called with the same pointer and size. These are new functions in order to be backward compatible; the default
+	// implementation does not support mapping.
+	virtual const void*	MapFile(const utf8_t* path, int64_t& size)
+	{
+		size = 0;
+		return NULL;
+	}
+	virtual void		UnmapFile(const void* pData, int64_t size) { }
 };
 
 
@@ -172,6 +183,8 @@ public:
     bool       MakeDirectory(const utf8_t* path); // This version in default file system is smart enough to create multiple directory levels if required.
     bool       GetDataDirectory(utf8_t* path, size_t pathBufferCapacity);
 	bool	   GetTempDirectory(utf8_t* path, size_t pathBufferCapacity); 
+	const void* MapFile(const utf8_t* path, int64_t& size);
+	void       UnmapFile(const void* pData, int64_t size);
 private:
 	bool		MakeDirectoryInternal(const utf8_t* path);
 };
@@ -396,6 +396,12 @@ public:
 
     //  Array capacity
     virtual uint32_t		GetFamilyNameArrayCapacity(void) = 0; 
+
+    // Glyph prefetch (optional). EAWebKit calls PrefetchGlyphs with glyphs that layout just found, as they are likely to be drawn 
+    // soon, and CommitPrefetchedGlyphs before it paints. A text system can rasterize the glyphs in the background in between, 
+    // so that GetGlyphs does not have to do it while painting.
+    virtual void	PrefetchGlyphs(IFont* /*pFont*/, const GlyphId* /*gIdArray*/, int /*glyphCount*/) { }
+    virtual void	CommitPrefetchedGlyphs(void) { }
 };
 
 } // Namespace WebKit
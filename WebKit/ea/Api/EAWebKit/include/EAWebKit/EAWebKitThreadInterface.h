@@ -118,6 +118,7 @@ public:
 	virtual IThread* CreateAThread() = 0;
 	virtual void DestroyAThread(IThread*) = 0;
 
+	// The work is expected to be done when ScheduleWork returns; EAWebKit uses it to run the database and local storage tasks.
 	virtual void ScheduleWork(EA::WebKit::DoWorkEntryPoint doWork, void* workContext) = 0;
 	virtual ThreadId CurrentThreadId() = 0;
 	virtual bool IsMainThread() = 0;
@@ -128,6 +129,7 @@ public:
 
 void SetThreadSystem(IThreadSystem*);
 IThreadSystem* GetThreadSystem();
+IThreadSystem* GetNativeThreadSystem(); // The default thread system with native threads, or NULL if EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED is 0.
 
 void ThreadCleanupTick();
 }
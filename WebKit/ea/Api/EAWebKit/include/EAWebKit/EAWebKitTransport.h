@@ -248,9 +248,11 @@ public:
 	bool							mbVerifySSLCert;            // True if the job should validate SSL certificates.
 	bool							mbAsync;					// Normally True. False for a synchronous request.
 	bool							mbUsePlatformHttp;			// Normally false. True if the client indicates this preference.
+	bool							mbFollowRedirects;			// Normally true. A TransportHandler that doesn't follow HTTP redirects itself sets this to false in InitJob. The TransportServer then starts a new job for the redirect location.
 
 public:
 	TransportInfo();
+	void Reset();   // Restores the constructed state. The string and header map storage is kept so that a TransportInfo can be reused cheaply.
 private:
 	TransportInfo(const TransportInfo& rhs);
 	TransportInfo& operator = (const TransportInfo& rhs);
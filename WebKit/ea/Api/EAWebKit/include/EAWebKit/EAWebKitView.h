@@ -42,6 +42,7 @@ namespace WebCore
 class Frame;
 class Node;
 class TileEA;
+class TileSurfacePool;
 class BitmapTextureEA;
 }
 
@@ -102,6 +103,19 @@ struct JumpNavigationParams
 	}
 };
 
+// Optional parameters of the tiled backing store. Only used if using tiled backing store. Otherwise, ignored.
+struct TileParameters
+{
+	bool mPrefetchTiles;		// Paints tiles ahead of the scroll direction, a few per update, and keeps them when the non visible tiles are removed.
+	uint32_t mTileMemoryBudget;	// Bytes of tile surfaces, recycled ones included, past which no tile is created outside of the visible area. 0 means no limit.
+	TileParameters()
+		: mPrefetchTiles(true)
+		, mTileMemoryBudget(16 * 1024 * 1024)
+	{
+
+	}
+};
+
 // The virtual members of this class represent the API that can be called by the Application.
 // Non virtual members are for internal usage.
 class View
@@ -221,6 +235,7 @@ public:
 	// In hardware rendering, memory usage may slightly increase because of the additional surfaces being created for drawing texture boundaries.
 	virtual void SetDrawDebugVisuals(bool on);   
     virtual void ForceInvalidateFullView(); // This call is normally not needed but can be used to manually force the view to be repainted.  
+	virtual void SetTileParameters(const TileParameters& tileParameters); // Can be called before or after InitView. Applies to the existing tiles from the next update.
 
 
     //
@@ -258,6 +273,7 @@ public:
 
 	void AddTile(WebCore::TileEA* tile);
 	void RemoveTile(WebCore::TileEA* tile);
+	WebCore::TileSurfacePool* GetTileSurfacePool();
 
 	void AddTexture(WebCore::BitmapTextureEA* texture);
 	void RemoveTexture(WebCore::BitmapTextureEA* texture);
@@ -43,6 +43,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <internal/include/EAWebKitDomainFilter.h>
 #include <internal/include/EAWebKitFPUPrecision.h>
 #include <internal/include/EAWebKitString.h>
+#include <internal/include/EAWebKitThreadPool.h>
 #include <EAWebKit/EAWebKitClient.h>
 #include <EAWebKit/EAWebKitView.h>
 #include <EAWebKit/EAWebKitThreadInterface.h>
@@ -57,6 +58,11 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ResourceHandleManagerEA.h"
 #include "NetworkStateNotifier.h"
 #include "MemoryCache.h"
+#include "BitmapImage.h"
+#include "GlyphRunCacheEA.h"
+#include "DecompressedImageCacheEA.h"
+#include "ImageDecodeQueueEA.h"
+#include "ImageCompressionEA.h"
 #include "ea_class.h"
 #include "RenderThemeEA.h"
 #include "ScrollbarThemeEA.h"
@@ -335,6 +341,80 @@ const char* EAWebKitLib::GetVersion()
 	return EA::WebKit::GetVersion();
 }
 
+void EAWebKitLib::GetTransportJobQueueInfo(EA::WebKit::TransportJobQueueInfo& transportJobQueueInfo)
+{
+	SET_AUTOFPUPRECISION(EA::WebKit::kFPUPrecisionExtended);
+    EAWEBKIT_THREAD_CHECK();
+    EAWWBKIT_INIT_CHECK(); 
+	EA::WebKit::GetTransportJobQueueInfo(transportJobQueueInfo);
+}
+
+void EAWebKitLib::GetHttpConnectionUsageInfo(EA::WebKit::HttpConnectionUsageInfo& httpConnectionUsageInfo)
+{
+	SET_AUTOFPUPRECISION(EA::WebKit::kFPUPrecisionExtended);
+    EAWEBKIT_THREAD_CHECK();
+    EAWWBKIT_INIT_CHECK(); 
+	EA::WebKit::GetHttpConnectionUsageInfo(httpConnectionUsageInfo);
+}
+
+void EAWebKitLib::GetGlyphCacheUsage(EA::WebKit::GlyphCacheUsageInfo& glyphCacheUsageInfo)
+{
+	SET_AUTOFPUPRECISION(EA::WebKit::kFPUPrecisionExtended);
+    EAWEBKIT_THREAD_CHECK();
+    EAWWBKIT_INIT_CHECK(); 
+	EA::WebKit::GetGlyphCacheUsage(glyphCacheUsageInfo);
+}
+
+void EAWebKitLib::GetImageCompressionUsage(EA::WebKit::ImageCompressionUsageInfo& imageCompressionUsageInfo)
+{
+	SET_AUTOFPUPRECISION(EA::WebKit::kFPUPrecisionExtended);
+    EAWEBKIT_THREAD_CHECK();
+    EAWWBKIT_INIT_CHECK(); 
+	EA::WebKit::GetImageCompressionUsage(imageCompressionUsageInfo);
+}
+
+void EAWebKitLib::GetDiskCacheSharingUsage(EA::WebKit::DiskCacheSharingUsageInfo& diskCacheSharingUsageInfo)
+{
+	SET_AUTOFPUPRECISION(EA::WebKit::kFPUPrecisionExtended);
+    EAWEBKIT_THREAD_CHECK();
+    EAWWBKIT_INIT_CHECK(); 
+	EA::WebKit::GetDiskCacheSharingUsage(diskCacheSharingUsageInfo);
+}
+
+void EAWebKitLib::GetImageDecodeUsage(EA::WebKit::ImageDecodeUsageInfo& imageDecodeUsageInfo)
+{
+	SET_AUTOFPUPRECISION(EA::WebKit::kFPUPrecisionExtended);
+    EAWEBKIT_THREAD_CHECK();
+    EAWWBKIT_INIT_CHECK(); 
+	EA::WebKit::GetImageDecodeUsage(imageDecodeUsageInfo);
+}
+
+IThreadSystem* EAWebKitLib::GetNativeThreadSystem()
+{
+	SET_AUTOFPUPRECISION(EA::WebKit::kFPUPrecisionExtended);
+	return EA::WebKit::GetNativeThreadSystem();
+}
+
+void EAWebKitLib::RunThreadPoolWork(DoWorkEntryPoint doWork, void* const* pWorkContexts, uint32_t workCount)
+{
+	SET_AUTOFPUPRECISION(EA::WebKit::kFPUPrecisionExtended);
+    EAWEBKIT_THREAD_CHECK();
+    EAWWBKIT_INIT_CHECK(); 
+	EA::WebKit::ThreadPool& threadPool = EA::WebKit::ThreadPool::GetInstance();
+	EA::WebKit::ThreadPoolWorkGroup workGroup;
+	for(uint32_t i = 0; i < workCount; ++i)
+		threadPool.ScheduleWork(doWork, pWorkContexts[i], &workGroup);
+	threadPool.Wait(&workGroup);
+}
+
+uint32_t EAWebKitLib::GetThreadPoolWorkerCount()
+{
+	SET_AUTOFPUPRECISION(EA::WebKit::kFPUPrecisionExtended);
+    EAWEBKIT_THREAD_CHECK();
+    EAWWBKIT_INIT_CHECK(); 
+	return EA::WebKit::ThreadPool::GetInstance().GetWorkerCount();
+}
+
 JavascriptValue *EAWebKitLib::CreateJavascriptValue(View *view) 
 {
 	SET_AUTOFPUPRECISION(EA::WebKit::kFPUPrecisionExtended);
@@ -703,12 +783,16 @@ void Shutdown()
 	}
 
 	WebCore::ResourceHandleManager::finalize();	// Needed to free DirtySDK related resources
+	WebCore::ImageDecodeQueue::GetInstance().Clear(); // Before the thread pool shutdown, as it waits for the decodes.
+	WebCore::GlyphRunCache::GetInstance().Clear(); // Before the text system shutdown, as the runs are keyed by font.
+	WebCore::DecompressedImageCache::GetInstance().Clear();
 	EA::WebKit::GetTextSystem()->Shutdown();	// Needed to free EAText related resources 
 
 #if ENABLE(EATEXT_IN_DLL) 
     EA::WebKit::ShutdownFontSystem();
 #endif
 
+	EA::WebKit::ThreadPool::GetInstance().Shutdown(); // Before the thread system shutdown, as the workers are its threads.
 	EA::WebKit::GetThreadSystem()->Shutdown(); // Needed to free any thread related resources. Call at last since some timer stuff uses it to query main thread.
 	SetWebKitStatus(kWebKitStatusInactive);
 }
@@ -868,6 +952,35 @@ void GetDiskCacheUsage(EA::WebKit::DiskCacheUsageInfo& diskCacheUsageInfo)
 	WebCore::ResourceHandleManager::sharedInstance()->GetDiskCacheUsage(diskCacheUsageInfo); 
 }
 
+void GetTransportJobQueueInfo(EA::WebKit::TransportJobQueueInfo& transportJobQueueInfo)
+{
+	WebCore::ResourceHandleManager::sharedInstance()->GetTransportJobQueueInfo(transportJobQueueInfo); 
+}
+
+void GetHttpConnectionUsageInfo(EA::WebKit::HttpConnectionUsageInfo& httpConnectionUsageInfo)
+{
+	WebCore::ResourceHandleManager::sharedInstance()->GetHttpConnectionUsageInfo(httpConnectionUsageInfo); 
+}
+
+void GetDiskCacheSharingUsage(EA::WebKit::DiskCacheSharingUsageInfo& diskCacheSharingUsageInfo)
+{
+	WebCore::ResourceHandleManager::sharedInstance()->GetDiskCacheSharingUsage(diskCacheSharingUsageInfo); 
+}
+
+void GetGlyphCacheUsage(EA::WebKit::GlyphCacheUsageInfo& glyphCacheUsageInfo)
+{
+#if ENABLE(EATEXT_IN_DLL)
+	EA::WebKit::GetFontSystemGlyphCacheUsage(glyphCacheUsageInfo);
+#else
+	glyphCacheUsageInfo = EA::WebKit::GlyphCacheUsageInfo();
+#endif
+}
+
+void GetImageCompressionUsage(EA::WebKit::ImageCompressionUsageInfo& imageCompressionUsageInfo)
+{
+	WebCore::ImageCompressionGetUsage(imageCompressionUsageInfo);
+}
+
 void SetCookieUsage(const EA::WebKit::CookieInfo& cookieInfo)
 {
 	const char8_t* pCookieFilePath = cookieInfo.mCookieFilePath;
@@ -885,7 +998,7 @@ void SetCookieUsage(const EA::WebKit::CookieInfo& cookieInfo)
 	WebCore::ResourceHandleManager* pRHM = WebCore::ResourceHandleManager::sharedInstance();
 	EA::WebKit::CookieManager* pCM = pRHM->GetCookieManager();   
 	CookieManagerParameters    params(pCookieFilePath, cookieInfo.mMaxIndividualCookieSize, 
-									cookieInfo.mDiskCookieStorageSize, cookieInfo.mMaxCookieCount);
+									cookieInfo.mDiskCookieStorageSize, cookieInfo.mMaxCookieCount, GetParameters().mCookieAsyncFileIO);
 	pCM->SetParametersAndInitialize(params);
 }
 
@@ -904,6 +1017,15 @@ void GetRAMCacheUsage(RAMCacheUsageInfo& ramCacheUsageInfo)
 	ramCacheUsageInfo.mFontsBytes = stats.fonts.size;
 }
 
+void GetImageDecodeUsage(ImageDecodeUsageInfo& imageDecodeUsageInfo)
+{
+	unsigned savedBytes, reducedCount, redecodeCount;
+	WebCore::BitmapImage::getDecodeToDisplaySizeUsage(savedBytes, reducedCount, redecodeCount);
+	imageDecodeUsageInfo.mDecodeSavedBytes = savedBytes;
+	imageDecodeUsageInfo.mReducedImageCount = reducedCount;
+	imageDecodeUsageInfo.mRedecodeCount = redecodeCount;
+}
+
 void AddAllowedDomainInfo(const char8_t* allowedDomain, const char8_t* excludedPaths /* = 0 */)
 {
 	EAWebKitDomainFilter::GetInstance().AddAllowedDomainInfo(allowedDomain, excludedPaths);
@@ -980,6 +1102,8 @@ void ClearMemoryCache()
 
 	// Invalidating the font cache and freeing all inactive font data.
 	WebCore::fontCache()->invalidate();
+	WebCore::GlyphRunCache::GetInstance().Clear();
+	WebCore::DecompressedImageCache::GetInstance().Clear();
 
 	// Empty the Cross-Origin Preflight cache
 	WebCore::CrossOriginPreflightResultCache::shared().empty();
@@ -1161,6 +1285,20 @@ Parameters::Parameters()
 	, mEnableLowQualitySamplingDuringScaling(true)
     , mEnableRoundedCornerClip(false)
 	, mEnableWebWorkers(true)
+	, mMaxTransportJobsPerHost(6)
+	, mHttpTransportThreadEnabled(false)
+	, mGlyphRunCacheSize(1024 * 1024) // 1 MB
+    , mEnableParallelImageCompression(true)
+    , mDecompressedImageCacheSize(4 * 1024 * 1024) // 4 MB
+    , mEnableParallelTilePainting(false)
+    , mEnableAsyncImageDecoding(false)
+    , mEnableDecodeToDisplaySize(false)
+    , mMaxKeepAliveConnectionsPerHost(6)
+    , mHttpKeepAliveTimeoutSeconds(15)
+    , mDiskCacheAsyncFileIO(false)
+    , mDiskCacheShareIdenticalFiles(true)
+    , mCookieAsyncFileIO(false)
+    , mEnableGlyphPrefetch(false)
 {
     // Set up default font names 
 	EA::Internal::Strcpy(mSystemFont,			EA_CHAR16(""));                       // If no font name is set here (our default), webkit will decide on the font to use. 
@@ -57,6 +57,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 		#include <sys/types.h>
 	#if !defined(EA_PLATFORM_SONY)
 		#include <utime.h>		// Some versions may require <sys/utime.h>. Take this header out if not required on OS X.
+		#include <sys/mman.h>
 	#endif
 		#ifndef S_ISREG
 			#define S_ISREG(m) (((m) & S_IFMT) == S_IFREG)
@@ -153,11 +154,27 @@ bool FileSystemDefault::OpenFile(FileObject fileObject, const char* path, int op
 		//http://msdn.microsoft.com/en-us/library/yeby3zcb%28VS.80%29.aspx
 		//b Open in binary (untranslated) mode; translations involving carriage-return and linefeed characters are suppressed. 
 
-	#ifdef _MSC_VER
-		pFileInfo->mpFile = fopen(path, openFlags & kWrite ? "wb" : "rb");
-	#else
-		pFileInfo->mpFile = fopen(path, openFlags & kWrite ? "w" : "r");
-	#endif
+		if((openFlags & kWrite) && ((createDisposition == kCDOOpenAlways) || (createDisposition == kCDOOpenExisting)))
+		{
+			// These dispositions keep the existing contents. Open for update and create the file if allowed.
+		#ifdef _MSC_VER
+			pFileInfo->mpFile = fopen(path, "r+b");
+			if(!pFileInfo->mpFile && (createDisposition == kCDOOpenAlways))
+				pFileInfo->mpFile = fopen(path, "w+b");
+		#else
+			pFileInfo->mpFile = fopen(path, "r+");
+			if(!pFileInfo->mpFile && (createDisposition == kCDOOpenAlways))
+				pFileInfo->mpFile = fopen(path, "w+");
+		#endif
+		}
+		else
+		{
+		#ifdef _MSC_VER
+			pFileInfo->mpFile = fopen(path, openFlags & kWrite ? "wb" : "rb");
+		#else
+			pFileInfo->mpFile = fopen(path, openFlags & kWrite ? "w" : "r");
+		#endif
+		}
 	}
 
     if(pFileInfo->mpFile)
@@ -740,6 +757,74 @@ bool FileSystemDefault::GetTempDirectory(char8_t* path, size_t pathBufferCapacit
 	return false;
 
 }
+
+const void* FileSystemDefault::MapFile(const char8_t* path, int64_t& size)
+{
+	size = 0;
+	if(path && *path)
+	{
+	#if defined(EA_PLATFORM_WINDOWS)
+
+		HANDLE hFile = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if(hFile != INVALID_HANDLE_VALUE)
+		{
+			LARGE_INTEGER fileSize;
+			const void* pData = NULL;
+			if(::GetFileSizeEx(hFile, &fileSize) && (fileSize.QuadPart > 0))
+			{
+				// The view keeps the mapping alive so both handles can be closed right away.
+				HANDLE hMapping = ::CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+				if(hMapping)
+				{
+					pData = ::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+					::CloseHandle(hMapping);
+					if(pData)
+						size = fileSize.QuadPart;
+				}
+			}
+			::CloseHandle(hFile);
+			return pData;
+		}
+
+	#elif defined(EA_PLATFORM_UNIX) && !defined(EA_PLATFORM_SONY)
+
+		const int fd = open(path, O_RDONLY);
+		if(fd >= 0)
+		{
+			struct stat tempStat;
+			void* pData = NULL;
+			if((fstat(fd, &tempStat) == 0) && (tempStat.st_size > 0))
+			{
+				pData = mmap(NULL, (size_t)tempStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if(pData == MAP_FAILED)
+					pData = NULL;
+				else
+					size = tempStat.st_size;
+			}
+			close(fd);
+			return pData;
+		}
+
+	#endif
+	}
+
+	return NULL;
+}
+
+void FileSystemDefault::UnmapFile(const void* pData, int64_t size)
+{
+	if(pData)
+	{
+	#if defined(EA_PLATFORM_WINDOWS)
+		(void)size;
+		::UnmapViewOfFile(pData);
+	#elif defined(EA_PLATFORM_UNIX) && !defined(EA_PLATFORM_SONY)
+		munmap(const_cast<void*>(pData), (size_t)size);
+	#else
+		(void)size;
+	#endif
+	}
+}
 #endif // EAWEBKIT_DEFAULT_FILE_SYSTEM_ENABLED
 
 } // namespace WebKit
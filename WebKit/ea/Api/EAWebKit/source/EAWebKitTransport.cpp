@@ -111,10 +111,38 @@ TransportInfo::TransportInfo()
 , mbVerifySSLCert(true)
 , mbAsync(true)
 , mbUsePlatformHttp(false)
+, mbFollowRedirects(true)
 {
     mScheme[0] = 0;
 }
 
+void TransportInfo::Reset()
+{
+    GetHeaderMap(mHeaderMapOut)->clear();
+    GetHeaderMap(mHeaderMapIn)->clear();
+    GetFixedString(mURI)->clear();
+    GetFixedString(mEffectiveURI)->clear();
+    GetFixedString(mPath)->clear();
+    mScheme[0]              = 0;
+    mPort                   = 0;
+    mPostSize               = -1;
+    mTimeout                = 0;
+    mTimeoutInterval        = 0;
+    mResultCode             = 200;
+    mHttpRequestType        = kHttpRequestTypeUnknown;
+    mpTransportServerJobInfo = NULL;
+    mpRH                    = NULL;
+    mpView                  = NULL;
+    mpTransportServer       = NULL;
+    mpTransportHandler      = NULL;
+    mTransportHandlerData   = 0;
+    mpCookieManager         = NULL;
+    mbVerifySSLCert         = true;
+    mbAsync                 = true;
+    mbUsePlatformHttp       = false;
+    mbFollowRedirects       = true;
+}
+
 
 /////////////////////////////////////////////////////////////////////////////
 // TransportHandlerFileScheme
@@ -50,6 +50,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "DOMTimeStamp.h"
 #include "PageClientEA.h"
 #include "TileEA.h"
+#include "TileSurfacePoolEA.h"
 #include "TextureMapperEA.h"
 
 #include <EAWebKit/EAWebKitSystem.h>
@@ -59,6 +60,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <internal/include/EAWebKitFPUPrecision.h> 
 #include <internal/include/InputBinding/EAWebKitUtils.h>
 #include <internal/include/EAWebKitViewNavigationDelegate.h>
+#include <internal/include/EAWebKitDirtyRegionTracker.h>
 
 #include "WebInspector.h"
 
@@ -157,9 +159,9 @@ public:
 	bool mRemoveNonVisibleTiles;
 	bool mAllowJSTextInputStateNotificationOnConsole;
 	int mTileSize;
+	TileParameters mTileParameters;
 
-    typedef eastl::vector<WebCore::IntRect> DirtyRegions;
-	DirtyRegions mDirtyRegions;
+	DirtyRegionTracker mDirtyRegions;
 
     typedef eastl::map<eastl::string, IJSBoundObject*> JSObjectMap;
     JSObjectMap mBoundObjects;
@@ -189,6 +191,7 @@ public:
 #if ENABLE(TILED_BACKING_STORE)
 	typedef eastl::list<WebCore::TileEA*> Tiles;
 	Tiles mTiles;
+	WebCore::TileSurfacePool mTileSurfacePool;
 #endif	
 #if USE(ACCELERATED_COMPOSITING)
 	typedef eastl::list<WebCore::BitmapTextureEA*> Textures;
@@ -261,9 +264,13 @@ void View::Paint(bool tickLib)
                     coreView->updateLayoutAndStyleIfNeededRecursive();
                     NOTIFY_PROCESS_STATUS(kVProcessTypeLayout, EA::WebKit::kVProcessStatusEnded, this);
 
+                    // Add the glyphs that were rasterized in the background since layout found them, before they are drawn.
+                    if (ITextSystem* pTextSystem = EA::WebKit::GetTextSystem())
+                        pTextSystem->CommitPrefetchedGlyphs();
+
 					if(!HardwareAccelerated()) //Software rendering path
 					{
-						if (!d->mDirtyRegions.empty()) 
+						if (!d->mDirtyRegions.IsEmpty()) 
 						{
 							ViewUpdateInfo info;
 							info.mpView = this;
@@ -273,10 +280,11 @@ void View::Paint(bool tickLib)
 							//AddDirtyRegion(IntRect(IntPoint(0, 0), GetSize())); //Uncomment as a debug tool to repaint entire screen
 
 							// Translate the dirty regions into something we can export outside the DLL.
-							eastl::vector<IntRect> eaDirtyRegions(d->mDirtyRegions.size());
-							for (int i = 0; i < (int) d->mDirtyRegions.size(); ++i)
+							const DirtyRegionTracker::Regions& dirtyRegions = d->mDirtyRegions.GetRegions();
+							eastl::vector<IntRect> eaDirtyRegions(dirtyRegions.size());
+							for (int i = 0; i < (int) dirtyRegions.size(); ++i)
 							{
-								eaDirtyRegions[i] = d->mDirtyRegions[i];
+								eaDirtyRegions[i] = dirtyRegions[i];
 							}
 
 							info.mDirtyRegions = eaDirtyRegions.data();
@@ -290,7 +298,7 @@ void View::Paint(bool tickLib)
 								NOTIFY_PROCESS_STATUS(kVProcessTypeBeginViewUpdate, EA::WebKit::kVProcessStatusEnded, this);
 							}
 
-							frame->render(d->mDisplaySurface, d->mDirtyRegions);
+							frame->render(d->mDisplaySurface, dirtyRegions);
 							PaintOverlays();
 
 							if (pClient) 
@@ -301,7 +309,7 @@ void View::Paint(bool tickLib)
 								pClient->ViewUpdate(info);
 								NOTIFY_PROCESS_STATUS(kVProcessTypeEndViewUpdate, EA::WebKit::kVProcessStatusEnded, this);
 							}
-							d->mDirtyRegions.clear();
+							d->mDirtyRegions.Clear();
 						}
 					}
 					else //Hardware rendering path
@@ -328,15 +336,15 @@ void View::Paint(bool tickLib)
 							}
 							else
 							{
-								frame->render(d->mDisplaySurface, d->mDirtyRegions);
+								frame->render(d->mDisplaySurface, d->mDirtyRegions.GetRegions());
 							}
 #endif //ENABLE(TILED_BACKING_STORE)
 						NOTIFY_PROCESS_STATUS(kVProcessTypeHardwareRender, EA::WebKit::kVProcessStatusStarted, this);
 						// If hardware acceleration is enabled we always want to call frame->renderAccelerated
 						// so that the compositing commands get sent to the GPU.
-						frame->renderAccelerated(d->mDirtyRegions);
+						frame->renderAccelerated(d->mDirtyRegions.GetRegions());
 						PaintOverlaysAccelerated();
-						d->mDirtyRegions.clear();
+						d->mDirtyRegions.Clear();
 						d->mHardwareRenderer->EndPainting();
 
 						NOTIFY_PROCESS_STATUS(kVProcessTypeHardwareRender, EA::WebKit::kVProcessStatusEnded, this);
@@ -368,7 +376,7 @@ void View::PaintOverlaysAccelerated(void)
 void View::PaintOverlays(void)
 {
     int overlayCount = d->mOverlaySurfaces.size();
-    if (!overlayCount || (d->mDirtyRegions.empty()))
+    if (!overlayCount || (d->mDirtyRegions.IsEmpty()))
     {
         return;
     }
@@ -388,9 +396,10 @@ void View::PaintOverlays(void)
     ViewPrivate::OverlaySurfaces::const_iterator end = d->mOverlaySurfaces.end();    
     for (; iter < end; ++iter) 
 	{
-        for (unsigned i = 0; i < d->mDirtyRegions.size(); ++i) 
+        const DirtyRegionTracker::Regions& dirtyRegions = d->mDirtyRegions.GetRegions();
+        for (unsigned i = 0; i < dirtyRegions.size(); ++i) 
 		{
-            if (iter->mRect.intersects(d->mDirtyRegions[i]))
+            if (iter->mRect.intersects(dirtyRegions[i]))
             {
                 // Just blit over the full surface so we don't have to do this multiple times if intersecting with many dirty rects 
                 ISurface::SurfaceDescriptor overlayDescriptor = {0};
@@ -467,6 +476,10 @@ bool View::InitView(const ViewParameters& vp)
 			EAW_ASSERT_MSG(!displaySurface, "Don't pass a display surface if using tiled backing storage. Backing tiles will be created by EAWebKit.");
 			d->mTileSize = vp.mTileSize;
 			d->mRemoveNonVisibleTiles = vp.mRemoveNonVisibleTiles;
+#if ENABLE(TILED_BACKING_STORE)
+			d->mTileSurfacePool.SetRenderer(vp.mHardwareRenderer);
+			d->mTileSurfacePool.SetBudget(d->mTileParameters.mTileMemoryBudget);
+#endif
 		}
 		if(!displaySurface)
 		{
@@ -498,6 +511,8 @@ bool View::InitView(const ViewParameters& vp)
 			Page()->handle()->page->settings()->setTiledBackingStoreEnabled(true);
 			Page()->handle()->page->mainFrame()->tiledBackingStore()->SetUseTimers(false);
 			Page()->handle()->page->mainFrame()->tiledBackingStore()->setTileSize(WebCore::IntSize(d->mTileSize,d->mTileSize));
+			Page()->handle()->page->mainFrame()->tiledBackingStore()->setTileMemoryBudget(d->mTileParameters.mTileMemoryBudget);
+			Page()->handle()->page->mainFrame()->tiledBackingStore()->setPrefetchEnabled(d->mTileParameters.mPrefetchTiles);
 		}
 		else
 		{
@@ -537,6 +552,9 @@ void View::ShutdownView(void)
 		}
 		delete d->page;
 		d->page = NULL;
+#if ENABLE(TILED_BACKING_STORE)
+		d->mTileSurfacePool.Clear(); // The tiles went away with the page.
+#endif
 
 		d->OverlayChangeNotify();
 		EAW_ASSERT(!d->mOverlaySurfaces.size());
@@ -766,7 +784,7 @@ void View::SetSize(IntSize size)
         d->mDisplaySurface->SetContentDimensions(size.mWidth, size.mHeight);
     	
 		// Clear any old dirty regions since the resize could have invalidated them.
-        d->mDirtyRegions.clear();
+        d->mDirtyRegions.Clear();
     }
 	
 	ForceInvalidateFullView();
@@ -1269,6 +1287,28 @@ void View::ForceInvalidateFullView()
 	}
 #endif
 }
+
+void View::SetTileParameters(const TileParameters& tileParameters)
+{
+	SET_AUTOFPUPRECISION(EA::WebKit::kFPUPrecisionExtended);
+	EAWEBKIT_THREAD_CHECK();
+	EAWWBKIT_INIT_CHECK(); 
+
+	d->mTileParameters = tileParameters;
+
+#if ENABLE(TILED_BACKING_STORE)
+	// Without a page yet, InitView applies them.
+	if (d->mUsingTiledBackingStore && d->page)
+	{
+		d->mTileSurfacePool.SetBudget(tileParameters.mTileMemoryBudget);
+		if (WebCore::TiledBackingStore *backingStore = WebFramePrivate::core(d->page->mainFrame())->tiledBackingStore())
+		{
+			backingStore->setTileMemoryBudget(tileParameters.mTileMemoryBudget);
+			backingStore->setPrefetchEnabled(tileParameters.mPrefetchTiles);
+		}
+	}
+#endif
+}
 // Constructors for the metrics callback system
 ViewProcessInfo::ViewProcessInfo(void)
 : mpView(0),
@@ -1493,58 +1533,7 @@ uint32_t View::GetBackgroundColor(void) const
 
 void View::AddDirtyRegion(const IntRect &region) 
 {
-    WebCore::IntRect wcRegion(region);
-	ViewPrivate::DirtyRegions& dirtyRegions = d->mDirtyRegions;
-    for (uint32_t iRegion = 0; iRegion < dirtyRegions.size(); ++iRegion) 
-	{
-        WebCore::IntRect &iRegionRect = dirtyRegions[iRegion];
-        if (iRegionRect.intersects(wcRegion)) 
-		{
-            // If the region is fully contained there's no need to merge later.
-            if (iRegionRect.contains(wcRegion)) 
-			{
-                return;
-            }
-
-            // Otherwise, unite the rects, and execute the merge code.
-            iRegionRect.unite(wcRegion);
-            
-            // Repeatedly merge the rects until there is no change.
-            // This uses a goto because it's the easiest way to break out of
-            // a double nested loop and restart the process.
-RestartMerge:
-            const uint32_t dirtyRegionCount = dirtyRegions.size();
-            for (uint32_t i = 0; i < dirtyRegionCount; ++i) 
-			{
-                WebCore::IntRect &iRect = dirtyRegions[i];
-                for (uint32_t j = i + 1; j < dirtyRegionCount; ++j) 
-				{
-                    const WebCore::IntRect &jRect = dirtyRegions[j];
-                    if (iRect.intersects(jRect)) 
-					{
-                        iRect.unite(jRect);
-                        dirtyRegions.erase(dirtyRegions.begin() + j);
-                        goto RestartMerge;
-                    }
-                }
-            }
-
-#if _DEBUG
-			// There should be no intersecting rects in dirtyRegions at this point.
-            for (uint32_t i = 0; i < dirtyRegions.size(); ++i) 
-			{
-                for (uint32_t j = i+1; j < dirtyRegions.size(); ++j) 
-				  {
-                    EAW_ASSERT_MSG(dirtyRegions[i].intersects(dirtyRegions[j]) == false, "Intersecting Dirty rects");
-                }
-            }
-#endif
-            return;
-        }
-    }
-
-    // The region didn't intersect with anything, add it as a new region.
-    dirtyRegions.push_back(wcRegion);
+    d->mDirtyRegions.Add(WebCore::IntRect(region));
 }
 
 ISurface* View::GetDisplaySurface(void) 
@@ -1581,6 +1570,15 @@ void View::RemoveTile(WebCore::TileEA* tile)
 #endif
 }
 
+WebCore::TileSurfacePool* View::GetTileSurfacePool()
+{
+#if ENABLE(TILED_BACKING_STORE)
+	return &d->mTileSurfacePool;
+#else
+	return NULL;
+#endif
+}
+
 void View::AddTexture(WebCore::BitmapTextureEA* texture)
 {
 #if USE(ACCELERATED_COMPOSITING)
@@ -0,0 +1,81 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// EAWebKitDirtyRegionTracker.h
+//
+// Maintained by EAWebKit Team
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EAWEBKIT_EAWEBKITDIRTYREGIONTRACKER_H
+#define EAWEBKIT_EAWEBKITDIRTYREGIONTRACKER_H
+
+#include <EABase/eabase.h>
+#include <internal/include/EAWebkitEASTLHelpers.h>
+#include <EASTL/vector.h>
+#include "IntRect.h"
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+		// Collects the rects invalidated between two paints. The rects kept never overlap, so no pixel is painted twice, and
+		// there are never more than kMaxRegionCount of them.
+		//
+		// Every rect painted costs a surface lock and a walk of the render tree on top of its pixels. So a new rect is merged
+		// with the existing rect that wastes the fewest pixels when united with it, as long as the waste stays under what a
+		// separate paint would cost. Otherwise the new rect keeps only its parts not covered yet. When the list is full, the
+		// two rects that waste the fewest pixels together are merged.
+		class DirtyRegionTracker
+		{
+		public:
+			typedef eastl::vector<WebCore::IntRect> Regions;
+
+			static const uint32_t kMaxRegionCount = 32;
+			static const int64_t  kRegionOverheadArea = 64 * 64; // Pixels we would rather overpaint than paint another rect.
+
+			void Add(const WebCore::IntRect& rect);
+			void Clear() { mRegions.clear(); }
+
+			bool IsEmpty() const { return mRegions.empty(); }
+			const Regions& GetRegions() const { return mRegions; }
+
+		private:
+			void Insert(const WebCore::IntRect& rect);
+			void Absorb(const WebCore::IntRect& rect); // Unites rect with every rect it overlaps, however much that overpaints.
+			void MergeCheapestPair();
+
+			Regions mRegions;
+			Regions mPending; // Rects waiting to be inserted while an Add runs.
+		};
+    }
+}
+
+#endif // EAWEBKIT_EAWEBKITDIRTYREGIONTRACKER_H
@@ -33,6 +33,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <EAWebKit/EAWebKitConfig.h>
 #include <EAWebKit/EAWebKitTextInterface.h>
 #include <EAWebKit/EAWebkitAllocator.h> 
+#include <internal/include/EAWebKitThreadPool.h>
 
 #include <EAText/EATextFontServer.h>   
 #include <EAText/EATextFont.h>
@@ -40,13 +41,18 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <EAText/EATextBreak.h> 
 #include <EAText/EATextTypesetter.h>
 #include <eastl/map.h>
+#include <EASTL/fixed_vector.h>
+#include <EASTL/vector.h>
 
 namespace EA
 {
 namespace WebKit
 {
+    struct GlyphCacheUsageInfo;
+
     void InitFontSystem(void);
     void ShutdownFontSystem(void);
+    void GetFontSystemGlyphCacheUsage(GlyphCacheUsageInfo& glyphCacheUsageInfo);
 
 class TextSystem;
 // This class implements the font interface defined by EAWebKit.
@@ -142,6 +148,10 @@ public:
 
 	virtual uint32_t GetFamilyNameArrayCapacity(void);
 
+    // Glyph prefetch
+    virtual void PrefetchGlyphs(EA::WebKit::IFont* pFont, const EA::WebKit::GlyphId* gIdArray, int glyphCount);
+    virtual void CommitPrefetchedGlyphs(void);
+
     // Implementation specific methods of this class
     EA::Text::FontServer* GetFontServer(void) 
     { 
@@ -160,11 +170,18 @@ public:
     void FlushGlyphCache(void);
     void RemoveTextureInfoFromGlyphCache(EA::Text::Font* pFont);   
     void ResetDrawInfoVector(void);
+    void GetGlyphCacheUsage(GlyphCacheUsageInfo& glyphCacheUsageInfo) const;
 
  private:
     FontImpl* CreateFontImpl(EA::Text::Font* pFont);
-    bool FillGlyphDrawInfo(EA::WebKit::IFont* pFont, const EA::WebKit::GlyphId* gIdArray, int glyphCount, EA::WebKit::GlyphDrawInfo* outGDI, bool abortOnFail);
+    bool FillGlyphDrawInfo(EA::WebKit::IFont* pFont, const EA::WebKit::GlyphId* gIdArray, int glyphCount, EA::WebKit::GlyphDrawInfo* outGDI, bool abortOnFail, int* pFilledCount = NULL);
     bool GetCachedGlyph(EA::Text::Font* pFont, EA::WebKit::GlyphId g, EA::WebKit::GlyphDrawInfo& gti);
+    void TouchGlyphCachePage(EA::Text::TextureInfo* pTextureInfo);
+    bool EvictGlyphCachePage(void);
+    void ScheduleGlyphPrefetchBatch(void);
+    static void RenderGlyphPrefetchBatch(void* pContext);
+    struct GlyphPrefetchBatch;
+    void FinishGlyphPrefetchBatch(GlyphPrefetchBatch* pBatch, bool bCommit);
     bool BuildDrawInfoFromLineLayout(const EA::Text::LineLayout& line, bool abortOnFail, float clipLeft, float clipRight, float& outXMin, float& outXMax, float& outYMin, float& outYMax);  
 
     eastl::list<EA::WebKit::FontImpl*, EA::WebKit::EASTLAllocator> mActiveFonts;
@@ -180,6 +197,51 @@ public:
 
     typedef eastl::fixed_vector<EA::WebKit::GlyphDrawInfo, 500, true, EASTLAllocator> GlyphDrawInfoVector;
     GlyphDrawInfoVector mCurrentGlyphDrawInfoVector;       // The current draw info for the text string (complex text).
+
+    // Last use of each glyph cache page, so that a full cache can be made room in by clearing the least recently used page 
+    // instead of every page. The use serial is bumped for every text run.
+    struct GlyphCachePage
+    {
+        EA::Text::TextureInfo*  mpTextureInfo;
+        uint32_t                mLastUse;
+    };
+    typedef eastl::fixed_vector<GlyphCachePage, 8, true, EASTLAllocator> GlyphCachePageVector;
+    GlyphCachePageVector mGlyphCachePages;
+    uint32_t mGlyphCacheUseSerial;
+    bool mbGlyphCacheFull;                      // Set when a glyph could not be added for lack of space.
+
+    uint32_t mGlyphCacheHits;
+    uint32_t mGlyphCacheMisses;
+    uint32_t mGlyphCacheEvictedPages;
+    uint32_t mGlyphCacheFlushes;
+    uint32_t mGlyphCachePrefetchedGlyphs;
+
+    // Prefetched glyphs are rasterized on the thread pool in batches. A batch belongs to its worker from the time it is
+    // scheduled until its work group is done, after which the main thread adds its bitmaps to the glyph cache.
+    enum { kGlyphPrefetchBatchSize = 32, kMaxScheduledPrefetchGlyphs = 1024 };
+
+    struct PrefetchGlyph
+    {
+        EA::Text::Font*     mpFont;         // A reference is held until the glyph is committed.
+        EA::Text::GlyphId   mGlyphId;
+        bool                mbRendered;     // The members below are set by the worker if true.
+        uint32_t            mnWidth;
+        uint32_t            mnHeight;
+        uint32_t            mnStride;
+        uint32_t            mBitmapFormat;
+        uint32_t            mDataOffset;    // Into GlyphPrefetchBatch::mData.
+    };
+
+    struct GlyphPrefetchBatch
+    {
+        eastl::fixed_vector<PrefetchGlyph, kGlyphPrefetchBatchSize, false, EASTLAllocator> mGlyphs;
+        eastl::vector<uint8_t, EASTLAllocator> mData;
+        ThreadPoolWorkGroup mWorkGroup;
+    };
+    typedef eastl::fixed_vector<GlyphPrefetchBatch*, kMaxScheduledPrefetchGlyphs / kGlyphPrefetchBatchSize, false, EASTLAllocator> GlyphPrefetchBatchVector;
+
+    GlyphPrefetchBatch*         mpPendingPrefetchBatch;     // Being filled by PrefetchGlyphs.
+    GlyphPrefetchBatchVector    mScheduledPrefetchBatches;
 };
 
 } // Namespace WebKit
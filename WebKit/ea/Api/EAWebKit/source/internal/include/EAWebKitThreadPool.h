@@ -0,0 +1,140 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// EAWebKitThreadPool.h
+//
+// Maintained by EAWebKit Team
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EAWEBKIT_EAWEBKITTHREADPOOL_H
+#define EAWEBKIT_EAWEBKITTHREADPOOL_H
+
+#include <EABase/eabase.h>
+#include <EAWebKit/EAWebKitThreadInterface.h>
+#include <internal/include/EAWebkitEASTLHelpers.h>
+#include <EASTL/deque.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+		// Work scheduled with the same group can be waited on together.
+		class ThreadPoolWorkGroup
+		{
+		public:
+			ThreadPoolWorkGroup()
+				: mPendingCount(0)
+				, mQueuedCount(0)
+			{
+			}
+		private:
+			friend class ThreadPool;
+			uint32_t mPendingCount; // Protected by the pool mutex.
+			uint32_t mQueuedCount;  // Protected by the pool mutex. Pending work not taken by a thread yet.
+		};
+
+		// A pool of worker threads created through the IThreadSystem. Every worker has its own queue. Work scheduled from a worker
+		// goes on the worker's queue and the worker runs its newest work first, while idle workers steal the oldest work of the
+		// others. If the thread system can't create threads, the work runs on the calling thread.
+		//
+		// Unlike IThreadSystem::ScheduleWork, ScheduleWork here returns right away. The pool starts on first use, which is
+		// expected to be on the main thread, and is shut down with EAWebKit.
+		class ThreadPool
+		{
+		public:
+			static ThreadPool& GetInstance()
+			{
+				static ThreadPool instance;
+				return instance;
+			}
+			void Shutdown(); // Runs the work still queued and ends the worker threads.
+
+			void ScheduleWork(DoWorkEntryPoint doWork, void* workContext, ThreadPoolWorkGroup* pWorkGroup = NULL);
+			
+			// Returns once all the work scheduled with pWorkGroup ran. A worker runs any queued work while it waits, so it is
+			// fine to wait from a worker. Other threads only run the queued work of pWorkGroup and otherwise block.
+			void Wait(ThreadPoolWorkGroup* pWorkGroup);
+
+			// Returns true if all the work scheduled with pWorkGroup ran. Does not run or wait for any work.
+			bool IsDone(ThreadPoolWorkGroup* pWorkGroup);
+
+			uint32_t GetWorkerCount(); // 0 if the work runs on the calling thread.
+
+		private:
+			ThreadPool();
+			ThreadPool(const ThreadPool& instance);
+			ThreadPool& operator = (const ThreadPool& instance);
+
+			enum { kMaxWorkerCount = 8 };
+
+			struct WorkItem
+			{
+				DoWorkEntryPoint		mDoWork;
+				void*					mpWorkContext;
+				ThreadPoolWorkGroup*	mpWorkGroup;
+			};
+			typedef eastl::deque<WorkItem, EASTLAllocator> WorkQueue;
+
+			struct Worker
+			{
+				ThreadPool*	mpThreadPool;
+				uint32_t	mIndex;
+				IThread*	mpThread;
+				IMutex*		mpQueueMutex;
+				WorkQueue	mQueue;     // Protected by mpQueueMutex.
+				bool		mbRunning;
+			};
+
+			void Start();
+			void DestroyWorker(Worker* pWorker);
+			Worker* GetCurrentWorker();
+			bool PopWork(Worker* pSelf, WorkItem& item);
+			bool PopGroupWork(ThreadPoolWorkGroup* pWorkGroup, WorkItem& item);
+			void RunWork(const WorkItem& item);
+			void RunWorker(Worker* pWorker);
+			static void* WorkerThreadFunction(void* pContext);
+
+			IThreadSystem*			mpThreadSystem;
+			IMutex*					mpMutex;
+			IThreadCondition*		mpCondition;        // Signaled when work is queued or a work group completes.
+			IThreadLocalStorage*	mpCurrentWorker;
+			Worker*					mWorkers[kMaxWorkerCount];
+			uint32_t				mWorkerCount;
+			uint32_t				mNextWorker;        // Protected by mpMutex. Round robin for work scheduled from other threads.
+			uint32_t				mQueuedCount;       // Protected by mpMutex. Work in all the queues.
+			uint32_t				mWaiterCount;       // Protected by mpMutex. Threads other than the workers blocked in Wait.
+			bool					mbStarted;
+			bool					mbStop;             // Protected by mpMutex.
+		};
+    }
+}
+
+#endif // EAWEBKIT_EAWEBKITTHREADPOOL_H
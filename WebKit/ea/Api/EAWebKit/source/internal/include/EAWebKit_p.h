@@ -48,8 +48,14 @@ void  DestroyView(View* pView);
 
 void			SetRAMCacheUsage(const RAMCacheInfo& ramCacheInfo);
 void			GetRAMCacheUsage(RAMCacheUsageInfo& ramCacheUsageInfo);
+void			GetImageDecodeUsage(ImageDecodeUsageInfo& imageDecodeUsageInfo);
 bool			SetDiskCacheUsage(const DiskCacheInfo& diskCacheInfo); //Returns a bool that indicates if cache directory is successfully created.
 void			GetDiskCacheUsage(DiskCacheUsageInfo& diskCacheUsageInfo);
+void			GetTransportJobQueueInfo(TransportJobQueueInfo& transportJobQueueInfo);
+void			GetHttpConnectionUsageInfo(HttpConnectionUsageInfo& httpConnectionUsageInfo);
+void			GetGlyphCacheUsage(GlyphCacheUsageInfo& glyphCacheUsageInfo);
+void			GetImageCompressionUsage(ImageCompressionUsageInfo& imageCompressionUsageInfo);
+void			GetDiskCacheSharingUsage(DiskCacheSharingUsageInfo& diskCacheSharingUsageInfo);
 void			SetCookieUsage(const CookieInfo& cookieInfo);
 void            SetTextSystem(ITextSystem* pTextSystem);    // This replaces the old glyph cache and font server set.
 ITextSystem*    GetTextSystem();
@@ -0,0 +1,217 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// EAWebKitDirtyRegionTracker.cpp
+//
+// Maintained by EAWebKit Team
+///////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include <internal/include/EAWebKitDirtyRegionTracker.h>
+#include <internal/include/EAWebKitAssert.h>
+#include <EASTL/algorithm.h>
+
+namespace EA
+{
+namespace WebKit
+{
+
+namespace
+{
+// Cap on the rects inserted by one Add before the remaining ones are simply united with whatever they overlap.
+const uint32_t kMaxInsertCount = DirtyRegionTracker::kMaxRegionCount * 8;
+
+int64_t GetArea(const WebCore::IntRect& rect)
+{
+	return (int64_t) rect.width() * rect.height();
+}
+
+// Pixels painted by the union of a and b that neither a nor b needed.
+int64_t GetMergeWaste(const WebCore::IntRect& a, const WebCore::IntRect& b)
+{
+	WebCore::IntRect overlap(a);
+	overlap.intersect(b);
+	WebCore::IntRect bounds(a);
+	bounds.unite(b);
+	return GetArea(bounds) - (GetArea(a) + GetArea(b) - GetArea(overlap));
+}
+
+// Adds the parts of rect outside of hole to pieces. Full width bands above and below the hole come first, then what is left
+// on either side of it.
+void Subtract(const WebCore::IntRect& rect, const WebCore::IntRect& hole, DirtyRegionTracker::Regions& pieces)
+{
+	if (hole.y() > rect.y())
+		pieces.push_back(WebCore::IntRect(rect.x(), rect.y(), rect.width(), hole.y() - rect.y()));
+	if (hole.maxY() < rect.maxY())
+		pieces.push_back(WebCore::IntRect(rect.x(), hole.maxY(), rect.width(), rect.maxY() - hole.maxY()));
+
+	const int top = eastl::max_alt(rect.y(), hole.y());
+	const int bottom = eastl::min_alt(rect.maxY(), hole.maxY());
+	if (hole.x() > rect.x())
+		pieces.push_back(WebCore::IntRect(rect.x(), top, hole.x() - rect.x(), bottom - top));
+	if (hole.maxX() < rect.maxX())
+		pieces.push_back(WebCore::IntRect(hole.maxX(), top, rect.maxX() - hole.maxX(), bottom - top));
+}
+}
+
+void DirtyRegionTracker::Add(const WebCore::IntRect& rect)
+{
+	if (rect.isEmpty())
+		return;
+
+	mPending.push_back(rect);
+	for (uint32_t insertCount = 0; !mPending.empty(); ++insertCount)
+	{
+		WebCore::IntRect pendingRect = mPending.back();
+		mPending.pop_back();
+		if (insertCount < kMaxInsertCount)
+			Insert(pendingRect);
+		else
+			Absorb(pendingRect);
+	}
+
+	while (mRegions.size() > kMaxRegionCount)
+		MergeCheapestPair();
+
+#if _DEBUG
+	// There should be no intersecting rects in mRegions at this point.
+	for (uint32_t i = 0; i < mRegions.size(); ++i)
+	{
+		for (uint32_t j = i + 1; j < mRegions.size(); ++j)
+		{
+			EAW_ASSERT_MSG(mRegions[i].intersects(mRegions[j]) == false, "Intersecting Dirty rects");
+		}
+	}
+#endif
+}
+
+void DirtyRegionTracker::Insert(const WebCore::IntRect& rect)
+{
+	int64_t cheapestWaste = kRegionOverheadArea + 1;
+	uint32_t cheapestIndex = 0;
+	for (uint32_t i = 0; i < mRegions.size(); )
+	{
+		const WebCore::IntRect& region = mRegions[i];
+		if (region.contains(rect))
+			return;
+
+		if (rect.contains(region))
+		{
+			mRegions.erase(mRegions.begin() + i);
+			continue;
+		}
+
+		const int64_t waste = GetMergeWaste(region, rect);
+		if (waste < cheapestWaste)
+		{
+			cheapestWaste = waste;
+			cheapestIndex = i;
+		}
+		++i;
+	}
+
+	// Merging is cheaper than painting one more rect. The union goes back in the pending list since it may now overlap others.
+	if (cheapestWaste <= kRegionOverheadArea)
+	{
+		WebCore::IntRect merged(mRegions[cheapestIndex]);
+		merged.unite(rect);
+		mRegions.erase(mRegions.begin() + cheapestIndex);
+		mPending.push_back(merged);
+		return;
+	}
+
+	for (uint32_t i = 0; i < mRegions.size(); ++i)
+	{
+		if (mRegions[i].intersects(rect))
+		{
+			Subtract(rect, mRegions[i], mPending);
+			return;
+		}
+	}
+
+	mRegions.push_back(rect);
+}
+
+void DirtyRegionTracker::Absorb(const WebCore::IntRect& rect)
+{
+	WebCore::IntRect merged(rect);
+
+	// Each union can reach rects the previous one didn't, so repeat until nothing overlaps.
+	bool grew = true;
+	while (grew)
+	{
+		grew = false;
+		for (uint32_t i = 0; i < mRegions.size(); )
+		{
+			if (mRegions[i].intersects(merged))
+			{
+				merged.unite(mRegions[i]);
+				mRegions.erase(mRegions.begin() + i);
+				grew = true;
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+
+	mRegions.push_back(merged);
+}
+
+void DirtyRegionTracker::MergeCheapestPair()
+{
+	EAW_ASSERT(mRegions.size() >= 2);
+
+	int64_t cheapestWaste = GetMergeWaste(mRegions[0], mRegions[1]);
+	uint32_t cheapestI = 0;
+	uint32_t cheapestJ = 1;
+	for (uint32_t i = 0; i < mRegions.size(); ++i)
+	{
+		for (uint32_t j = i + 1; j < mRegions.size(); ++j)
+		{
+			const int64_t waste = GetMergeWaste(mRegions[i], mRegions[j]);
+			if (waste < cheapestWaste)
+			{
+				cheapestWaste = waste;
+				cheapestI = i;
+				cheapestJ = j;
+			}
+		}
+	}
+
+	WebCore::IntRect merged(mRegions[cheapestI]);
+	merged.unite(mRegions[cheapestJ]);
+	mRegions.erase(mRegions.begin() + cheapestJ); // cheapestJ > cheapestI, so erase it first.
+	mRegions.erase(mRegions.begin() + cheapestI);
+	Absorb(merged);
+}
+
+} // namespace WebKit
+} // namespace EA
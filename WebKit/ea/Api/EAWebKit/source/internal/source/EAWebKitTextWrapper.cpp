@@ -62,6 +62,13 @@ inline void delete_object(T* pObject, EA::Allocator::ICoreAllocator* pAllocator)
 
 #define EATEXT_WRAPPER_DELETE(pObject, pAllocator) delete_object(pObject,pAllocator)
 //-
+
+// Glyphs are only prefetched on worker threads if EAText fonts are thread safe.
+#if defined(EATEXT_THREAD_SAFETY_ENABLED) && EATEXT_THREAD_SAFETY_ENABLED
+    #define EAWEBKIT_GLYPH_PREFETCH_ENABLED 1
+#else
+    #define EAWEBKIT_GLYPH_PREFETCH_ENABLED 0
+#endif
         
         
 // Small helper function to find allocator used
@@ -913,6 +920,14 @@ TextSystem::TextSystem(EA::Text::FontServer* pFontServer, EA::Text::GlyphCache*
     , mpGlyphCache(pGlyphCache)
     , mOwnFontServer(false)    
     , mOwnGlyphCache(false)  
+    , mGlyphCacheUseSerial(0)
+    , mbGlyphCacheFull(false)
+    , mGlyphCacheHits(0)
+    , mGlyphCacheMisses(0)
+    , mGlyphCacheEvictedPages(0)
+    , mGlyphCacheFlushes(0)
+    , mGlyphCachePrefetchedGlyphs(0)
+    , mpPendingPrefetchBatch(NULL)
 {
     // Create our own server here if 
     // EAWebKitTODO: add...
@@ -934,6 +949,19 @@ bool TextSystem::Init(void)
 
 bool TextSystem::Shutdown(void)
 {
+    // Releases the font references held by prefetched glyphs.
+    if (mpPendingPrefetchBatch)
+    {
+        FinishGlyphPrefetchBatch(mpPendingPrefetchBatch, false);
+        mpPendingPrefetchBatch = NULL;
+    }
+    for (GlyphPrefetchBatchVector::iterator itBatch = mScheduledPrefetchBatches.begin(); itBatch != mScheduledPrefetchBatches.end(); ++itBatch)
+    {
+        ThreadPool::GetInstance().Wait(&(*itBatch)->mWorkGroup);
+        FinishGlyphPrefetchBatch(*itBatch, false);
+    }
+    mScheduledPrefetchBatches.clear();
+
     mCurrentGlyphDrawInfoVector.set_capacity(0); 
     
     eastl::list<EA::WebKit::FontImpl*, EA::WebKit::EASTLAllocator> currentlyActiveFonts = mActiveFonts;
@@ -1041,13 +1069,203 @@ void TextSystem::FlushGlyphCache(void)
         if (pInfo)
             mpGlyphCache->ClearTexture(pInfo);
     }
+    mGlyphCachePages.clear();
+    ++mGlyphCacheFlushes;
+}
+
+void TextSystem::TouchGlyphCachePage(EA::Text::TextureInfo* pTextureInfo)
+{
+    for (GlyphCachePageVector::iterator it = mGlyphCachePages.begin(); it != mGlyphCachePages.end(); ++it)
+    {
+        if (it->mpTextureInfo == pTextureInfo)
+        {
+            it->mLastUse = mGlyphCacheUseSerial;
+            return;
+        }
+    }
+
+    GlyphCachePage page;
+    page.mpTextureInfo = pTextureInfo;
+    page.mLastUse = mGlyphCacheUseSerial;
+    mGlyphCachePages.push_back(page);
+}
+
+// Clears the least recently used page that the current text run does not use, as glyphs from the current run 
+// could be referenced from it. Returns false if there is no such page.
+bool TextSystem::EvictGlyphCachePage(void)
+{
+    GlyphCachePageVector::iterator itLRU = mGlyphCachePages.end();
+    uint32_t maxAge = 0;
+    for (GlyphCachePageVector::iterator it = mGlyphCachePages.begin(); it != mGlyphCachePages.end(); ++it)
+    {
+        const uint32_t age = mGlyphCacheUseSerial - it->mLastUse;   // Wrap safe.
+        if (age > maxAge)
+        {
+            maxAge = age;
+            itLRU = it;
+        }
+    }
+
+    if (itLRU == mGlyphCachePages.end())
+        return false;
+
+    mpGlyphCache->ClearTexture(itLRU->mpTextureInfo);
+    mGlyphCachePages.erase(itLRU);
+    ++mGlyphCacheEvictedPages;
+    return true;
+}
+
+void TextSystem::GetGlyphCacheUsage(GlyphCacheUsageInfo& glyphCacheUsageInfo) const
+{
+    glyphCacheUsageInfo.mPageCount = (uint32_t)mGlyphCachePages.size();
+    glyphCacheUsageInfo.mHits = mGlyphCacheHits;
+    glyphCacheUsageInfo.mMisses = mGlyphCacheMisses;
+    glyphCacheUsageInfo.mEvictedPages = mGlyphCacheEvictedPages;
+    glyphCacheUsageInfo.mFlushes = mGlyphCacheFlushes;
+    glyphCacheUsageInfo.mPrefetchedGlyphs = mGlyphCachePrefetchedGlyphs;
+}
+
+void TextSystem::PrefetchGlyphs(EA::WebKit::IFont* pFont, const EA::WebKit::GlyphId* gIdArray, int glyphCount)
+{
+#if EAWEBKIT_GLYPH_PREFETCH_ENABLED
+    // Checked first, as GetWorkerCount starts the thread pool. Without worker threads, the glyphs would just be rasterized now 
+    // instead of at paint.
+    if (!GetParameters().mEnableGlyphPrefetch || !ThreadPool::GetInstance().GetWorkerCount())
+        return;
+
+    EA::Text::Font* pFontEA = static_cast<EA::WebKit::FontImpl*> (pFont)->mpFont;
+    for (int i = 0; i < glyphCount; ++i)
+    {
+        if ((mScheduledPrefetchBatches.size() * kGlyphPrefetchBatchSize) >= kMaxScheduledPrefetchGlyphs)
+            return; // Enough in flight. The rest is rasterized when drawn.
+
+        EA::Text::GlyphTextureInfo gtiEA;
+        const EA::Text::GlyphId glyphEA = GetEAText_GlyphId(gIdArray[i]);
+        if (mpGlyphCache->GetGlyphTextureInfo(pFontEA, glyphEA, gtiEA))
+            continue;
+
+        if (!mpPendingPrefetchBatch)
+            mpPendingPrefetchBatch = EATEXT_WRAPPER_NEW(GlyphPrefetchBatch, GetAllocator_Helper(), "GlyphPrefetchBatch");
+
+        PrefetchGlyph glyph;
+        glyph.mpFont = pFontEA;
+        glyph.mGlyphId = glyphEA;
+        glyph.mbRendered = false;
+        pFontEA->AddRef();
+        mpPendingPrefetchBatch->mGlyphs.push_back(glyph);
+
+        if (mpPendingPrefetchBatch->mGlyphs.size() == kGlyphPrefetchBatchSize)
+            ScheduleGlyphPrefetchBatch();
+    }
+#else
+    (void)pFont; (void)gIdArray; (void)glyphCount;
+#endif
+}
+
+void TextSystem::ScheduleGlyphPrefetchBatch(void)
+{
+    EA_ASSERT(mpPendingPrefetchBatch && !mpPendingPrefetchBatch->mGlyphs.empty());
+
+    mScheduledPrefetchBatches.push_back(mpPendingPrefetchBatch);
+    ThreadPool::GetInstance().ScheduleWork(RenderGlyphPrefetchBatch, mpPendingPrefetchBatch, &mpPendingPrefetchBatch->mWorkGroup);
+    mpPendingPrefetchBatch = NULL;
+}
+
+// Runs on a worker thread. EAText fonts lock themselves from RenderGlyphBitmap to DoneGlyphBitmap, so the bitmaps are copied out.
+void TextSystem::RenderGlyphPrefetchBatch(void* pContext)
+{
+    GlyphPrefetchBatch* pBatch = static_cast<GlyphPrefetchBatch*> (pContext);
+
+    for (int i = 0; i < (int) pBatch->mGlyphs.size(); ++i)
+    {
+        PrefetchGlyph& glyph = pBatch->mGlyphs[i];
+
+        const EA::Text::Font::GlyphBitmap* pGlyphBitmap = 0;    
+        if (glyph.mpFont->RenderGlyphBitmap(&pGlyphBitmap, glyph.mGlyphId))
+        {
+            const uint8_t* pData = (const uint8_t*) pGlyphBitmap->mpData;
+            const uint32_t dataSize = pGlyphBitmap->mnStride * pGlyphBitmap->mnHeight;
+
+            glyph.mnWidth = pGlyphBitmap->mnWidth;
+            glyph.mnHeight = pGlyphBitmap->mnHeight;
+            glyph.mnStride = pGlyphBitmap->mnStride;
+            glyph.mBitmapFormat = (uint32_t) pGlyphBitmap->mBitmapFormat;
+            glyph.mDataOffset = (uint32_t) pBatch->mData.size();
+            pBatch->mData.insert(pBatch->mData.end(), pData, pData + dataSize);
+            glyph.mbRendered = true;
+
+            glyph.mpFont->DoneGlyphBitmap(pGlyphBitmap);
+        }
+    }
+}
+
+void TextSystem::CommitPrefetchedGlyphs(void)
+{
+    if (mpPendingPrefetchBatch)
+        ScheduleGlyphPrefetchBatch();
+
+    if (mScheduledPrefetchBatches.empty())
+        return;
+
+    // Paint does not wait for the workers. The batches still being rasterized are committed by a later paint, and GetGlyphs 
+    // rasterizes their glyphs itself if they are drawn before that.
+    ++mGlyphCacheUseSerial; // As for a text run, so that the glyphs committed here don't clear each other's pages.
+    GlyphPrefetchBatchVector::iterator itKept = mScheduledPrefetchBatches.begin();
+    for (GlyphPrefetchBatchVector::iterator itBatch = mScheduledPrefetchBatches.begin(); itBatch != mScheduledPrefetchBatches.end(); ++itBatch)
+    {
+        if (ThreadPool::GetInstance().IsDone(&(*itBatch)->mWorkGroup))
+            FinishGlyphPrefetchBatch(*itBatch, true);
+        else
+            *itKept++ = *itBatch;
+    }
+    mScheduledPrefetchBatches.erase(itKept, mScheduledPrefetchBatches.end());
+}
+
+// If bCommit, adds the bitmaps of a batch that is done to the glyph cache, clearing the least recently used pages for them like 
+// GetGlyphs does. Then releases the font references of the batch and deletes it.
+void TextSystem::FinishGlyphPrefetchBatch(GlyphPrefetchBatch* pBatch, bool bCommit)
+{
+    for (int i = 0; i < (int) pBatch->mGlyphs.size(); ++i)
+    {
+        const PrefetchGlyph& glyph = pBatch->mGlyphs[i];
+
+        EA::Text::GlyphTextureInfo gtiEA;
+        if (bCommit && glyph.mbRendered && !mpGlyphCache->GetGlyphTextureInfo(glyph.mpFont, glyph.mGlyphId, gtiEA))
+        {
+            const uint8_t* pData = pBatch->mData.data() + glyph.mDataOffset;
+            bool bAdded = mpGlyphCache->AddGlyphTexture(glyph.mpFont, glyph.mGlyphId, pData, glyph.mnWidth, glyph.mnHeight, glyph.mnStride, glyph.mBitmapFormat, gtiEA);
+            if (!bAdded && EvictGlyphCachePage())
+                bAdded = mpGlyphCache->AddGlyphTexture(glyph.mpFont, glyph.mGlyphId, pData, glyph.mnWidth, glyph.mnHeight, glyph.mnStride, glyph.mBitmapFormat, gtiEA);
+
+            if (bAdded)
+            {
+                mpGlyphCache->EndUpdate(gtiEA.mpTextureInfo);
+                TouchGlyphCachePage(gtiEA.mpTextureInfo);
+                ++mGlyphCachePrefetchedGlyphs;
+            }
+            else
+            {
+                // Every page left was filled by this commit, or the glyph does not fit in a cleared page. Prefetched glyphs don't 
+                // flush the cache, so the rest are dropped.
+                bCommit = false;
+            }
+        }
+
+        // Same as FontImpl::Release, if this was the last reference.
+        if (!glyph.mpFont->Release())
+            RemoveTextureInfoFromGlyphCache(glyph.mpFont);
+    }
+    EATEXT_WRAPPER_DELETE(pBatch, GetAllocator_Helper());
 }
 
-bool TextSystem::FillGlyphDrawInfo(EA::WebKit::IFont* pFont, const EA::WebKit::GlyphId* gIdArray, int glyphCount, EA::WebKit::GlyphDrawInfo* outGDI, bool abortOnFail)
+// pFilledCount, if set, receives the number of glyphs filled in before the one that failed.
+bool TextSystem::FillGlyphDrawInfo(EA::WebKit::IFont* pFont, const EA::WebKit::GlyphId* gIdArray, int glyphCount, EA::WebKit::GlyphDrawInfo* outGDI, bool abortOnFail, int* pFilledCount)
 {
     bool returnFlag = true;
+    int i = 0;
+    mbGlyphCacheFull = false;
     EA::Text::Font* pFontEA =  static_cast<EA::WebKit::FontImpl*> (pFont)->mpFont;
-    for (int i=0; i < glyphCount; i++)
+    for (; i < glyphCount; i++)
     {
         EA::Text::GlyphId glyphEA = GetEAText_GlyphId(gIdArray[i]);
         if(!GetCachedGlyph(pFontEA, glyphEA, outGDI[i]))
@@ -1058,18 +1276,36 @@ bool TextSystem::FillGlyphDrawInfo(EA::WebKit::IFont* pFont, const EA::WebKit::G
                 break;
         }
     }
+    if (pFilledCount)
+        *pFilledCount = i;
     return returnFlag;
 }
 
 bool TextSystem::GetGlyphs(EA::WebKit::IFont* pFont, const EA::WebKit::GlyphId* gIdArray, int glyphCount, EA::WebKit::GlyphDrawInfo* outGDI)
 {
+    ++mGlyphCacheUseSerial;
+
     // Try to draw/cache all the glyphs in the run.
     bool abortOnFail = true;
-    bool returnFlag = FillGlyphDrawInfo(pFont, gIdArray, glyphCount, outGDI, abortOnFail);
+    int filledCount = 0;
+    bool returnFlag = FillGlyphDrawInfo(pFont, gIdArray, glyphCount, outGDI, abortOnFail, &filledCount);
+    
+    // If the cache is full, clear the least recently used pages one at a time and carry on from the glyph that failed. The glyphs 
+    // already filled in are on pages used by this run, which are not cleared.
+    while (!returnFlag && mbGlyphCacheFull && EvictGlyphCachePage())
+    {
+        int count = 0;
+        returnFlag = FillGlyphDrawInfo(pFont, gIdArray + filledCount, glyphCount - filledCount, outGDI + filledCount, abortOnFail, &count);
+        if (!returnFlag && !count && mbGlyphCacheFull)
+            break;  // Does not fit in a cleared page either.
+        filledCount += count;
+    }
+
     if (!returnFlag)
     {
-        // Flush the cache if we need to retry
-        FlushGlyphCache();
+        // Flush the cache if we need to retry. Only needed if this run alone fills every page.
+        if (mbGlyphCacheFull)
+            FlushGlyphCache();
         abortOnFail = false;   // We attempt to draw what we can, even if a glyph fails after flushing. 
         returnFlag = FillGlyphDrawInfo(pFont, gIdArray, glyphCount, outGDI, abortOnFail);
     }
@@ -1082,8 +1318,14 @@ bool TextSystem::GetCachedGlyph(EA::Text::Font* pFontEA, EA::WebKit::GlyphId g,
     EA::Text::GlyphId gEA = GetEAText_GlyphId(g);
     
     bool returnFlag = mpGlyphCache->GetGlyphTextureInfo(pFontEA, gEA, gtiEA);
-    if (!returnFlag)
+    if (returnFlag)
     {
+        ++mGlyphCacheHits;
+    }
+    else
+    {
+        ++mGlyphCacheMisses;
+
         // Draw the glyph
         const EA::Text::Font::GlyphBitmap* pGlyphBitmap = 0;    
         if (pFontEA->RenderGlyphBitmap(&pGlyphBitmap, gEA))
@@ -1097,7 +1339,8 @@ bool TextSystem::GetCachedGlyph(EA::Text::Font* pFontEA, EA::WebKit::GlyphId g,
             }
             else
             {
-                EA_ASSERT_MSG(false, "FontEA: Out of glyph cache space.  Please consider increasing size");
+                // Out of glyph cache space. The caller clears a page and tries again.
+                mbGlyphCacheFull = true;
             }
             pFontEA->DoneGlyphBitmap(pGlyphBitmap);
         } 
@@ -1109,7 +1352,10 @@ bool TextSystem::GetCachedGlyph(EA::Text::Font* pFontEA, EA::WebKit::GlyphId g,
 
     // Now convert back to EAWebKitFormat
     if (returnFlag)
+    {
+        TouchGlyphCachePage(gtiEA.mpTextureInfo);
         ConvertToWebKit_GlyphTextureInfo(gtiEA,gdi);    
+    }
     else
         gdi.mpData = 0;
     
@@ -1453,6 +1699,7 @@ bool TextSystem::BuildDrawInfoFromLineLayout(const EA::Text::LineLayout& line, b
     // Init the draw info array.
     mCurrentGlyphDrawInfoVector.clear();
     mCurrentGlyphDrawInfoVector.reserve(glyphArrayCount);
+    mbGlyphCacheFull = false;
 
     EA::Text::LineLayout::GlyphLayoutInfoArray::const_iterator     it     = line.mGlyphLayoutInfoArray.begin();
     EA::Text::LineLayout::GlyphLayoutInfoArray::const_iterator     itEnd  = line.mGlyphLayoutInfoArray.end();
@@ -1570,11 +1817,18 @@ bool TextSystem::GetDrawInfoForComplexText(EA::WebKit::IFont* pFont, const EA::W
     // Build the draw info.
     float xMin, yMin, xMax, yMax;
     bool abortOnFail = true;
+    ++mGlyphCacheUseSerial;
     bool result = BuildDrawInfoFromLineLayout(lineLayout, abortOnFail, clipLeft, clipRight, xMin, xMax, yMin, yMax);  
+    
+    // If the cache is full, clear the least recently used pages that this line does not use until it fits.
+    while (!result && mbGlyphCacheFull && EvictGlyphCachePage())
+        result = BuildDrawInfoFromLineLayout(lineLayout, abortOnFail, clipLeft, clipRight, xMin, xMax, yMin, yMax);  
+
     if (!result)
     {
         // Flush the cache if we need to retry.
-        FlushGlyphCache();
+        if (mbGlyphCacheFull)
+            FlushGlyphCache();
         abortOnFail = false;   // We attempt to draw what we can, even if a glyph fails after flushing. 
         BuildDrawInfoFromLineLayout(lineLayout, abortOnFail, clipLeft, clipRight, xMin, xMax, yMin, yMax);  
     }
@@ -1661,6 +1915,14 @@ void InitFontSystem(void)
     }
 }
 
+void GetFontSystemGlyphCacheUsage(GlyphCacheUsageInfo& glyphCacheUsageInfo)
+{
+    if (spTextSystem)
+        spTextSystem->GetGlyphCacheUsage(glyphCacheUsageInfo);
+    else
+        glyphCacheUsageInfo = GlyphCacheUsageInfo();
+}
+
 void ShutdownFontSystem(void)
 {
     if(sFontSystemHasInit)
@@ -0,0 +1,420 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// EAWebKitThreadPool.cpp
+//
+// Maintained by EAWebKit Team
+///////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include <internal/include/EAWebKitThreadPool.h>
+#include <internal/include/EAWebKitAssert.h>
+#include <internal/include/EAWebKitNewDelete.h>
+
+#if defined(EA_PLATFORM_MICROSOFT)
+	#pragma warning(push, 1)
+	#include EAWEBKIT_PLATFORM_HEADER
+	#pragma warning(pop)
+#elif defined(EA_PLATFORM_UNIX)
+	#include <unistd.h>
+#endif
+
+namespace EA
+{
+namespace WebKit
+{
+
+static uint32_t GetProcessorCount()
+{
+#if defined(EA_PLATFORM_MICROSOFT)
+	SYSTEM_INFO systemInfo;
+	GetNativeSystemInfo(&systemInfo);
+	return (uint32_t)systemInfo.dwNumberOfProcessors;
+#elif defined(EA_PLATFORM_UNIX) && defined(_SC_NPROCESSORS_ONLN)
+	const long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+	return (processorCount > 0) ? (uint32_t)processorCount : 1;
+#else
+	return 2;
+#endif
+}
+
+ThreadPool::ThreadPool()
+	: mpThreadSystem(NULL)
+	, mpMutex(NULL)
+	, mpCondition(NULL)
+	, mpCurrentWorker(NULL)
+	, mWorkerCount(0)
+	, mNextWorker(0)
+	, mQueuedCount(0)
+	, mWaiterCount(0)
+	, mbStarted(false)
+	, mbStop(false)
+{
+	for(uint32_t i = 0; i < kMaxWorkerCount; ++i)
+		mWorkers[i] = NULL;
+}
+
+void ThreadPool::Start()
+{
+	mbStarted = true;
+	mpThreadSystem = GetThreadSystem();
+	EAW_ASSERT_MSG(mpThreadSystem->IsMainThread(), "The thread pool is expected to start on the main thread");
+
+	// The default thread system can't create threads on all platforms (see DefaultThreadSystem::CurrentThreadId).
+	if(mpThreadSystem->CurrentThreadId() == EA::WebKit::kThreadIdInvalid)
+		return;
+
+	mpMutex         = mpThreadSystem->CreateAMutex();
+	mpCondition     = mpThreadSystem->CreateAThreadCondition();
+	mpCurrentWorker = mpThreadSystem->CreateAThreadLocalStorage();
+	if(!mpMutex || !mpCondition || !mpCurrentWorker)
+		return;
+
+	// Leave a processor to the main thread.
+	uint32_t workerCount = GetProcessorCount();
+	workerCount = (workerCount > 1) ? (workerCount - 1) : 1;
+	if(workerCount > kMaxWorkerCount)
+		workerCount = kMaxWorkerCount;
+
+	// All the workers exist before the first thread starts, as workers steal from each other.
+	mbStop = false;
+	for(uint32_t i = 0; i < workerCount; ++i)
+	{
+		Worker* pWorker = EAWEBKIT_NEW("ThreadPoolWorker") Worker;
+		pWorker->mpThreadPool = this;
+		pWorker->mIndex       = i;
+		pWorker->mpThread     = mpThreadSystem->CreateAThread();
+		pWorker->mpQueueMutex = mpThreadSystem->CreateAMutex();
+		pWorker->mbRunning    = false;
+		if(!pWorker->mpThread || !pWorker->mpQueueMutex)
+		{
+			DestroyWorker(pWorker);
+			break;
+		}
+		mWorkers[mWorkerCount++] = pWorker;
+	}
+
+	// A worker whose thread failed to start still gets work, which the other workers steal.
+	uint32_t runningCount = 0;
+	for(uint32_t i = 0; i < mWorkerCount; ++i)
+	{
+		Worker* pWorker = mWorkers[i];
+		if(pWorker->mpThread->Begin(WorkerThreadFunction, pWorker) != EA::WebKit::kThreadIdInvalid)
+		{
+			pWorker->mpThread->SetName("EAWebKit worker");
+			pWorker->mbRunning = true;
+			++runningCount;
+		}
+	}
+
+	if(!runningCount)
+	{
+		for(uint32_t i = 0; i < mWorkerCount; ++i)
+		{
+			DestroyWorker(mWorkers[i]);
+			mWorkers[i] = NULL;
+		}
+		mWorkerCount = 0;
+	}
+}
+
+void ThreadPool::DestroyWorker(Worker* pWorker)
+{
+	if(pWorker->mbRunning)
+	{
+		intptr_t result = 0;
+		pWorker->mpThread->WaitForEnd(&result);
+	}
+	if(pWorker->mpThread)
+		mpThreadSystem->DestroyAThread(pWorker->mpThread);
+	if(pWorker->mpQueueMutex)
+		mpThreadSystem->DestroyAMutex(pWorker->mpQueueMutex);
+	EAWEBKIT_DELETE pWorker;
+}
+
+void ThreadPool::Shutdown()
+{
+	if(!mbStarted)
+		return;
+
+	if(mWorkerCount)
+	{
+		mpMutex->Lock();
+		mbStop = true;
+		mpCondition->Signal(true);
+		mpMutex->Unlock();
+
+		for(uint32_t i = 0; i < mWorkerCount; ++i)
+		{
+			DestroyWorker(mWorkers[i]);
+			mWorkers[i] = NULL;
+		}
+	}
+	EAW_ASSERT(!mQueuedCount);
+
+	if(mpCurrentWorker)
+		mpThreadSystem->DestroyAThreadLocalStorage(mpCurrentWorker);
+	if(mpCondition)
+		mpThreadSystem->DestroyAThreadCondition(mpCondition);
+	if(mpMutex)
+		mpThreadSystem->DestroyAMutex(mpMutex);
+
+	mpCurrentWorker = NULL;
+	mpCondition     = NULL;
+	mpMutex         = NULL;
+	mpThreadSystem  = NULL;
+	mWorkerCount    = 0;
+	mNextWorker     = 0;
+	mQueuedCount    = 0;
+	mWaiterCount    = 0;
+	mbStop          = false;
+	mbStarted       = false;
+}
+
+void ThreadPool::ScheduleWork(DoWorkEntryPoint doWork, void* workContext, ThreadPoolWorkGroup* pWorkGroup)
+{
+	if(!mbStarted)
+		Start();
+
+	if(!mWorkerCount)
+	{
+		doWork(workContext);
+		return;
+	}
+
+	WorkItem item;
+	item.mDoWork       = doWork;
+	item.mpWorkContext = workContext;
+	item.mpWorkGroup   = pWorkGroup;
+
+	Worker* pWorker = GetCurrentWorker();
+
+	mpMutex->Lock();
+	if(!pWorker)
+		pWorker = mWorkers[mNextWorker++ % mWorkerCount];
+	if(pWorkGroup)
+	{
+		++pWorkGroup->mPendingCount;  // Before the work is queued, as it may run right away.
+		++pWorkGroup->mQueuedCount;
+	}
+
+	pWorker->mpQueueMutex->Lock();
+	pWorker->mQueue.push_back(item);
+	pWorker->mpQueueMutex->Unlock();
+
+	++mQueuedCount;
+	mpCondition->Signal(mWaiterCount != 0); // A thread waiting in Wait may not take this work, so it can't be the only one woken.
+	mpMutex->Unlock();
+}
+
+void ThreadPool::Wait(ThreadPoolWorkGroup* pWorkGroup)
+{
+	if(!pWorkGroup || !mWorkerCount)
+		return;
+
+	// A thread other than a worker (usually the main thread) only runs the work of pWorkGroup, so that it doesn't end up running
+	// a long unrelated job.
+	Worker* pSelf = GetCurrentWorker();
+	for(;;)
+	{
+		WorkItem item;
+		if(pSelf ? PopWork(pSelf, item) : PopGroupWork(pWorkGroup, item))
+		{
+			RunWork(item);
+			continue;
+		}
+
+		mpMutex->Lock();
+		if(pSelf)
+		{
+			while(pWorkGroup->mPendingCount && !mQueuedCount)
+				mpCondition->Wait(mpMutex);
+		}
+		else
+		{
+			++mWaiterCount;
+			while(pWorkGroup->mPendingCount && !pWorkGroup->mQueuedCount)
+				mpCondition->Wait(mpMutex);
+			--mWaiterCount;
+		}
+		const bool bDone = (pWorkGroup->mPendingCount == 0);
+		mpMutex->Unlock();
+
+		if(bDone)
+			return;
+	}
+}
+
+bool ThreadPool::IsDone(ThreadPoolWorkGroup* pWorkGroup)
+{
+	if(!pWorkGroup || !mWorkerCount)
+		return true;
+
+	mpMutex->Lock();
+	const bool bDone = (pWorkGroup->mPendingCount == 0);
+	mpMutex->Unlock();
+	return bDone;
+}
+
+uint32_t ThreadPool::GetWorkerCount()
+{
+	if(!mbStarted)
+		Start();
+	return mWorkerCount;
+}
+
+ThreadPool::Worker* ThreadPool::GetCurrentWorker()
+{
+	return static_cast<Worker*>(mpCurrentWorker->GetValue());
+}
+
+// Takes the newest work of pSelf, or steals the oldest work of another worker.
+bool ThreadPool::PopWork(Worker* pSelf, WorkItem& item)
+{
+	bool bFound = false;
+
+	if(pSelf)
+	{
+		pSelf->mpQueueMutex->Lock();
+		if(!pSelf->mQueue.empty())
+		{
+			item = pSelf->mQueue.back();
+			pSelf->mQueue.pop_back();
+			bFound = true;
+		}
+		pSelf->mpQueueMutex->Unlock();
+	}
+
+	const uint32_t firstVictim = pSelf ? (pSelf->mIndex + 1) : 0;
+	for(uint32_t i = 0; !bFound && (i < mWorkerCount); ++i)
+	{
+		Worker* pVictim = mWorkers[(firstVictim + i) % mWorkerCount];
+		if(pVictim == pSelf)
+			continue;
+
+		pVictim->mpQueueMutex->Lock();
+		if(!pVictim->mQueue.empty())
+		{
+			item = pVictim->mQueue.front();
+			pVictim->mQueue.pop_front();
+			bFound = true;
+		}
+		pVictim->mpQueueMutex->Unlock();
+	}
+
+	if(bFound)
+	{
+		mpMutex->Lock();
+		--mQueuedCount;
+		if(item.mpWorkGroup)
+			--item.mpWorkGroup->mQueuedCount;
+		mpMutex->Unlock();
+	}
+	return bFound;
+}
+
+// Takes the oldest work of pWorkGroup from any worker.
+bool ThreadPool::PopGroupWork(ThreadPoolWorkGroup* pWorkGroup, WorkItem& item)
+{
+	bool bFound = false;
+
+	for(uint32_t i = 0; !bFound && (i < mWorkerCount); ++i)
+	{
+		Worker* pVictim = mWorkers[i];
+
+		pVictim->mpQueueMutex->Lock();
+		for(WorkQueue::iterator it = pVictim->mQueue.begin(); it != pVictim->mQueue.end(); ++it)
+		{
+			if(it->mpWorkGroup == pWorkGroup)
+			{
+				item = *it;
+				pVictim->mQueue.erase(it);
+				bFound = true;
+				break;
+			}
+		}
+		pVictim->mpQueueMutex->Unlock();
+	}
+
+	if(bFound)
+	{
+		mpMutex->Lock();
+		--mQueuedCount;
+		--pWorkGroup->mQueuedCount;
+		mpMutex->Unlock();
+	}
+	return bFound;
+}
+
+void ThreadPool::RunWork(const WorkItem& item)
+{
+	item.mDoWork(item.mpWorkContext);
+
+	if(item.mpWorkGroup)
+	{
+		mpMutex->Lock();
+		if(--item.mpWorkGroup->mPendingCount == 0)
+			mpCondition->Signal(true);
+		mpMutex->Unlock();
+	}
+}
+
+void ThreadPool::RunWorker(Worker* pWorker)
+{
+	mpCurrentWorker->SetValue(pWorker);
+
+	for(;;)
+	{
+		WorkItem item;
+		if(PopWork(pWorker, item))
+		{
+			RunWork(item);
+			continue;
+		}
+
+		mpMutex->Lock();
+		while(!mQueuedCount && !mbStop)
+			mpCondition->Wait(mpMutex);
+		const bool bStop = (mbStop && !mQueuedCount);
+		mpMutex->Unlock();
+
+		if(bStop)
+			break;
+	}
+}
+
+void* ThreadPool::WorkerThreadFunction(void* pContext)
+{
+	Worker* pWorker = static_cast<Worker*>(pContext);
+	pWorker->mpThreadPool->RunWorker(pWorker);
+	return NULL;
+}
+
+}
+}
@@ -45,78 +45,523 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <wtf/MainThread.h>
 #include "SharedTimer.h"
 
+#if EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED
+	#if defined(EA_PLATFORM_MICROSOFT)
+		#pragma warning(push, 1)
+		#include EAWEBKIT_PLATFORM_HEADER
+		#pragma warning(pop)
+
+	// EA_PLATFORM_UNIX is defined when EA_PLATFORM_OSX is defined.
+	#elif defined(EA_PLATFORM_UNIX)
+		#include <pthread.h>
+		#include <sched.h>
+		#include <errno.h>
+		#include <string.h>
+		#include <unistd.h>
+		#include <sys/time.h>
+	#else
+		#error "The support for this platform's threads is missing. Define EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED to 0."
+	#endif
+#endif
+
 namespace EA
 {
 namespace WebKit
 {
+#if EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED && defined(EA_PLATFORM_MICROSOFT)
+
 class DefaultMutex : public IMutex
 {
 public:
 	friend class DefaultThreadCondition;
 	DefaultMutex()
-		: mLockCount(0)
 	{
-
+		InitializeCriticalSection(&mCriticalSection);
+	}
+	~DefaultMutex()
+	{
+		DeleteCriticalSection(&mCriticalSection);
 	}
 	void Lock() 
 	{
-		++mLockCount;
+		EnterCriticalSection(&mCriticalSection);
 	}
 
 	bool TryLock()
 	{
-		if(mLockCount)
-			return false;
-		
-		Lock();
-		return true;
+		return (TryEnterCriticalSection(&mCriticalSection) != 0);
 	}
 
 	void Unlock()
 	{
-		--mLockCount;
+		LeaveCriticalSection(&mCriticalSection);
 	}
 private:
-	int mLockCount;
+	CRITICAL_SECTION mCriticalSection;
 };
 
 class DefaultThreadCondition : public IThreadCondition
 {
 public:
+	DefaultThreadCondition()
+	{
+		InitializeConditionVariable(&mCondition);
+	}
+
 	void Wait(IMutex* mutex)
 	{
-		
+		SleepConditionVariableCS(&mCondition, &static_cast<DefaultMutex*>(mutex)->mCriticalSection, INFINITE);
 	}
 
 	bool TimedWait(IMutex* mutex, double relativeTimeMS)
 	{
-		return false;
+		DWORD timeoutMS = 0;
+		if(relativeTimeMS >= (double)(INFINITE - 1))
+			timeoutMS = INFINITE - 1;
+		else if(relativeTimeMS > 0.0)
+			timeoutMS = (DWORD)relativeTimeMS;
+
+		return (SleepConditionVariableCS(&mCondition, &static_cast<DefaultMutex*>(mutex)->mCriticalSection, timeoutMS) != 0);
 	}
 
 	void Signal(bool broadcast)
+	{
+		if(broadcast)
+			WakeAllConditionVariable(&mCondition);
+		else
+			WakeConditionVariable(&mCondition);
+	}
+private:
+	CONDITION_VARIABLE mCondition;
+};
+
+// Shared by the thread and its DefaultThread, which may be destroyed before the thread ends if the thread is detached.
+struct DefaultThreadData
+{
+	volatile LONG	mRefCount;
+	ThreadFunc		mThreadFunc;
+	void*			mpThreadContext;
+	void*			mpResult;
+};
+
+class DefaultThread : public IThread
+{
+public:
+	DefaultThread()
+		: mThreadHandle(NULL)
+		, mThreadId(kThreadIdInvalid)
+		, mpThreadData(NULL)
 	{
 
 	}
+	~DefaultThread()
+	{
+		if(mThreadHandle)
+			CloseHandle(mThreadHandle);
+		ReleaseThreadData(mpThreadData);
+	}
+	virtual ThreadId Begin(ThreadFunc threadFunc, void* pThreadContext, void* pUserData)
+	{
+		EAW_ASSERT_MSG(!mThreadHandle, "Thread already started");
+
+		mpThreadData = new DefaultThreadData;
+		mpThreadData->mRefCount = 2;
+		mpThreadData->mThreadFunc = threadFunc;
+		mpThreadData->mpThreadContext = pThreadContext;
+		mpThreadData->mpResult = NULL;
+
+		DWORD threadId = 0;
+		mThreadHandle = CreateThread(NULL, 0, ThreadEntry, mpThreadData, 0, &threadId);
+		if(!mThreadHandle)
+		{
+			delete mpThreadData;
+			mpThreadData = NULL;
+			return kThreadIdInvalid;
+		}
+
+		mThreadId = (ThreadId)threadId;
+		return mThreadId;
+	}
+	virtual void WaitForEnd(intptr_t* result)
+	{
+		if(mThreadHandle)
+		{
+			WaitForSingleObject(mThreadHandle, INFINITE);
+			CloseHandle(mThreadHandle);
+			mThreadHandle = NULL;
+		}
+		if(result)
+			*result = mpThreadData ? (intptr_t)mpThreadData->mpResult : 0;
+	}
+	virtual void SetName(const char* pName)
+	{
+	#if defined(_MSC_VER) && defined(EA_PLATFORM_WINDOWS)
+		// The debugger picks up the name from this exception. See "How to: Set a Thread Name in Native Code" on MSDN.
+		#pragma pack(push, 8)
+		struct ThreadNameInfo
+		{
+			DWORD  dwType;
+			LPCSTR szName;
+			DWORD  dwThreadID;
+			DWORD  dwFlags;
+		};
+		#pragma pack(pop)
+
+		if(!mThreadHandle || !IsDebuggerPresent())
+			return;
+
+		ThreadNameInfo info;
+		info.dwType = 0x1000;
+		info.szName = pName;
+		info.dwThreadID = mThreadId;
+		info.dwFlags = 0;
+
+		__try
+		{
+			RaiseException(0x406D1388, 0, sizeof(info) / sizeof(ULONG_PTR), (const ULONG_PTR*)&info);
+		}
+		__except(EXCEPTION_EXECUTE_HANDLER)
+		{
+		}
+	#endif
+	}
 private:
+	static DWORD WINAPI ThreadEntry(LPVOID pArgument)
+	{
+		DefaultThreadData* pThreadData = static_cast<DefaultThreadData*>(pArgument);
+		pThreadData->mpResult = pThreadData->mThreadFunc(pThreadData->mpThreadContext);
+		ReleaseThreadData(pThreadData);
+		return 0;
+	}
+
+	static void ReleaseThreadData(DefaultThreadData* pThreadData)
+	{
+		if(pThreadData && (InterlockedDecrement(&pThreadData->mRefCount) == 0))
+			delete pThreadData;
+	}
+
+	HANDLE				mThreadHandle;
+	ThreadId			mThreadId;
+	DefaultThreadData*	mpThreadData;
 };
 
+class DefaultThreadLocalStorage : public IThreadLocalStorage
+{
+public:
+	DefaultThreadLocalStorage()
+		: mTlsIndex(TlsAlloc())
+	{
+		EAW_ASSERT_MSG(mTlsIndex != TLS_OUT_OF_INDEXES, "Out of thread local storage indices");
+	}
+	~DefaultThreadLocalStorage()
+	{
+		if(mTlsIndex != TLS_OUT_OF_INDEXES)
+			TlsFree(mTlsIndex);
+	}
+	virtual void* GetValue() 
+	{
+		return (mTlsIndex != TLS_OUT_OF_INDEXES) ? TlsGetValue(mTlsIndex) : NULL;
+	}
+	bool SetValue(void* pData)
+	{
+		return (mTlsIndex != TLS_OUT_OF_INDEXES) && (TlsSetValue(mTlsIndex, pData) != 0);
+	}
+private:
+	DWORD mTlsIndex;
+};
+
+static ThreadId GetNativeThreadId()
+{
+	return (ThreadId)GetCurrentThreadId();
+}
+
+#elif EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED && defined(EA_PLATFORM_UNIX)
+
+// pthread_t is not an integer on all platforms, so threads are numbered as they are first seen.
+static pthread_once_t	sThreadIdKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t	sThreadIdKey;
+static pthread_mutex_t	sThreadIdMutex = PTHREAD_MUTEX_INITIALIZER;
+static ThreadId			sNextThreadId = kThreadIdInvalid + 1;
+
+static void CreateThreadIdKey()
+{
+	pthread_key_create(&sThreadIdKey, NULL);
+}
+
+static ThreadId AllocateThreadId()
+{
+	pthread_mutex_lock(&sThreadIdMutex);
+	const ThreadId threadId = sNextThreadId++;
+	if(sNextThreadId == kThreadIdInvalid)
+		sNextThreadId = kThreadIdInvalid + 1;
+	pthread_mutex_unlock(&sThreadIdMutex);
+	return threadId;
+}
+
+static void SetNativeThreadId(ThreadId threadId)
+{
+	pthread_once(&sThreadIdKeyOnce, CreateThreadIdKey);
+	pthread_setspecific(sThreadIdKey, (void*)(uintptr_t)threadId);
+}
+
+static ThreadId GetNativeThreadId()
+{
+	pthread_once(&sThreadIdKeyOnce, CreateThreadIdKey);
+	ThreadId threadId = (ThreadId)(uintptr_t)pthread_getspecific(sThreadIdKey);
+	if(threadId == kThreadIdInvalid)
+	{
+		threadId = AllocateThreadId();
+		pthread_setspecific(sThreadIdKey, (void*)(uintptr_t)threadId);
+	}
+	return threadId;
+}
+
+class DefaultMutex : public IMutex
+{
+public:
+	friend class DefaultThreadCondition;
+	DefaultMutex()
+	{
+		// Recursive, like the critical section used on Microsoft platforms.
+		pthread_mutexattr_t attr;
+		pthread_mutexattr_init(&attr);
+		pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+		pthread_mutex_init(&mMutex, &attr);
+		pthread_mutexattr_destroy(&attr);
+	}
+	~DefaultMutex()
+	{
+		pthread_mutex_destroy(&mMutex);
+	}
+	void Lock() 
+	{
+		pthread_mutex_lock(&mMutex);
+	}
+
+	bool TryLock()
+	{
+		return (pthread_mutex_trylock(&mMutex) == 0);
+	}
+
+	void Unlock()
+	{
+		pthread_mutex_unlock(&mMutex);
+	}
+private:
+	pthread_mutex_t mMutex;
+};
+
+class DefaultThreadCondition : public IThreadCondition
+{
+public:
+	DefaultThreadCondition()
+	{
+		pthread_cond_init(&mCondition, NULL);
+	}
+	~DefaultThreadCondition()
+	{
+		pthread_cond_destroy(&mCondition);
+	}
+
+	void Wait(IMutex* mutex)
+	{
+		pthread_cond_wait(&mCondition, &static_cast<DefaultMutex*>(mutex)->mMutex);
+	}
+
+	bool TimedWait(IMutex* mutex, double relativeTimeMS)
+	{
+		if(relativeTimeMS < 0.0)
+			relativeTimeMS = 0.0;
+
+		struct timeval timeNow;
+		gettimeofday(&timeNow, NULL);
+
+		const double absoluteTimeUS = (double)timeNow.tv_sec * 1000000.0 + (double)timeNow.tv_usec + relativeTimeMS * 1000.0;
+		struct timespec absoluteTime;
+		absoluteTime.tv_sec  = (time_t)(absoluteTimeUS / 1000000.0);
+		absoluteTime.tv_nsec = (long)((absoluteTimeUS - (double)absoluteTime.tv_sec * 1000000.0) * 1000.0);
+		if(absoluteTime.tv_nsec >= 1000000000L)
+		{
+			++absoluteTime.tv_sec;
+			absoluteTime.tv_nsec -= 1000000000L;
+		}
+
+		return (pthread_cond_timedwait(&mCondition, &static_cast<DefaultMutex*>(mutex)->mMutex, &absoluteTime) == 0);
+	}
+
+	void Signal(bool broadcast)
+	{
+		if(broadcast)
+			pthread_cond_broadcast(&mCondition);
+		else
+			pthread_cond_signal(&mCondition);
+	}
+private:
+	pthread_cond_t mCondition;
+};
+
+// Handed to the new thread, which frees it.
+struct DefaultThreadStartData
+{
+	ThreadFunc	mThreadFunc;
+	void*		mpThreadContext;
+	ThreadId	mThreadId;
+};
 
 class DefaultThread : public IThread
 {
 public:
-	virtual ThreadId Begin(ThreadFunc,void* pThreadContext, void* pUserData)
+	DefaultThread()
+		: mThread()
+		, mThreadId(kThreadIdInvalid)
+		, mbJoinable(false)
 	{
-		EAW_ASSERT_MSG(false, "Using a feature that requires thread creation. This is not supported.");
-		return (ThreadId)0;
+
+	}
+	~DefaultThread()
+	{
+		if(mbJoinable)
+			pthread_detach(mThread);
+	}
+	virtual ThreadId Begin(ThreadFunc threadFunc, void* pThreadContext, void* pUserData)
+	{
+		EAW_ASSERT_MSG(!mbJoinable, "Thread already started");
+
+		DefaultThreadStartData* pStartData = new DefaultThreadStartData;
+		pStartData->mThreadFunc = threadFunc;
+		pStartData->mpThreadContext = pThreadContext;
+		pStartData->mThreadId = AllocateThreadId();
+
+		const ThreadId threadId = pStartData->mThreadId; // The new thread may free pStartData before pthread_create returns.
+		if(pthread_create(&mThread, NULL, ThreadEntry, pStartData) != 0)
+		{
+			delete pStartData;
+			return kThreadIdInvalid;
+		}
+
+		mbJoinable = true;
+		mThreadId = threadId;
+		return mThreadId;
 	}
 	virtual void WaitForEnd(intptr_t* result)
 	{
+		void* pResult = NULL;
+		if(mbJoinable)
+		{
+			pthread_join(mThread, &pResult);
+			mbJoinable = false;
+		}
+		if(result)
+			*result = (intptr_t)pResult;
 	}
 	virtual void SetName(const char* pName)
 	{
+	#if defined(EA_PLATFORM_LINUX)
+		// Linux limits thread names to 15 characters.
+		if(mbJoinable && pName)
+		{
+			char name[16];
+			strncpy(name, pName, sizeof(name) - 1);
+			name[sizeof(name) - 1] = 0;
+			pthread_setname_np(mThread, name);
+		}
+	#endif
+	}
+private:
+	static void* ThreadEntry(void* pArgument)
+	{
+		const DefaultThreadStartData startData = *static_cast<DefaultThreadStartData*>(pArgument);
+		delete static_cast<DefaultThreadStartData*>(pArgument);
+
+		SetNativeThreadId(startData.mThreadId);
+		return startData.mThreadFunc(startData.mpThreadContext);
+	}
+
+	pthread_t	mThread;
+	ThreadId	mThreadId;
+	bool		mbJoinable;
+};
+
+class DefaultThreadLocalStorage : public IThreadLocalStorage
+{
+public:
+	DefaultThreadLocalStorage()
+		: mbValid(pthread_key_create(&mKey, NULL) == 0)
+	{
+		EAW_ASSERT_MSG(mbValid, "Out of thread local storage keys");
+	}
+	~DefaultThreadLocalStorage()
+	{
+		if(mbValid)
+			pthread_key_delete(mKey);
+	}
+	virtual void* GetValue() 
+	{
+		return mbValid ? pthread_getspecific(mKey) : NULL;
+	}
+	bool SetValue(void* pData)
+	{
+		return mbValid && (pthread_setspecific(mKey, pData) == 0);
+	}
+private:
+	pthread_key_t	mKey;
+	bool			mbValid;
+};
+
+#else
+
+class DefaultMutex : public IMutex
+{
+public:
+	friend class DefaultThreadCondition;
+	DefaultMutex()
+		: mLockCount(0)
+	{
+
+	}
+	void Lock() 
+	{
+		++mLockCount;
+	}
+
+	bool TryLock()
+	{
+		if(mLockCount)
+			return false;
+		
+		Lock();
+		return true;
 	}
+
+	void Unlock()
+	{
+		--mLockCount;
+	}
+private:
+	int mLockCount;
 };
 
+class DefaultThreadCondition : public IThreadCondition
+{
+public:
+	void Wait(IMutex* mutex)
+	{
+		
+	}
+
+	bool TimedWait(IMutex* mutex, double relativeTimeMS)
+	{
+		return false;
+	}
+
+	void Signal(bool broadcast)
+	{
+
+	}
+private:
+};
+
+
 class DefaultThreadLocalStorage : public IThreadLocalStorage
 {
 public:
@@ -139,9 +584,39 @@ private:
 
 };
 
+#endif
+
+// The thread of a thread system that can't create threads.
+class UnsupportedThread : public IThread
+{
+public:
+	virtual ThreadId Begin(ThreadFunc,void* pThreadContext, void* pUserData)
+	{
+		EAW_ASSERT_MSG(false, "Using a feature that requires thread creation. This is not supported.");
+		return (ThreadId)0;
+	}
+	virtual void WaitForEnd(intptr_t* result)
+	{
+	}
+	virtual void SetName(const char* pName)
+	{
+	}
+};
+
+// Unless it is created with native threads (see GetNativeThreadSystem), the default thread system can't create threads and
+// reports kThreadIdInvalid as the id of every thread. Code written for it relies on that: the local storage and database
+// threads fail to start, so their FileSystem and SQLite use stays on the main thread, and StorageAreaSync::blockUntilImportComplete
+// doesn't wait for an import no thread would do.
 class DefaultThreadSystem : public IThreadSystem
 {
 public:
+	explicit DefaultThreadSystem(bool bNativeThreads)
+		: mMainThreadId(kThreadIdInvalid)
+		, mbNativeThreads(bNativeThreads)
+	{
+
+	}
+
 	virtual bool Initialize();
 	virtual bool Shutdown();
 
@@ -163,10 +638,15 @@ public:
 	virtual void YieldThread();
 	virtual void SleepThread(uint32_t ms);
 
+private:
+	ThreadId mMainThreadId;   // The thread that initialized the thread system, which is the thread EAWebKit runs on. Only set with native threads.
+	bool     mbNativeThreads;
 };
 
 bool DefaultThreadSystem::Initialize()
 {
+	if(mMainThreadId == kThreadIdInvalid)
+		mMainThreadId = CurrentThreadId();
 	return true;
 }
 
@@ -207,7 +687,11 @@ void DefaultThreadSystem::DestroyAThreadLocalStorage(IThreadLocalStorage* thread
 
 IThread* DefaultThreadSystem::CreateAThread()
 {
-	return new DefaultThread();
+#if EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED
+	if(mbNativeThreads)
+		return new DefaultThread();
+#endif
+	return new UnsupportedThread();
 }
 
 void DefaultThreadSystem::DestroyAThread(IThread* pThread)
@@ -217,25 +701,46 @@ void DefaultThreadSystem::DestroyAThread(IThread* pThread)
 
 void DefaultThreadSystem::ScheduleWork(EA::WebKit::DoWorkEntryPoint doWork, void* workContext)
 {
+	// The callers (DatabaseThread, LocalStorageThread) rely on the work being done when this returns, so it runs on the calling
+	// thread. Work that can run in parallel goes through the ThreadPool instead.
 	doWork(workContext);
 }
 EA::WebKit::ThreadId DefaultThreadSystem::CurrentThreadId()
 {
+#if EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED
+	if(mbNativeThreads)
+		return GetNativeThreadId();
+#endif
 	//06/03/2013 - We are taking advantage of this implementation in some places to detect if we have default thread system. So if the implementation ever changes, make sure to adjust the other code!
+	//Those places now detect a thread system that can't create threads, which the default thread system is unless it was created with native threads.
 	return EA::WebKit::kThreadIdInvalid;
 }
 
 bool DefaultThreadSystem::IsMainThread()
 {
+#if EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED
+	if(mbNativeThreads)
+		return (CurrentThreadId() == mMainThreadId);
+#endif
 	return true;
 }
 
 void DefaultThreadSystem::YieldThread()
 {
+#if EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED && defined(EA_PLATFORM_MICROSOFT)
+	SwitchToThread();
+#elif EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED && defined(EA_PLATFORM_UNIX)
+	sched_yield();
+#endif
 }
 
 void DefaultThreadSystem::SleepThread(uint32_t ms)
 {
+#if EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED && defined(EA_PLATFORM_MICROSOFT)
+	Sleep(ms);
+#elif EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED && defined(EA_PLATFORM_UNIX)
+	usleep((useconds_t)ms * 1000);
+#endif
 }
 
 
@@ -251,13 +756,24 @@ IThreadSystem* GetThreadSystem()
 {
 	if(!spThreadSystem)
 	{
-		static DefaultThreadSystem defaultThreadSystem;
+		static DefaultThreadSystem defaultThreadSystem(false);
 		spThreadSystem = &defaultThreadSystem;
+		spThreadSystem->Initialize();
 	}
 		
 	return spThreadSystem;
 }
 
+IThreadSystem* GetNativeThreadSystem()
+{
+#if EAWEBKIT_DEFAULT_THREAD_SYSTEM_ENABLED
+	static DefaultThreadSystem nativeThreadSystem(true);
+	return &nativeThreadSystem;
+#else
+	return NULL;
+#endif
+}
+
 void ThreadCleanupTick()
 {
 	WTF::dispatchFunctionsFromMainThread();
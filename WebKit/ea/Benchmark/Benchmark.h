@@ -0,0 +1,134 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// Benchmark.h
+//
+// Maintained by EAWebKit Team
+//
+// EAWebKitBenchmark is a console application that drives EAWebKit the way a
+// title does (through the dll interface only) and reports timings as JSON, so
+// that two builds of the library can be compared. See BenchmarkMain.cpp for
+// the command line.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EAWEBKIT_BENCHMARK_H
+#define EAWEBKIT_BENCHMARK_H
+
+#include <EABase/eabase.h>
+
+#if defined(_MSC_VER) && (_MSC_VER < 1900) // VS2015 has a C99 snprintf.
+    #include <stdarg.h>
+    #include <stdio.h>
+
+    // _snprintf doesn't terminate a truncated string and returns -1 for it. This terminates it and returns the
+    // length the string would have had, as C99 snprintf does.
+    inline int BenchmarkSnprintf(char* pBuffer, size_t bufferSize, const char* pFormat, ...)
+    {
+        va_list args;
+        va_start(args, pFormat);
+        int result = _vsnprintf(pBuffer, bufferSize, pFormat, args);
+        va_end(args);
+
+        if((result < 0) || ((size_t)result >= bufferSize))
+        {
+            if(bufferSize)
+                pBuffer[bufferSize - 1] = 0;
+            va_start(args, pFormat);
+            result = _vscprintf(pFormat, args);
+            va_end(args);
+        }
+        return result;
+    }
+
+    #define snprintf BenchmarkSnprintf
+#endif
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            class Host;
+            class Results;
+
+            struct Options
+            {
+                const char8_t*  mpFilter;           // Only suites whose name contains this run. NULL runs all of them.
+                const char8_t*  mpFontPath;         // A font file or a directory of .ttf/.otf files to load. Text suites are skipped without fonts.
+                const char8_t*  mpDataDirectory;    // Directory of the pages and manifests used by the suites. Defaults to WebKit/ea/Benchmark/Data.
+                uint32_t        mIterations;        // Repeats of each measurement. The suites report the median.
+                bool            mbVerbose;          // Print each result as it is measured.
+
+                Options()
+                    : mpFilter(NULL)
+                    , mpFontPath(NULL)
+                    , mpDataDirectory("WebKit/ea/Benchmark/Data")
+                    , mIterations(5)
+                    , mbVerbose(false)
+                {
+                }
+            };
+
+            typedef void (*SuiteFunction)(Host& host, Results& results, const Options& options);
+
+            struct Suite
+            {
+                const char8_t*  mpName;
+                SuiteFunction   mpFunction;
+            };
+
+            // Suites
+            void RunCookieBenchmark(Host& host, Results& results, const Options& options);
+            void RunCookieFileBenchmark(Host& host, Results& results, const Options& options);
+            void RunThreadSystemBenchmark(Host& host, Results& results, const Options& options);
+            void RunGlyphRasterBenchmark(Host& host, Results& results, const Options& options);
+            void RunGlyphRunCacheBenchmark(Host& host, Results& results, const Options& options);
+            void RunCJKGlyphCacheBenchmark(Host& host, Results& results, const Options& options);
+            void RunImageCompressionBenchmark(Host& host, Results& results, const Options& options);
+            void RunImageFrameCacheBenchmark(Host& host, Results& results, const Options& options);
+            void RunDamageTraceBenchmark(Host& host, Results& results, const Options& options);
+            void RunTileScrollBenchmark(Host& host, Results& results, const Options& options);
+            void RunNetworkLoadBenchmark(Host& host, Results& results, const Options& options);
+            void RunRenderBenchmark(Host& host, Results& results, const Options& options);
+            void RunDiskCacheBenchmark(Host& host, Results& results, const Options& options);
+            void RunDiskCacheIndexBenchmark(Host& host, Results& results, const Options& options);
+            void RunTransportJobBenchmark(Host& host, Results& results, const Options& options);
+            void RunInflateBenchmark(Host& host, Results& results, const Options& options);
+
+            // Helpers shared by the suites
+            double Median(double* pValues, uint32_t count); // Reorders pValues.
+            uint32_t Crc32(const uint8_t* pData, size_t size, uint32_t crc = 0); // The CRC of PNG chunks and gzip members. Pass the previous result to continue it.
+        }
+    }
+}
+
+#endif // EAWEBKIT_BENCHMARK_H
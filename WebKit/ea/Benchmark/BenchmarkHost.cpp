@@ -0,0 +1,479 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// BenchmarkHost.cpp
+//
+// Maintained by EAWebKit Team
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "BenchmarkHost.h"
+#include "Benchmark.h"
+#include <EAWebKit/EAWebKitDll.h>
+#include <EAWebKit/EAWebKitTextInterface.h>
+#include <EAWebKit/EAWebkitJavascriptValue.h>
+#include <EAIO/EAFileStream.h>
+#include <EASTL/vector.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(EA_PLATFORM_MICROSOFT)
+    #pragma warning(push)
+    #pragma warning(disable: 4255)
+    #include <windows.h>
+    #pragma warning(pop)
+#else
+    #include <dirent.h>
+    #include <time.h>
+#endif
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            namespace
+            {
+                double TimerCallback()
+                {
+                    return Host::Now();
+                }
+
+                bool HasFontExtension(const char8_t* pName)
+                {
+                    const size_t length = strlen(pName);
+                    if(length < 4)
+                        return false;
+
+                    char8_t extension[5];
+                    for(int i = 0; i < 4; ++i)
+                        extension[i] = (char8_t)tolower((unsigned char)pName[length - 4 + i]);
+                    extension[4] = 0;
+                    return (strcmp(extension, ".ttf") == 0) || (strcmp(extension, ".otf") == 0) || (strcmp(extension, ".ttc") == 0);
+                }
+
+                // In VProcessType order.
+                const char8_t* const kProcessTypeNames[] =
+                {
+                    "user1",
+                    "user2",
+                    "user3",
+                    "lib_tick",
+                    "view_tick",
+                    "transport_tick",
+                    "keyboard_event",
+                    "mouse_move_event",
+                    "mouse_button_event",
+                    "mouse_wheel_event",
+                    "scroll_event",
+                    "script",
+                    "th_jobs",
+                    "transport_job",
+                    "file_cache_job",
+                    "draw_image",
+                    "draw_image_pattern",
+                    "draw_glyph",
+                    "draw_raster",
+                    "image_decoder",
+                    "image_compression_pack",
+                    "image_compression_unpack",
+                    "javascript_parser",
+                    "javascript_execute",
+                    "css_parse_sheet",
+                    "font_loading",
+                    "paint",
+                    "sync_layers",
+                    "paint_tiles_cpu",
+                    "hardware_render",
+                    "paint_tiles_gpu",
+                    "paint_texture_mapper",
+                    "paint_scrollbars",
+                    "layout",
+                    "begin_view_update",
+                    "end_view_update",
+                    "animation",
+                    "paint_tile_record",
+                    "paint_tile_raster"
+                };
+
+                // Fails to compile when a process type is added without its name.
+                typedef char ProcessTypeNameCountCheck[((sizeof(kProcessTypeNames) / sizeof(kProcessTypeNames[0])) == kVProcessTypeLast) ? 1 : -1];
+            }
+
+            const char8_t* GetProcessTypeName(VProcessType processType)
+            {
+                if((processType <= kVProcessTypeNone) || (processType >= kVProcessTypeLast))
+                    return "none";
+                return kProcessTypeNames[processType];
+            }
+
+            Host::Host()
+                : mpLib(NULL)
+                , mpView(NULL)
+                , mFontCount(0)
+                , mbVerbose(false)
+                , mpFrameCallback(NULL)
+                , mpFrameCallbackContext(NULL)
+                , mbLoadComplete(false)
+                , mbLoadFailed(false)
+                , mLoadStartTime(0.0)
+                , mCommitTime(-1.0)
+                , mFirstLayoutTime(-1.0)
+                , mLoadCompleteTime(-1.0)
+            {
+                ResetProcessStats();
+            }
+
+            Host::~Host()
+            {
+                Shutdown();
+            }
+
+            double Host::Now()
+            {
+            #if defined(EA_PLATFORM_MICROSOFT)
+                static double sSecondsPerTick = 0.0;
+                if(sSecondsPerTick == 0.0)
+                {
+                    LARGE_INTEGER frequency;
+                    QueryPerformanceFrequency(&frequency);
+                    sSecondsPerTick = 1.0 / (double)frequency.QuadPart;
+                }
+                LARGE_INTEGER counter;
+                QueryPerformanceCounter(&counter);
+                return (double)counter.QuadPart * sSecondsPerTick;
+            #else
+                timespec ts;
+                clock_gettime(CLOCK_MONOTONIC, &ts);
+                return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+            #endif
+            }
+
+            bool Host::Init(const Options& options, int viewWidth, int viewHeight)
+            {
+                mbVerbose = options.mbVerbose;
+
+                mpLib = CreateEAWebkitInstance();
+                if(!mpLib)
+                    return false;
+
+                AppCallbacks appCallbacks;
+                memset(&appCallbacks, 0, sizeof(appCallbacks));
+                appCallbacks.timer = TimerCallback;
+
+                // NULL members select the library defaults. The structure itself has to be passed. The default thread system
+                // can't create threads, so the native one is passed as a title without its own thread system would do.
+                AppSystems appSystems;
+                memset(&appSystems, 0, sizeof(appSystems));
+                appSystems.mThreadSystem   = mpLib->GetNativeThreadSystem();
+                appSystems.mEAWebkitClient = this;
+
+                if(!mpLib->Init(&appCallbacks, &appSystems))
+                {
+                    mpLib = NULL;
+                    return false;
+                }
+
+                Parameters& parameters = mpLib->GetParameters();
+                parameters.mEnableProfiling = true;
+                mpLib->SetParameters(parameters);
+
+                if(options.mpFontPath)
+                    LoadFonts(options.mpFontPath);
+
+                ViewParameters viewParameters;
+                viewParameters.mWidth  = viewWidth;
+                viewParameters.mHeight = viewHeight;
+                if(!ResetView(viewParameters))
+                {
+                    Shutdown();
+                    return false;
+                }
+
+                return true;
+            }
+
+            bool Host::ResetView(const ViewParameters& viewParameters)
+            {
+                if(mpView)
+                {
+                    mpView->ShutdownView();
+                    mpLib->DestroyView(mpView);
+                }
+
+                mpView = mpLib->CreateView();
+                if(mpView && !mpView->InitView(viewParameters))
+                {
+                    mpLib->DestroyView(mpView);
+                    mpView = NULL;
+                }
+                return mpView != NULL;
+            }
+
+            void Host::Shutdown()
+            {
+                if(mpLib)
+                {
+                    if(mpView)
+                    {
+                        mpView->ShutdownView();
+                        mpLib->DestroyView(mpView);
+                        mpView = NULL;
+                    }
+                    mpLib->Shutdown();
+                    mpLib->Destroy();
+                    mpLib = NULL;
+                }
+            }
+
+            bool Host::AddFont(const char8_t* pPath)
+            {
+                EA::IO::FileStream* pStream = new EA::IO::FileStream(pPath);
+                pStream->AddRef();
+
+                uint32_t faceCount = 0;
+                if(pStream->Open(EA::IO::kAccessFlagRead))
+                    faceCount = mpLib->GetTextSystem()->AddFace(pStream);
+                else
+                    fprintf(stderr, "Could not open font %s\n", pPath);
+
+                pStream->Release(); // The font server keeps its own reference.
+                mFontCount += faceCount;
+                return faceCount > 0;
+            }
+
+            void Host::LoadFonts(const char8_t* pPath)
+            {
+                char8_t path[512];
+
+            #if defined(EA_PLATFORM_MICROSOFT)
+                const DWORD attributes = GetFileAttributesA(pPath);
+                if((attributes != INVALID_FILE_ATTRIBUTES) && (attributes & FILE_ATTRIBUTE_DIRECTORY))
+                {
+                    snprintf(path, sizeof(path), "%s\\*", pPath);
+                    WIN32_FIND_DATAA findData;
+                    HANDLE hFind = FindFirstFileA(path, &findData);
+                    if(hFind != INVALID_HANDLE_VALUE)
+                    {
+                        do
+                        {
+                            if(!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && HasFontExtension(findData.cFileName))
+                            {
+                                snprintf(path, sizeof(path), "%s\\%s", pPath, findData.cFileName);
+                                AddFont(path);
+                            }
+                        } while(FindNextFileA(hFind, &findData));
+                        FindClose(hFind);
+                    }
+                    return;
+                }
+            #else
+                if(DIR* pDir = opendir(pPath))
+                {
+                    while(dirent* pEntry = readdir(pDir))
+                    {
+                        if(HasFontExtension(pEntry->d_name))
+                        {
+                            snprintf(path, sizeof(path), "%s/%s", pPath, pEntry->d_name);
+                            AddFont(path);
+                        }
+                    }
+                    closedir(pDir);
+                    return;
+                }
+            #endif
+
+                AddFont(pPath);
+            }
+
+            bool Host::WaitForLoad(double timeoutSeconds)
+            {
+                while(!mbLoadComplete)
+                {
+                    if((Now() - mLoadStartTime) > timeoutSeconds)
+                    {
+                        fprintf(stderr, "Load timed out after %.1f seconds\n", timeoutSeconds);
+                        return false;
+                    }
+                    Frame();
+                }
+
+                // Paint once more so that the first full paint is not counted by whatever is measured next.
+                Frame();
+                return !mbLoadFailed;
+            }
+
+            bool Host::LoadHtml(const char8_t* pHtml, size_t length, const char8_t* pBaseUrl, double timeoutSeconds)
+            {
+                mbLoadComplete      = false;
+                mbLoadFailed        = false;
+                mCommitTime         = -1.0;
+                mFirstLayoutTime    = -1.0;
+                mLoadCompleteTime   = -1.0;
+                mLoadStartTime      = Now();
+                mpView->SetHtml(pHtml, length, pBaseUrl);
+                return WaitForLoad(timeoutSeconds);
+            }
+
+            bool Host::LoadURI(const char8_t* pURI, double timeoutSeconds)
+            {
+                mbLoadComplete      = false;
+                mbLoadFailed        = false;
+                mCommitTime         = -1.0;
+                mFirstLayoutTime    = -1.0;
+                mLoadCompleteTime   = -1.0;
+                mLoadStartTime      = Now();
+                mpView->SetURI(pURI);
+                return WaitForLoad(timeoutSeconds);
+            }
+
+            bool Host::LoadFile(const char8_t* pPath, const char8_t* pBaseUrl, double timeoutSeconds)
+            {
+                FILE* pFile = fopen(pPath, "rb");
+                if(!pFile)
+                {
+                    fprintf(stderr, "Could not open %s\n", pPath);
+                    return false;
+                }
+
+                eastl::vector<char8_t> html;
+                char8_t buffer[4096];
+                size_t count;
+                while((count = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+                    html.insert(html.end(), buffer, buffer + count);
+                fclose(pFile);
+
+                return LoadHtml(html.data(), html.size(), pBaseUrl, timeoutSeconds);
+            }
+
+            double Host::Frame()
+            {
+                if(mpFrameCallback)
+                    mpFrameCallback(mpFrameCallbackContext);
+
+                const double startTime = Now();
+                mpView->Paint(true);
+                return Now() - startTime;
+            }
+
+            double Host::EvaluateNumber(const char8_t* pScript)
+            {
+                double result = 0.0;
+                JavascriptValue* pValue = mpLib->CreateJavascriptValue(mpView);
+                if(mpView->EvaluateJavaScript(pScript, pValue) && (pValue->Type() == JavascriptValueType::Number))
+                    result = pValue->GetNumberValue();
+                mpLib->DestroyJavascriptValue(pValue);
+                return result;
+            }
+
+            void Host::ResetProcessStats()
+            {
+                memset(mProcessStats, 0, sizeof(mProcessStats));
+                mPaintedPixelCount  = 0;
+                mPaintedRegionCount = 0;
+            }
+
+            void Host::LoadUpdate(LoadInfo& loadInfo)
+            {
+                switch(loadInfo.mLoadEventType)
+                {
+                    case kLETLoadCommited:
+                        if(mCommitTime < 0.0)
+                            mCommitTime = Now() - mLoadStartTime;
+                        break;
+
+                    case kLETVisualLayOutAvailable:
+                        if(mFirstLayoutTime < 0.0)
+                            mFirstLayoutTime = Now() - mLoadStartTime;
+                        break;
+
+                    case kLETLoadCompletedWithErrors:
+                        mbLoadFailed = true;
+                        // Fall through
+                    case kLETLoadCompletedWithoutErrors:
+                        if(!mbLoadComplete)
+                            mLoadCompleteTime = Now() - mLoadStartTime;
+                        mbLoadComplete = true;
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+
+            void Host::ViewUpdate(ViewUpdateInfo& viewUpdateInfo)
+            {
+                if(viewUpdateInfo.mStage != ViewUpdateInfo::Begin)
+                    return;
+
+                for(int i = 0; i < viewUpdateInfo.mDirtyRegionCount; ++i)
+                {
+                    const IntRect& rect = viewUpdateInfo.mDirtyRegions[i];
+                    mPaintedPixelCount += (uint64_t)rect.mSize.mWidth * (uint64_t)rect.mSize.mHeight;
+                }
+                mPaintedRegionCount += (uint32_t)viewUpdateInfo.mDirtyRegionCount;
+            }
+
+            void Host::ViewProcessStatus(ViewProcessInfo& processInfo)
+            {
+                if((processInfo.mProcessType <= kVProcessTypeNone) || (processInfo.mProcessType >= kVProcessTypeLast))
+                    return;
+
+                // The start and intermediate times are left to the application; the library only clears them when a process starts.
+                if(processInfo.mProcessStatus == kVProcessStatusStarted)
+                {
+                    processInfo.mStartTime = Now();
+                }
+                else if(processInfo.mProcessStatus == kVProcessStatusEnded)
+                {
+                    ProcessStats& stats = mProcessStats[processInfo.mProcessType];
+                    ++stats.mCount;
+                    stats.mTotalSize += processInfo.mSize;
+
+                    if(processInfo.mStartTime > 0.0)
+                    {
+                        const double time = Now() - processInfo.mStartTime;
+                        stats.mTotalTime += time;
+                        if(time > stats.mMaxTime)
+                            stats.mMaxTime = time;
+                    }
+                }
+            }
+
+            void Host::DebugLog(DebugLogInfo& debugLogInfo)
+            {
+                if(mbVerbose && debugLogInfo.mpLogText)
+                    fprintf(stderr, "%s\n", debugLogInfo.mpLogText);
+            }
+        }
+    }
+}
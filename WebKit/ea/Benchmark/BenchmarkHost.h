@@ -0,0 +1,151 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// BenchmarkHost.h
+//
+// Maintained by EAWebKit Team
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EAWEBKIT_BENCHMARKHOST_H
+#define EAWEBKIT_BENCHMARKHOST_H
+
+#include <EABase/eabase.h>
+#include <EAWebKit/EAWebKit.h>
+#include <EAWebKit/EAWebKitClient.h>
+#include <EAWebKit/EAWebKitView.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            struct Options;
+
+            // What the library reported through EAWebKitClient::ViewProcessStatus for one process type since the last
+            // ResetProcessStats. Processes that only notify their end (work finished on other threads) add to mCount and
+            // mTotalSize but not to the times.
+            struct ProcessStats
+            {
+                uint32_t    mCount;
+                double      mTotalTime;     // Seconds
+                double      mMaxTime;       // Seconds
+                int64_t     mTotalSize;     // Sum of ViewProcessInfo::mSize at the end of each process
+            };
+
+            // Lower case name of the process type for result names, for instance "layout" for kVProcessTypeLayout.
+            const char8_t* GetProcessTypeName(EA::WebKit::VProcessType processType);
+
+            // Owns the library instance and a single headless view painted in software to the default surface. The view is
+            // never shown; its surface is only there so that the paint code runs as it does in a title.
+            class Host : public EA::WebKit::EAWebKitClient
+            {
+            public:
+                typedef void (*FrameCallback)(void* pContext);
+
+                Host();
+                virtual ~Host();
+
+                bool Init(const Options& options, int viewWidth = 1280, int viewHeight = 720);
+                void Shutdown();
+
+                // Replaces the view with one made from viewParameters, for instance one with a hardware renderer and tiles.
+                bool ResetView(const EA::WebKit::ViewParameters& viewParameters);
+
+                EA::WebKit::EAWebKitLib*    GetLib()  const { return mpLib; }
+                EA::WebKit::View*           GetView() const { return mpView; }
+                bool                        HasFonts() const { return mFontCount > 0; }
+
+                // Seconds, from the same high resolution timer the library is given.
+                static double Now();
+
+                // Loads the html (the document URL is pBaseUrl, so cookies and relative URLs resolve against it) or the URL, and
+                // paints until the load completes. Returns false on timeout or if the load completed with errors.
+                bool LoadHtml(const char8_t* pHtml, size_t length, const char8_t* pBaseUrl, double timeoutSeconds = 10.0);
+                bool LoadURI(const char8_t* pURI, double timeoutSeconds = 30.0);
+                bool LoadFile(const char8_t* pPath, const char8_t* pBaseUrl, double timeoutSeconds = 10.0);
+
+                // One frame as a title runs it: tick the library, then paint the view. Returns the time it took.
+                double Frame();
+
+                // Called at the start of each frame, outside of its time, for the work a title does between frames. The
+                // network suite serves its pages from there. NULL removes it.
+                void SetFrameCallback(FrameCallback pCallback, void* pContext) { mpFrameCallback = pCallback; mpFrameCallbackContext = pContext; }
+
+                // Runs script in the main frame and returns its result as a number (0 if it is not one).
+                double EvaluateNumber(const char8_t* pScript);
+
+                void                ResetProcessStats();
+                const ProcessStats& GetProcessStats(EA::WebKit::VProcessType processType) const { return mProcessStats[processType]; }
+
+                // Dirty regions handed to ViewUpdate since the last ResetProcessStats.
+                uint64_t GetPaintedPixelCount() const { return mPaintedPixelCount; }
+                uint32_t GetPaintedRegionCount() const { return mPaintedRegionCount; }
+
+                // Load milestones of the last LoadHtml/LoadURI, in seconds from its start. Negative if not reached.
+                double GetTimeToCommit() const { return mCommitTime; }
+                double GetTimeToFirstLayout() const { return mFirstLayoutTime; }
+                double GetTimeToLoadComplete() const { return mLoadCompleteTime; }
+
+                // EAWebKitClient
+                virtual void LoadUpdate(EA::WebKit::LoadInfo& loadInfo);
+                virtual void ViewUpdate(EA::WebKit::ViewUpdateInfo& viewUpdateInfo);
+                virtual void ViewProcessStatus(EA::WebKit::ViewProcessInfo& processInfo);
+                virtual void DebugLog(EA::WebKit::DebugLogInfo& debugLogInfo);
+
+            private:
+                bool WaitForLoad(double timeoutSeconds);
+                void LoadFonts(const char8_t* pPath);
+                bool AddFont(const char8_t* pPath);
+
+                EA::WebKit::EAWebKitLib*    mpLib;
+                EA::WebKit::View*           mpView;
+                uint32_t                    mFontCount;
+                bool                        mbVerbose;
+                FrameCallback               mpFrameCallback;
+                void*                       mpFrameCallbackContext;
+
+                bool                        mbLoadComplete;
+                bool                        mbLoadFailed;
+                double                      mLoadStartTime;
+                double                      mCommitTime;
+                double                      mFirstLayoutTime;
+                double                      mLoadCompleteTime;
+
+                ProcessStats                mProcessStats[EA::WebKit::kVProcessTypeLast];
+                uint64_t                    mPaintedPixelCount;
+                uint32_t                    mPaintedRegionCount;
+            };
+        }
+    }
+}
+
+#endif // EAWEBKIT_BENCHMARKHOST_H
@@ -0,0 +1,238 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// BenchmarkMain.cpp
+//
+// Maintained by EAWebKit Team
+//
+// Usage:
+//   EAWebKitBenchmark [--filter <suite>] [--iterations <n>] [--fonts <file or directory>]
+//                     [--data <directory>] [--json <results.json>] [--verbose]
+//   EAWebKitBenchmark --compare <baseline.json> <current.json> [--threshold <percent>]
+//
+// The first form runs the suites and prints their results, and writes them to
+// the json file if one is given. The second form compares two such files and
+// exits with 1 if a result got worse by more than the threshold (5% by
+// default), so that it can gate a change: run the benchmark on a build without
+// the change, then with it, then compare.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "Benchmark.h"
+#include "BenchmarkHost.h"
+#include "BenchmarkResults.h"
+#include <EASTL/sort.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// EASTL expects the application to provide these.
+void* operator new[](size_t size, const char* /*pName*/, int /*flags*/, unsigned /*debugFlags*/, const char* /*file*/, int /*line*/)
+{
+    return malloc(size);
+}
+
+void* operator new[](size_t size, size_t alignment, size_t alignmentOffset, const char* /*pName*/, int /*flags*/, unsigned /*debugFlags*/, const char* /*file*/, int /*line*/)
+{
+    // Only aligned allocations with no offset are made by the containers used here.
+    (void)alignmentOffset;
+#if defined(_MSC_VER)
+    return _aligned_malloc(size, alignment);
+#else
+    void* p = NULL;
+    return (posix_memalign(&p, (alignment < sizeof(void*)) ? sizeof(void*) : alignment, size) == 0) ? p : NULL;
+#endif
+}
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            const Suite kSuites[] =
+            {
+                { "cookie",             RunCookieBenchmark },
+                { "cookie_file",        RunCookieFileBenchmark },
+                { "thread_system",      RunThreadSystemBenchmark },
+                { "glyph_raster",       RunGlyphRasterBenchmark },
+                { "glyph_run_cache",    RunGlyphRunCacheBenchmark },
+                { "cjk_glyph_cache",    RunCJKGlyphCacheBenchmark },
+                { "image_compression",  RunImageCompressionBenchmark },
+                { "image_frame_cache",  RunImageFrameCacheBenchmark },
+                { "damage_trace",       RunDamageTraceBenchmark },
+                { "tile_scroll",        RunTileScrollBenchmark },
+                { "network_load",       RunNetworkLoadBenchmark },
+                { "render",             RunRenderBenchmark },
+                { "disk_cache",         RunDiskCacheBenchmark },
+                { "disk_cache_index",   RunDiskCacheIndexBenchmark },
+                { "transport_jobs",     RunTransportJobBenchmark },
+                { "inflate",            RunInflateBenchmark },
+            };
+
+            double Median(double* pValues, uint32_t count)
+            {
+                if(!count)
+                    return 0.0;
+
+                eastl::sort(pValues, pValues + count);
+                if(count & 1)
+                    return pValues[count / 2];
+                return (pValues[(count / 2) - 1] + pValues[count / 2]) * 0.5;
+            }
+
+            uint32_t Crc32(const uint8_t* pData, size_t size, uint32_t crc)
+            {
+                crc = ~crc;
+                for(size_t i = 0; i < size; ++i)
+                {
+                    crc ^= pData[i];
+                    for(int bit = 0; bit < 8; ++bit)
+                        crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+                }
+                return ~crc;
+            }
+
+            int Compare(const char8_t* pBaselinePath, const char8_t* pCurrentPath, double thresholdPercent)
+            {
+                Results baseline, current;
+                if(!baseline.ReadJSON(pBaselinePath))
+                {
+                    fprintf(stderr, "Could not read %s\n", pBaselinePath);
+                    return 2;
+                }
+                if(!current.ReadJSON(pCurrentPath))
+                {
+                    fprintf(stderr, "Could not read %s\n", pCurrentPath);
+                    return 2;
+                }
+
+                const uint32_t regressionCount = CompareResults(baseline, current, thresholdPercent, stdout);
+                printf("%u regression(s) beyond %.1f%%\n", regressionCount, thresholdPercent);
+                return regressionCount ? 1 : 0;
+            }
+
+            int Run(const Options& options, const char8_t* pJsonPath)
+            {
+                Host host;
+                if(!host.Init(options))
+                {
+                    fprintf(stderr, "Could not initialize EAWebKit\n");
+                    return 2;
+                }
+
+                Results results;
+                for(size_t i = 0; i < sizeof(kSuites) / sizeof(kSuites[0]); ++i)
+                {
+                    const Suite& suite = kSuites[i];
+                    if(options.mpFilter && !strstr(suite.mpName, options.mpFilter))
+                        continue;
+
+                    printf("Running %s\n", suite.mpName);
+                    const size_t resultCount = results.GetResults().size();
+                    suite.mpFunction(host, results, options);
+
+                    if(options.mbVerbose)
+                    {
+                        for(size_t r = resultCount; r < results.GetResults().size(); ++r)
+                        {
+                            const Result& result = results.GetResults()[r];
+                            printf("  %-40s %14.4f %s\n", result.mName.c_str(), result.mValue, result.mUnit.c_str());
+                        }
+                    }
+                }
+
+                host.Shutdown();
+
+                printf("\n");
+                results.Print(stdout);
+
+                if(pJsonPath && !results.WriteJSON(pJsonPath))
+                {
+                    fprintf(stderr, "Could not write %s\n", pJsonPath);
+                    return 2;
+                }
+                return 0;
+            }
+        }
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    using namespace EA::WebKit::Benchmark;
+
+    Options        options;
+    const char8_t* pJsonPath        = NULL;
+    const char8_t* pBaselinePath    = NULL;
+    const char8_t* pCurrentPath     = NULL;
+    double         thresholdPercent = 5.0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const char8_t* pArg  = argv[i];
+        const char8_t* pNext = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if(!strcmp(pArg, "--verbose"))
+            options.mbVerbose = true;
+        else if(pNext && !strcmp(pArg, "--filter"))
+            options.mpFilter = argv[++i];
+        else if(pNext && !strcmp(pArg, "--iterations"))
+            options.mIterations = (uint32_t)atoi(argv[++i]);
+        else if(pNext && !strcmp(pArg, "--fonts"))
+            options.mpFontPath = argv[++i];
+        else if(pNext && !strcmp(pArg, "--data"))
+            options.mpDataDirectory = argv[++i];
+        else if(pNext && !strcmp(pArg, "--json"))
+            pJsonPath = argv[++i];
+        else if(pNext && !strcmp(pArg, "--threshold"))
+            thresholdPercent = atof(argv[++i]);
+        else if((i + 2 < argc) && !strcmp(pArg, "--compare"))
+        {
+            pBaselinePath = argv[++i];
+            pCurrentPath  = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "Unknown argument %s\n", pArg);
+            return 2;
+        }
+    }
+
+    if(options.mIterations == 0)
+        options.mIterations = 1;
+
+    if(pBaselinePath)
+        return Compare(pBaselinePath, pCurrentPath, thresholdPercent);
+
+    return Run(options, pJsonPath);
+}
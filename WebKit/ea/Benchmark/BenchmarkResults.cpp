@@ -0,0 +1,259 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// BenchmarkResults.cpp
+//
+// Maintained by EAWebKit Team
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "BenchmarkResults.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            namespace
+            {
+                void WriteString(FILE* pFile, const eastl::string& s)
+                {
+                    fputc('"', pFile);
+                    for(eastl_size_t i = 0; i < s.size(); ++i)
+                    {
+                        const char c = s[i];
+                        if((c == '"') || (c == '\\'))
+                            fputc('\\', pFile);
+                        if((unsigned char)c >= 0x20)
+                            fputc(c, pFile);
+                    }
+                    fputc('"', pFile);
+                }
+
+                // Reads the flat objects that WriteJSON writes. Nested arrays and objects other than the results array are not expected.
+                class Reader
+                {
+                public:
+                    Reader(const char* p, const char* pEnd) : mp(p), mpEnd(pEnd) { }
+
+                    void SkipSpace()
+                    {
+                        while((mp < mpEnd) && ((*mp == ' ') || (*mp == '\t') || (*mp == '\r') || (*mp == '\n') || (*mp == ',') || (*mp == ':')))
+                            ++mp;
+                    }
+
+                    bool Consume(char c)
+                    {
+                        SkipSpace();
+                        if((mp < mpEnd) && (*mp == c))
+                        {
+                            ++mp;
+                            return true;
+                        }
+                        return false;
+                    }
+
+                    bool Find(char c)
+                    {
+                        while((mp < mpEnd) && (*mp != c))
+                            ++mp;
+                        return Consume(c);
+                    }
+
+                    bool ReadString(eastl::string& s)
+                    {
+                        s.clear();
+                        if(!Consume('"'))
+                            return false;
+                        while((mp < mpEnd) && (*mp != '"'))
+                        {
+                            if((*mp == '\\') && (mp + 1 < mpEnd))
+                                ++mp;
+                            s.push_back(*mp++);
+                        }
+                        return Consume('"');
+                    }
+
+                    // Reads a number, true, false or a string as the value of a key.
+                    void ReadValue(eastl::string& s)
+                    {
+                        SkipSpace();
+                        if((mp < mpEnd) && (*mp == '"'))
+                        {
+                            ReadString(s);
+                            return;
+                        }
+                        s.clear();
+                        while((mp < mpEnd) && (*mp != ',') && (*mp != '}') && (*mp != ' ') && (*mp != '\r') && (*mp != '\n'))
+                            s.push_back(*mp++);
+                    }
+
+                    bool AtEnd() { SkipSpace(); return mp >= mpEnd; }
+
+                private:
+                    const char* mp;
+                    const char* mpEnd;
+                };
+            }
+
+            void Results::Add(const char8_t* pSuite, const char8_t* pName, double value, const char8_t* pUnit, bool bHigherIsBetter)
+            {
+                Result& result = mResults.push_back();
+                result.mSuite           = pSuite;
+                result.mName            = pName;
+                result.mUnit            = pUnit;
+                result.mValue           = value;
+                result.mbHigherIsBetter = bHigherIsBetter;
+            }
+
+            const Result* Results::Find(const char8_t* pSuite, const char8_t* pName) const
+            {
+                for(ResultArray::const_iterator it = mResults.begin(); it != mResults.end(); ++it)
+                {
+                    if((it->mSuite == pSuite) && (it->mName == pName))
+                        return &*it;
+                }
+                return NULL;
+            }
+
+            bool Results::WriteJSON(const char8_t* pPath) const
+            {
+                FILE* pFile = fopen(pPath, "w");
+                if(!pFile)
+                    return false;
+
+                fprintf(pFile, "{\n  \"results\": [\n");
+                for(eastl_size_t i = 0; i < mResults.size(); ++i)
+                {
+                    const Result& result = mResults[i];
+                    fprintf(pFile, "    { \"suite\": ");
+                    WriteString(pFile, result.mSuite);
+                    fprintf(pFile, ", \"name\": ");
+                    WriteString(pFile, result.mName);
+                    fprintf(pFile, ", \"value\": %.9g, \"unit\": ", result.mValue);
+                    WriteString(pFile, result.mUnit);
+                    fprintf(pFile, ", \"higherIsBetter\": %s }%s\n", result.mbHigherIsBetter ? "true" : "false", (i + 1 < mResults.size()) ? "," : "");
+                }
+                fprintf(pFile, "  ]\n}\n");
+
+                const bool bSuccess = (ferror(pFile) == 0);
+                fclose(pFile);
+                return bSuccess;
+            }
+
+            bool Results::ReadJSON(const char8_t* pPath)
+            {
+                FILE* pFile = fopen(pPath, "rb");
+                if(!pFile)
+                    return false;
+
+                eastl::string text;
+                char buffer[4096];
+                size_t count;
+                while((count = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+                    text.append(buffer, buffer + count);
+                fclose(pFile);
+
+                Reader reader(text.data(), text.data() + text.size());
+                if(!reader.Find('['))
+                    return false;
+
+                mResults.clear();
+                eastl::string key, value;
+                while(reader.Consume('{'))
+                {
+                    Result result;
+                    result.mValue = 0.0;
+                    result.mbHigherIsBetter = false;
+
+                    while(!reader.Consume('}'))
+                    {
+                        if(reader.AtEnd() || !reader.ReadString(key))
+                            return false;
+                        reader.ReadValue(value);
+
+                        if(key == "suite")
+                            result.mSuite = value;
+                        else if(key == "name")
+                            result.mName = value;
+                        else if(key == "unit")
+                            result.mUnit = value;
+                        else if(key == "value")
+                            result.mValue = strtod(value.c_str(), NULL);
+                        else if(key == "higherIsBetter")
+                            result.mbHigherIsBetter = (value == "true");
+                    }
+                    mResults.push_back(result);
+                }
+                return reader.Consume(']');
+            }
+
+            void Results::Print(FILE* pFile) const
+            {
+                for(ResultArray::const_iterator it = mResults.begin(); it != mResults.end(); ++it)
+                    fprintf(pFile, "%-24s %-40s %14.4f %s\n", it->mSuite.c_str(), it->mName.c_str(), it->mValue, it->mUnit.c_str());
+            }
+
+            uint32_t CompareResults(const Results& baseline, const Results& current, double thresholdPercent, FILE* pFile)
+            {
+                uint32_t regressionCount = 0;
+
+                fprintf(pFile, "%-24s %-40s %14s %14s %9s\n", "suite", "name", "baseline", "current", "change");
+                for(Results::ResultArray::const_iterator it = current.GetResults().begin(); it != current.GetResults().end(); ++it)
+                {
+                    const Result* pBase = baseline.Find(it->mSuite.c_str(), it->mName.c_str());
+                    if(!pBase)
+                    {
+                        fprintf(pFile, "%-24s %-40s %14s %14.4f %9s\n", it->mSuite.c_str(), it->mName.c_str(), "-", it->mValue, "new");
+                        continue;
+                    }
+
+                    // Positive means better, whichever way the result goes.
+                    double changePercent = 0.0;
+                    if(pBase->mValue != 0.0)
+                        changePercent = (it->mValue - pBase->mValue) * 100.0 / pBase->mValue;
+                    if(!it->mbHigherIsBetter)
+                        changePercent = -changePercent;
+
+                    const bool bRegression = (changePercent < -thresholdPercent);
+                    if(bRegression)
+                        ++regressionCount;
+
+                    fprintf(pFile, "%-24s %-40s %14.4f %14.4f %+8.1f%%%s\n", it->mSuite.c_str(), it->mName.c_str(), pBase->mValue, it->mValue, changePercent, bRegression ? "  REGRESSION" : "");
+                }
+
+                return regressionCount;
+            }
+        }
+    }
+}
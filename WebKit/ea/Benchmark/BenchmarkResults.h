@@ -0,0 +1,87 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// BenchmarkResults.h
+//
+// Maintained by EAWebKit Team
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EAWEBKIT_BENCHMARKRESULTS_H
+#define EAWEBKIT_BENCHMARKRESULTS_H
+
+#include <EABase/eabase.h>
+#include <EASTL/string.h>
+#include <EASTL/vector.h>
+#include <stdio.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            struct Result
+            {
+                eastl::string   mSuite;
+                eastl::string   mName;
+                eastl::string   mUnit;
+                double          mValue;
+                bool            mbHigherIsBetter;
+            };
+
+            // The results of a run. They are written as
+            //   { "results": [ { "suite": "cookie", "name": "lookup", "value": 1.5, "unit": "us", "higherIsBetter": false }, ... ] }
+            // and ReadJSON only needs to read back what WriteJSON writes.
+            class Results
+            {
+            public:
+                typedef eastl::vector<Result> ResultArray;
+
+                void Add(const char8_t* pSuite, const char8_t* pName, double value, const char8_t* pUnit, bool bHigherIsBetter);
+                const Result* Find(const char8_t* pSuite, const char8_t* pName) const;
+                const ResultArray& GetResults() const { return mResults; }
+
+                bool WriteJSON(const char8_t* pPath) const;
+                bool ReadJSON(const char8_t* pPath);
+                void Print(FILE* pFile) const;
+
+            private:
+                ResultArray mResults;
+            };
+
+            // Prints each result of current next to the same result in baseline, and returns how many got worse by more than
+            // thresholdPercent.
+            uint32_t CompareResults(const Results& baseline, const Results& current, double thresholdPercent, FILE* pFile);
+        }
+    }
+}
+
+#endif // EAWEBKIT_BENCHMARKRESULTS_H
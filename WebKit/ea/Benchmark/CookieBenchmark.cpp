@@ -0,0 +1,236 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// CookieBenchmark.cpp
+//
+// Maintained by EAWebKit Team
+//
+// Measures adding cookies and looking up the cookies of a URL, with the cookie
+// jar holding a few hundred and a few thousand cookies spread over many
+// domains. The lookup goes through document.cookie, which asks the
+// CookieManager for the cookie text of the document URL just like a request
+// header does. A lookup that only visits the matching cookies costs about the
+// same at both sizes.
+//
+// The cookie_file suite measures saving the persistent cookies to the cookie
+// file and reading them back. SetCookieUsage shuts the cookie manager down,
+// which saves what changed, and starts it again, which reads the file, so it
+// stands in for a shutdown followed by a startup.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "Benchmark.h"
+#include "BenchmarkHost.h"
+#include "BenchmarkResults.h"
+#include <EASTL/vector.h>
+#include <stdio.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            namespace
+            {
+                const uint32_t kCookiesPerDomain    = 4;    // Two on the host, one on the parent domain, one on a deeper path.
+                const uint32_t kSampleDomainCount   = 8;    // Documents the lookups are made from.
+                const uint32_t kLookupsPerSample    = 500;
+                const uint32_t kSavedCookiesPerDomain = 2;
+
+                const char8_t kCookieFileName[]     = "EAWebKitBenchmarkCookies.dat"; // Relative to the temp directory.
+                const char8_t kExpires[]            = "expires=Fri, 01 Jan 2038 00:00:00 GMT";
+
+                void AddCookies(Host& host, uint32_t domainCount, double& addTime)
+                {
+                    char8_t header[128];
+                    char8_t uri[128];
+
+                    const double startTime = Host::Now();
+                    for(uint32_t i = 0; i < domainCount; ++i)
+                    {
+                        snprintf(uri, sizeof(uri), "http://www.d%u.bench.test/", i);
+
+                        snprintf(header, sizeof(header), "session%u=0123456789abcdef; path=/", i);
+                        host.GetLib()->AddCookie(header, uri);
+                        snprintf(header, sizeof(header), "prefs%u=lang-en_theme-dark; path=/", i);
+                        host.GetLib()->AddCookie(header, uri);
+                        snprintf(header, sizeof(header), "tracking%u=fedcba9876543210; domain=.d%u.bench.test; path=/", i, i);
+                        host.GetLib()->AddCookie(header, uri);
+                        snprintf(header, sizeof(header), "cart%u=item-42; path=/shop/cart", i);
+                        host.GetLib()->AddCookie(header, uri);
+                    }
+                    addTime = Host::Now() - startTime;
+                }
+
+                // Returns the median time of one document.cookie read, in seconds, with the cost of the script loop removed.
+                double MeasureLookup(Host& host, uint32_t domainCount, const Options& options)
+                {
+                    static const char8_t kHtml[] = "<html><body>cookies</body></html>";
+
+                    char8_t cookieScript[160];
+                    char8_t emptyScript[160];
+                    snprintf(cookieScript, sizeof(cookieScript), "(function(){var n=0;for(var i=0;i<%u;++i)n+=document.cookie.length;return n;})()", kLookupsPerSample);
+                    snprintf(emptyScript,  sizeof(emptyScript),  "(function(){var n=0;for(var i=0;i<%u;++i)n+=i&1;return n;})()", kLookupsPerSample);
+
+                    eastl::vector<double> samples;
+                    char8_t baseUrl[128];
+
+                    for(uint32_t s = 0; s < kSampleDomainCount; ++s)
+                    {
+                        const uint32_t domain = (s * domainCount) / kSampleDomainCount;
+                        snprintf(baseUrl, sizeof(baseUrl), "http://www.d%u.bench.test/shop/cart/index.html", domain);
+                        if(!host.LoadHtml(kHtml, sizeof(kHtml) - 1, baseUrl))
+                            continue;
+
+                        if(host.EvaluateNumber(cookieScript) == 0.0)
+                        {
+                            fprintf(stderr, "cookie: no cookies visible from %s\n", baseUrl);
+                            continue;
+                        }
+
+                        for(uint32_t iteration = 0; iteration < options.mIterations; ++iteration)
+                        {
+                            double startTime = Host::Now();
+                            host.EvaluateNumber(emptyScript);
+                            const double emptyTime = Host::Now() - startTime;
+
+                            startTime = Host::Now();
+                            host.EvaluateNumber(cookieScript);
+                            const double cookieTime = Host::Now() - startTime;
+
+                            samples.push_back((cookieTime - emptyTime) / kLookupsPerSample);
+                        }
+                    }
+
+                    return samples.empty() ? 0.0 : Median(samples.data(), (uint32_t)samples.size());
+                }
+
+                void AddSavedCookies(Host& host, uint32_t domainCount)
+                {
+                    char8_t header[160];
+                    char8_t uri[128];
+
+                    for(uint32_t i = 0; i < domainCount; ++i)
+                    {
+                        snprintf(uri, sizeof(uri), "http://www.d%u.bench.test/", i);
+
+                        snprintf(header, sizeof(header), "id%u=0123456789abcdef; path=/; %s", i, kExpires);
+                        host.GetLib()->AddCookie(header, uri);
+                        snprintf(header, sizeof(header), "prefs%u=lang-en_theme-dark; domain=.d%u.bench.test; path=/; %s", i, i, kExpires);
+                        host.GetLib()->AddCookie(header, uri);
+                    }
+                }
+
+                double TimeCookieUsage(Host& host, const CookieInfo& cookieInfo)
+                {
+                    const double startTime = Host::Now();
+                    host.GetLib()->SetCookieUsage(cookieInfo);
+                    return Host::Now() - startTime;
+                }
+            }
+
+            void RunCookieBenchmark(Host& host, Results& results, const Options& options)
+            {
+                static const uint32_t kDomainCounts[] = { 64, 1024 };
+
+                for(size_t i = 0; i < sizeof(kDomainCounts) / sizeof(kDomainCounts[0]); ++i)
+                {
+                    const uint32_t domainCount = kDomainCounts[i];
+                    const uint32_t cookieCount = domainCount * kCookiesPerDomain;
+
+                    CookieInfo cookieInfo;
+                    cookieInfo.mMaxCookieCount = (uint16_t)(cookieCount + 16);
+                    host.GetLib()->SetCookieUsage(cookieInfo);
+                    host.GetLib()->RemoveCookies();
+
+                    double addTime = 0.0;
+                    AddCookies(host, domainCount, addTime);
+
+                    const double lookupTime = MeasureLookup(host, domainCount, options);
+
+                    char8_t name[64];
+                    snprintf(name, sizeof(name), "add_%u_cookies", cookieCount);
+                    results.Add("cookie", name, addTime * 1e6 / cookieCount, "us/cookie", false);
+                    snprintf(name, sizeof(name), "lookup_among_%u_cookies", cookieCount);
+                    results.Add("cookie", name, lookupTime * 1e6, "us/lookup", false);
+                }
+
+                host.GetLib()->RemoveCookies();
+                host.GetLib()->SetCookieUsage(CookieInfo());
+            }
+
+            void RunCookieFileBenchmark(Host& host, Results& results, const Options& options)
+            {
+                static const uint32_t kDomainCounts[] = { 64, 1024 };
+
+                for(size_t i = 0; i < sizeof(kDomainCounts) / sizeof(kDomainCounts[0]); ++i)
+                {
+                    const uint32_t domainCount = kDomainCounts[i];
+                    const uint32_t cookieCount = domainCount * kSavedCookiesPerDomain;
+
+                    CookieInfo cookieInfo;
+                    cookieInfo.mCookieFilePath        = kCookieFileName;
+                    cookieInfo.mMaxCookieCount        = (uint16_t)(cookieCount + 16);
+                    cookieInfo.mDiskCookieStorageSize = cookieCount * 256; // Room for all of them.
+
+                    eastl::vector<double> saveTimes, loadTimes, changeTimes;
+                    for(uint32_t iteration = 0; iteration < options.mIterations; ++iteration)
+                    {
+                        host.GetLib()->SetCookieUsage(cookieInfo);
+                        host.GetLib()->RemoveCookies();
+                        AddSavedCookies(host, domainCount);
+
+                        // Every cookie is new, so the first one writes them all. Nothing changed for the second one, which
+                        // only reads the file.
+                        saveTimes.push_back(TimeCookieUsage(host, cookieInfo));
+                        loadTimes.push_back(TimeCookieUsage(host, cookieInfo));
+
+                        char8_t header[160];
+                        snprintf(header, sizeof(header), "id0=fedcba9876543210; path=/; %s", kExpires);
+                        host.GetLib()->AddCookie(header, "http://www.d0.bench.test/");
+                        changeTimes.push_back(TimeCookieUsage(host, cookieInfo));
+                    }
+
+                    char8_t name[64];
+                    snprintf(name, sizeof(name), "save_%u_cookies", cookieCount);
+                    results.Add("cookie_file", name, Median(saveTimes.data(), (uint32_t)saveTimes.size()) * 1e3, "ms", false);
+                    snprintf(name, sizeof(name), "load_%u_cookies", cookieCount);
+                    results.Add("cookie_file", name, Median(loadTimes.data(), (uint32_t)loadTimes.size()) * 1e3, "ms", false);
+                    snprintf(name, sizeof(name), "save_1_change_and_load_%u_cookies", cookieCount);
+                    results.Add("cookie_file", name, Median(changeTimes.data(), (uint32_t)changeTimes.size()) * 1e3, "ms", false);
+                }
+
+                host.GetLib()->RemoveCookies();   // Deletes the cookie file.
+                host.GetLib()->SetCookieUsage(CookieInfo());
+            }
+        }
+    }
+}
@@ -0,0 +1,146 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// DamageBenchmark.cpp
+//
+// Maintained by EAWebKit Team
+//
+// Replays invalidation traces through the view's dirty region tracking. Each
+// trace is a page of absolutely positioned boxes and a step script that
+// changes some of them each frame, the way a title's UI does:
+//   overlapping_panels  Large panels, overlapping each other, changing color.
+//   text_lines          Scattered line-sized bars changing color.
+//   carets              Many caret-sized marks blinking, more than the
+//                       tracker keeps rects for.
+//   moving_sprites      Small sprites moving a few pixels, so the old and new
+//                       rects of each overlap.
+// For each trace, the suite reports the pixels and rects handed to ViewUpdate
+// per frame, and the frame time, which includes adding the rects.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "Benchmark.h"
+#include "BenchmarkHost.h"
+#include "BenchmarkResults.h"
+#include <EASTL/string.h>
+#include <EASTL/vector.h>
+#include <stdio.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            namespace
+            {
+                const uint32_t kFramesPerIteration  = 30;
+                const char8_t  kDamagePageUrl[]     = "http://www.bench.test/damage.html";
+
+                struct DamageTrace
+                {
+                    const char8_t*  mpName;
+                    const char8_t*  mpSetup;    // Adds the boxes with add(x, y, width, height). They are in the array e.
+                    const char8_t*  mpStep;     // Body of step(f), run before frame f is painted.
+                };
+
+                const DamageTrace kDamageTraces[] =
+                {
+                    {
+                        "overlapping_panels",
+                        "for(var i=0;i<6;++i)add(80+i*160,60+(i&1)*140,400,300);",
+                        "for(var i=0;i<e.length;++i)if(((f+i)%3)==0)e[i].style.backgroundColor=(f&1)?'#c0c0ff':'#ffc0c0';"
+                    },
+                    {
+                        "text_lines",
+                        "for(var i=0;i<40;++i)add(20+(i%2)*640,10+(i>>1)*35,600,14);",
+                        "for(var k=0;k<8;++k)e[(f*7+k*5)%e.length].style.backgroundColor=(f&1)?'#404040':'#606060';"
+                    },
+                    {
+                        "carets",
+                        "for(var i=0;i<120;++i)add(13+(i*97)%1240,7+(i*53)%690,2,16);",
+                        "for(var i=0;i<e.length;++i)e[i].style.visibility=((f+i)&1)?'hidden':'visible';"
+                    },
+                    {
+                        "moving_sprites",
+                        "for(var i=0;i<24;++i)add((i*211)%1180,(i*127)%620,32,32);",
+                        "for(var i=0;i<e.length;++i)e[i].style.left=((i*211+f*3)%1180)+'px';"
+                    }
+                };
+
+                void BuildDamagePage(const DamageTrace& trace, eastl::string& html)
+                {
+                    html.sprintf("<html><body style='margin:0;background:#ffffff'><script>"
+                                 "var e=[];"
+                                 "function add(x,y,w,h){var d=document.createElement('div');"
+                                 "d.style.cssText='position:absolute;background:#808080;left:'+x+'px;top:'+y+'px;width:'+w+'px;height:'+h+'px';"
+                                 "document.body.appendChild(d);e.push(d);}"
+                                 "%s"
+                                 "function step(f){%sreturn 0;}"
+                                 "</script></body></html>", trace.mpSetup, trace.mpStep);
+                }
+            }
+
+            void RunDamageTraceBenchmark(Host& host, Results& results, const Options& options)
+            {
+                const uint32_t frameCount = kFramesPerIteration * options.mIterations;
+
+                eastl::string html;
+                char8_t script[32];
+                char8_t name[64];
+
+                for(size_t t = 0; t < sizeof(kDamageTraces) / sizeof(kDamageTraces[0]); ++t)
+                {
+                    const DamageTrace& trace = kDamageTraces[t];
+                    BuildDamagePage(trace, html);
+                    if(!host.LoadHtml(html.data(), html.size(), kDamagePageUrl))
+                        continue;
+                    host.Frame();
+
+                    eastl::vector<double> frameTimes;
+                    host.ResetProcessStats();
+                    for(uint32_t frame = 0; frame < frameCount; ++frame)
+                    {
+                        snprintf(script, sizeof(script), "step(%u)", frame);
+                        host.EvaluateNumber(script);
+                        frameTimes.push_back(host.Frame());
+                    }
+
+                    snprintf(name, sizeof(name), "%s_painted_pixels_per_frame", trace.mpName);
+                    results.Add("damage_trace", name, (double)host.GetPaintedPixelCount() / frameCount / 1e3, "kpixels", false);
+                    snprintf(name, sizeof(name), "%s_regions_per_frame", trace.mpName);
+                    results.Add("damage_trace", name, (double)host.GetPaintedRegionCount() / frameCount, "rects", false);
+                    snprintf(name, sizeof(name), "%s_frame", trace.mpName);
+                    results.Add("damage_trace", name, Median(frameTimes.data(), (uint32_t)frameTimes.size()) * 1e3, "ms", false);
+                }
+            }
+        }
+    }
+}
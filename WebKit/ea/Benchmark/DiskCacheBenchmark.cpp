@@ -0,0 +1,401 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// DiskCacheBenchmark.cpp
+//
+// Maintained by EAWebKit Team
+//
+// Lookups and evictions of the disk cache (TransportHandlerDiskCache) as it
+// fills up. The pages are generated: each has kImagesPerPage small images
+// under URLs never requested before, served by a LoopbackHttpServer with
+// Cache-Control: max-age, so that every image of a page is stored in the disk
+// cache. Identical file sharing is turned off for the suite, as the images all
+// have the same body and would otherwise share a single file.
+//
+// disk_cache fills the cache to each of kFillLevels entries and reports there
+// the time per request of loading a page of new images (a miss, which stores
+// them) and of loading the last page again after clearing the memory cache (a
+// hit, read from the disk cache). Lookups that don't depend on the number of
+// entries cost about the same at every level. It then lowers the file limit
+// to half the entries and reports the time per evicted entry, which includes
+// deleting its file and writing the index.
+//
+// disk_cache_index measures the startup of the disk cache with kIndexEntryCounts
+// entries, from the ini file of older versions and from the index journal
+// that replaced it. The files and the ini file are written directly, and
+// SetDiskCacheUsage is switched between an empty directory and the directory
+// of the entries, which saves the index of one and reads the index of the
+// other. It reports per count the startup time:
+//   ini_startup              Reads the ini file and writes the journal from it.
+//   journal_startup          Reads the journal and appends to it.
+//   journal_compact_startup  Reads the journal and rewrites it. The journal is
+//                            given a torn record at its end, as after a crash.
+// and the size per entry of the ini file and of the journal.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "Benchmark.h"
+#include "BenchmarkHost.h"
+#include "BenchmarkResults.h"
+#include "LoopbackHttpServer.h"
+#include <EAWebKit/EAWebKitFileSystem.h>
+#include <EASTL/string.h>
+#include <EASTL/vector.h>
+#include <stdio.h>
+#include <time.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            namespace
+            {
+                const uint32_t kImagesPerPage   = 256;
+                const uint32_t kFillLevels[]    = { 2000, 10000, 50000 };
+
+                const char8_t kDiskCacheDirectory[] = "EAWebKitBenchmarkDiskCache"; // Relative to the temp directory.
+
+                const uint32_t kIndexEntryCounts[]  = { 2000, 10000, 50000 };
+
+                const char8_t kIndexDirectory[]     = "EAWebKitBenchmarkDiskCacheIndex";   // Relative to the temp directory.
+                const char8_t kEmptyDirectory[]     = "EAWebKitBenchmarkDiskCacheEmpty";
+
+                // A 1x1 RGB PNG.
+                const uint8_t kPng[] =
+                {
+                    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+                    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x08, 0x02, 0x00, 0x00, 0x00, 0x90, 0x77, 0x53,
+                    0xde, 0x00, 0x00, 0x00, 0x0c, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9c, 0x63, 0x68, 0x98, 0xb0, 0x00,
+                    0x00, 0x03, 0x44, 0x01, 0xb1, 0x7a, 0xd7, 0x36, 0x14, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e,
+                    0x44, 0xae, 0x42, 0x60, 0x82
+                };
+
+                // The images of page pageNumber, under URLs that no other page uses (see LoopbackHttpServer::AddResource).
+                void BuildPage(uint32_t pageNumber, uint16_t port, eastl::string& html)
+                {
+                    html = "<html><body>";
+                    for(uint32_t i = 0; i < kImagesPerPage; ++i)
+                        html.append_sprintf("<img src='http://127.0.0.1:%u/%u/i.png' width='1' height='1'>", (unsigned)port, pageNumber * kImagesPerPage + i);
+                    html += "</body></html>";
+                }
+
+                uint32_t GetCachedFileCount(Host& host)
+                {
+                    DiskCacheUsageInfo usageInfo;
+                    host.GetLib()->GetDiskCacheUsage(usageInfo);
+                    return usageInfo.mCurrentNumberOfCachedFiles;
+                }
+
+                // The directory SetDiskCacheUsage makes of pName, with a trailing separator.
+                void GetCacheDirectoryPath(FileSystem* pFS, const char8_t* pName, eastl::string& path)
+                {
+                    char8_t tempDirectory[FileSystem::kMaxPathLength];
+                    path.clear();
+                    if(pFS->GetTempDirectory(tempDirectory, sizeof(tempDirectory) - 1) && tempDirectory[0])
+                    {
+                        path = tempDirectory;
+                        if((path.back() != '/') && (path.back() != '\\'))
+                            path += '/';
+                    }
+                    path += pName;
+                    path += '/';
+                }
+
+                bool WriteCacheFile(FileSystem* pFS, const char8_t* pPath, const void* pData, size_t size, bool bAppend)
+                {
+                    FileSystem::FileObject fileObject = pFS->CreateFileObject();
+                    if(fileObject == FileSystem::kFileObjectInvalid)
+                        return false;
+
+                    bool bResult = false;
+                    if(pFS->OpenFile(fileObject, pPath, FileSystem::kWrite, bAppend ? FileSystem::kCDOOpenExisting : FileSystem::kCDOCreateAlways))
+                    {
+                        bResult = (!bAppend || pFS->SetFilePosition(fileObject, pFS->GetFileSize(fileObject))) && pFS->WriteFile(fileObject, pData, (int64_t)size);
+                        pFS->CloseFile(fileObject);
+                    }
+                    pFS->DestroyFileObject(fileObject);
+                    return bResult;
+                }
+
+                // The checksum the disk cache puts in its ini file (GetByteChecksum in TransportHandlerDiskCacheEA.cpp).
+                uint32_t IniChecksum(const char8_t* pData, size_t size, uint32_t checksum)
+                {
+                    for(size_t i = 0; i < size; ++i)
+                        checksum += (checksum << 8) + (uint32_t)(int32_t)(signed char)pData[i];
+                    return checksum;
+                }
+
+                // The ini file of the versions before the index journal, listing entryCount images with a file each.
+                void BuildIniFile(uint32_t entryCount, eastl::string& ini)
+                {
+                    const uint32_t now      = (uint32_t)time(NULL);
+                    const uint32_t checksum = IniChecksum((const char8_t*)kPng, sizeof(kPng), 0);
+
+                    ini = "Cache Entries: V 1.01.00\n";
+                    for(uint32_t i = 0; i < entryCount; ++i)
+                    {
+                        ini.append_sprintf("Cache Entry:http://www.bench.test/%u/i.png,b%u.cache,image/png,%u,%u,%u,%u,%u,%u,%u\n",
+                                           i, i, (unsigned)sizeof(kPng), 86400u, now - entryCount, now - (entryCount - i), now + 86400, checksum, 0u);
+                    }
+                    ini.append_sprintf("Cache Checksum:%u", IniChecksum(ini.data(), ini.size(), 0));
+                }
+
+                double TimeDiskCacheUsage(Host& host, const DiskCacheInfo& diskCacheInfo)
+                {
+                    const double startTime = Host::Now();
+                    host.GetLib()->SetDiskCacheUsage(diskCacheInfo);
+                    return Host::Now() - startTime;
+                }
+            }
+
+            void RunDiskCacheBenchmark(Host& host, Results& results, const Options& options)
+            {
+                LoopbackHttpServer server;
+                if(!server.Start())
+                {
+                    fprintf(stderr, "disk_cache: skipped, could not listen on 127.0.0.1\n");
+                    return;
+                }
+                server.AddResource("/i.png", "image/png", kPng, sizeof(kPng), kLoopbackResourceCacheable);
+                host.SetFrameCallback(LoopbackHttpServer::PumpCallback, &server);
+
+                EAWebKitLib* pLib = host.GetLib();
+                Parameters& parameters = pLib->GetParameters();
+                const bool bShareIdenticalFiles = parameters.mDiskCacheShareIdenticalFiles;
+                parameters.mDiskCacheShareIdenticalFiles = false;
+                pLib->SetParameters(parameters);
+
+                DiskCacheInfo diskCacheInfo;
+                diskCacheInfo.mDiskCacheSize            = 1024 * 1024 * 1024;
+                diskCacheInfo.mMaxNumberOfCachedFiles   = kFillLevels[sizeof(kFillLevels) / sizeof(kFillLevels[0]) - 1] * 2;
+                diskCacheInfo.mMinFileSizeToCache       = 0;
+                diskCacheInfo.mDiskCacheDirectory       = kDiskCacheDirectory;
+
+                // Starts the cache, then empties it in case an earlier run left entries behind.
+                DiskCacheInfo clearInfo(diskCacheInfo);
+                clearInfo.mDiskCacheSize = 0;
+                bool bFailed = !pLib->SetDiskCacheUsage(diskCacheInfo) || !pLib->SetDiskCacheUsage(clearInfo) || !pLib->SetDiskCacheUsage(diskCacheInfo);
+                if(bFailed)
+                    fprintf(stderr, "disk_cache: skipped, could not use a disk cache in %s\n", kDiskCacheDirectory);
+
+                static const char8_t kBlankPage[] = "<html><body></body></html>";
+                char8_t baseUrl[64];
+                char8_t name[64];
+                snprintf(baseUrl, sizeof(baseUrl), "http://127.0.0.1:%u/", (unsigned)server.GetPort());
+
+                eastl::string html;
+                uint32_t pageNumber = 0;
+
+                for(size_t level = 0; (level < sizeof(kFillLevels) / sizeof(kFillLevels[0])) && !bFailed; ++level)
+                {
+                    const uint32_t entryCount = kFillLevels[level];
+
+                    // Fill up to the level, timing the last pages.
+                    eastl::vector<double> storeTimes;
+                    while(!bFailed && (storeTimes.size() < options.mIterations))
+                    {
+                        const uint32_t fileCount = GetCachedFileCount(host);
+                        const bool bTimed = (fileCount + (options.mIterations * kImagesPerPage) >= entryCount);
+                        BuildPage(pageNumber++, server.GetPort(), html);
+                        if(!host.LoadHtml(html.data(), html.size(), baseUrl, 30.0))
+                        {
+                            fprintf(stderr, "disk_cache: a page of new images failed to load\n");
+                            bFailed = true;
+                        }
+                        else if(GetCachedFileCount(host) == fileCount)
+                        {
+                            fprintf(stderr, "disk_cache: the images of a page were not stored in the disk cache\n");
+                            bFailed = true;
+                        }
+                        else if(bTimed)
+                            storeTimes.push_back(host.GetTimeToLoadComplete() / kImagesPerPage);
+                    }
+                    if(bFailed)
+                        break;
+
+                    // Load the last page again from the disk cache.
+                    eastl::vector<double> hitTimes;
+                    const uint32_t requestCount = server.GetRequestCount();
+                    for(uint32_t i = 0; (i < options.mIterations) && !bFailed; ++i)
+                    {
+                        host.LoadHtml(kBlankPage, sizeof(kBlankPage) - 1, baseUrl);   // So that the images are no longer in use.
+                        pLib->ClearMemoryCache();
+                        if(host.LoadHtml(html.data(), html.size(), baseUrl, 30.0))
+                            hitTimes.push_back(host.GetTimeToLoadComplete() / kImagesPerPage);
+                        else
+                        {
+                            fprintf(stderr, "disk_cache: a page of cached images failed to load\n");
+                            bFailed = true;
+                        }
+                    }
+                    if(server.GetRequestCount() != requestCount)
+                        fprintf(stderr, "disk_cache: %u cached images were requested from the network\n", server.GetRequestCount() - requestCount);
+
+                    snprintf(name, sizeof(name), "store_%u", entryCount);
+                    results.Add("disk_cache", name, Median(storeTimes.data(), (uint32_t)storeTimes.size()) * 1e6, "us", false);
+                    if(!hitTimes.empty())
+                    {
+                        snprintf(name, sizeof(name), "hit_%u", entryCount);
+                        results.Add("disk_cache", name, Median(hitTimes.data(), (uint32_t)hitTimes.size()) * 1e6, "us", false);
+                    }
+                }
+
+                if(!bFailed)
+                {
+                    // SetMaxFileCount evicts the least recently used entries down to the new limit right away.
+                    const uint32_t fileCount = GetCachedFileCount(host);
+                    DiskCacheInfo evictInfo(diskCacheInfo);
+                    evictInfo.mDiskCacheSize          = 1;
+                    evictInfo.mMaxNumberOfCachedFiles = fileCount / 2;
+
+                    const double startTime = Host::Now();
+                    pLib->SetDiskCacheUsage(evictInfo);
+                    const double evictTime = Host::Now() - startTime;
+
+                    const uint32_t evictedCount = fileCount - GetCachedFileCount(host);
+                    if(evictedCount)
+                        results.Add("disk_cache", "evict", evictTime * 1e6 / evictedCount, "us", false);
+                }
+
+                pLib->SetDiskCacheUsage(clearInfo);    // Deletes the cached files.
+                host.SetFrameCallback(NULL, NULL);
+                server.Stop();
+                parameters.mDiskCacheShareIdenticalFiles = bShareIdenticalFiles;
+                pLib->SetParameters(parameters);
+            }
+
+            void RunDiskCacheIndexBenchmark(Host& host, Results& results, const Options& options)
+            {
+                EAWebKitLib* pLib = host.GetLib();
+                FileSystem* pFS = pLib->GetFileSystem();
+
+                DiskCacheInfo emptyInfo;
+                emptyInfo.mDiskCacheSize            = 1024 * 1024 * 1024;
+                emptyInfo.mMaxNumberOfCachedFiles   = kIndexEntryCounts[sizeof(kIndexEntryCounts) / sizeof(kIndexEntryCounts[0]) - 1] * 2;
+                emptyInfo.mMinFileSizeToCache       = 0;
+                emptyInfo.mDiskCacheDirectory       = kEmptyDirectory;
+
+                DiskCacheInfo indexInfo(emptyInfo);
+                indexInfo.mDiskCacheDirectory = kIndexDirectory;
+
+                DiskCacheInfo clearInfo(indexInfo);
+                clearInfo.mDiskCacheSize = 0;
+
+                eastl::string directory, emptyDirectory, iniPath, indexPath, path, ini;
+                GetCacheDirectoryPath(pFS, kIndexDirectory, directory);
+                GetCacheDirectoryPath(pFS, kEmptyDirectory, emptyDirectory);
+                iniPath   = directory + "FileCache.ini";
+                indexPath = directory + "FileCache.idx";
+
+                // Starts with nothing in the directory of the entries, in case an earlier run left entries behind.
+                if(!pLib->SetDiskCacheUsage(indexInfo) || !pLib->SetDiskCacheUsage(clearInfo))
+                {
+                    fprintf(stderr, "disk_cache_index: skipped, could not use a disk cache in %s\n", kIndexDirectory);
+                    return;
+                }
+
+                char8_t name[64];
+                const uint8_t kTornRecord = 1; // A record type without the rest of the record.
+
+                for(size_t c = 0; c < sizeof(kIndexEntryCounts) / sizeof(kIndexEntryCounts[0]); ++c)
+                {
+                    const uint32_t entryCount = kIndexEntryCounts[c];
+                    bool bFailed = !pLib->SetDiskCacheUsage(emptyInfo);
+
+                    for(uint32_t i = 0; (i < entryCount) && !bFailed; ++i)
+                    {
+                        path.sprintf("%sb%u.cache", directory.c_str(), i);
+                        bFailed = !WriteCacheFile(pFS, path.c_str(), kPng, sizeof(kPng), false);
+                    }
+                    BuildIniFile(entryCount, ini);
+
+                    eastl::vector<double> iniTimes, journalTimes, compactTimes;
+                    int64_t journalSize = 0;
+                    for(uint32_t i = 0; (i < options.mIterations) && !bFailed; ++i)
+                    {
+                        pFS->RemoveFile(indexPath.c_str());
+                        if(!WriteCacheFile(pFS, iniPath.c_str(), ini.data(), ini.size(), false))
+                        {
+                            bFailed = true;
+                            break;
+                        }
+                        iniTimes.push_back(TimeDiskCacheUsage(host, indexInfo));
+                        if(GetCachedFileCount(host) != entryCount)
+                        {
+                            fprintf(stderr, "disk_cache_index: %u of %u entries were read from the ini file\n", GetCachedFileCount(host), entryCount);
+                            bFailed = true;
+                            break;
+                        }
+
+                        pLib->SetDiskCacheUsage(emptyInfo);
+                        pFS->GetFileSize(indexPath.c_str(), journalSize);
+                        journalTimes.push_back(TimeDiskCacheUsage(host, indexInfo));
+
+                        pLib->SetDiskCacheUsage(emptyInfo);
+                        WriteCacheFile(pFS, indexPath.c_str(), &kTornRecord, sizeof(kTornRecord), true);
+                        compactTimes.push_back(TimeDiskCacheUsage(host, indexInfo));
+                        if(GetCachedFileCount(host) != entryCount)
+                        {
+                            fprintf(stderr, "disk_cache_index: %u of %u entries were read from the journal\n", GetCachedFileCount(host), entryCount);
+                            bFailed = true;
+                        }
+                        pLib->SetDiskCacheUsage(emptyInfo);
+                    }
+
+                    if(bFailed)
+                        fprintf(stderr, "disk_cache_index: could not measure %u entries in %s\n", entryCount, directory.c_str());
+                    else
+                    {
+                        snprintf(name, sizeof(name), "ini_startup_%u", entryCount);
+                        results.Add("disk_cache_index", name, Median(iniTimes.data(), (uint32_t)iniTimes.size()) * 1e3, "ms", false);
+                        snprintf(name, sizeof(name), "journal_startup_%u", entryCount);
+                        results.Add("disk_cache_index", name, Median(journalTimes.data(), (uint32_t)journalTimes.size()) * 1e3, "ms", false);
+                        snprintf(name, sizeof(name), "journal_compact_startup_%u", entryCount);
+                        results.Add("disk_cache_index", name, Median(compactTimes.data(), (uint32_t)compactTimes.size()) * 1e3, "ms", false);
+                        snprintf(name, sizeof(name), "ini_size_%u", entryCount);
+                        results.Add("disk_cache_index", name, (double)ini.size() / entryCount, "bytes/entry", false);
+                        snprintf(name, sizeof(name), "journal_size_%u", entryCount);
+                        results.Add("disk_cache_index", name, (double)journalSize / entryCount, "bytes/entry", false);
+                    }
+
+                    // Deletes the files of the entries.
+                    pLib->SetDiskCacheUsage(indexInfo);
+                    pLib->SetDiskCacheUsage(clearInfo);
+                    pFS->RemoveFile(iniPath.c_str());
+                }
+
+                pFS->RemoveFile((emptyDirectory + "FileCache.idx").c_str());
+                pFS->DeleteDirectory(emptyDirectory.c_str());
+            }
+        }
+    }
+}
@@ -0,0 +1,404 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// ImageBenchmark.cpp
+//
+// Maintained by EAWebKit Team
+//
+// Image compression suite (see Parameters::mEnableImageCompression). The page
+// images are PNGs generated here and loaded as data URIs, one page per kind
+// of image, so that each kind goes through the compression it gets in a
+// title:
+//   photo   Opaque noisy gradient. RLE gains nothing, so it is DXT compressed.
+//   banner  Opaque flat bands, RLE compressed with a constant alpha.
+//   ui      Shapes over a transparent background, RLE compressed with alpha.
+// The images of a page are drawn once as the page loads, which compresses
+// them, and then drawn again each frame, which decompresses them, with the
+// decompressed frame cache off. The rates are the pixel counts of the
+// kVProcessTypeImageCompressionPack and UnPack notifications over their time,
+// with mEnableParallelImageCompression off and then on.
+//
+// image_frame_cache repaints the photo and the ui pages, with compression on,
+// first with the decompressed frame cache off and then at its default size,
+// and reports the frame time and the counters of
+// EAWebKitLib::GetImageCompressionUsage per frame.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "Benchmark.h"
+#include "BenchmarkHost.h"
+#include "BenchmarkResults.h"
+#include <EASTL/string.h>
+#include <EASTL/vector.h>
+#include <stdio.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            namespace
+            {
+                const uint32_t kFramesPerIteration  = 10;
+                const uint32_t kCacheFramesPerIteration = 20;
+                const char8_t  kImagePageUrl[]      = "http://www.bench.test/images.html";
+
+                enum ImageKind
+                {
+                    kImageKindPhoto,
+                    kImageKindBanner,
+                    kImageKindUI,
+                    kImageKindCount
+                };
+
+                struct ImageKindInfo
+                {
+                    const char8_t*  mpName;
+                    uint32_t        mWidth;
+                    uint32_t        mHeight;
+                    uint32_t        mColumns;   // The page is a grid of columns x rows of the image, which fits the 1280x720 view.
+                    uint32_t        mRows;
+                    bool            mbAlpha;
+                };
+
+                const ImageKindInfo kImageKinds[kImageKindCount] =
+                {
+                    { "photo",  640, 360, 2, 2, false },
+                    { "banner", 640,  90, 2, 4, false },
+                    { "ui",     256,  64, 5, 4, true  }
+                };
+
+                uint32_t Random(uint32_t& seed)
+                {
+                    seed = (seed * 1664525) + 1013904223;
+                    return seed >> 16;
+                }
+
+                void AppendUint32(eastl::vector<uint8_t>& data, uint32_t value)
+                {
+                    data.push_back((uint8_t)(value >> 24));
+                    data.push_back((uint8_t)(value >> 16));
+                    data.push_back((uint8_t)(value >> 8));
+                    data.push_back((uint8_t)value);
+                }
+
+                void AppendChunk(eastl::vector<uint8_t>& png, const char8_t* pType, const eastl::vector<uint8_t>& chunk)
+                {
+                    AppendUint32(png, (uint32_t)chunk.size());
+                    const size_t typePosition = png.size();
+                    png.insert(png.end(), (const uint8_t*)pType, (const uint8_t*)pType + 4);
+                    png.insert(png.end(), chunk.begin(), chunk.end());
+                    AppendUint32(png, Crc32(&png[typePosition], png.size() - typePosition));
+                }
+
+                // Fills the rows (each with its filter byte) of one image of the kind.
+                void GeneratePixels(ImageKind kind, uint32_t seed, eastl::vector<uint8_t>& rows)
+                {
+                    const ImageKindInfo& info = kImageKinds[kind];
+                    const uint32_t pixelSize = info.mbAlpha ? 4 : 3;
+                    const uint8_t  tint      = (uint8_t)Random(seed);
+
+                    rows.clear();
+                    rows.reserve((info.mWidth * pixelSize + 1) * info.mHeight);
+                    for(uint32_t y = 0; y < info.mHeight; ++y)
+                    {
+                        rows.push_back(0); // No filter
+                        for(uint32_t x = 0; x < info.mWidth; ++x)
+                        {
+                            uint8_t r, g, b, a = 255;
+                            switch(kind)
+                            {
+                                case kImageKindPhoto:
+                                {
+                                    const uint32_t noise = Random(seed) & 31;
+                                    r = (uint8_t)(((x * 255) / info.mWidth + noise) & 0xff);
+                                    g = (uint8_t)(((y * 255) / info.mHeight + noise + tint) & 0xff);
+                                    b = (uint8_t)(((x + y) / 4 + noise * 2) & 0xff);
+                                    break;
+                                }
+
+                                case kImageKindBanner:
+                                {
+                                    const uint32_t band = (x / 40) + (y / 30);
+                                    r = (uint8_t)(tint + band * 24);
+                                    g = (uint8_t)(band * 48);
+                                    b = (uint8_t)(200 - band * 12);
+                                    break;
+                                }
+
+                                default:
+                                {
+                                    // A rounded button with a soft edge, and an icon in it.
+                                    const int dx = (int)x - (int)(info.mWidth / 2);
+                                    const int dy = (int)y - (int)(info.mHeight / 2);
+                                    const int edge = (int)(info.mHeight / 2) - ((dx * dx) / (int)(info.mWidth * 4) + (dy * dy) / (int)info.mHeight);
+                                    r = (uint8_t)(tint + y);
+                                    g = 96;
+                                    b = (uint8_t)(255 - y * 2);
+                                    a = (edge <= 0) ? 0 : (edge >= 8) ? 255 : (uint8_t)(edge * 32);
+                                    if(((x % 64) < 16) && ((y % 32) < 16))
+                                        r = g = b = 255;
+                                    break;
+                                }
+                            }
+
+                            rows.push_back(r);
+                            rows.push_back(g);
+                            rows.push_back(b);
+                            if(info.mbAlpha)
+                                rows.push_back(a);
+                        }
+                    }
+                }
+
+                // Builds a PNG of the rows with an uncompressed zlib stream, so that the decode stays cheap next to the compression.
+                void BuildPng(const ImageKindInfo& info, const eastl::vector<uint8_t>& rows, eastl::vector<uint8_t>& png)
+                {
+                    static const uint8_t kSignature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+                    png.assign(kSignature, kSignature + sizeof(kSignature));
+
+                    eastl::vector<uint8_t> chunk;
+                    AppendUint32(chunk, info.mWidth);
+                    AppendUint32(chunk, info.mHeight);
+                    chunk.push_back(8);                         // Bit depth
+                    chunk.push_back(info.mbAlpha ? 6 : 2);      // RGBA or RGB
+                    chunk.push_back(0);                         // Compression, filter and interlace methods
+                    chunk.push_back(0);
+                    chunk.push_back(0);
+                    AppendChunk(png, "IHDR", chunk);
+
+                    chunk.clear();
+                    chunk.push_back(0x78);
+                    chunk.push_back(0x01);
+                    uint32_t adlerA = 1, adlerB = 0;
+                    for(size_t position = 0; position < rows.size(); )
+                    {
+                        const uint32_t blockSize = (rows.size() - position > 65535) ? 65535 : (uint32_t)(rows.size() - position);
+                        chunk.push_back((position + blockSize == rows.size()) ? 1 : 0); // Stored block, final or not
+                        chunk.push_back((uint8_t)blockSize);
+                        chunk.push_back((uint8_t)(blockSize >> 8));
+                        chunk.push_back((uint8_t)~blockSize);
+                        chunk.push_back((uint8_t)(~blockSize >> 8));
+                        for(uint32_t i = 0; i < blockSize; ++i)
+                        {
+                            adlerA = (adlerA + rows[position + i]) % 65521;
+                            adlerB = (adlerB + adlerA) % 65521;
+                        }
+                        chunk.insert(chunk.end(), rows.begin() + position, rows.begin() + position + blockSize);
+                        position += blockSize;
+                    }
+                    AppendUint32(chunk, (adlerB << 16) | adlerA);
+                    AppendChunk(png, "IDAT", chunk);
+
+                    chunk.clear();
+                    AppendChunk(png, "IEND", chunk);
+                }
+
+                void AppendBase64(eastl::string& s, const eastl::vector<uint8_t>& data)
+                {
+                    static const char8_t kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+                    for(size_t i = 0; i < data.size(); i += 3)
+                    {
+                        const uint32_t remaining = (uint32_t)(data.size() - i);
+                        const uint32_t value = (data[i] << 16) | ((remaining > 1) ? (data[i + 1] << 8) : 0) | ((remaining > 2) ? data[i + 2] : 0);
+                        s += kAlphabet[(value >> 18) & 63];
+                        s += kAlphabet[(value >> 12) & 63];
+                        s += (remaining > 1) ? kAlphabet[(value >> 6) & 63] : '=';
+                        s += (remaining > 2) ? kAlphabet[value & 63] : '=';
+                    }
+                }
+
+                // Each image of the page gets its own seed, and so its own URI, so that none is shared through the memory cache.
+                void BuildImagePage(ImageKind kind, uint32_t seed, eastl::string& html)
+                {
+                    const ImageKindInfo& info = kImageKinds[kind];
+                    eastl::vector<uint8_t> rows, png;
+
+                    html = "<html><body style='margin:0'>";
+                    for(uint32_t row = 0; row < info.mRows; ++row)
+                    {
+                        for(uint32_t column = 0; column < info.mColumns; ++column)
+                        {
+                            GeneratePixels(kind, seed++, rows);
+                            BuildPng(info, rows, png);
+                            html.append_sprintf("<img style='position:absolute;left:%upx;top:%upx' width=%u height=%u src='data:image/png;base64,",
+                                                column * info.mWidth, row * info.mHeight, info.mWidth, info.mHeight);
+                            AppendBase64(html, png);
+                            html += "'>";
+                        }
+                    }
+                    html += "</body></html>";
+                }
+
+                // Toggles the background of the page each frame so that the whole view, images included, is painted again.
+                void RepaintFrame(Host& host, uint32_t frame)
+                {
+                    host.EvaluateNumber((frame & 1) ? "document.body.style.backgroundColor = '#f0f0f0'; 0" : "document.body.style.backgroundColor = '#ffffff'; 0");
+                }
+
+                // Returns MPixels/s, or 0 if nothing was notified.
+                double PixelRate(const ProcessStats& stats)
+                {
+                    return (stats.mTotalTime > 0.0) ? (double)stats.mTotalSize / stats.mTotalTime / 1e6 : 0.0;
+                }
+            }
+
+            void RunImageCompressionBenchmark(Host& host, Results& results, const Options& options)
+            {
+                Parameters& parameters = host.GetLib()->GetParameters();
+                const bool     bImageCompression          = parameters.mEnableImageCompression;
+                const bool     bParallelImageCompression  = parameters.mEnableParallelImageCompression;
+                const uint32_t decompressedImageCacheSize = parameters.mDecompressedImageCacheSize;
+
+                eastl::string html;
+                uint32_t seed = 1;
+
+                for(int pass = 0; pass < 2; ++pass)
+                {
+                    const bool bParallel = (pass == 1);
+                    parameters.mEnableImageCompression          = true;
+                    parameters.mEnableParallelImageCompression  = bParallel;
+                    parameters.mDecompressedImageCacheSize      = 0;
+                    host.GetLib()->SetParameters(parameters);
+
+                    for(int kind = 0; kind < kImageKindCount; ++kind)
+                    {
+                        eastl::vector<double> compressRates, decompressRates;
+                        for(uint32_t iteration = 0; iteration < options.mIterations; ++iteration)
+                        {
+                            BuildImagePage((ImageKind)kind, seed, html);
+                            seed += kImageKinds[kind].mColumns * kImageKinds[kind].mRows;
+
+                            host.ResetProcessStats();
+                            if(!host.LoadHtml(html.data(), html.size(), kImagePageUrl))
+                                continue;
+                            host.Frame();
+                            const double compressRate = PixelRate(host.GetProcessStats(kVProcessTypeImageCompressionPack));
+
+                            host.ResetProcessStats();
+                            for(uint32_t frame = 0; frame < kFramesPerIteration; ++frame)
+                            {
+                                RepaintFrame(host, frame);
+                                host.Frame();
+                            }
+                            const double decompressRate = PixelRate(host.GetProcessStats(kVProcessTypeImageCompressionUnPack));
+
+                            if((compressRate > 0.0) && (decompressRate > 0.0))
+                            {
+                                compressRates.push_back(compressRate);
+                                decompressRates.push_back(decompressRate);
+                            }
+                        }
+
+                        if(compressRates.empty())
+                        {
+                            fprintf(stderr, "image_compression: no %s image was compressed\n", kImageKinds[kind].mpName);
+                            continue;
+                        }
+
+                        char8_t name[64];
+                        snprintf(name, sizeof(name), "compress_%s%s", kImageKinds[kind].mpName, bParallel ? "" : "_serial");
+                        results.Add("image_compression", name, Median(compressRates.data(), (uint32_t)compressRates.size()), "MPixels/s", true);
+                        snprintf(name, sizeof(name), "decompress_%s%s", kImageKinds[kind].mpName, bParallel ? "" : "_serial");
+                        results.Add("image_compression", name, Median(decompressRates.data(), (uint32_t)decompressRates.size()), "MPixels/s", true);
+                    }
+                }
+
+                parameters.mEnableImageCompression          = bImageCompression;
+                parameters.mEnableParallelImageCompression  = bParallelImageCompression;
+                parameters.mDecompressedImageCacheSize      = decompressedImageCacheSize;
+                host.GetLib()->SetParameters(parameters);
+            }
+
+            void RunImageFrameCacheBenchmark(Host& host, Results& results, const Options& options)
+            {
+                static const ImageKind kKinds[] = { kImageKindPhoto, kImageKindUI };
+
+                Parameters& parameters = host.GetLib()->GetParameters();
+                const bool     bImageCompression          = parameters.mEnableImageCompression;
+                const uint32_t decompressedImageCacheSize = parameters.mDecompressedImageCacheSize;
+                const uint32_t frameCount                 = kCacheFramesPerIteration * options.mIterations;
+
+                eastl::string html;
+                for(size_t k = 0; k < sizeof(kKinds) / sizeof(kKinds[0]); ++k)
+                {
+                    const ImageKindInfo& info = kImageKinds[kKinds[k]];
+                    for(int pass = 0; pass < 2; ++pass)
+                    {
+                        const bool bCache = (pass == 1);
+                        parameters.mEnableImageCompression     = true;
+                        parameters.mDecompressedImageCacheSize = bCache ? decompressedImageCacheSize : 0;
+                        host.GetLib()->SetParameters(parameters);
+
+                        // A new page for each pass, so that the second one doesn't start with the images of the first decompressed.
+                        BuildImagePage(kKinds[k], (uint32_t)(k * 2 + pass) * 1000, html);
+                        if(!host.LoadHtml(html.data(), html.size(), kImagePageUrl))
+                            continue;
+                        host.Frame();
+
+                        ImageCompressionUsageInfo startUsage;
+                        host.GetLib()->GetImageCompressionUsage(startUsage);
+
+                        eastl::vector<double> frameTimes;
+                        for(uint32_t frame = 0; frame < frameCount; ++frame)
+                        {
+                            RepaintFrame(host, frame);
+                            frameTimes.push_back(host.Frame());
+                        }
+
+                        ImageCompressionUsageInfo endUsage;
+                        host.GetLib()->GetImageCompressionUsage(endUsage);
+
+                        const char8_t* pSuffix = bCache ? "" : "_no_cache";
+                        char8_t name[64];
+                        snprintf(name, sizeof(name), "%s_frame%s", info.mpName, pSuffix);
+                        results.Add("image_frame_cache", name, Median(frameTimes.data(), (uint32_t)frameTimes.size()) * 1e3, "ms", false);
+                        snprintf(name, sizeof(name), "%s_decompressions_per_frame%s", info.mpName, pSuffix);
+                        results.Add("image_frame_cache", name, (double)(endUsage.mDecompressions - startUsage.mDecompressions) / frameCount, "frames", false);
+                        snprintf(name, sizeof(name), "%s_pooled_buffer_reuses_per_frame%s", info.mpName, pSuffix);
+                        results.Add("image_frame_cache", name, (double)(endUsage.mPooledBufferReuses - startUsage.mPooledBufferReuses) / frameCount, "buffers", true);
+                        if(bCache)
+                        {
+                            snprintf(name, sizeof(name), "%s_cache_hits_per_frame", info.mpName);
+                            results.Add("image_frame_cache", name, (double)(endUsage.mDecompressedCacheHits - startUsage.mDecompressedCacheHits) / frameCount, "frames", true);
+                            snprintf(name, sizeof(name), "%s_cache_bytes", info.mpName);
+                            results.Add("image_frame_cache", name, endUsage.mDecompressedCacheBytes / 1024.0, "KB", false);
+                        }
+                    }
+                }
+
+                parameters.mEnableImageCompression     = bImageCompression;
+                parameters.mDecompressedImageCacheSize = decompressedImageCacheSize;
+                host.GetLib()->SetParameters(parameters);
+            }
+        }
+    }
+}
@@ -0,0 +1,209 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// InflateBenchmark.cpp
+//
+// Maintained by EAWebKit Team
+//
+// Throughput of large gzip encoded responses through the DirtySDK transport
+// handler, from a LoopbackHttpServer. Each page links kInflateResourceCount
+// style sheets of one of kInflateResourceSizes, sent gzip encoded and chunked.
+// The style sheets are a single comment, so that they cost little to parse.
+//
+// inflate loads the pages with the http transport in each mode below, and
+// reports per mode and size the median content received per second (from
+// EAWebKitLib::GetTransportJobQueueInfo, so after decoding) and the main
+// thread job loop time (kVProcessTypeTHJobs) per MB:
+//   chunks         Parameters::mHttpTransportThreadEnabled: the network thread
+//                  inflates into its pool of chunks, which the main thread
+//                  passes to WebCore as they are.
+//   shared_buffer  The main thread inflates into the shared decompression
+//                  buffer of the transport handler.
+// The transport reads mHttpTransportThreadEnabled when its scheme is
+// initialized, so the suite removes the http transport handler and adds it
+// again for each mode. Without a thread system that can create threads, both
+// modes run on the main thread.
+//
+// The server sends the gzip data in stored deflate blocks (see
+// LoopbackHttpServer.cpp), so the results measure the handling of the inflate
+// output more than the decoding itself.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "Benchmark.h"
+#include "BenchmarkHost.h"
+#include "BenchmarkResults.h"
+#include "LoopbackHttpServer.h"
+#include <EAWebKit/EAWebKitTransport.h>
+#include <EASTL/string.h>
+#include <EASTL/vector.h>
+#include <stdio.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            namespace
+            {
+                const uint32_t kInflateResourceSizes[]  = { 256 * 1024, 4 * 1024 * 1024 };
+                const uint32_t kInflateResourceCount    = 4;    // Style sheets per page, loaded at once.
+
+                struct InflateMode
+                {
+                    const char8_t*  mpName;
+                    bool            mbNetworkThread;
+                };
+
+                const InflateMode kInflateModes[] =
+                {
+                    { "chunks",         true  },
+                    { "shared_buffer",  false }
+                };
+
+                // Removes the http (and https, if it shares it) transport handler and adds it again, so that its schemes are
+                // initialized with mHttpTransportThreadEnabled set to bNetworkThread.
+                void RestartHttpTransport(EAWebKitLib* pLib, TransportHandler* pHttpHandler, bool bHttps, bool bNetworkThread)
+                {
+                    if(bHttps)
+                        pLib->RemoveTransportHandler(pHttpHandler, EA_CHAR16("https"));
+                    pLib->RemoveTransportHandler(pHttpHandler, EA_CHAR16("http"));
+
+                    Parameters& parameters = pLib->GetParameters();
+                    parameters.mHttpTransportThreadEnabled = bNetworkThread;
+                    pLib->SetParameters(parameters);
+
+                    pLib->AddTransportHandler(pHttpHandler, EA_CHAR16("http"));
+                    if(bHttps)
+                        pLib->AddTransportHandler(pHttpHandler, EA_CHAR16("https"));
+                }
+            }
+
+            void RunInflateBenchmark(Host& host, Results& results, const Options& options)
+            {
+                EAWebKitLib* pLib = host.GetLib();
+                TransportHandler* pHttpHandler = pLib->GetTransportHandler(EA_CHAR16("http"));
+                if(!pHttpHandler)
+                {
+                    fprintf(stderr, "inflate: skipped, no http transport handler\n");
+                    return;
+                }
+                const bool bHttps = (pLib->GetTransportHandler(EA_CHAR16("https")) == pHttpHandler);
+                const bool bNetworkThreadEnabled = pLib->GetParameters().mHttpTransportThreadEnabled;
+
+                LoopbackHttpServer server;
+                if(!server.Start())
+                {
+                    fprintf(stderr, "inflate: skipped, could not listen on 127.0.0.1\n");
+                    return;
+                }
+                host.SetFrameCallback(LoopbackHttpServer::PumpCallback, &server);
+
+                eastl::string text;
+                eastl::string html;
+                uint32_t loadNumber = 0;
+                char8_t path[64];
+                char8_t url[512];
+                char8_t name[96];
+
+                for(size_t s = 0; s < sizeof(kInflateResourceSizes) / sizeof(kInflateResourceSizes[0]); ++s)
+                {
+                    const uint32_t size = kInflateResourceSizes[s];
+
+                    text = "/*";
+                    text.append(size - 4, 'x');
+                    text += "*/";
+
+                    server.ClearResources();
+                    html = "<html><head><title>inflate</title>";
+                    for(uint32_t r = 0; r < kInflateResourceCount; ++r)
+                    {
+                        snprintf(path, sizeof(path), "/inflate%u.css", r);
+                        server.AddResource(path, "text/css", (const uint8_t*)text.data(), text.size(), kLoopbackResourceGzip | kLoopbackResourceChunked);
+                        html.append_sprintf("<link rel='stylesheet' href='%s'>", path + 1);
+                    }
+                    html += "</head><body></body></html>";
+                    server.AddResource("/inflate.html", "text/html", (const uint8_t*)html.data(), html.size(), 0);
+
+                    for(size_t m = 0; m < sizeof(kInflateModes) / sizeof(kInflateModes[0]); ++m)
+                    {
+                        const InflateMode& mode = kInflateModes[m];
+                        RestartHttpTransport(pLib, pHttpHandler, bHttps, mode.mbNetworkThread);
+
+                        const uint32_t gzipResponseCount = server.GetGzipResponseCount();
+                        host.ResetProcessStats();
+
+                        eastl::vector<double> throughputs;
+                        uint64_t totalBytes = 0;
+                        for(uint32_t i = 0; i < options.mIterations; ++i)
+                        {
+                            TransportJobQueueInfo startJobs;
+                            pLib->GetTransportJobQueueInfo(startJobs);
+
+                            snprintf(url, sizeof(url), "http://127.0.0.1:%u/%u/inflate.html", (unsigned)server.GetPort(), ++loadNumber);
+                            if(!host.LoadURI(url))
+                            {
+                                fprintf(stderr, "inflate: a page of %u byte style sheets failed to load with %s\n", size, mode.mpName);
+                                break;
+                            }
+
+                            TransportJobQueueInfo endJobs;
+                            pLib->GetTransportJobQueueInfo(endJobs);
+                            const uint64_t bytes = endJobs.mBytesReceived - startJobs.mBytesReceived;
+                            throughputs.push_back((double)bytes / host.GetTimeToLoadComplete() / 1e6);
+                            totalBytes += bytes;
+                        }
+                        if(throughputs.empty())
+                            continue;
+
+                        // Without Accept-Encoding: gzip from the transport, nothing was inflated.
+                        if((server.GetGzipResponseCount() - gzipResponseCount) < (uint32_t)throughputs.size() * kInflateResourceCount)
+                        {
+                            fprintf(stderr, "inflate: the style sheets were not sent gzip encoded with %s\n", mode.mpName);
+                            continue;
+                        }
+
+                        snprintf(name, sizeof(name), "%s_%uk", mode.mpName, size / 1024);
+                        results.Add("inflate", name, Median(throughputs.data(), (uint32_t)throughputs.size()), "MB/s", true);
+
+                        const ProcessStats& stats = host.GetProcessStats(kVProcessTypeTHJobs);
+                        snprintf(name, sizeof(name), "%s_%uk_jobs", mode.mpName, size / 1024);
+                        results.Add("inflate", name, stats.mTotalTime * 1e3 / ((double)totalBytes / 1e6), "ms/MB", false);
+                    }
+                }
+
+                RestartHttpTransport(pLib, pHttpHandler, bHttps, bNetworkThreadEnabled);
+                host.SetFrameCallback(NULL, NULL);
+                server.Stop();
+            }
+        }
+    }
+}
@@ -0,0 +1,502 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// LoopbackHttpServer.cpp
+//
+// Maintained by EAWebKit Team
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "LoopbackHttpServer.h"
+#include "Benchmark.h"
+#include "BenchmarkHost.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(EA_PLATFORM_MICROSOFT)
+    #pragma warning(push)
+    #pragma warning(disable: 4255)
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma warning(pop)
+#else
+    #include <sys/types.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            namespace
+            {
+                const intptr_t kInvalidSocket       = -1;
+                const size_t   kChunkSize           = 8192;     // Of the chunked transfer encoding
+                const size_t   kMaxStoredBlockSize  = 65535;    // Of a deflate stored block
+                const size_t   kReceiveSize         = 16384;
+                const double   kMaxBurstSeconds     = 0.05;     // Of bandwidth saved up by an idle connection
+
+            #if defined(EA_PLATFORM_MICROSOFT)
+                typedef SOCKET SocketHandle;
+
+                bool WouldBlock()                   { return WSAGetLastError() == WSAEWOULDBLOCK; }
+                void CloseSocket(intptr_t s)        { closesocket((SocketHandle)s); }
+                bool SetNonBlocking(intptr_t s)     { u_long nonBlocking = 1; return ioctlsocket((SocketHandle)s, FIONBIO, &nonBlocking) == 0; }
+            #else
+                typedef int SocketHandle;
+
+                bool WouldBlock()                   { return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR); }
+                void CloseSocket(intptr_t s)        { close((SocketHandle)s); }
+                bool SetNonBlocking(intptr_t s)     { const int flags = fcntl((SocketHandle)s, F_GETFL, 0); return (flags >= 0) && (fcntl((SocketHandle)s, F_SETFL, flags | O_NONBLOCK) == 0); }
+            #endif
+
+            #if defined(MSG_NOSIGNAL)
+                const int kSendFlags = MSG_NOSIGNAL;    // A client closing its end must not kill the benchmark with SIGPIPE.
+            #else
+                const int kSendFlags = 0;
+            #endif
+
+                void AppendUint32LE(eastl::vector<uint8_t>& data, uint32_t value)
+                {
+                    data.push_back((uint8_t)value);
+                    data.push_back((uint8_t)(value >> 8));
+                    data.push_back((uint8_t)(value >> 16));
+                    data.push_back((uint8_t)(value >> 24));
+                }
+
+                // A gzip member of the data in stored deflate blocks. The benchmark doesn't link zlib, so the body is not
+                // smaller, but the client still parses the gzip framing and runs the body through its inflate stream.
+                void BuildGzip(const uint8_t* pData, size_t size, eastl::vector<uint8_t>& gzip)
+                {
+                    static const uint8_t kHeader[] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff }; // Deflate, no flags, no time, unknown OS
+                    gzip.assign(kHeader, kHeader + sizeof(kHeader));
+
+                    size_t position = 0;
+                    do
+                    {
+                        const size_t blockSize = ((size - position) < kMaxStoredBlockSize) ? (size - position) : kMaxStoredBlockSize;
+                        const bool   bFinal    = (position + blockSize) == size;
+                        gzip.push_back(bFinal ? 1 : 0); // BFINAL, BTYPE 00 (stored)
+                        gzip.push_back((uint8_t)blockSize);
+                        gzip.push_back((uint8_t)(blockSize >> 8));
+                        gzip.push_back((uint8_t)~blockSize);
+                        gzip.push_back((uint8_t)(~blockSize >> 8));
+                        gzip.insert(gzip.end(), pData + position, pData + position + blockSize);
+                        position += blockSize;
+                    } while(position < size);
+
+                    AppendUint32LE(gzip, Crc32(pData, size));
+                    AppendUint32LE(gzip, (uint32_t)size);
+                }
+
+                // Value of the header in the request headers (lower cased), or an empty string.
+                eastl::string GetHeader(const eastl::string& headers, const char8_t* pName)
+                {
+                    eastl::string key("\r\n");
+                    key += pName;
+                    key += ':';
+
+                    const eastl::string::size_type start = headers.find(key);
+                    if(start == eastl::string::npos)
+                        return eastl::string();
+
+                    eastl::string::size_type valueStart = start + key.size();
+                    while((valueStart < headers.size()) && (headers[valueStart] == ' '))
+                        ++valueStart;
+                    const eastl::string::size_type valueEnd = headers.find("\r\n", valueStart);
+                    return headers.substr(valueStart, (valueEnd == eastl::string::npos) ? eastl::string::npos : valueEnd - valueStart);
+                }
+            }
+
+            LoopbackHttpServer::LoopbackHttpServer()
+                : mListenSocket(kInvalidSocket)
+                , mPort(0)
+                , mConnectionCount(0)
+                , mRequestCount(0)
+                , mGzipResponseCount(0)
+                , mbSocketsStarted(false)
+            {
+            }
+
+            LoopbackHttpServer::~LoopbackHttpServer()
+            {
+                Stop();
+            }
+
+            bool LoopbackHttpServer::Start()
+            {
+            #if defined(EA_PLATFORM_MICROSOFT)
+                WSADATA wsaData;
+                if(WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+                    return false;
+            #endif
+                mbSocketsStarted = true;
+
+                const SocketHandle listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+                mListenSocket = (intptr_t)listenSocket;
+            #if defined(EA_PLATFORM_MICROSOFT)
+                if(listenSocket == INVALID_SOCKET)
+                    mListenSocket = kInvalidSocket;
+            #endif
+                if(mListenSocket == kInvalidSocket)
+                {
+                    Stop();
+                    return false;
+                }
+
+                sockaddr_in address;
+                memset(&address, 0, sizeof(address));
+                address.sin_family      = AF_INET;
+                address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                address.sin_port        = 0; // Any free port
+
+                socklen_t addressLength = sizeof(address);
+                if((bind(listenSocket, (sockaddr*)&address, sizeof(address)) != 0) ||
+                   (listen(listenSocket, SOMAXCONN) != 0) ||
+                   (getsockname(listenSocket, (sockaddr*)&address, &addressLength) != 0) ||
+                   !SetNonBlocking(mListenSocket))
+                {
+                    Stop();
+                    return false;
+                }
+
+                mPort               = ntohs(address.sin_port);
+                mConnectionCount    = 0;
+                mRequestCount       = 0;
+                mGzipResponseCount  = 0;
+                return true;
+            }
+
+            void LoopbackHttpServer::Stop()
+            {
+                for(eastl::vector<Connection>::iterator it = mConnections.begin(); it != mConnections.end(); ++it)
+                    CloseConnection(*it);
+                mConnections.clear();
+
+                if(mListenSocket != kInvalidSocket)
+                {
+                    CloseSocket(mListenSocket);
+                    mListenSocket = kInvalidSocket;
+                }
+                mPort = 0;
+
+                if(mbSocketsStarted)
+                {
+                #if defined(EA_PLATFORM_MICROSOFT)
+                    WSACleanup();
+                #endif
+                    mbSocketsStarted = false;
+                }
+            }
+
+            void LoopbackHttpServer::AddResource(const char8_t* pPath, const char8_t* pContentType, const uint8_t* pData, size_t size, int flags)
+            {
+                mResources.push_back();
+                Resource& resource = mResources.back();
+                resource.mPath          = pPath;
+                resource.mContentType   = pContentType;
+                resource.mData.assign(pData, pData + size);
+                resource.mFlags         = flags;
+                if(flags & kLoopbackResourceGzip)
+                    BuildGzip(pData, size, resource.mGzipData);
+            }
+
+            void LoopbackHttpServer::ClearResources()
+            {
+                mResources.clear();
+            }
+
+            const LoopbackHttpServer::Resource* LoopbackHttpServer::LookUpResource(const eastl::string& path) const
+            {
+                eastl::string::size_type start = 0;
+                if((path.size() > 1) && isdigit((unsigned char)path[1]))
+                {
+                    const eastl::string::size_type slash = path.find('/', 1);
+                    if(slash != eastl::string::npos)
+                        start = slash;
+                }
+
+                for(eastl::vector<Resource>::const_iterator it = mResources.begin(); it != mResources.end(); ++it)
+                {
+                    if(path.compare(start, eastl::string::npos, it->mPath) == 0)
+                        return &*it;
+                }
+                return NULL;
+            }
+
+            void LoopbackHttpServer::Pump()
+            {
+                if(mListenSocket == kInvalidSocket)
+                    return;
+
+                const double now = Host::Now();
+
+                for(;;)
+                {
+                    const SocketHandle acceptedSocket = accept((SocketHandle)mListenSocket, NULL, NULL);
+                #if defined(EA_PLATFORM_MICROSOFT)
+                    if(acceptedSocket == INVALID_SOCKET)
+                        break;
+                #else
+                    if(acceptedSocket < 0)
+                        break;
+                #endif
+
+                    const int noDelay = 1;
+                    setsockopt(acceptedSocket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+                #if defined(SO_NOSIGPIPE)
+                    const int noSigPipe = 1;
+                    setsockopt(acceptedSocket, SOL_SOCKET, SO_NOSIGPIPE, (const char*)&noSigPipe, sizeof(noSigPipe));
+                #endif
+
+                    Connection connection;
+                    connection.mSocket          = (intptr_t)acceptedSocket;
+                    connection.mSentSize        = 0;
+                    connection.mSendAllowance   = 0.0;
+                    connection.mLastSendTime    = now;
+                    connection.mbClosed         = !SetNonBlocking(connection.mSocket);
+                    mConnections.push_back(connection);
+                    ++mConnectionCount;
+                }
+
+                for(eastl::vector<Connection>::iterator it = mConnections.begin(); it != mConnections.end(); )
+                {
+                    Connection& connection = *it;
+                    if(!connection.mbClosed && !ReadRequests(connection, now))
+                        CloseConnection(connection);
+                    if(!connection.mbClosed && !SendResponses(connection, now))
+                        CloseConnection(connection);
+
+                    if(connection.mbClosed)
+                        it = mConnections.erase(it);
+                    else
+                        ++it;
+                }
+            }
+
+            // Returns false when the connection has to be closed.
+            bool LoopbackHttpServer::ReadRequests(Connection& connection, double now)
+            {
+                char8_t buffer[kReceiveSize];
+                bool bClientDone = false;
+                for(;;)
+                {
+                    const int count = (int)recv((SocketHandle)connection.mSocket, buffer, (int)sizeof(buffer), 0);
+                    if(count > 0)
+                        connection.mInput.append(buffer, (size_t)count);
+                    else if(count == 0)
+                    {
+                        bClientDone = true; // It may still wait for the responses to what it sent.
+                        break;
+                    }
+                    else if(WouldBlock())
+                        break;
+                    else
+                        return false;
+                }
+
+                // The requests of the benchmark pages have no body, so a request ends with its headers.
+                for(;;)
+                {
+                    const eastl::string::size_type end = connection.mInput.find("\r\n\r\n");
+                    if(end == eastl::string::npos)
+                        break;
+
+                    AddResponse(connection, connection.mInput.substr(0, end + 2), now);
+                    connection.mInput.erase(0, end + 4);
+                }
+                return !bClientDone || !connection.mResponses.empty();
+            }
+
+            void LoopbackHttpServer::AddResponse(Connection& connection, const eastl::string& request, double now)
+            {
+                ++mRequestCount;
+
+                // Header names are case insensitive. Compare them, and the values looked at, in lower case.
+                eastl::string headers(request.substr(request.find("\r\n")));
+                for(eastl::string::size_type i = 0; i < headers.size(); ++i)
+                    headers[i] = (char8_t)tolower((unsigned char)headers[i]);
+
+                char8_t method[16] = "";
+                char8_t target[1024] = "";
+                char8_t version[16] = "";
+                sscanf(request.c_str(), "%15s %1023s %15s", method, target, version);
+
+                eastl::string path(target);
+                const eastl::string::size_type query = path.find('?');
+                if(query != eastl::string::npos)
+                    path.erase(query);
+
+                const eastl::string connectionHeader = GetHeader(headers, "connection");
+                bool bKeepAlive = mSettings.mbKeepAlive;
+                if(strcmp(version, "HTTP/1.1") == 0)
+                    bKeepAlive = bKeepAlive && (connectionHeader.find("close") == eastl::string::npos);
+                else
+                    bKeepAlive = bKeepAlive && (connectionHeader.find("keep-alive") != eastl::string::npos);
+
+                const Resource* pResource = LookUpResource(path);
+                const bool bHead = (strcmp(method, "HEAD") == 0);
+
+                connection.mResponses.push_back();
+                Response& response = connection.mResponses.back();
+                response.mReadyTime = now + mSettings.mLatencySeconds;
+                response.mbClose    = !bKeepAlive;
+
+                eastl::string header;
+                const uint8_t* pBody = NULL;
+                size_t bodySize = 0;
+                bool bChunked = false;
+
+                if(!pResource)
+                {
+                    static const char8_t kNotFound[] = "<html><body>Not found</body></html>";
+                    header.sprintf("HTTP/1.1 404 Not Found\r\nContent-Type: text/html\r\n");
+                    pBody    = (const uint8_t*)kNotFound;
+                    bodySize = sizeof(kNotFound) - 1;
+                }
+                else if((strcmp(method, "GET") != 0) && !bHead)
+                {
+                    header.sprintf("HTTP/1.1 405 Method Not Allowed\r\nAllow: GET, HEAD\r\n");
+                    response.mbClose = true; // The request body, if any, was not read.
+                }
+                else
+                {
+                    // no-store keeps the pages out of the caches, so that every load goes to the network.
+                    const char8_t* pCacheControl = (pResource->mFlags & kLoopbackResourceCacheable) ? "max-age=86400" : "no-store";
+                    header.sprintf("HTTP/1.1 200 OK\r\nContent-Type: %s\r\nCache-Control: %s\r\n", pResource->mContentType.c_str(), pCacheControl);
+
+                    pBody    = pResource->mData.data();
+                    bodySize = pResource->mData.size();
+                    if((pResource->mFlags & kLoopbackResourceGzip) && (GetHeader(headers, "accept-encoding").find("gzip") != eastl::string::npos))
+                    {
+                        header += "Content-Encoding: gzip\r\n";
+                        ++mGzipResponseCount;
+                        pBody    = pResource->mGzipData.data();
+                        bodySize = pResource->mGzipData.size();
+                    }
+                    bChunked = (pResource->mFlags & kLoopbackResourceChunked) && (strcmp(version, "HTTP/1.1") == 0);
+                }
+
+                if(bChunked)
+                    header += "Transfer-Encoding: chunked\r\n";
+                else
+                    header.append_sprintf("Content-Length: %u\r\n", (unsigned)bodySize);
+                header += response.mbClose ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+
+                response.mData.assign((const uint8_t*)header.data(), (const uint8_t*)header.data() + header.size());
+                if(bHead)
+                    return;
+
+                if(bChunked)
+                {
+                    char8_t chunkHeader[16];
+                    for(size_t position = 0; position < bodySize; position += kChunkSize)
+                    {
+                        const size_t chunkSize = ((bodySize - position) < kChunkSize) ? (bodySize - position) : kChunkSize;
+                        const int length = snprintf(chunkHeader, sizeof(chunkHeader), "%x\r\n", (unsigned)chunkSize);
+                        response.mData.insert(response.mData.end(), (const uint8_t*)chunkHeader, (const uint8_t*)chunkHeader + length);
+                        response.mData.insert(response.mData.end(), pBody + position, pBody + position + chunkSize);
+                        response.mData.push_back('\r');
+                        response.mData.push_back('\n');
+                    }
+                    static const char8_t kLastChunk[] = "0\r\n\r\n";
+                    response.mData.insert(response.mData.end(), (const uint8_t*)kLastChunk, (const uint8_t*)kLastChunk + sizeof(kLastChunk) - 1);
+                }
+                else if(bodySize)
+                    response.mData.insert(response.mData.end(), pBody, pBody + bodySize);
+            }
+
+            // Returns false when the connection has to be closed.
+            bool LoopbackHttpServer::SendResponses(Connection& connection, double now)
+            {
+                if(mSettings.mBytesPerSecond)
+                {
+                    const double maxAllowance = mSettings.mBytesPerSecond * kMaxBurstSeconds;
+                    connection.mSendAllowance += (now - connection.mLastSendTime) * mSettings.mBytesPerSecond;
+                    if(connection.mSendAllowance > maxAllowance)
+                        connection.mSendAllowance = maxAllowance;
+                }
+                connection.mLastSendTime = now;
+
+                while(!connection.mResponses.empty() && (connection.mResponses.front().mReadyTime <= now))
+                {
+                    Response& response = connection.mResponses.front();
+
+                    size_t size = response.mData.size() - connection.mSentSize;
+                    if(mSettings.mBytesPerSecond)
+                    {
+                        if(connection.mSendAllowance < 1.0)
+                            break;
+                        if(size > (size_t)connection.mSendAllowance)
+                            size = (size_t)connection.mSendAllowance;
+                    }
+
+                    const int count = (int)send((SocketHandle)connection.mSocket, (const char*)response.mData.data() + connection.mSentSize, (int)size, kSendFlags);
+                    if(count < 0)
+                        return WouldBlock();
+
+                    connection.mSentSize += (size_t)count;
+                    if(mSettings.mBytesPerSecond)
+                        connection.mSendAllowance -= count;
+
+                    if(connection.mSentSize < response.mData.size())
+                        continue;
+
+                    const bool bClose = response.mbClose;
+                    connection.mResponses.erase(connection.mResponses.begin());
+                    connection.mSentSize = 0;
+                    if(bClose)
+                        return false;
+                }
+
+                return true;
+            }
+
+            void LoopbackHttpServer::CloseConnection(Connection& connection)
+            {
+                if(!connection.mbClosed)
+                {
+                    CloseSocket(connection.mSocket);
+                    connection.mbClosed = true;
+                }
+            }
+        }
+    }
+}
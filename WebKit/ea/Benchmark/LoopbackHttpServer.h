@@ -0,0 +1,161 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// LoopbackHttpServer.h
+//
+// Maintained by EAWebKit Team
+//
+// A small HTTP/1.1 server on 127.0.0.1 for the network suites, so that page
+// loads don't depend on live sites. It runs on the main thread: Pump accepts
+// connections, reads requests and sends responses without blocking, and the
+// suites call it once per frame (see Host::SetFrameCallback), the way a title
+// would tick a local service between frames.
+//
+// Resources are served from memory, with an optional gzip content encoding
+// and chunked transfer encoding each, and are not cached unless asked to.
+// The latency and bandwidth of the responses and whether connections are kept
+// alive are settings, so that the same pages can be loaded as over a fast or a
+// slow network.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EAWEBKIT_LOOPBACKHTTPSERVER_H
+#define EAWEBKIT_LOOPBACKHTTPSERVER_H
+
+#include <EABase/eabase.h>
+#include <EASTL/string.h>
+#include <EASTL/vector.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            struct LoopbackHttpSettings
+            {
+                double      mLatencySeconds;    // Time between a complete request and the first byte of its response.
+                uint32_t    mBytesPerSecond;    // Send rate of each connection. 0 sends as fast as the socket takes the data.
+                bool        mbKeepAlive;        // If false, every response closes its connection.
+
+                LoopbackHttpSettings()
+                    : mLatencySeconds(0.0)
+                    , mBytesPerSecond(0)
+                    , mbKeepAlive(true)
+                {
+                }
+            };
+
+            enum LoopbackResourceFlags
+            {
+                kLoopbackResourceGzip       = 0x01, // Sent with Content-Encoding: gzip to requests that accept it.
+                kLoopbackResourceChunked    = 0x02, // Sent with Transfer-Encoding: chunked instead of a Content-Length.
+                kLoopbackResourceCacheable  = 0x04  // Sent with Cache-Control: max-age=86400 instead of no-store.
+            };
+
+            class LoopbackHttpServer
+            {
+            public:
+                LoopbackHttpServer();
+                ~LoopbackHttpServer();
+
+                // Listens on a free port of 127.0.0.1. Returns false if sockets are not available.
+                bool     Start();
+                void     Stop();
+                uint16_t GetPort() const { return mPort; }
+
+                // Applies to the requests received from now on.
+                void SetSettings(const LoopbackHttpSettings& settings) { mSettings = settings; }
+
+                // pPath is the absolute path of the resource, without query. Requests whose first path segment is a number
+                // are served as if it was not there, so that a page can be loaded again under new URLs that miss the caches:
+                // /12/index.html is /index.html.
+                void AddResource(const char8_t* pPath, const char8_t* pContentType, const uint8_t* pData, size_t size, int flags);
+                void ClearResources();
+
+                // Accepts connections, reads requests and sends as much of the responses as their latency and the bandwidth
+                // allow. Never blocks.
+                void Pump();
+                static void PumpCallback(void* pServer) { static_cast<LoopbackHttpServer*>(pServer)->Pump(); }
+
+                // Since Start.
+                uint32_t GetConnectionCount() const { return mConnectionCount; }
+                uint32_t GetRequestCount() const { return mRequestCount; }
+                uint32_t GetGzipResponseCount() const { return mGzipResponseCount; }
+
+            private:
+                struct Resource
+                {
+                    eastl::string           mPath;
+                    eastl::string           mContentType;
+                    eastl::vector<uint8_t>  mData;
+                    eastl::vector<uint8_t>  mGzipData;  // Empty unless kLoopbackResourceGzip.
+                    int                     mFlags;
+                };
+
+                struct Response
+                {
+                    eastl::vector<uint8_t>  mData;      // Status line, headers and body, as sent.
+                    double                  mReadyTime; // Not sent before this time.
+                    bool                    mbClose;    // Close the connection once it is sent.
+                };
+
+                struct Connection
+                {
+                    intptr_t                mSocket;
+                    eastl::string           mInput;         // Received and not yet parsed.
+                    eastl::vector<Response> mResponses;     // In request order.
+                    size_t                  mSentSize;      // Of the first response.
+                    double                  mSendAllowance; // Bytes that may be sent now, with a bandwidth limit.
+                    double                  mLastSendTime;
+                    bool                    mbClosed;
+                };
+
+                const Resource* LookUpResource(const eastl::string& path) const;
+                bool            ReadRequests(Connection& connection, double now);
+                void            AddResponse(Connection& connection, const eastl::string& request, double now);
+                bool            SendResponses(Connection& connection, double now);
+                void            CloseConnection(Connection& connection);
+
+                intptr_t                    mListenSocket;
+                uint16_t                    mPort;
+                LoopbackHttpSettings        mSettings;
+                eastl::vector<Resource>     mResources;
+                eastl::vector<Connection>   mConnections;
+                uint32_t                    mConnectionCount;
+                uint32_t                    mRequestCount;
+                uint32_t                    mGzipResponseCount;
+                bool                        mbSocketsStarted;
+            };
+        }
+    }
+}
+
+#endif // EAWEBKIT_LOOPBACKHTTPSERVER_H
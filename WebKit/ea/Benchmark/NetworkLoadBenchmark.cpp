@@ -0,0 +1,388 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// NetworkLoadBenchmark.cpp
+//
+// Maintained by EAWebKit Team
+//
+// Full page loads through the library's network stack (ResourceHandleManager
+// and the DirtySDK transport handler) from a LoopbackHttpServer, so that
+// network changes can be measured without live sites.
+//
+// The pages are the resource lists in <data>/Network: the path, type, size
+// and transfer options of each resource of a typical page. The bodies are
+// generated to those sizes: the document links every other resource in list
+// order and is padded with paragraphs, style sheets and scripts are padded
+// with rules and functions, and images are 1x1 PNGs padded with a private
+// chunk and laid out at their listed size. Each load is under a new URL and
+// the server sends Cache-Control: no-store, so nothing comes from the caches.
+//
+// network_load loads each page with each network profile below, and reports
+// per page and profile the median load time, the average time to first byte
+// and the received bytes per second (from EAWebKitLib::GetTransportJobQueueInfo),
+// the connections opened per load (from GetHttpConnectionUsageInfo), and the
+// time per load of each kVProcessType notified from the main thread.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "Benchmark.h"
+#include "BenchmarkHost.h"
+#include "BenchmarkResults.h"
+#include "LoopbackHttpServer.h"
+#include <EASTL/string.h>
+#include <EASTL/vector.h>
+#include <stdio.h>
+#include <string.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            namespace
+            {
+                const char8_t* const kNetworkPages[] = { "news", "store", "forum" };
+
+                struct NetworkProfile
+                {
+                    const char8_t*  mpName;
+                    double          mLatencySeconds;
+                    uint32_t        mBytesPerSecond;    // Per connection
+                    bool            mbKeepAlive;
+                };
+
+                const NetworkProfile kNetworkProfiles[] =
+                {
+                    { "local",          0.0,    0,          true  },
+                    { "broadband",      0.020,  2000000,    true  },
+                    { "mobile",         0.150,  200000,     true  },
+                    { "no_keep_alive",  0.020,  2000000,    false }
+                };
+
+                struct ManifestEntry
+                {
+                    eastl::string   mPath;
+                    eastl::string   mContentType;
+                    uint32_t        mSize;
+                    int             mFlags;     // LoopbackResourceFlags
+                    uint32_t        mWidth;     // Layout size of images. 0 if not given.
+                    uint32_t        mHeight;
+                };
+
+                bool ReadManifest(const char8_t* pPath, eastl::vector<ManifestEntry>& entries)
+                {
+                    FILE* pFile = fopen(pPath, "r");
+                    if(!pFile)
+                    {
+                        fprintf(stderr, "Could not open %s\n", pPath);
+                        return false;
+                    }
+
+                    entries.clear();
+                    char8_t line[512];
+                    while(fgets(line, sizeof(line), pFile))
+                    {
+                        char8_t path[256], contentType[64];
+                        unsigned size = 0;
+                        int consumed = 0;
+                        if((line[0] == '#') || (sscanf(line, "%255s %63s %u%n", path, contentType, &size, &consumed) < 3))
+                            continue;
+
+                        ManifestEntry entry;
+                        entry.mPath         = path;
+                        entry.mContentType  = contentType;
+                        entry.mSize         = size;
+                        entry.mFlags        = 0;
+                        entry.mWidth        = 0;
+                        entry.mHeight       = 0;
+
+                        char8_t option[32];
+                        int optionLength = 0;
+                        for(const char8_t* pOptions = line + consumed; sscanf(pOptions, "%31s%n", option, &optionLength) == 1; pOptions += optionLength)
+                        {
+                            unsigned width, height;
+                            if(strcmp(option, "gzip") == 0)
+                                entry.mFlags |= kLoopbackResourceGzip;
+                            else if(strcmp(option, "chunked") == 0)
+                                entry.mFlags |= kLoopbackResourceChunked;
+                            else if(sscanf(option, "%ux%u", &width, &height) == 2)
+                            {
+                                entry.mWidth  = width;
+                                entry.mHeight = height;
+                            }
+                        }
+                        entries.push_back(entry);
+                    }
+                    fclose(pFile);
+
+                    if(entries.empty())
+                        fprintf(stderr, "%s lists no resources\n", pPath);
+                    return !entries.empty();
+                }
+
+                // Appends paragraphs of words, then spaces, until the text is the size, if it is not already larger.
+                void PadWithWords(eastl::string& text, size_t size)
+                {
+                    static const char8_t* kWords[] = { "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit", "sed", "eiusmod", "tempor" };
+                    for(uint32_t w = 0; ; ++w)
+                    {
+                        const char8_t* pWord      = kWords[w % (sizeof(kWords) / sizeof(kWords[0]))];
+                        const char8_t* pSeparator = ((w % 97) == 96) ? "</p><p>" : " ";
+                        if(text.size() + strlen(pWord) + strlen(pSeparator) > size)
+                            break;
+                        text += pWord;
+                        text += pSeparator;
+                    }
+                    if(text.size() < size)
+                        text.append(size - text.size(), ' ');
+                }
+
+                // A comment taking up the rest of the size, for style sheets and scripts.
+                void PadWithComment(eastl::string& text, size_t size)
+                {
+                    if(text.size() + 4 <= size)
+                    {
+                        text += "/*";
+                        text.append(size - text.size() - 2, ' ');
+                        text += "*/";
+                    }
+                    else if(text.size() < size)
+                        text.append(size - text.size(), '\n');
+                }
+
+                void BuildDocument(const eastl::vector<ManifestEntry>& entries, eastl::string& html)
+                {
+                    // Relative URLs, so that the subresources are requested under the URL of the load.
+                    html = "<html><head><title>network_load</title>";
+                    for(size_t i = 1; i < entries.size(); ++i)
+                    {
+                        if(entries[i].mContentType == "text/css")
+                            html.append_sprintf("<link rel='stylesheet' href='%s'>", entries[i].mPath.c_str() + 1);
+                    }
+                    html += "</head><body>";
+                    for(size_t i = 1; i < entries.size(); ++i)
+                    {
+                        if(entries[i].mContentType.compare(0, 6, "image/") != 0)
+                            continue;
+                        if(entries[i].mWidth)
+                            html.append_sprintf("<img src='%s' width='%u' height='%u'>", entries[i].mPath.c_str() + 1, entries[i].mWidth, entries[i].mHeight);
+                        else
+                            html.append_sprintf("<img src='%s'>", entries[i].mPath.c_str() + 1);
+                    }
+
+                    eastl::string scripts;
+                    for(size_t i = 1; i < entries.size(); ++i)
+                    {
+                        if(entries[i].mContentType == "application/javascript")
+                            scripts.append_sprintf("<script src='%s'></script>", entries[i].mPath.c_str() + 1);
+                    }
+                    scripts += "</p></body></html>";
+
+                    html += "<p>";
+                    const size_t size = entries[0].mSize;
+                    PadWithWords(html, (size > html.size() + scripts.size()) ? size - scripts.size() : html.size());
+                    html += scripts;
+                }
+
+                void BuildResource(const ManifestEntry& entry, eastl::vector<uint8_t>& data)
+                {
+                    eastl::string text;
+
+                    if(entry.mContentType == "text/css")
+                    {
+                        for(uint32_t r = 0; ; ++r)
+                        {
+                            char8_t rule[128];
+                            const int length = snprintf(rule, sizeof(rule), ".r%u{margin:%upx;padding:%upx %upx;color:#%06x}\n", r, r % 7, r % 5, r % 11, (r * 0x3b1d) & 0xffffff);
+                            if(text.size() + length > entry.mSize)
+                                break;
+                            text += rule;
+                        }
+                        PadWithComment(text, entry.mSize);
+                    }
+                    else if(entry.mContentType == "application/javascript")
+                    {
+                        for(uint32_t f = 0; ; ++f)
+                        {
+                            char8_t function[128];
+                            const int length = snprintf(function, sizeof(function), "function f%u(a,b){var c=a*%u+b;return c>%u?c-a:c+b;}\n", f, f % 13 + 1, f * 3);
+                            if(text.size() + length > entry.mSize)
+                                break;
+                            text += function;
+                        }
+                        PadWithComment(text, entry.mSize);
+                    }
+                    else if(entry.mContentType == "image/png")
+                    {
+                        // A 1x1 RGB PNG without its IEND chunk.
+                        static const uint8_t kPng[] =
+                        {
+                            0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+                            0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x08, 0x02, 0x00, 0x00, 0x00, 0x90, 0x77, 0x53,
+                            0xde, 0x00, 0x00, 0x00, 0x0c, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9c, 0x63, 0x68, 0x98, 0xb0, 0x00,
+                            0x00, 0x03, 0x44, 0x01, 0xb1, 0x7a, 0xd7, 0x36, 0x14
+                        };
+                        static const uint8_t kEnd[] = { 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82 };
+                        const size_t chunkOverhead = 12;
+                        const size_t minSize = sizeof(kPng) + chunkOverhead + sizeof(kEnd);
+                        const uint32_t padSize = (entry.mSize > minSize) ? (uint32_t)(entry.mSize - minSize) : 0;
+
+                        data.assign(kPng, kPng + sizeof(kPng));
+
+                        // pdDg: ancillary, private and safe to copy, so that decoders skip it.
+                        const uint8_t lengthAndType[] = { (uint8_t)(padSize >> 24), (uint8_t)(padSize >> 16), (uint8_t)(padSize >> 8), (uint8_t)padSize, 'p', 'd', 'D', 'g' };
+                        data.insert(data.end(), lengthAndType, lengthAndType + sizeof(lengthAndType));
+                        const size_t typePosition = data.size() - 4;
+                        data.resize(data.size() + padSize, 0);
+                        const uint32_t crc = Crc32(&data[typePosition], 4 + padSize);
+                        const uint8_t crcBytes[] = { (uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc };
+                        data.insert(data.end(), crcBytes, crcBytes + sizeof(crcBytes));
+
+                        data.insert(data.end(), kEnd, kEnd + sizeof(kEnd));
+                        return;
+                    }
+                    else
+                        text.assign(entry.mSize, 'x');
+
+                    data.assign((const uint8_t*)text.data(), (const uint8_t*)text.data() + text.size());
+                }
+
+                void AddPage(LoopbackHttpServer& server, const eastl::vector<ManifestEntry>& entries)
+                {
+                    server.ClearResources();
+
+                    eastl::string html;
+                    BuildDocument(entries, html);
+                    server.AddResource(entries[0].mPath.c_str(), entries[0].mContentType.c_str(), (const uint8_t*)html.data(), html.size(), entries[0].mFlags);
+
+                    eastl::vector<uint8_t> data;
+                    for(size_t i = 1; i < entries.size(); ++i)
+                    {
+                        BuildResource(entries[i], data);
+                        server.AddResource(entries[i].mPath.c_str(), entries[i].mContentType.c_str(), data.data(), data.size(), entries[i].mFlags);
+                    }
+                }
+            }
+
+            void RunNetworkLoadBenchmark(Host& host, Results& results, const Options& options)
+            {
+                LoopbackHttpServer server;
+                if(!server.Start())
+                {
+                    fprintf(stderr, "network_load: skipped, could not listen on 127.0.0.1\n");
+                    return;
+                }
+                host.SetFrameCallback(LoopbackHttpServer::PumpCallback, &server);
+
+                EAWebKitLib* pLib = host.GetLib();
+                uint32_t loadNumber = 0;
+                char8_t path[512];
+                char8_t url[512];
+                char8_t name[96];
+
+                for(size_t p = 0; p < sizeof(kNetworkPages) / sizeof(kNetworkPages[0]); ++p)
+                {
+                    const char8_t* pPage = kNetworkPages[p];
+                    eastl::vector<ManifestEntry> entries;
+                    snprintf(path, sizeof(path), "%s/Network/%s.txt", options.mpDataDirectory, pPage);
+                    if(!ReadManifest(path, entries))
+                        continue;
+                    AddPage(server, entries);
+
+                    for(size_t n = 0; n < sizeof(kNetworkProfiles) / sizeof(kNetworkProfiles[0]); ++n)
+                    {
+                        const NetworkProfile& profile = kNetworkProfiles[n];
+                        LoopbackHttpSettings settings;
+                        settings.mLatencySeconds = profile.mLatencySeconds;
+                        settings.mBytesPerSecond = profile.mBytesPerSecond;
+                        settings.mbKeepAlive     = profile.mbKeepAlive;
+                        server.SetSettings(settings);
+
+                        TransportJobQueueInfo startJobs;
+                        HttpConnectionUsageInfo startConnections;
+                        pLib->GetTransportJobQueueInfo(startJobs);
+                        pLib->GetHttpConnectionUsageInfo(startConnections);
+                        host.ResetProcessStats();
+
+                        eastl::vector<double> loadTimes;
+                        double totalLoadTime = 0.0;
+                        for(uint32_t i = 0; i < options.mIterations; ++i)
+                        {
+                            snprintf(url, sizeof(url), "http://127.0.0.1:%u/%u%s", (unsigned)server.GetPort(), ++loadNumber, entries[0].mPath.c_str());
+                            if(!host.LoadURI(url))
+                            {
+                                fprintf(stderr, "network_load: %s failed to load with the %s profile\n", pPage, profile.mpName);
+                                break;
+                            }
+                            loadTimes.push_back(host.GetTimeToLoadComplete());
+                            totalLoadTime += host.GetTimeToLoadComplete();
+                        }
+                        if(loadTimes.empty())
+                            continue;
+
+                        TransportJobQueueInfo endJobs;
+                        HttpConnectionUsageInfo endConnections;
+                        pLib->GetTransportJobQueueInfo(endJobs);
+                        pLib->GetHttpConnectionUsageInfo(endConnections);
+
+                        const uint32_t loadCount      = (uint32_t)loadTimes.size();
+                        const uint32_t respondedJobs  = endJobs.mRespondedJobs - startJobs.mRespondedJobs;
+
+                        snprintf(name, sizeof(name), "%s_%s_load", pPage, profile.mpName);
+                        results.Add("network_load", name, Median(loadTimes.data(), loadCount) * 1e3, "ms", false);
+                        if(respondedJobs)
+                        {
+                            snprintf(name, sizeof(name), "%s_%s_first_byte", pPage, profile.mpName);
+                            results.Add("network_load", name, (endJobs.mTotalFirstByteSeconds - startJobs.mTotalFirstByteSeconds) * 1e3 / respondedJobs, "ms", false);
+                        }
+                        snprintf(name, sizeof(name), "%s_%s_throughput", pPage, profile.mpName);
+                        results.Add("network_load", name, (double)(endJobs.mBytesReceived - startJobs.mBytesReceived) / totalLoadTime / 1e3, "KB/s", true);
+                        snprintf(name, sizeof(name), "%s_%s_connections_opened", pPage, profile.mpName);
+                        results.Add("network_load", name, (double)(endConnections.mConnectionsOpened - startConnections.mConnectionsOpened) / loadCount, "connections", false);
+
+                        // Processes only notified at their end (worker thread work) have no time and are left out.
+                        for(int type = 0; type < kVProcessTypeLast; ++type)
+                        {
+                            const ProcessStats& stats = host.GetProcessStats((VProcessType)type);
+                            if(stats.mTotalTime <= 0.0)
+                                continue;
+                            snprintf(name, sizeof(name), "%s_%s_%s", pPage, profile.mpName, GetProcessTypeName((VProcessType)type));
+                            results.Add("network_load", name, stats.mTotalTime * 1e3 / loadCount, "ms", false);
+                        }
+                    }
+                }
+
+                host.SetFrameCallback(NULL, NULL);
+                server.Stop();
+            }
+        }
+    }
+}
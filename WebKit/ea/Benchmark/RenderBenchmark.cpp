@@ -0,0 +1,190 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// RenderBenchmark.cpp
+//
+// Maintained by EAWebKit Team
+//
+// Layout and paint of the pages in <data>/Render, driven through the View
+// input functions the way a title forwards its controller and mouse:
+//   article       A long article with floats, scrolled with the mouse wheel.
+//   leaderboard   A large table, scrolled with the arrow keys.
+//   store_menu    A grid of tiles with :hover styles, swept by the mouse.
+//   hud           CSS animations only. Nothing is sent, the page animates.
+// The scrolled pages go down for half of the frames and back up for the rest.
+//
+// render reports per page the frame time median, p99 and max, where a frame
+// is the input of the frame and Host::Frame, and for each kVProcessType
+// notified with a time, its average and worst time per frame.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "Benchmark.h"
+#include "BenchmarkHost.h"
+#include "BenchmarkResults.h"
+#include <EAWebKit/EAWebKitInput.h>
+#include <EASTL/vector.h>
+#include <stdio.h>
+#include <string.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            namespace
+            {
+                const uint32_t kRenderFramesPerIteration = 60;
+
+                enum RenderInput
+                {
+                    kRenderInputWheel,
+                    kRenderInputKeys,
+                    kRenderInputHover,
+                    kRenderInputNone
+                };
+
+                struct RenderPage
+                {
+                    const char8_t*  mpName;     // Also the file name, with .html.
+                    RenderInput     mInput;
+                };
+
+                const RenderPage kRenderPages[] =
+                {
+                    { "article",        kRenderInputWheel },
+                    { "leaderboard",    kRenderInputKeys  },
+                    { "store_menu",     kRenderInputHover },
+                    { "hud",            kRenderInputNone  }
+                };
+
+                void SendInput(View* pView, RenderInput input, uint32_t frame, uint32_t frameCount)
+                {
+                    const IntSize size  = pView->GetSize();
+                    const bool    bDown = frame < (frameCount / 2);
+
+                    switch(input)
+                    {
+                        case kRenderInputWheel:
+                        {
+                            // A notch of a traditional wheel with 3 lines per notch.
+                            const MouseWheelEvent wheelEvent(bDown ? -120 : 120, bDown ? -3.0f : 3.0f, size.mWidth / 2, size.mHeight / 2);
+                            pView->OnMouseWheelEvent(wheelEvent);
+                            break;
+                        }
+
+                        case kRenderInputKeys:
+                        {
+                            const uint32_t key = bDown ? kArrowDown : kArrowUp;
+                            pView->OnKeyboardEvent(KeyboardEvent(key, false, true));
+                            pView->OnKeyboardEvent(KeyboardEvent(key, false, false));
+                            break;
+                        }
+
+                        case kRenderInputHover:
+                        {
+                            // Sweeps the view in rows, about half a tile per frame.
+                            const int32_t x = (int32_t)((frame * 97) % (uint32_t)size.mWidth);
+                            const int32_t y = (int32_t)(((frame * 97) / (uint32_t)size.mWidth) * 61 % (uint32_t)size.mHeight);
+                            pView->OnMouseMoveEvent(MouseMoveEvent(kMouseNoButton, x, y));
+                            break;
+                        }
+
+                        default:
+                            break;
+                    }
+                }
+            }
+
+            void RunRenderBenchmark(Host& host, Results& results, const Options& options)
+            {
+                const uint32_t frameCount = kRenderFramesPerIteration * options.mIterations;
+                char8_t path[512];
+                char8_t url[128];
+                char8_t name[96];
+
+                for(size_t p = 0; p < sizeof(kRenderPages) / sizeof(kRenderPages[0]); ++p)
+                {
+                    const RenderPage& page = kRenderPages[p];
+                    snprintf(path, sizeof(path), "%s/Render/%s.html", options.mpDataDirectory, page.mpName);
+                    snprintf(url, sizeof(url), "http://www.bench.test/render/%s.html", page.mpName);
+                    if(!host.LoadFile(path, url))
+                        continue;
+
+                    // As in a title, so that the key events reach the page.
+                    host.GetView()->OnFocusChangeEvent(true);
+
+                    eastl::vector<double> frameTimes;
+                    double totalTimes[kVProcessTypeLast];
+                    double maxTimes[kVProcessTypeLast];
+                    memset(totalTimes, 0, sizeof(totalTimes));
+                    memset(maxTimes, 0, sizeof(maxTimes));
+
+                    for(uint32_t frame = 0; frame < frameCount; ++frame)
+                    {
+                        host.ResetProcessStats();
+                        const double startTime = Host::Now();
+                        SendInput(host.GetView(), page.mInput, frame, frameCount);
+                        host.Frame();
+                        frameTimes.push_back(Host::Now() - startTime);
+
+                        for(int type = 0; type < kVProcessTypeLast; ++type)
+                        {
+                            const double time = host.GetProcessStats((VProcessType)type).mTotalTime;
+                            totalTimes[type] += time;
+                            if(time > maxTimes[type])
+                                maxTimes[type] = time;
+                        }
+                    }
+
+                    const double medianTime = Median(frameTimes.data(), (uint32_t)frameTimes.size()); // Sorts frameTimes.
+                    snprintf(name, sizeof(name), "%s_frame", page.mpName);
+                    results.Add("render", name, medianTime * 1e3, "ms", false);
+                    snprintf(name, sizeof(name), "%s_frame_p99", page.mpName);
+                    results.Add("render", name, frameTimes[(frameTimes.size() * 99) / 100] * 1e3, "ms", false);
+                    snprintf(name, sizeof(name), "%s_frame_max", page.mpName);
+                    results.Add("render", name, frameTimes.back() * 1e3, "ms", false);
+
+                    for(int type = 0; type < kVProcessTypeLast; ++type)
+                    {
+                        if(totalTimes[type] <= 0.0)
+                            continue;
+                        const char8_t* pTypeName = GetProcessTypeName((VProcessType)type);
+                        snprintf(name, sizeof(name), "%s_%s", page.mpName, pTypeName);
+                        results.Add("render", name, totalTimes[type] * 1e3 / frameCount, "ms", false);
+                        snprintf(name, sizeof(name), "%s_%s_max", page.mpName, pTypeName);
+                        results.Add("render", name, maxTimes[type] * 1e3, "ms", false);
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,233 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// TextBenchmark.cpp
+//
+// Maintained by EAWebKit Team
+//
+// Text paint suites. They need fonts (see --fonts) and are skipped without.
+//
+// glyph_raster repaints a page of paragraphs at several sizes with a new text
+// color every frame, with the glyph run cache off, so that every run goes
+// through Font::drawGlyphs and its glyph compositing each frame. The glyph
+// rate is the glyph count of the kVProcessTypeDrawGlyph notifications over
+// their time.
+//
+// glyph_run_cache repaints the same page with a new background color every
+// frame, so the text itself never changes, first with the glyph run cache off
+// and then with it at its default size.
+//
+// cjk_glyph_cache cycles a block of text through the CJK unified ideographs,
+// a few hundred new characters per frame, so that the glyph cache overflows
+// and has to make room while it is still in use. It reports the cache
+// counters of EAWebKitLib::GetGlyphCacheUsage per frame and the frame time
+// hitches. The fonts must include one with CJK coverage.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "Benchmark.h"
+#include "BenchmarkHost.h"
+#include "BenchmarkResults.h"
+#include <EASTL/string.h>
+#include <EASTL/vector.h>
+#include <stdio.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            namespace
+            {
+                const uint32_t kParagraphCount      = 40;
+                const uint32_t kWordsPerParagraph   = 48;
+                const uint32_t kFramesPerIteration  = 20;
+
+                const uint32_t kCJKFramesPerIteration   = 60;
+                const uint32_t kCJKRunLength            = 1200;     // Characters on screen
+                const uint32_t kCJKNewPerFrame          = 300;      // Characters replaced each frame
+                const uint32_t kCJKCharacterCount       = 20000;    // From U+4E00
+
+                const char8_t  kTextPageUrl[]       = "http://www.bench.test/text.html";
+
+                void BuildTextPage(eastl::string& html)
+                {
+                    static const char8_t* kWords[] =
+                    {
+                        "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit", "sed", "do",
+                        "eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore", "magna", "aliqua", "Quantum",
+                        "Xylophone", "jukebox", "WAVE", "fjord", "0123", "4567", "89", "(brackets)", "[square]", "{curly}"
+                    };
+                    static const uint32_t kFontSizes[] = { 11, 13, 16, 20, 24 };
+                    const uint32_t wordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+                    html = "<html><body style='margin:4px'>";
+                    for(uint32_t p = 0; p < kParagraphCount; ++p)
+                    {
+                        html.append_sprintf("<p style='font-size:%upx;margin:2px'>", kFontSizes[p % (sizeof(kFontSizes) / sizeof(kFontSizes[0]))]);
+                        for(uint32_t w = 0; w < kWordsPerParagraph; ++w)
+                        {
+                            html += kWords[((p * 7) + (w * 13)) % wordCount];
+                            html += ' ';
+                        }
+                        html += "</p>";
+                    }
+                    html += "</body></html>";
+                }
+
+                // Runs the script, which changes the page, then paints, for each frame. pScriptFormat gets the frame number.
+                // Returns the median frame time and leaves the process stats of all the frames in the host.
+                double RepaintFrames(Host& host, const char8_t* pScriptFormat, uint32_t frameCount)
+                {
+                    eastl::vector<double> frameTimes;
+                    char8_t script[256];
+
+                    host.ResetProcessStats();
+                    for(uint32_t frame = 0; frame < frameCount; ++frame)
+                    {
+                        snprintf(script, sizeof(script), pScriptFormat, frame);
+                        host.EvaluateNumber(script);
+                        frameTimes.push_back(host.Frame());
+                    }
+                    return Median(frameTimes.data(), (uint32_t)frameTimes.size());
+                }
+
+                void SetGlyphRunCacheSize(Host& host, uint32_t glyphRunCacheSize)
+                {
+                    Parameters& parameters = host.GetLib()->GetParameters();
+                    parameters.mGlyphRunCacheSize = glyphRunCacheSize;
+                    host.GetLib()->SetParameters(parameters);
+                }
+            }
+
+            void RunGlyphRasterBenchmark(Host& host, Results& results, const Options& options)
+            {
+                if(!host.HasFonts())
+                {
+                    fprintf(stderr, "glyph_raster: skipped, no fonts (see --fonts)\n");
+                    return;
+                }
+
+                const uint32_t glyphRunCacheSize = host.GetLib()->GetParameters().mGlyphRunCacheSize;
+                SetGlyphRunCacheSize(host, 0);
+
+                eastl::string html;
+                BuildTextPage(html);
+                if(host.LoadHtml(html.data(), html.size(), kTextPageUrl))
+                {
+                    const double frameTime = RepaintFrames(host, "document.body.style.color = (%u & 1) ? '#102030' : '#302010'; 0", kFramesPerIteration * options.mIterations);
+
+                    const ProcessStats& glyphStats = host.GetProcessStats(kVProcessTypeDrawGlyph);
+                    if(glyphStats.mTotalTime > 0.0)
+                        results.Add("glyph_raster", "glyphs", (double)glyphStats.mTotalSize / glyphStats.mTotalTime / 1e3, "kglyphs/s", true);
+                    results.Add("glyph_raster", "frame", frameTime * 1e3, "ms", false);
+                }
+
+                SetGlyphRunCacheSize(host, glyphRunCacheSize);
+            }
+
+            void RunGlyphRunCacheBenchmark(Host& host, Results& results, const Options& options)
+            {
+                if(!host.HasFonts())
+                {
+                    fprintf(stderr, "glyph_run_cache: skipped, no fonts (see --fonts)\n");
+                    return;
+                }
+
+                const uint32_t glyphRunCacheSize = host.GetLib()->GetParameters().mGlyphRunCacheSize;
+                const uint32_t frameCount = kFramesPerIteration * options.mIterations;
+
+                eastl::string html;
+                BuildTextPage(html);
+                for(int pass = 0; pass < 2; ++pass)
+                {
+                    const bool bCache = (pass == 1);
+                    SetGlyphRunCacheSize(host, bCache ? glyphRunCacheSize : 0);
+                    if(!host.LoadHtml(html.data(), html.size(), kTextPageUrl))
+                        break;
+
+                    const double frameTime = RepaintFrames(host, "document.body.style.backgroundColor = (%u & 1) ? '#f0f0f0' : '#ffffff'; 0", frameCount);
+                    const ProcessStats& glyphStats = host.GetProcessStats(kVProcessTypeDrawGlyph);
+
+                    results.Add("glyph_run_cache", bCache ? "frame" : "frame_no_cache", frameTime * 1e3, "ms", false);
+                    results.Add("glyph_run_cache", bCache ? "draw_glyphs_per_frame" : "draw_glyphs_per_frame_no_cache", glyphStats.mTotalTime * 1e3 / frameCount, "ms", false);
+                }
+
+                SetGlyphRunCacheSize(host, glyphRunCacheSize);
+            }
+
+            void RunCJKGlyphCacheBenchmark(Host& host, Results& results, const Options& options)
+            {
+                if(!host.HasFonts())
+                {
+                    fprintf(stderr, "cjk_glyph_cache: skipped, no fonts (see --fonts)\n");
+                    return;
+                }
+
+                static const char8_t kHtml[] = "<html><body style='margin:4px;font-size:20px'><div id='t'></div></body></html>";
+                if(!host.LoadHtml(kHtml, sizeof(kHtml) - 1, kTextPageUrl))
+                    return;
+
+                char8_t script[320];
+                const uint32_t frameCount = kCJKFramesPerIteration * options.mIterations;
+                eastl::vector<double> frameTimes;
+
+                GlyphCacheUsageInfo startUsage;
+                host.GetLib()->GetGlyphCacheUsage(startUsage);
+
+                for(uint32_t frame = 0; frame < frameCount; ++frame)
+                {
+                    snprintf(script, sizeof(script), "(function(s){var a=[];for(var i=0;i<%u;++i)a.push(String.fromCharCode(0x4E00+((s+i)%%%u)));"
+                                                     "document.getElementById('t').textContent=a.join('');return 0;})(%u)",
+                                                     kCJKRunLength, kCJKCharacterCount, frame * kCJKNewPerFrame);
+                    host.EvaluateNumber(script);
+                    frameTimes.push_back(host.Frame());
+                }
+
+                GlyphCacheUsageInfo endUsage;
+                host.GetLib()->GetGlyphCacheUsage(endUsage);
+
+                const uint32_t hits   = endUsage.mHits - startUsage.mHits;
+                const uint32_t misses = endUsage.mMisses - startUsage.mMisses;
+                if(hits + misses)
+                    results.Add("cjk_glyph_cache", "hit_rate", hits * 100.0 / (hits + misses), "%", true);
+                results.Add("cjk_glyph_cache", "misses_per_frame", (double)misses / frameCount, "glyphs", false);
+                results.Add("cjk_glyph_cache", "evicted_pages_per_frame", (double)(endUsage.mEvictedPages - startUsage.mEvictedPages) / frameCount, "pages", false);
+                results.Add("cjk_glyph_cache", "flushes", (double)(endUsage.mFlushes - startUsage.mFlushes), "flushes", false);
+
+                const double medianTime = Median(frameTimes.data(), (uint32_t)frameTimes.size()); // Sorts frameTimes.
+                results.Add("cjk_glyph_cache", "frame", medianTime * 1e3, "ms", false);
+                results.Add("cjk_glyph_cache", "frame_p99", frameTimes[(frameTimes.size() * 99) / 100] * 1e3, "ms", false);
+                results.Add("cjk_glyph_cache", "frame_max", frameTimes.back() * 1e3, "ms", false);
+            }
+        }
+    }
+}
@@ -0,0 +1,318 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// ThreadSystemBenchmark.cpp
+//
+// Maintained by EAWebKit Team
+//
+// Measures the thread system the library runs with (the native one, see
+// Host::Init): mutexes with and without contention and the round trip of a
+// condition between two threads. Then the EAWebKit thread pool that runs the
+// parallel work on it: the cost per work item of a batch scheduled and waited
+// on, the time until each item starts (its latency under contention), and the
+// speedup of a batch of small jobs over running them on the calling thread.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "Benchmark.h"
+#include "BenchmarkHost.h"
+#include "BenchmarkResults.h"
+#include <EAWebKit/EAWebKitThreadInterface.h>
+#include <EASTL/vector.h>
+#include <stdio.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            namespace
+            {
+                const uint32_t kMaxThreadCount          = 8;
+                const uint32_t kMutexOpsPerThread       = 200000;
+                const uint32_t kRoundTripCount          = 10000;
+
+                struct MutexContext
+                {
+                    IMutex*             mpMutex;
+                    volatile uint32_t*  mpCounter;
+                };
+
+                void* MutexThread(void* pContext)
+                {
+                    MutexContext* pMutexContext = static_cast<MutexContext*>(pContext);
+                    for(uint32_t i = 0; i < kMutexOpsPerThread; ++i)
+                    {
+                        pMutexContext->mpMutex->Lock();
+                        ++*pMutexContext->mpCounter;
+                        pMutexContext->mpMutex->Unlock();
+                    }
+                    return NULL;
+                }
+
+                struct PingPongContext
+                {
+                    IMutex*             mpMutex;
+                    IThreadCondition*   mpCondition;
+                    uint32_t            mTurn;      // Protected by mpMutex. Odd when it is the other thread's turn.
+                };
+
+                void* PongThread(void* pContext)
+                {
+                    PingPongContext* pPingPong = static_cast<PingPongContext*>(pContext);
+                    pPingPong->mpMutex->Lock();
+                    for(uint32_t i = 0; i < kRoundTripCount; ++i)
+                    {
+                        while(!(pPingPong->mTurn & 1))
+                            pPingPong->mpCondition->Wait(pPingPong->mpMutex);
+                        ++pPingPong->mTurn;
+                        pPingPong->mpCondition->Signal(false);
+                    }
+                    pPingPong->mpMutex->Unlock();
+                    return NULL;
+                }
+
+                struct PoolWork
+                {
+                    double              mScheduleTime;  // When the batch was handed to the pool.
+                    double              mStartTime;     // When this item started to run.
+                    uint32_t            mIterations;    // Of the compute loop. 0 for no work.
+                    volatile uint32_t   mResult;
+                };
+
+                void DoPoolWork(void* pContext)
+                {
+                    PoolWork* pWork = static_cast<PoolWork*>(pContext);
+                    pWork->mStartTime = Host::Now();
+
+                    uint32_t value = (uint32_t)(uintptr_t)pContext;
+                    for(uint32_t i = 0; i < pWork->mIterations; ++i)
+                        value = (value ^ (value >> 15)) * 0x2c1b3c6d + i;
+                    pWork->mResult = value;
+                }
+
+                // Starts a thread per context and returns the time until the last one ended. 0 if a thread could not start.
+                double RunThreads(IThreadSystem* pThreadSystem, ThreadFunc function, void** pContexts, uint32_t threadCount)
+                {
+                    IThread* threads[kMaxThreadCount];
+                    uint32_t startedCount = 0;
+
+                    const double startTime = Host::Now();
+                    for(uint32_t i = 0; i < threadCount; ++i)
+                    {
+                        threads[i] = pThreadSystem->CreateAThread();
+                        if(threads[i] && (threads[i]->Begin(function, pContexts[i]) != kThreadIdInvalid))
+                            ++startedCount;
+                        else if(threads[i])
+                        {
+                            pThreadSystem->DestroyAThread(threads[i]);
+                            break;
+                        }
+                        else
+                            break;
+                    }
+                    for(uint32_t i = 0; i < startedCount; ++i)
+                    {
+                        intptr_t result = 0;
+                        threads[i]->WaitForEnd(&result);
+                        pThreadSystem->DestroyAThread(threads[i]);
+                    }
+                    const double elapsedTime = Host::Now() - startTime;
+
+                    return (startedCount == threadCount) ? elapsedTime : 0.0;
+                }
+
+                void MeasureMutex(IThreadSystem* pThreadSystem, Results& results)
+                {
+                    IMutex* pMutex = pThreadSystem->CreateAMutex();
+                    volatile uint32_t counter = 0;
+
+                    double startTime = Host::Now();
+                    for(uint32_t i = 0; i < kMutexOpsPerThread; ++i)
+                    {
+                        pMutex->Lock();
+                        ++counter;
+                        pMutex->Unlock();
+                    }
+                    results.Add("thread_system", "mutex_uncontended", (Host::Now() - startTime) * 1e9 / kMutexOpsPerThread, "ns/lock", false);
+
+                    static const uint32_t kThreadCounts[] = { 2, 4, 8 };
+                    for(size_t t = 0; t < sizeof(kThreadCounts) / sizeof(kThreadCounts[0]); ++t)
+                    {
+                        const uint32_t threadCount = kThreadCounts[t];
+                        MutexContext contexts[kMaxThreadCount];
+                        void* pContexts[kMaxThreadCount];
+                        for(uint32_t i = 0; i < threadCount; ++i)
+                        {
+                            contexts[i].mpMutex   = pMutex;
+                            contexts[i].mpCounter = &counter;
+                            pContexts[i] = &contexts[i];
+                        }
+
+                        const double elapsedTime = RunThreads(pThreadSystem, MutexThread, pContexts, threadCount);
+                        if(elapsedTime > 0.0)
+                        {
+                            char8_t name[64];
+                            snprintf(name, sizeof(name), "mutex_contended_%u_threads", threadCount);
+                            results.Add("thread_system", name, (threadCount * kMutexOpsPerThread) / elapsedTime / 1e6, "Mlocks/s", true);
+                        }
+                    }
+
+                    pThreadSystem->DestroyAMutex(pMutex);
+                }
+
+                void MeasureCondition(IThreadSystem* pThreadSystem, Results& results)
+                {
+                    PingPongContext pingPong;
+                    pingPong.mpMutex     = pThreadSystem->CreateAMutex();
+                    pingPong.mpCondition = pThreadSystem->CreateAThreadCondition();
+                    pingPong.mTurn       = 0;
+
+                    IThread* pThread = pThreadSystem->CreateAThread();
+                    if(pThread && (pThread->Begin(PongThread, &pingPong) != kThreadIdInvalid))
+                    {
+                        const double startTime = Host::Now();
+                        pingPong.mpMutex->Lock();
+                        for(uint32_t i = 0; i < kRoundTripCount; ++i)
+                        {
+                            ++pingPong.mTurn;
+                            pingPong.mpCondition->Signal(false);
+                            while(pingPong.mTurn & 1)
+                                pingPong.mpCondition->Wait(pingPong.mpMutex);
+                        }
+                        pingPong.mpMutex->Unlock();
+                        const double elapsedTime = Host::Now() - startTime;
+
+                        intptr_t result = 0;
+                        pThread->WaitForEnd(&result);
+                        results.Add("thread_system", "condition_round_trip", elapsedTime * 1e6 / kRoundTripCount, "us", false);
+                    }
+                    else
+                        fprintf(stderr, "thread_system: the thread system can't create threads\n");
+
+                    if(pThread)
+                        pThreadSystem->DestroyAThread(pThread);
+                    pThreadSystem->DestroyAThreadCondition(pingPong.mpCondition);
+                    pThreadSystem->DestroyAMutex(pingPong.mpMutex);
+                }
+
+                // Runs a batch of workCount items on the pool and returns the time until the last one ended.
+                double RunPoolBatch(Host& host, PoolWork* pWork, void** pContexts, uint32_t workCount)
+                {
+                    const double startTime = Host::Now();
+                    for(uint32_t i = 0; i < workCount; ++i)
+                        pWork[i].mScheduleTime = startTime;
+                    host.GetLib()->RunThreadPoolWork(DoPoolWork, pContexts, workCount);
+                    return Host::Now() - startTime;
+                }
+
+                void MeasureThreadPool(Host& host, Results& results, const Options& options)
+                {
+                    const uint32_t kMaxBatchSize = 4096;
+                    eastl::vector<PoolWork> work(kMaxBatchSize);
+                    eastl::vector<void*>    contexts(kMaxBatchSize);
+                    for(uint32_t i = 0; i < kMaxBatchSize; ++i)
+                        contexts[i] = &work[i];
+
+                    const uint32_t workerCount = host.GetLib()->GetThreadPoolWorkerCount();
+                    results.Add("thread_system", "pool_workers", workerCount, "threads", true);
+                    if(!workerCount)
+                        fprintf(stderr, "thread_system: the thread pool runs the work on the calling thread\n");
+
+                    // Empty items: what the pool costs per item, scheduling, stealing and the wait included.
+                    static const uint32_t kBatchSizes[] = { 16, 256, kMaxBatchSize };
+                    for(size_t s = 0; s < sizeof(kBatchSizes) / sizeof(kBatchSizes[0]); ++s)
+                    {
+                        const uint32_t batchSize = kBatchSizes[s];
+                        for(uint32_t i = 0; i < batchSize; ++i)
+                            work[i].mIterations = 0;
+
+                        const uint32_t batchCount = options.mIterations * (kMaxBatchSize / batchSize);
+                        eastl::vector<double> batchTimes;
+                        eastl::vector<double> latencies;
+                        for(uint32_t b = 0; b < batchCount; ++b)
+                        {
+                            batchTimes.push_back(RunPoolBatch(host, work.data(), contexts.data(), batchSize));
+                            for(uint32_t i = 0; i < batchSize; ++i)
+                                latencies.push_back(work[i].mStartTime - work[i].mScheduleTime);
+                        }
+
+                        const double medianTime    = Median(batchTimes.data(), (uint32_t)batchTimes.size());
+                        const double medianLatency = Median(latencies.data(), (uint32_t)latencies.size()); // Sorts latencies.
+                        const double p99Latency    = latencies[(latencies.size() * 99) / 100];
+
+                        char8_t name[64];
+                        snprintf(name, sizeof(name), "pool_batch_%u", batchSize);
+                        results.Add("thread_system", name, medianTime * 1e9 / batchSize, "ns/item", false);
+                        snprintf(name, sizeof(name), "pool_batch_%u_start_median", batchSize);
+                        results.Add("thread_system", name, medianLatency * 1e6, "us", false);
+                        snprintf(name, sizeof(name), "pool_batch_%u_start_p99", batchSize);
+                        results.Add("thread_system", name, p99Latency * 1e6, "us", false);
+                    }
+
+                    // Small jobs of about ten microseconds each, the size of a few glyphs or a small image band.
+                    const uint32_t kComputeBatchSize  = 256;
+                    const uint32_t kComputeIterations = 5000;
+                    for(uint32_t i = 0; i < kComputeBatchSize; ++i)
+                        work[i].mIterations = kComputeIterations;
+
+                    eastl::vector<double> serialTimes;
+                    eastl::vector<double> poolTimes;
+                    for(uint32_t n = 0; n < options.mIterations; ++n)
+                    {
+                        const double startTime = Host::Now();
+                        for(uint32_t i = 0; i < kComputeBatchSize; ++i)
+                            DoPoolWork(contexts[i]);
+                        serialTimes.push_back(Host::Now() - startTime);
+                        poolTimes.push_back(RunPoolBatch(host, work.data(), contexts.data(), kComputeBatchSize));
+                    }
+
+                    const double serialTime = Median(serialTimes.data(), (uint32_t)serialTimes.size());
+                    const double poolTime   = Median(poolTimes.data(), (uint32_t)poolTimes.size());
+                    results.Add("thread_system", "pool_compute", poolTime * 1e3, "ms", false);
+                    if(poolTime > 0.0)
+                        results.Add("thread_system", "pool_compute_speedup", serialTime / poolTime, "x", true);
+                }
+            }
+
+            void RunThreadSystemBenchmark(Host& host, Results& results, const Options& options)
+            {
+                IThreadSystem* pThreadSystem = host.GetLib()->GetThreadSystem();
+                if(!pThreadSystem)
+                    return;
+
+                MeasureMutex(pThreadSystem, results);
+                MeasureCondition(pThreadSystem, results);
+                MeasureThreadPool(host, results, options);
+            }
+        }
+    }
+}
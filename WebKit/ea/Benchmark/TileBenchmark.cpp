@@ -0,0 +1,230 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// TileBenchmark.cpp
+//
+// Maintained by EAWebKit Team
+//
+// Scrolls a tall page with the tiled backing store, which the library only
+// uses with a hardware renderer. The renderer here keeps its surfaces in
+// memory and composites nothing, so the frame time is the tile paint and the
+// layer sync around it. The view is replaced by a tiled one for the suite and
+// by a software one again at the end.
+//
+// tile_scroll reports the frame time median, p99 and max, the time of
+// kVProcessTypePaintTilesCPU per frame, and the surfaces the renderer had to
+// create while scrolling, which the tile surface pool should keep near 0. It
+// runs with the default settings, with mEnableParallelTilePainting, and with
+// TileParameters::mPrefetchTiles off.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "Benchmark.h"
+#include "BenchmarkHost.h"
+#include "BenchmarkResults.h"
+#include <EAWebKit/EAWebKitHardwareRenderer.h>
+#include <EAWebKit/EAWebKitSurface.h>
+#include <EASTL/string.h>
+#include <EASTL/vector.h>
+#include <stdio.h>
+#include <string.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            namespace
+            {
+                const uint32_t kScrollFramesPerIteration    = 120;
+                const uint32_t kScrollStep                  = 48;   // Pixels per frame, a fast flick.
+                const uint32_t kSectionCount                = 160;
+                const int      kBytesPerPixel               = 4;
+                const char8_t  kTilePageUrl[]               = "http://www.bench.test/tiles.html";
+
+                class MemorySurface : public ISurface
+                {
+                public:
+                    MemorySurface() : mpData(NULL) { }
+
+                    virtual void Lock(SurfaceDescriptor* pSDOut, const IntRect* rect)
+                    {
+                        pSDOut->mStride = (int)mStride;
+                        pSDOut->mData   = rect ? mpData + (rect->mLocation.mX * kBytesPerPixel) + (rect->mLocation.mY * mStride) : mpData;
+                    }
+
+                    virtual void Unlock() { }
+
+                    virtual void Release()
+                    {
+                        delete[] mpData;
+                        delete this;
+                    }
+
+                    virtual bool IsAllocated() const { return mpData != NULL; }
+                    virtual void Reset() { memset(mpData, 0, mContentHeight * mStride); }
+
+                private:
+                    virtual void AllocateSurface(int width, int height)
+                    {
+                        delete[] mpData;
+                        mStride = width * kBytesPerPixel;
+                        mpData  = new uint8_t[height * mStride];
+                    }
+
+                    uint8_t* mpData;
+                };
+
+                // Hands out memory surfaces and counts them. Rendering and clipping do nothing.
+                class MemoryRenderer : public IHardwareRenderer
+                {
+                public:
+                    MemoryRenderer() : mCreatedSurfaceCount(0) { }
+
+                    virtual ISurface* CreateSurface()
+                    {
+                        ++mCreatedSurfaceCount;
+                        return new MemorySurface;
+                    }
+
+                    virtual void SetRenderTarget(ISurface* /*target*/) { }
+                    virtual void RenderSurface(ISurface* /*surface*/, FloatRect& /*target*/, TransformationMatrix& /*matrix*/, float /*opacity*/, ISurface* /*mask*/) { }
+                    virtual void BeginClip(TransformationMatrix& /*matrix*/, FloatRect& /*target*/) { }
+                    virtual void EndClip() { }
+
+                    uint32_t GetCreatedSurfaceCount() const { return mCreatedSurfaceCount; }
+
+                private:
+                    uint32_t mCreatedSurfaceCount;
+                };
+
+                // Sections of boxes, borders, gradients and, with fonts, text, so that every tile has something to paint.
+                void BuildTilePage(eastl::string& html)
+                {
+                    html = "<html><body style='margin:0;background:#f4f4f4'>";
+                    for(uint32_t s = 0; s < kSectionCount; ++s)
+                    {
+                        html.append_sprintf("<div style='margin:8px 16px;height:112px;border:2px solid #%06x;border-radius:6px;"
+                                            "background:-webkit-linear-gradient(left, #%06x, #ffffff)'>",
+                                            (s * 0x2f1b07) & 0xffffff, (s * 0x0b3d91) & 0xffffff);
+                        for(uint32_t b = 0; b < 6; ++b)
+                            html.append_sprintf("<div style='float:left;width:96px;height:64px;margin:8px;background:#%06x'></div>", ((s + b) * 0x1d5f3b) & 0xffffff);
+                        html.append_sprintf("<p style='clear:left;margin:0 8px;font-size:14px'>Section %u: the quick brown fox jumps over the lazy dog.</p></div>", s);
+                    }
+                    html += "</body></html>";
+                }
+            }
+
+            void RunTileScrollBenchmark(Host& host, Results& results, const Options& options)
+            {
+                struct Pass
+                {
+                    const char8_t*  mpSuffix;
+                    bool            mbParallel;
+                    bool            mbPrefetch;
+                };
+                static const Pass kPasses[] =
+                {
+                    { "",               false,  true  },
+                    { "_parallel",      true,   true  },
+                    { "_no_prefetch",   false,  false }
+                };
+
+                const IntSize viewSize = host.GetView()->GetSize();
+                const uint32_t frameCount = kScrollFramesPerIteration * options.mIterations;
+
+                Parameters& parameters = host.GetLib()->GetParameters();
+                const bool bParallelTilePainting = parameters.mEnableParallelTilePainting;
+
+                eastl::string html;
+                BuildTilePage(html);
+
+                MemoryRenderer renderer;
+                char8_t script[128];
+                char8_t name[64];
+
+                for(size_t p = 0; p < sizeof(kPasses) / sizeof(kPasses[0]); ++p)
+                {
+                    const Pass& pass = kPasses[p];
+                    parameters.mEnableParallelTilePainting = pass.mbParallel;
+                    host.GetLib()->SetParameters(parameters);
+
+                    ViewParameters viewParameters;
+                    viewParameters.mWidth               = viewSize.mWidth;
+                    viewParameters.mHeight              = viewSize.mHeight;
+                    viewParameters.mHardwareRenderer    = &renderer;
+                    if(!host.ResetView(viewParameters))
+                        break;
+
+                    TileParameters tileParameters;
+                    tileParameters.mPrefetchTiles = pass.mbPrefetch;
+                    host.GetView()->SetTileParameters(tileParameters);
+                    if(!host.LoadHtml(html.data(), html.size(), kTilePageUrl))
+                        break;
+
+                    const uint32_t startSurfaceCount = renderer.GetCreatedSurfaceCount();
+                    eastl::vector<double> frameTimes;
+                    host.ResetProcessStats();
+                    for(uint32_t frame = 0; frame < frameCount; ++frame)
+                    {
+                        snprintf(script, sizeof(script), "window.scrollTo(0, (%u * %u) %% (document.body.scrollHeight - window.innerHeight)); 0", frame, kScrollStep);
+                        host.EvaluateNumber(script);
+                        frameTimes.push_back(host.Frame());
+                    }
+
+                    const ProcessStats& tileStats = host.GetProcessStats(kVProcessTypePaintTilesCPU);
+                    snprintf(name, sizeof(name), "paint_tiles_per_frame%s", pass.mpSuffix);
+                    results.Add("tile_scroll", name, tileStats.mTotalTime * 1e3 / frameCount, "ms", false);
+                    snprintf(name, sizeof(name), "surfaces_created%s", pass.mpSuffix);
+                    results.Add("tile_scroll", name, (double)(renderer.GetCreatedSurfaceCount() - startSurfaceCount), "surfaces", false);
+
+                    const double medianTime = Median(frameTimes.data(), (uint32_t)frameTimes.size()); // Sorts frameTimes.
+                    snprintf(name, sizeof(name), "frame%s", pass.mpSuffix);
+                    results.Add("tile_scroll", name, medianTime * 1e3, "ms", false);
+                    snprintf(name, sizeof(name), "frame_p99%s", pass.mpSuffix);
+                    results.Add("tile_scroll", name, frameTimes[(frameTimes.size() * 99) / 100] * 1e3, "ms", false);
+                    snprintf(name, sizeof(name), "frame_max%s", pass.mpSuffix);
+                    results.Add("tile_scroll", name, frameTimes.back() * 1e3, "ms", false);
+                }
+
+                parameters.mEnableParallelTilePainting = bParallelTilePainting;
+                host.GetLib()->SetParameters(parameters);
+
+                // The renderer goes away with this function, so the tiled view has to go first.
+                ViewParameters viewParameters;
+                viewParameters.mWidth  = viewSize.mWidth;
+                viewParameters.mHeight = viewSize.mHeight;
+                if(!host.ResetView(viewParameters))
+                    fprintf(stderr, "tile_scroll: could not restore the software view\n");
+            }
+        }
+    }
+}
@@ -0,0 +1,204 @@
+/*
+Copyright (C) 2013 Electronic Arts, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+3.  Neither the name of Electronic Arts, Inc. ("EA") nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY ELECTRONIC ARTS AND ITS CONTRIBUTORS "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL ELECTRONIC ARTS OR ITS CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+// TransportJobBenchmark.cpp
+//
+// Maintained by EAWebKit Team
+//
+// The cost of running many transport jobs at once in the ResourceHandleManager
+// job loop, without the cost of a real transport. The pages are generated:
+// each has kJobsPerConcurrentJob images per allowed concurrent job, under the
+// benchjob scheme, which a loopback TransportHandler of the suite serves from
+// memory. Each of its jobs stays in the transfer state for a number of job
+// loop ticks, so that the job loop holds up to mMaxTransportJobs jobs with a
+// few of them completing and being removed on every tick.
+//
+// transport_jobs loads the pages with each of kConcurrentJobCounts as
+// Parameters::mMaxTransportJobs, and reports per count the average and worst
+// time of a pass of the job loop (kVProcessTypeTHJobs), and the job loop time
+// per job.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "Benchmark.h"
+#include "BenchmarkHost.h"
+#include "BenchmarkResults.h"
+#include <EAWebKit/EAWebKitTransport.h>
+#include <EASTL/string.h>
+#include <stdio.h>
+
+
+namespace EA
+{
+    namespace WebKit
+    {
+        namespace Benchmark
+        {
+            namespace
+            {
+                const uint32_t kConcurrentJobCounts[]   = { 16, 1000 };
+                const uint32_t kJobsPerConcurrentJob    = 4;
+                const uint32_t kMinTransferTicks        = 10;   // Job loop ticks a job spends in the transfer state, at least.
+                const uint32_t kTransferTickSpread      = 30;
+
+                // A 1x1 RGB PNG.
+                const uint8_t kPng[] =
+                {
+                    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+                    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x08, 0x02, 0x00, 0x00, 0x00, 0x90, 0x77, 0x53,
+                    0xde, 0x00, 0x00, 0x00, 0x0c, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9c, 0x63, 0x68, 0x98, 0xb0, 0x00,
+                    0x00, 0x03, 0x44, 0x01, 0xb1, 0x7a, 0xd7, 0x36, 0x14, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e,
+                    0x44, 0xae, 0x42, 0x60, 0x82
+                };
+
+                // Serves every request with kPng after a number of Transfer calls. mTransportHandlerData holds the calls left.
+                class LoopbackTransportHandler : public TransportHandler
+                {
+                public:
+                    LoopbackTransportHandler() : mStartedJobCount(0), mCompletedJobCount(0) { }
+
+                    bool InitJob(TransportInfo* pTInfo, bool& bStateComplete)
+                    {
+                        // Spread the completions so that a few jobs are removed on each tick.
+                        pTInfo->mTransportHandlerData = kMinTransferTicks + ((mStartedJobCount++ * 7) % kTransferTickSpread);
+                        bStateComplete = true;
+                        return true;
+                    }
+
+                    bool Transfer(TransportInfo* pTInfo, bool& bStateComplete)
+                    {
+                        if(--pTInfo->mTransportHandlerData)
+                        {
+                            bStateComplete = false;
+                            return true;
+                        }
+
+                        TransportServer* pServer = pTInfo->mpTransportServer;
+                        pServer->SetMimeType(pTInfo, "image/png");
+                        pServer->SetExpectedLength(pTInfo, sizeof(kPng));
+                        pServer->DataReceived(pTInfo, kPng, sizeof(kPng));
+                        pTInfo->mResultCode = 200;
+                        pServer->DataDone(pTInfo, true);
+
+                        ++mCompletedJobCount;
+                        bStateComplete = true;
+                        return true;
+                    }
+
+                    uint32_t GetCompletedJobCount() const { return mCompletedJobCount; }
+
+                private:
+                    uint32_t mStartedJobCount;
+                    uint32_t mCompletedJobCount;
+                };
+
+                struct RunningJobSampler
+                {
+                    EAWebKitLib*    mpLib;
+                    uint32_t        mMaxRunningJobs;
+
+                    static void Sample(void* pContext)
+                    {
+                        RunningJobSampler* pSampler = static_cast<RunningJobSampler*>(pContext);
+                        TransportJobQueueInfo queueInfo;
+                        pSampler->mpLib->GetTransportJobQueueInfo(queueInfo);
+                        if(queueInfo.mRunningJobs > pSampler->mMaxRunningJobs)
+                            pSampler->mMaxRunningJobs = queueInfo.mRunningJobs;
+                    }
+                };
+            }
+
+            void RunTransportJobBenchmark(Host& host, Results& results, const Options& options)
+            {
+                EAWebKitLib* pLib = host.GetLib();
+                LoopbackTransportHandler handler;
+                pLib->AddTransportHandler(&handler, EA_CHAR16("benchjob"));
+
+                Parameters& parameters = pLib->GetParameters();
+                const uint32_t maxTransportJobs        = parameters.mMaxTransportJobs;
+                const uint32_t maxTransportJobsPerHost = parameters.mMaxTransportJobsPerHost;
+
+                RunningJobSampler sampler;
+                sampler.mpLib = pLib;
+                host.SetFrameCallback(RunningJobSampler::Sample, &sampler);
+
+                eastl::string html;
+                uint32_t loadNumber = 0;
+                char8_t name[64];
+
+                for(size_t c = 0; c < sizeof(kConcurrentJobCounts) / sizeof(kConcurrentJobCounts[0]); ++c)
+                {
+                    const uint32_t concurrentJobCount = kConcurrentJobCounts[c];
+                    parameters.mMaxTransportJobs        = concurrentJobCount;
+                    parameters.mMaxTransportJobsPerHost = 0;
+                    pLib->SetParameters(parameters);
+
+                    sampler.mMaxRunningJobs = 0;
+                    host.ResetProcessStats();
+                    const uint32_t completedJobCount = handler.GetCompletedJobCount();
+
+                    bool bLoaded = true;
+                    for(uint32_t i = 0; (i < options.mIterations) && bLoaded; ++i)
+                    {
+                        // New URLs on each load, so that the images don't come from the memory cache.
+                        ++loadNumber;
+                        html = "<html><body>";
+                        for(uint32_t j = 0; j < concurrentJobCount * kJobsPerConcurrentJob; ++j)
+                            html.append_sprintf("<img src='benchjob://bench.test/%u/%u.png' width='1' height='1'>", loadNumber, j);
+                        html += "</body></html>";
+
+                        bLoaded = host.LoadHtml(html.data(), html.size(), "http://www.bench.test/", 60.0);
+                        if(!bLoaded)
+                            fprintf(stderr, "transport_jobs: a page of %u jobs failed to load\n", concurrentJobCount * kJobsPerConcurrentJob);
+                    }
+
+                    const ProcessStats& stats = host.GetProcessStats(kVProcessTypeTHJobs);
+                    const uint32_t jobCount = handler.GetCompletedJobCount() - completedJobCount;
+                    if(!bLoaded || !stats.mCount || !jobCount)
+                        continue;
+                    if(sampler.mMaxRunningJobs < concurrentJobCount)
+                        fprintf(stderr, "transport_jobs: at most %u of %u jobs ran at once\n", sampler.mMaxRunningJobs, concurrentJobCount);
+
+                    snprintf(name, sizeof(name), "tick_%u", concurrentJobCount);
+                    results.Add("transport_jobs", name, stats.mTotalTime * 1e6 / stats.mCount, "us", false);
+                    snprintf(name, sizeof(name), "tick_%u_max", concurrentJobCount);
+                    results.Add("transport_jobs", name, stats.mMaxTime * 1e6, "us", false);
+                    snprintf(name, sizeof(name), "job_%u", concurrentJobCount);
+                    results.Add("transport_jobs", name, stats.mTotalTime * 1e6 / jobCount, "us", false);
+                }
+
+                host.SetFrameCallback(NULL, NULL);
+                parameters.mMaxTransportJobs        = maxTransportJobs;
+                parameters.mMaxTransportJobsPerHost = maxTransportJobsPerHost;
+                pLib->SetParameters(parameters);
+                pLib->RemoveTransportHandler(&handler, EA_CHAR16("benchjob"));
+            }
+        }
+    }
+}